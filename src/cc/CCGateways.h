@@ -18,6 +18,7 @@
 #define CC_GATEWAYS_H
 
 #include "CCinclude.h"
+#include "CCindex.h"
 #include "../merkleblock.h"
 
 bool GatewaysValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
@@ -31,9 +32,90 @@ std::string GatewaysMarkDone(uint64_t txfee,uint256 withdrawtxid,std::string ref
 UniValue GatewaysPendingDeposits(uint256 bindtxid,std::string refcoin);
 UniValue GatewaysPendingWithdraws(uint256 bindtxid,std::string refcoin);
 UniValue GatewaysProcessedWithdraws(uint256 bindtxid,std::string refcoin);
+uint8_t DecodeGatewaysOpRet(const CScript &scriptPubKey);
+CScript EncodeGatewaysDepositOpRet(uint8_t funcid,uint256 bindtxid,std::string refcoin,std::vector<CPubKey> publishers,std::vector<uint256>txids,int32_t height,uint256 cointxid,int32_t claimvout,std::string deposithex,std::vector<uint8_t>proof,CPubKey destpub,int64_t amount);
+uint8_t DecodeGatewaysDepositOpRet(const CScript &scriptPubKey,uint256 &bindtxid,std::string &refcoin,std::vector<CPubKey>&publishers,std::vector<uint256>&txids,int32_t &height,uint256 &cointxid, int32_t &claimvout,std::string &deposithex,std::vector<uint8_t> &proof,CPubKey &destpub,int64_t &amount);
+CScript EncodeGatewaysWithdrawOpRet(uint8_t funcid,uint256 tokenid,uint256 bindtxid,std::string refcoin,CPubKey withdrawpub,int64_t amount);
+uint8_t DecodeGatewaysWithdrawOpRet(const CScript &scriptPubKey, uint256& tokenid, uint256 &bindtxid, std::string &refcoin, CPubKey &withdrawpub, int64_t &amount);
+CScript EncodeGatewaysPartialOpRet(uint8_t funcid, uint256 withdrawtxid,std::string refcoin,uint8_t K, CPubKey signerpk,std::string hex);
+uint8_t DecodeGatewaysPartialOpRet(const CScript &scriptPubKey,uint256 &withdrawtxid,std::string &refcoin,uint8_t &K,CPubKey &signerpk,std::string &hex);
+CScript EncodeGatewaysCompleteSigningOpRet(uint8_t funcid,uint256 withdrawtxid,std::string refcoin,uint8_t K,std::string hex);
+uint8_t DecodeGatewaysCompleteSigningOpRet(const CScript &scriptPubKey,uint256 &withdrawtxid,std::string &refcoin,uint8_t &K,std::string &hex);
+CScript EncodeGatewaysMarkDoneOpRet(uint8_t funcid,uint256 withdrawtxid,std::string refcoin,uint256 completetxid);
 
 // CCcustom
 UniValue GatewaysInfo(uint256 bindtxid);
 UniValue GatewaysList();
 
+// CCgatewaysindex
+/** A deposit whose marker is not yet spent by its claim */
+struct CGatewaysDeposit
+{
+    uint256 deposittxid;
+    uint256 bindtxid;
+    std::string coin;
+    uint256 cointxid;
+    int32_t claimvout;
+    CPubKey destpub;
+    int64_t amount;
+    std::string markeraddr;             // where the marker vout went
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(deposittxid);
+        READWRITE(bindtxid);
+        READWRITE(coin);
+        READWRITE(cointxid);
+        READWRITE(claimvout);
+        READWRITE(destpub);
+        READWRITE(amount);
+        READWRITE(markeraddr);
+    }
+
+    CGatewaysDeposit() : claimvout(0), amount(0) {}
+};
+
+/** A withdraw not yet marked done, at its latest marker */
+struct CGatewaysWithdraw
+{
+    uint256 withdrawtxid;
+    uint256 bindtxid;
+    uint256 tokenid;
+    std::string coin;
+    CPubKey withdrawpub;
+    int64_t amount;
+    uint256 lasttxid;                   // the withdraw, partialsign or completesigning tx holding the marker
+    uint8_t K;                          // number of signs so far
+    std::string hex;
+    bool fComplete;                     // whether lasttxid is the completesigning tx
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(withdrawtxid);
+        READWRITE(bindtxid);
+        READWRITE(tokenid);
+        READWRITE(coin);
+        READWRITE(withdrawpub);
+        READWRITE(amount);
+        READWRITE(lasttxid);
+        READWRITE(K);
+        READWRITE(hex);
+        READWRITE(fComplete);
+    }
+
+    CGatewaysWithdraw() : amount(0), K(0), fComplete(false) {}
+};
+
+CCIndex *GatewaysIndex();
+//! The confirmed deposits of a gateway that are not claimed yet. False if the index is not in use.
+bool GetGatewaysDeposits(uint256 bindtxid, std::vector<CGatewaysDeposit> &deposits);
+//! The confirmed withdraws of a gateway that are pending or processed but not marked done
+bool GetGatewaysWithdraws(uint256 bindtxid, std::vector<CGatewaysWithdraw> &withdraws);
+//! The confirmed deposit of an external coin tx, if any
+bool GetGatewaysCointxidDeposit(uint256 cointxid, uint256 &deposittxid, bool &fFound);
+
 #endif
@@ -18,16 +18,53 @@
 #define CC_ORACLES_H
 
 #include "CCinclude.h"
+#include "CCindex.h"
 
 bool OraclesValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
 std::string OracleCreate(int64_t txfee,std::string name,std::string description,std::string format);
 std::string OracleRegister(int64_t txfee,uint256 oracletxid,int64_t datafee);
 std::string OracleSubscribe(int64_t txfee,uint256 oracletxid,CPubKey publisher,int64_t amount);
 std::string OracleData(int64_t txfee,uint256 oracletxid,std::vector <uint8_t> data);
+CScript EncodeOraclesData(uint8_t funcid,uint256 oracletxid,uint256 batontxid,CPubKey pk,std::vector <uint8_t>data);
 
 // CCcustom
 UniValue OracleDataSamples(uint256 reforacletxid,uint256 batontxid,int32_t num);
 UniValue OracleInfo(uint256 origtxid);
 UniValue OraclesList();
+int64_t OracleCorrelatedPrice(int32_t height,std::vector <int64_t> origprices);
+
+// CCoraclesindex
+/** A data point of a publisher */
+struct COracleSample
+{
+    uint256 txid;
+    uint256 batontxid;                  // the previous data tx of the publisher
+    int32_t nHeight;
+    std::vector<uint8_t> data;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(batontxid);
+        READWRITE(nHeight);
+        READWRITE(data);
+    }
+
+    COracleSample() : nHeight(0) {}
+};
+
+CCIndex *OracleIndex();
+//! Confirmed samples of publisher with heights from nFromHeight to nToHeight, newest first and at most nMax of them
+//! (all if negative). False if the index is not in use.
+bool GetOracleSamples(uint256 oracletxid, CPubKey publisher, int32_t nFromHeight, int32_t nToHeight, int32_t nMax, std::vector<COracleSample> &samples);
+//! Likewise, the sample of data tx txid and the ones before it, of oracle oracletxid; fFound is false if txid is no
+//! confirmed sample
+bool GetOracleSamplesFrom(uint256 txid, int32_t nMax, uint256 &oracletxid, std::vector<COracleSample> &samples, bool &fFound);
+//! The publishers that sent data to the oracle
+bool GetOraclePublishers(uint256 oracletxid, std::vector<CPubKey> &publishers);
+//! The price the publishers agree on, from their latest samples up to height (the newest if 0)
+bool GetOracleCorrelatedPrice(uint256 oracletxid, int32_t height, int64_t &price);
 
 #endif
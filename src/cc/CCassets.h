@@ -24,6 +24,7 @@
 #define CC_ASSETS_H
 
 #include "CCinclude.h"
+#include "CCindex.h"
 
 // CCcustom
 bool AssetsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
@@ -51,6 +52,7 @@ bool AssetCalcAmounts(struct CCcontract_info *cpAssets, int64_t &inputs, int64_t
 int64_t AddAssetInputs(struct CCcontract_info *cp, CMutableTransaction &mtx, CPubKey pk, uint256 assetid, int64_t total, int32_t maxinputs);
 
 UniValue AssetOrders(uint256 tokenid);
+UniValue AssetOrdersByPubkey(std::vector<uint8_t> pubkey, uint256 tokenid);
 //UniValue AssetInfo(uint256 tokenid);
 //UniValue AssetList();
 //std::string CreateAsset(int64_t txfee,int64_t assetsupply,std::string name,std::string description);
@@ -65,4 +67,49 @@ std::string CreateSwap(int64_t txfee,int64_t askamount,uint256 assetid,uint256 a
 std::string CancelSell(int64_t txfee,uint256 assetid,uint256 asktxid);
 std::string FillSell(int64_t txfee,uint256 assetid,uint256 assetid2,uint256 asktxid,int64_t fillamount);
 
+// CCassetsindex
+/** An open order: vout 0 of a bid ('b' 'B'), ask ('s' 'S') or swap ('e' 'E') at the global assets address */
+struct CAssetOrder
+{
+    uint256 txid;
+    uint8_t funcid;
+    uint256 tokenid;
+    uint256 otherid;                    // swaps: the token asked in exchange
+    int64_t nValue;                     // what is left in the order: coins for bids, tokens otherwise
+    int64_t nPrice;                     // what is asked for all of nValue: tokens for bids, coins (other tokens for swaps) otherwise
+    std::vector<uint8_t> origpubkey;
+    int32_t nHeight;                    // 0 while in the mempool
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(funcid);
+        READWRITE(tokenid);
+        READWRITE(otherid);
+        READWRITE(nValue);
+        READWRITE(nPrice);
+        READWRITE(origpubkey);
+        READWRITE(nHeight);
+    }
+
+    CAssetOrder() : funcid(0), nValue(0), nPrice(0), nHeight(0) {}
+
+    bool IsBid() const { return funcid == 'b' || funcid == 'B'; }
+    bool IsSwap() const { return funcid == 'e' || funcid == 'E'; }
+    //! What is paid per token, scaled by COIN
+    uint64_t GetUnitPrice() const;
+};
+
+bool DecodeAssetOrder(const CTransaction &tx, int32_t nHeight, CAssetOrder &order);
+CCIndex *AssetOrderIndex();
+//! Open orders for tokenid (any token if null), confirmed or not; bids best price first, then asks and swaps
+//! likewise. False if the index is not in use.
+bool GetAssetOrders(uint256 tokenid, std::vector<CAssetOrder> &orders);
+//! Likewise, for the orders placed by pubkey
+bool GetAssetOrdersByPubkey(const std::vector<uint8_t> &pubkey, uint256 tokenid, std::vector<CAssetOrder> &orders);
+//! Find the open order at txid; fOpen is false if there is none. False if the index is not in use.
+bool GetAssetOrder(uint256 txid, CAssetOrder &order, bool &fOpen);
+
 #endif
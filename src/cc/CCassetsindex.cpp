@@ -0,0 +1,324 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ The assets order book. Every open order is kept three times in the ccindex database:
+
+   'o' tokenid side price txid   the price levels of a token: bids from the highest price, asks and swaps from the lowest
+   'O' txid                      the order at an outpoint, to close it when it is spent
+   'p' origpubkey tokenid txid   the orders of a pubkey
+
+ Orders are always vout 0 of their transaction, so the txid names the outpoint.
+ */
+
+#include "CCassets.h"
+
+#include "../txmempool.h"
+
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+static const char DB_ASSET_ORDER = 'o';
+static const char DB_ASSET_ORDER_OUTPOINT = 'O';
+static const char DB_ASSET_ORDER_PUBKEY = 'p';
+
+/** Key of a price level entry. Numbers are big-endian so that LevelDB sorts by them. */
+struct CAssetOrderKey
+{
+    char prefix;
+    uint256 tokenid;
+    char side;
+    uint64_t nSortPrice;
+    uint256 txid;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, prefix);
+        tokenid.Serialize(s);
+        ser_writedata8(s, side);
+        ser_writedata32be(s, nSortPrice >> 32);
+        ser_writedata32be(s, nSortPrice & 0xffffffff);
+        txid.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        prefix = ser_readdata8(s);
+        tokenid.Unserialize(s);
+        side = ser_readdata8(s);
+        nSortPrice = (uint64_t)ser_readdata32be(s) << 32;
+        nSortPrice |= ser_readdata32be(s);
+        txid.Unserialize(s);
+    }
+
+    CAssetOrderKey() : prefix(0), side(0), nSortPrice(0) {}
+    explicit CAssetOrderKey(const CAssetOrder &order) : prefix(DB_ASSET_ORDER), tokenid(order.tokenid), txid(order.txid)
+    {
+        side = order.IsBid() ? 'b' : order.IsSwap() ? 'e' : 's';
+        nSortPrice = order.IsBid() ? ~order.GetUnitPrice() : order.GetUnitPrice();
+    }
+};
+
+static bool CompareAssetOrders(const CAssetOrder &a, const CAssetOrder &b)
+{
+    CAssetOrderKey ka(a), kb(b);
+    return std::make_pair(std::make_pair(ka.tokenid, ka.side), std::make_pair(ka.nSortPrice, ka.txid)) <
+           std::make_pair(std::make_pair(kb.tokenid, kb.side), std::make_pair(kb.nSortPrice, kb.txid));
+}
+
+uint64_t CAssetOrder::GetUnitPrice() const
+{
+    double paid = IsBid() ? nValue : nPrice;
+    double tokens = IsBid() ? nPrice : nValue;
+    if (tokens <= 0 || paid <= 0)
+        return 0;
+    double unit = paid * COIN / tokens;
+    return unit >= (double)std::numeric_limits<uint64_t>::max() ? std::numeric_limits<uint64_t>::max() : (uint64_t)unit;
+}
+
+/** The global assets addresses that hold open orders: coins of bids and tokens of asks */
+static bool IsAssetOrderAddress(const char *destaddr)
+{
+    static struct OrderAddresses {
+        char assets[64], tokens[64];
+        OrderAddresses()
+        {
+            struct CCcontract_info *cpAssets, assetsC;
+            cpAssets = CCinit(&assetsC, EVAL_ASSETS);
+            GetCCaddress(cpAssets, assets, GetUnspendable(cpAssets, NULL));
+            GetTokensCCaddress(cpAssets, tokens, GetUnspendable(cpAssets, NULL));
+        }
+    } addrs;
+    return strcmp(destaddr, addrs.assets) == 0 || strcmp(destaddr, addrs.tokens) == 0;
+}
+
+bool DecodeAssetOrder(const CTransaction &tx, int32_t nHeight, CAssetOrder &order)
+{
+    char destaddr[64];
+    uint8_t evalCode;
+    if (tx.vout.size() < 2 || tx.vout[0].nValue == 0 || !tx.vout[0].scriptPubKey.IsPayToCryptoCondition())
+        return false;
+    if (!Getscriptaddress(destaddr, tx.vout[0].scriptPubKey) || !IsAssetOrderAddress(destaddr))
+        return false;
+    order.funcid = DecodeAssetTokenOpRet(tx.vout.back().scriptPubKey, evalCode, order.tokenid, order.otherid, order.nPrice, order.origpubkey);
+    switch (order.funcid) {
+        case 'b': case 'B': case 's': case 'S': case 'e': case 'E':
+            break;
+        default:
+            return false;
+    }
+    order.txid = tx.GetHash();
+    order.nValue = tx.vout[0].nValue;
+    order.nHeight = nHeight;
+    return true;
+}
+
+class CAssetOrderIndex : public CCIndex
+{
+public:
+    const char *Name() const { return "asset orders"; }
+
+    void ConnectTx(CCIndexBatch &batch, const CTransaction &tx, int nHeight)
+    {
+        if (tx.IsCoinBase())
+            return;
+        BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+            CAssetOrder order;
+            if (txin.prevout.n == 0 && IsCCInput(txin.scriptSig) && batch.Read(std::make_pair(DB_ASSET_ORDER_OUTPOINT, txin.prevout.hash), order))
+                Erase(batch, order);
+        }
+        CAssetOrder order;
+        if (DecodeAssetOrder(tx, nHeight, order))
+            Write(batch, order);
+    }
+
+    bool Build(CCIndexBatch &batch)
+    {
+        struct CCcontract_info *cpAssets, assetsC;
+        cpAssets = CCinit(&assetsC, EVAL_ASSETS);
+        char assetsAddr[64], tokensAddr[64];
+        GetCCaddress(cpAssets, assetsAddr, GetUnspendable(cpAssets, NULL));
+        GetTokensCCaddress(cpAssets, tokensAddr, GetUnspendable(cpAssets, NULL));
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+        SetCCunspents(unspentOutputs, assetsAddr);
+        SetCCunspents(unspentOutputs, tokensAddr);
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+            CTransaction tx;
+            uint256 hashBlock;
+            CAssetOrder order;
+            if (it->first.index == 0 && GetTransaction(it->first.txhash, tx, hashBlock, false) && DecodeAssetOrder(tx, it->second.blockHeight, order))
+                Write(batch, order);
+        }
+        return true;
+    }
+
+    void AddMempoolTx(const CTransaction &tx)
+    {
+        CAssetOrder order;
+        if (DecodeAssetOrder(tx, 0, order)) {
+            LOCK(cs);
+            mapMempoolOrders[order.txid] = order;
+        }
+    }
+
+    void RemoveMempoolTx(const CTransaction &tx)
+    {
+        LOCK(cs);
+        mapMempoolOrders.erase(tx.GetHash());
+    }
+
+    //! Add the orders matching pubkey (any if empty) and tokenid (any if null) placed by the mempool
+    void GetMempoolOrders(const std::vector<uint8_t> &pubkey, const uint256 &tokenid, std::vector<CAssetOrder> &orders)
+    {
+        std::vector<CAssetOrder> vMempoolOrders;
+        {
+            LOCK(cs);
+            for (std::map<uint256, CAssetOrder>::const_iterator it = mapMempoolOrders.begin(); it != mapMempoolOrders.end(); ++it)
+                vMempoolOrders.push_back(it->second);
+        }
+        // mempool.cs is not taken under cs
+        std::vector<uint256> vGone;
+        BOOST_FOREACH(const CAssetOrder &order, vMempoolOrders) {
+            if (!mempool.exists(order.txid))
+                vGone.push_back(order.txid);
+            else if ((pubkey.empty() || order.origpubkey == pubkey) && (tokenid.IsNull() || order.tokenid == tokenid))
+                orders.push_back(order);
+        }
+        if (!vGone.empty()) {
+            LOCK(cs);
+            BOOST_FOREACH(const uint256 &txid, vGone)
+                mapMempoolOrders.erase(txid);
+        }
+    }
+
+    bool GetMempoolOrder(const uint256 &txid, CAssetOrder &order)
+    {
+        {
+            LOCK(cs);
+            std::map<uint256, CAssetOrder>::const_iterator it = mapMempoolOrders.find(txid);
+            if (it == mapMempoolOrders.end())
+                return false;
+            order = it->second;
+        }
+        return mempool.exists(txid);
+    }
+
+private:
+    CCriticalSection cs;
+    //! Orders placed by mempool transactions, by txid. Confirmed orders are in the database.
+    std::map<uint256, CAssetOrder> mapMempoolOrders;
+
+    static void Write(CCIndexBatch &batch, const CAssetOrder &order)
+    {
+        batch.Write(CAssetOrderKey(order), order);
+        batch.Write(std::make_pair(DB_ASSET_ORDER_OUTPOINT, order.txid), order);
+        batch.Write(std::make_pair(DB_ASSET_ORDER_PUBKEY, std::make_pair(order.origpubkey, std::make_pair(order.tokenid, order.txid))), order);
+    }
+
+    static void Erase(CCIndexBatch &batch, const CAssetOrder &order)
+    {
+        batch.Erase(CAssetOrderKey(order));
+        batch.Erase(std::make_pair(DB_ASSET_ORDER_OUTPOINT, order.txid));
+        batch.Erase(std::make_pair(DB_ASSET_ORDER_PUBKEY, std::make_pair(order.origpubkey, std::make_pair(order.tokenid, order.txid))));
+    }
+};
+
+static CAssetOrderIndex *GetAssetOrderIndex()
+{
+    static CAssetOrderIndex index;
+    return &index;
+}
+
+CCIndex *AssetOrderIndex()
+{
+    return GetAssetOrderIndex();
+}
+
+static bool IsSpentInMempool(const uint256 &txid)
+{
+    LOCK(mempool.cs);
+    return mempool.mapNextTx.count(COutPoint(txid, 0)) != 0;
+}
+
+/** Drop the orders closed by the mempool, add the ones it placed and put them in price order */
+static void MergeMempoolOrders(const std::vector<uint8_t> &pubkey, const uint256 &tokenid, std::vector<CAssetOrder> &orders)
+{
+    GetAssetOrderIndex()->GetMempoolOrders(pubkey, tokenid, orders);
+    std::vector<CAssetOrder> open;
+    open.reserve(orders.size());
+    BOOST_FOREACH(const CAssetOrder &order, orders) {
+        if (!IsSpentInMempool(order.txid))
+            open.push_back(order);
+    }
+    std::sort(open.begin(), open.end(), CompareAssetOrders);
+    orders.swap(open);
+}
+
+bool GetAssetOrders(uint256 tokenid, std::vector<CAssetOrder> &orders)
+{
+    if (!IsCCIndexReady())
+        return false;
+    orders.clear();
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    if (tokenid.IsNull())
+        pcursor->Seek(DB_ASSET_ORDER);
+    else
+        pcursor->Seek(std::make_pair(DB_ASSET_ORDER, tokenid));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        CAssetOrderKey key;
+        CAssetOrder order;
+        if (!pcursor->GetKey(key) || key.prefix != DB_ASSET_ORDER || (!tokenid.IsNull() && key.tokenid != tokenid))
+            break;
+        if (!pcursor->GetValue(order))
+            return error("%s: unreadable order %s", __func__, key.txid.GetHex());
+        orders.push_back(order);
+    }
+    MergeMempoolOrders(std::vector<uint8_t>(), tokenid, orders);
+    return true;
+}
+
+bool GetAssetOrdersByPubkey(const std::vector<uint8_t> &pubkey, uint256 tokenid, std::vector<CAssetOrder> &orders)
+{
+    if (!IsCCIndexReady())
+        return false;
+    orders.clear();
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    if (tokenid.IsNull())
+        pcursor->Seek(std::make_pair(DB_ASSET_ORDER_PUBKEY, pubkey));
+    else
+        pcursor->Seek(std::make_pair(DB_ASSET_ORDER_PUBKEY, std::make_pair(pubkey, tokenid)));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, std::pair<std::vector<uint8_t>, std::pair<uint256, uint256> > > key;
+        CAssetOrder order;
+        if (!pcursor->GetKey(key) || key.first != DB_ASSET_ORDER_PUBKEY || key.second.first != pubkey ||
+            (!tokenid.IsNull() && key.second.second.first != tokenid))
+            break;
+        if (!pcursor->GetValue(order))
+            return error("%s: unreadable order %s", __func__, key.second.second.second.GetHex());
+        orders.push_back(order);
+    }
+    MergeMempoolOrders(pubkey, tokenid, orders);
+    return true;
+}
+
+bool GetAssetOrder(uint256 txid, CAssetOrder &order, bool &fOpen)
+{
+    if (!IsCCIndexReady())
+        return false;
+    fOpen = (pccindex->Read(std::make_pair(DB_ASSET_ORDER_OUTPOINT, txid), order) || GetAssetOrderIndex()->GetMempoolOrder(txid, order)) &&
+            !IsSpentInMempool(txid);
+    return true;
+}
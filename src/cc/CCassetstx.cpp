@@ -66,122 +66,113 @@ int64_t AddAssetInputs(struct CCcontract_info *cp,CMutableTransaction &mtx,CPubK
 }
 
 
+static UniValue AssetOrderToJSON(struct CCcontract_info *cp, const CAssetOrder &order)
+{
+    UniValue item(UniValue::VOBJ);
+    char numstr[32], funcidstr[16], origaddr[64], assetidstr[65];
+
+    funcidstr[0] = order.funcid;
+    funcidstr[1] = 0;
+    item.push_back(Pair("funcid", funcidstr));
+    item.push_back(Pair("txid", uint256_str(assetidstr,order.txid)));
+    item.push_back(Pair("vout", (int64_t)0));
+    if ( order.IsBid() )
+    {
+        sprintf(numstr,"%.8f",(double)order.nValue/COIN);
+        item.push_back(Pair("amount",numstr));
+        item.push_back(Pair("bidamount",numstr));
+    }
+    else
+    {
+        sprintf(numstr,"%llu",(long long)order.nValue);
+        item.push_back(Pair("amount",numstr));
+        item.push_back(Pair("askamount",numstr));
+    }
+    if ( order.origpubkey.size() == 33 )
+    {
+        GetCCaddress(cp, origaddr, pubkey2pk(order.origpubkey));  // TODO: what is this? is it asset or token??
+        item.push_back(Pair("origaddress", origaddr));
+    }
+    if ( order.tokenid != zeroid )
+        item.push_back(Pair("tokenid",uint256_str(assetidstr,order.tokenid)));
+    if ( order.otherid != zeroid )
+        item.push_back(Pair("otherid",uint256_str(assetidstr,order.otherid)));
+    if ( order.nPrice > 0 )
+    {
+        if ( order.funcid == 's' || order.funcid == 'S' || order.funcid == 'e' )
+        {
+            sprintf(numstr,"%.8f",(double)order.nPrice / COIN);
+            item.push_back(Pair("totalrequired", numstr));
+            sprintf(numstr,"%.8f",(double)order.nPrice / (COIN * order.nValue));
+            item.push_back(Pair("price", numstr));
+        }
+        else
+        {
+            item.push_back(Pair("totalrequired", (int64_t)order.nPrice));
+            sprintf(numstr,"%.8f",(double)order.nValue / (order.nPrice * COIN));
+            item.push_back(Pair("price",numstr));
+        }
+    }
+    return item;
+}
+
 UniValue AssetOrders(uint256 refassetid)
 {
-    static uint256 zero;
-	UniValue result(UniValue::VARR);  
-	std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputsTokens, unspentOutputsAssets;
-	
-	struct CCcontract_info *cpTokens, tokensC;
+	UniValue result(UniValue::VARR);
+	std::vector<CAssetOrder> orders;
 	struct CCcontract_info *cpAssets, assetsC;
 
-	cpTokens = CCinit(&tokensC, EVAL_TOKENS);
 	cpAssets = CCinit(&assetsC, EVAL_ASSETS);
 
-	auto addOrders = [&](struct CCcontract_info *cp, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it)
+	// without the order book, find the orders among all the unspents of the global addresses
+	if (!GetAssetOrders(refassetid, orders))
 	{
-		uint256 txid, hashBlock, assetid, assetid2;
-		int64_t price;
-		std::vector<uint8_t> origpubkey;
-		CTransaction vintx;
-		uint8_t funcid, evalCode;
-		char numstr[32], funcidstr[16], origaddr[64], assetidstr[65];
-
-        txid = it->first.txhash;
-		//std::cerr << "addOrders() txid=" << txid.GetHex() << std::endl;
-        if ( GetTransaction(txid,vintx,hashBlock,false) != 0 ) 
-        {
-			// for logging: funcid = DecodeAssetOpRet(vintx.vout[vintx.vout.size() - 1].scriptPubKey, evalCode, assetid, assetid2, price, origpubkey);
-			//std::cerr << "addOrders() vintx.vout.size()=" << vintx.vout.size() << " funcid=" << (char)(funcid ? funcid : ' ') << " assetid=" << assetid.GetHex() << std::endl;
-            if (vintx.vout.size() > 0 && (funcid = DecodeAssetTokenOpRet(vintx.vout[vintx.vout.size()-1].scriptPubKey, evalCode, assetid, assetid2, price, origpubkey)) != 0)
-            {
-                if (refassetid != zero && assetid != refassetid)
-                {
-                    //int32_t z;
-                    //for (z=31; z>=0; z--) fprintf(stderr,"%02x",((uint8_t *)&txid)[z]);
-                    //fprintf(stderr," txid\n");
-                    //for (z=31; z>=0; z--) fprintf(stderr,"%02x",((uint8_t *)&assetid)[z]);
-                    //fprintf(stderr," assetid\n");
-                    //for (z=31; z>=0; z--) fprintf(stderr,"%02x",((uint8_t *)&refassetid)[z]);
-                    //fprintf(stderr," refassetid\n");
-                    return;
-                }
-
-				//std::cerr << "addOrders() it->first.index=" << it->first.index << " vintx.vout[it->first.index].nValue=" << vintx.vout[it->first.index].nValue << std::endl;
-                if (vintx.vout[it->first.index].nValue == 0)
-                    return;
-
-                UniValue item(UniValue::VOBJ);
-
-                funcidstr[0] = funcid;
-                funcidstr[1] = 0;
-                item.push_back(Pair("funcid", funcidstr));
-                item.push_back(Pair("txid", uint256_str(assetidstr,txid)));
-                item.push_back(Pair("vout", (int64_t)it->first.index));
-                if ( funcid == 'b' || funcid == 'B' )
-                {
-                    sprintf(numstr,"%.8f",(double)vintx.vout[it->first.index].nValue/COIN);
-                    item.push_back(Pair("amount",numstr));
-                    sprintf(numstr,"%.8f",(double)vintx.vout[0].nValue/COIN);
-                    item.push_back(Pair("bidamount",numstr));
-                }
-                else
-                {
-                    sprintf(numstr,"%llu",(long long)vintx.vout[it->first.index].nValue);
-                    item.push_back(Pair("amount",numstr));
-                    sprintf(numstr,"%llu",(long long)vintx.vout[0].nValue);
-                    item.push_back(Pair("askamount",numstr));
-                }
-                if ( origpubkey.size() == 33 )
-                {
-                    GetCCaddress(cp, origaddr, pubkey2pk(origpubkey));  // TODO: what is this? is it asset or token??
-                    item.push_back(Pair("origaddress", origaddr));
-                }
-                if ( assetid != zeroid )
-                    item.push_back(Pair("tokenid",uint256_str(assetidstr,assetid)));
-                if ( assetid2 != zeroid )
-                    item.push_back(Pair("otherid",uint256_str(assetidstr,assetid2)));
-                if ( price > 0 )
-                {
-                    if ( funcid == 's' || funcid == 'S' || funcid == 'e' || funcid == 'e' )
-                    {
-                        sprintf(numstr,"%.8f",(double)price / COIN);
-                        item.push_back(Pair("totalrequired", numstr));
-                        sprintf(numstr,"%.8f",(double)price / (COIN * vintx.vout[0].nValue));
-                        item.push_back(Pair("price", numstr));
-                    }
-                    else
-                    {
-                        item.push_back(Pair("totalrequired", (int64_t)price));
-                        sprintf(numstr,"%.8f",(double)vintx.vout[0].nValue / (price * COIN));
-                        item.push_back(Pair("price",numstr));
-                    }
-                }
-                result.push_back(item);
-                //fprintf(stderr,"addOrders() func.(%c) %s/v%d %.8f\n",funcid,uint256_str(assetidstr,txid),(int32_t)it->first.index,(double)vintx.vout[it->first.index].nValue/COIN);
-            }
-        }
-	};
-
-
-	char assetsUnspendableAddr[64];
-	GetCCaddress(cpAssets, assetsUnspendableAddr, GetUnspendable(cpAssets, NULL));
-	SetCCunspents(unspentOutputsAssets, assetsUnspendableAddr /*(char *)cpTokens->unspendableCCaddr*/);
+		std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+		char assetsUnspendableAddr[64], tokensUnspendableAddr[64];
+		GetCCaddress(cpAssets, assetsUnspendableAddr, GetUnspendable(cpAssets, NULL));
+		SetCCunspents(unspentOutputs, assetsUnspendableAddr);
+		GetTokensCCaddress(cpAssets, tokensUnspendableAddr, GetUnspendable(cpAssets, NULL));
+		SetCCunspents(unspentOutputs, tokensUnspendableAddr);
+
+		for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++)
+		{
+			CTransaction vintx;
+			uint256 hashBlock;
+			CAssetOrder order;
+			if (it->first.index == 0 && GetTransaction(it->first.txhash, vintx, hashBlock, false) != 0 &&
+				DecodeAssetOrder(vintx, it->second.blockHeight, order) && (refassetid == zeroid || order.tokenid == refassetid))
+				orders.push_back(order);
+		}
+	}
 
-	char tokensUnspendableAddr[64];
-	GetTokensCCaddress(cpAssets, tokensUnspendableAddr, GetUnspendable(cpAssets, NULL));
-	SetCCunspents(unspentOutputsAssets, tokensUnspendableAddr /*(char *)cpAssets->unspendableCCaddr*/);
+	for (std::vector<CAssetOrder>::const_iterator it = orders.begin(); it != orders.end(); it++)
+		result.push_back(AssetOrderToJSON(cpAssets, *it));
+    return(result);
+}
 
-	for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator itTokens = unspentOutputsTokens.begin();
-		itTokens != unspentOutputsTokens.end();
-		itTokens++)
-		addOrders(cpTokens, itTokens);
-	
-	for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator itAssets = unspentOutputsAssets.begin();
-		itAssets != unspentOutputsAssets.end();
-		itAssets++)
-		addOrders(cpAssets, itAssets);
+UniValue AssetOrdersByPubkey(std::vector<uint8_t> pubkey, uint256 tokenid)
+{
+	UniValue result(UniValue::VARR);
+	std::vector<CAssetOrder> orders;
+	struct CCcontract_info *cpAssets, assetsC;
 
+	cpAssets = CCinit(&assetsC, EVAL_ASSETS);
+	if (GetAssetOrdersByPubkey(pubkey, tokenid, orders))
+	{
+		for (std::vector<CAssetOrder>::const_iterator it = orders.begin(); it != orders.end(); it++)
+			result.push_back(AssetOrderToJSON(cpAssets, *it));
+	}
+	else
+	{
+		UniValue all = AssetOrders(tokenid);
+		std::string origaddr;
+		char addr[64];
+		if (pubkey.size() == 33 && GetCCaddress(cpAssets, addr, pubkey2pk(pubkey)))
+			origaddr = addr;
+		for (size_t i = 0; i < all.size(); i++)
+			if (!origaddr.empty() && find_value(all[i], "origaddress").getValStr() == origaddr)
+				result.push_back(all[i]);
+	}
     return(result);
 }
 
@@ -580,11 +571,25 @@ std::string CancelSell(int64_t txfee,uint256 assetid,uint256 asktxid)
 }
 
 //send tokens, receive coins:
+// the order at txid, which the order book also knows to be still open
+static bool GetOpenAssetOrder(uint256 txid, CAssetOrder &order)
+{
+    CTransaction vintx;
+    uint256 hashBlock;
+    bool fOpen;
+    if (GetAssetOrder(txid, order, fOpen))
+    {
+        if (!fOpen)
+            CCerror = strprintf("order %s is not open", txid.GetHex());
+        return fOpen;
+    }
+    return GetTransaction(txid, vintx, hashBlock, false) != 0 && DecodeAssetOrder(vintx, 0, order);
+}
+
 std::string FillBuyOffer(int64_t txfee,uint256 assetid,uint256 bidtxid,int64_t fillamount)
 {
     CMutableTransaction mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
-    CTransaction vintx; 
-	uint256 hashBlock; 
+    CAssetOrder order; 
 	CPubKey mypk; 
 	std::vector<uint8_t> origpubkey; 
 	int32_t bidvout=0; 
@@ -608,10 +613,11 @@ std::string FillBuyOffer(int64_t txfee,uint256 assetid,uint256 bidtxid,int64_t f
     if (AddNormalinputs(mtx, mypk, 2*txfee, 3) > 0)
     {
         mask = ~((1LL << mtx.vin.size()) - 1);
-        if (GetTransaction(bidtxid, vintx, hashBlock, false) != 0)
+        if (GetOpenAssetOrder(bidtxid, order))
         {
-            bidamount = vintx.vout[bidvout].nValue;
-            SetAssetOrigpubkey(origpubkey, origprice, vintx);
+            bidamount = order.nValue;
+            origpubkey = order.origpubkey;
+            origprice = order.nPrice;
           
 			mtx.vin.push_back(CTxIn(bidtxid, bidvout, CScript()));					// Coins on Assets unspendable
 
@@ -667,8 +673,7 @@ std::string FillBuyOffer(int64_t txfee,uint256 assetid,uint256 bidtxid,int64_t f
 std::string FillSell(int64_t txfee, uint256 assetid, uint256 assetid2, uint256 asktxid, int64_t fillunits)
 {
     CMutableTransaction mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
-    CTransaction vintx,filltx; 
-	uint256 hashBlock; 
+    CAssetOrder order; 
 	CPubKey mypk; 
 	std::vector<uint8_t> origpubkey; 
 	double dprice; 
@@ -700,10 +705,11 @@ std::string FillSell(int64_t txfee, uint256 assetid, uint256 assetid2, uint256 a
     if (AddNormalinputs(mtx, mypk, 2*txfee, 3) > 0)
     {
         mask = ~((1LL << mtx.vin.size()) - 1);
-        if (GetTransaction(asktxid, vintx, hashBlock, false) != 0)
+        if (GetOpenAssetOrder(asktxid, order))
         {
-            orig_assetoshis = vintx.vout[askvout].nValue;
-            SetAssetOrigpubkey(origpubkey, total_nValue, vintx);
+            orig_assetoshis = order.nValue;
+            origpubkey = order.origpubkey;
+            total_nValue = order.nPrice;
             dprice = (double)total_nValue / orig_assetoshis;
             paid_nValue = dprice * fillunits;
 
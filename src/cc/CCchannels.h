@@ -18,8 +18,11 @@
 #define CC_CHANNELS_H
 
 #include "CCinclude.h"
+#include "CCindex.h"
 #define CHANNELS_MAXPAYMENTS 1000
 
+int64_t IsChannelsvout(struct CCcontract_info *cp,const CTransaction& tx,CPubKey srcpub, CPubKey destpub,int32_t v);
+int64_t IsChannelsMarkervout(struct CCcontract_info *cp,const CTransaction& tx,CPubKey pubkey,int32_t v);
 bool ChannelsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
 std::string ChannelOpen(uint64_t txfee,CPubKey destpub,int32_t numpayments,int64_t payment,uint256 tokenid);
 std::string ChannelPayment(uint64_t txfee,uint256 opentxid,int64_t amount, uint256 secret);
@@ -28,5 +31,82 @@ std::string ChannelRefund(uint64_t txfee,uint256 opentxid,uint256 closetxid);
 UniValue ChannelsList();
 // CCcustom
 UniValue ChannelsInfo(uint256 opentxid);
+CScript EncodeChannelsOpRet(uint8_t funcid,uint256 tokenid,uint256 opentxid,CPubKey srcpub,CPubKey destpub,int32_t numpayments,int64_t payment,uint256 hashchain);
+uint8_t DecodeChannelsOpRet(const CScript &scriptPubKey, uint256 &tokenid, uint256 &opentxid, CPubKey &srcpub,CPubKey &destpub,int32_t &numpayments,int64_t &payment,uint256 &hashchain);
+
+// CCchannelsindex
+/** A tx of a channel, with its opreturn params */
+struct CChannelTx
+{
+    uint256 txid;
+    uint8_t funcid;
+    int32_t param1;                     // payments left after it, or the number of payments refunded
+    int64_t param2;                     // payments made by it
+    uint256 param3;                     // the secret, or the close txid of a refund
+    int64_t nFunds;                     // left in the channel at vout.0
+    std::string destaddr;               // where a payment or refund went
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(funcid);
+        READWRITE(param1);
+        READWRITE(param2);
+        READWRITE(param3);
+        READWRITE(nFunds);
+        READWRITE(destaddr);
+    }
+
+    CChannelTx() : funcid(0), param1(0), param2(0), nFunds(0) {}
+};
+
+/** Where a channel is at: its last tx, and how far down the hashchain its payments got */
+struct CChannelState
+{
+    uint256 opentxid;
+    uint256 tokenid;
+    CPubKey srcpub;
+    CPubKey destpub;
+    int32_t numpayments;
+    int64_t payment;                    // the denomination
+    uint256 hashchain;
+    uint256 txid;                       // the last tx, whose vout.0 holds the funds
+    uint8_t funcid;
+    int32_t depth;                      // payments left
+    uint256 secret;                     // the last secret revealed, the hashchain before any payment
+    int64_t nFunds;
+    uint32_t nTxs;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(opentxid);
+        READWRITE(tokenid);
+        READWRITE(srcpub);
+        READWRITE(destpub);
+        READWRITE(numpayments);
+        READWRITE(payment);
+        READWRITE(hashchain);
+        READWRITE(txid);
+        READWRITE(funcid);
+        READWRITE(depth);
+        READWRITE(secret);
+        READWRITE(nFunds);
+        READWRITE(nTxs);
+    }
+
+    CChannelState() : numpayments(0), payment(0), funcid(0), depth(0), nFunds(0), nTxs(0) {}
+    //! Move on to the next tx of the channel
+    void Apply(const CChannelTx &ctx);
+};
+
+CCIndex *ChannelsIndex();
+//! False if the index is not in use. With fMempool, the state after the channel txs the mempool chained on.
+bool GetChannelState(uint256 opentxid, bool fMempool, CChannelState &state, bool &fFound);
+//! The txs of a channel in order, from the open
+bool GetChannelTxs(uint256 opentxid, bool fMempool, std::vector<CChannelTx> &txs);
 
 #endif
@@ -0,0 +1,301 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ The state of the payment channels. In the ccindex database:
+
+   'c' opentxid       where the channel is at: its last tx, the payments left and the last secret
+   'y' opentxid seq   the txs of the channel, in order
+
+ A channel moves on with each tx spending the funds at vout.0 of its last one, as vin.1 of a
+ payment, close or refund does; ChannelsValidate() has checked those. Txs the mempool chains on
+ a channel are kept apart and followed through the spends of the mempool, so that a payment
+ stream does not wait for blocks.
+
+ Channels have no address in common, so the index is not built from the chain: it follows the
+ channels opened from then on, and one opened before is replayed from the address index of its
+ funds when it is asked for.
+ */
+
+#include "CCchannels.h"
+
+#include "../txmempool.h"
+
+#include <boost/foreach.hpp>
+
+static const char DB_CHANNEL = 'c';
+static const char DB_CHANNEL_TX = 'y';
+
+/** Key of a channel tx. The seq is big-endian so that LevelDB sorts by it. */
+struct CChannelTxKey
+{
+    char prefix;
+    uint256 opentxid;
+    uint32_t nSeq;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, prefix);
+        opentxid.Serialize(s);
+        ser_writedata32be(s, nSeq);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        prefix = ser_readdata8(s);
+        opentxid.Unserialize(s);
+        nSeq = ser_readdata32be(s);
+    }
+
+    CChannelTxKey() : prefix(0), nSeq(0) {}
+    CChannelTxKey(const uint256 &opentxidIn, uint32_t nSeqIn) : prefix(DB_CHANNEL_TX), opentxid(opentxidIn), nSeq(nSeqIn) {}
+};
+
+void CChannelState::Apply(const CChannelTx &ctx)
+{
+    txid = ctx.txid;
+    funcid = ctx.funcid;
+    nFunds = ctx.nFunds;
+    if (ctx.funcid == 'O' || ctx.funcid == 'P') {
+        depth = ctx.param1;
+        secret = ctx.param3;
+    }
+    nTxs++;
+}
+
+/** The channels opreturn of a tx, without DecodeChannelsOpRet() complaining about the ones that aren't */
+static uint8_t DecodeChannelTx(const CTransaction &tx, CChannelState &open, uint256 &opentxid, CChannelTx &ctx)
+{
+    std::vector<uint8_t> vopret;
+    if (tx.vout.size() < 3)
+        return 0;
+    const CScript &opret = tx.vout.back().scriptPubKey;
+    GetOpReturnData(opret, vopret);
+    if (vopret.size() > 2 && vopret[0] == EVAL_TOKENS) {
+        uint8_t evalCode;
+        uint256 tokenid;
+        std::vector<CPubKey> voutPubkeys;
+        std::vector<uint8_t> vopretExtra;
+        vopret.clear();
+        if (DecodeTokenOpRet(opret, evalCode, tokenid, voutPubkeys, vopretExtra) == 0 || vopretExtra.empty() || !E_UNMARSHAL(vopretExtra, { ss >> vopret; }))
+            return 0;
+    }
+    if (vopret.size() <= 2 || vopret[0] != EVAL_CHANNELS)
+        return 0;
+    ctx.funcid = DecodeChannelsOpRet(opret, open.tokenid, opentxid, open.srcpub, open.destpub, ctx.param1, ctx.param2, ctx.param3);
+    ctx.txid = tx.GetHash();
+    return ctx.funcid;
+}
+
+/** The next tx of a channel at state, or 0 */
+static uint8_t ChannelTxFollowing(const CChannelState &state, const CTransaction &tx, CChannelTx &ctx)
+{
+    struct CCcontract_info *cp, C;
+    CChannelState open;
+    uint256 opentxid;
+    char destaddr[64];
+    uint8_t funcid = DecodeChannelTx(tx, open, opentxid, ctx);
+    if ((funcid != 'P' && funcid != 'C' && funcid != 'R') || opentxid != state.opentxid || state.funcid == 'R')
+        return 0;
+    if (tx.vin.size() < 3 || tx.vin[1].prevout != COutPoint(state.txid, 0) || !IsCCInput(tx.vin[1].scriptSig))
+        return 0;
+    cp = CCinit(&C, EVAL_CHANNELS);
+    switch (funcid) {
+        case 'P':
+            if (tx.vout.size() < 5 || !Getscriptaddress(destaddr, tx.vout[3].scriptPubKey))
+                return 0;
+            ctx.nFunds = IsChannelsvout(cp, tx, state.srcpub, state.destpub, 0);
+            ctx.destaddr = destaddr;
+            break;
+        case 'C':
+            ctx.nFunds = IsChannelsvout(cp, tx, state.srcpub, state.destpub, 0);
+            break;
+        case 'R':
+            if (tx.vout.size() < 4 || !Getscriptaddress(destaddr, tx.vout[2].scriptPubKey))
+                return 0;
+            ctx.nFunds = 0;
+            ctx.destaddr = destaddr;
+            break;
+    }
+    return funcid;
+}
+
+class CChannelsIndex : public CCIndex
+{
+public:
+    const char *Name() const { return "channels"; }
+
+    void ConnectTx(CCIndexBatch &batch, const CTransaction &tx, int nHeight)
+    {
+        CChannelState state;
+        CChannelTx ctx;
+        uint256 opentxid;
+        if (tx.IsCoinBase())
+            return;
+        uint8_t funcid = DecodeChannelTx(tx, state, opentxid, ctx);
+        if (funcid == 'O') {
+            struct CCcontract_info *cp, C;
+            cp = CCinit(&C, EVAL_CHANNELS);
+            if ((ctx.nFunds = IsChannelsvout(cp, tx, state.srcpub, state.destpub, 0)) <= 0 ||
+                IsChannelsMarkervout(cp, tx, state.srcpub, 1) == 0 || IsChannelsMarkervout(cp, tx, state.destpub, 2) == 0)
+                return;
+            state.opentxid = ctx.txid;
+            state.numpayments = ctx.param1;
+            state.payment = ctx.param2;
+            state.hashchain = ctx.param3;
+        } else if (funcid == 0 || !batch.Read(std::make_pair(DB_CHANNEL, opentxid), state) || ChannelTxFollowing(state, tx, ctx) == 0) {
+            return;
+        }
+        batch.Write(CChannelTxKey(state.opentxid, state.nTxs), ctx);
+        state.Apply(ctx);
+        batch.Write(std::make_pair(DB_CHANNEL, state.opentxid), state);
+    }
+
+    bool Build(CCIndexBatch &batch)
+    {
+        // Channel txs pay the CC addresses of their two ends, no address common to all of them:
+        // channels opened before are replayed one at a time, see ReadChannel()
+        return true;
+    }
+
+    void AddMempoolTx(const CTransaction &tx)
+    {
+        CChannelState open;
+        CChannelTx ctx;
+        uint256 opentxid;
+        uint8_t funcid = DecodeChannelTx(tx, open, opentxid, ctx);
+        if (funcid == 'P' || funcid == 'C' || funcid == 'R') {
+            LOCK(cs);
+            mapMempoolTxs[opentxid].insert(ctx.txid);
+        }
+    }
+
+    void RemoveMempoolTx(const CTransaction &tx)
+    {
+        CChannelState open;
+        CChannelTx ctx;
+        uint256 opentxid;
+        uint8_t funcid = DecodeChannelTx(tx, open, opentxid, ctx);
+        if (funcid == 'P' || funcid == 'C' || funcid == 'R') {
+            LOCK(cs);
+            std::map<uint256, std::set<uint256> >::iterator it = mapMempoolTxs.find(opentxid);
+            if (it != mapMempoolTxs.end()) {
+                it->second.erase(ctx.txid);
+                if (it->second.empty())
+                    mapMempoolTxs.erase(it);
+            }
+        }
+    }
+
+    //! Follow the channel from state through the spends of the mempool, adding the txs to vtx if given
+    void FollowMempool(CChannelState &state, std::vector<CChannelTx> *vtx)
+    {
+        std::set<uint256> setTxids;
+        {
+            LOCK(cs);
+            std::map<uint256, std::set<uint256> >::iterator it = mapMempoolTxs.find(state.opentxid);
+            if (it == mapMempoolTxs.end())
+                return;
+            setTxids = it->second;
+        }
+        // mempool.cs is not taken under cs
+        LOCK(mempool.cs);
+        std::map<COutPoint, CInPoint>::const_iterator it;
+        while ((it = mempool.mapNextTx.find(COutPoint(state.txid, 0))) != mempool.mapNextTx.end() && setTxids.count(it->second.ptx->GetHash())) {
+            CChannelTx ctx;
+            if (ChannelTxFollowing(state, *it->second.ptx, ctx) == 0)
+                break;
+            state.Apply(ctx);
+            if (vtx != NULL)
+                vtx->push_back(ctx);
+        }
+    }
+
+private:
+    CCriticalSection cs;
+    //! Channel txs in the mempool, by opentxid
+    std::map<uint256, std::set<uint256> > mapMempoolTxs;
+};
+
+static CChannelsIndex *GetChannelsIndex()
+{
+    static CChannelsIndex index;
+    return &index;
+}
+
+CCIndex *ChannelsIndex()
+{
+    return GetChannelsIndex();
+}
+
+/** Connect the txs of a channel opened before the index was built, from the address index of its funds */
+static bool ReplayChannel(const uint256 &opentxid, CCIndexBatch &batch)
+{
+    CTransaction opentx, tx;
+    uint256 hashBlock;
+    char fundsaddr[64];
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    if (!myGetTransaction(opentxid, opentx, hashBlock) || opentx.vout.empty() || !Getscriptaddress(fundsaddr, opentx.vout[0].scriptPubKey))
+        return false;
+    SetCCtxids(addressIndex, fundsaddr);
+    // Each tx of the channel pays or spends the funds, in the order of the chain
+    std::map<std::pair<int, uint32_t>, uint256> mapTxids;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++)
+        mapTxids[std::make_pair(it->first.blockHeight, (uint32_t)it->first.txindex)] = it->first.txhash;
+    for (std::map<std::pair<int, uint32_t>, uint256>::const_iterator it = mapTxids.begin(); it != mapTxids.end(); it++) {
+        if (!myGetTransaction(it->second, tx, hashBlock))
+            return error("%s: cannot read tx %s of channel %s", __func__, it->second.GetHex(), opentxid.GetHex());
+        GetChannelsIndex()->ConnectTx(batch, tx, it->first.first);
+    }
+    return true;
+}
+
+/** The state of a channel, from the index or replayed into batch, which is not written */
+static bool ReadChannel(const uint256 &opentxid, CCIndexBatch &batch, CChannelState &state)
+{
+    if (batch.Read(std::make_pair(DB_CHANNEL, opentxid), state))
+        return true;
+    return ReplayChannel(opentxid, batch) && batch.Read(std::make_pair(DB_CHANNEL, opentxid), state);
+}
+
+bool GetChannelState(uint256 opentxid, bool fMempool, CChannelState &state, bool &fFound)
+{
+    if (!IsCCIndexReady())
+        return false;
+    CCIndexBatch batch(*pccindex);
+    fFound = ReadChannel(opentxid, batch, state);
+    if (fFound && fMempool)
+        GetChannelsIndex()->FollowMempool(state, NULL);
+    return true;
+}
+
+bool GetChannelTxs(uint256 opentxid, bool fMempool, std::vector<CChannelTx> &txs)
+{
+    CChannelState state;
+    if (!IsCCIndexReady())
+        return false;
+    txs.clear();
+    CCIndexBatch batch(*pccindex);
+    if (!ReadChannel(opentxid, batch, state))
+        return true;
+    for (uint32_t n = 0; n < state.nTxs; n++) {
+        CChannelTx ctx;
+        if (!batch.Read(CChannelTxKey(opentxid, n), ctx))
+            return error("%s: unreadable channel tx %d", __func__, n);
+        txs.push_back(ctx);
+    }
+    if (fMempool)
+        GetChannelsIndex()->FollowMempool(state, &txs);
+    return true;
+}
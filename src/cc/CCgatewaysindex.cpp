@@ -0,0 +1,238 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ The state of the gateways, as the unspent markers tell it. In the ccindex database:
+
+   'k' txid                    an unspent vout.0 marker of a deposit, withdraw, partialsign or completesigning tx
+   'e' bindtxid deposittxid    a deposit whose marker is not yet claimed
+   'w' bindtxid withdrawtxid   a withdraw whose marker is not yet marked done, at its latest tx
+   'x' cointxid                the deposit of an external coin tx
+
+ These are the markers gatewayspending, gatewaysprocessed and gatewayspendingdeposits looked up by
+ the unspents of the gateways CC addresses, with the same checks on their vouts. The remaining
+ tokens of a gateway are a token balance, which the tokens index keeps.
+ */
+
+#include "CCGateways.h"
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+static const char DB_GATEWAYS_MARKER = 'k';
+static const char DB_GATEWAYS_DEPOSIT = 'e';
+static const char DB_GATEWAYS_WITHDRAW = 'w';
+static const char DB_GATEWAYS_COINTXID = 'x';
+
+/** What an unspent marker belongs to */
+struct CGatewaysMarker
+{
+    uint8_t funcid;
+    uint256 bindtxid;
+    uint256 reftxid;                    // the deposit or withdraw tx
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(funcid);
+        READWRITE(bindtxid);
+        READWRITE(reftxid);
+    }
+
+    CGatewaysMarker() : funcid(0) {}
+    CGatewaysMarker(uint8_t funcidIn, const uint256 &bindtxidIn, const uint256 &reftxidIn) :
+        funcid(funcidIn), bindtxid(bindtxidIn), reftxid(reftxidIn) {}
+};
+
+typedef std::pair<uint256, uint256> gateways_txid_type;
+
+/** The funcid of a gateways tx, without DecodeTokenOpRet() complaining about the ones that aren't */
+static uint8_t GatewaysFuncId(const CTransaction &tx)
+{
+    std::vector<uint8_t> vopret;
+    if (tx.vout.size() < 2)
+        return 0;
+    GetOpReturnData(tx.vout.back().scriptPubKey, vopret);
+    if (vopret.size() > 2 && vopret[0] == EVAL_GATEWAYS)
+        return vopret[1];
+    else if (vopret.size() > 2 && vopret[0] == EVAL_TOKENS)
+        return DecodeGatewaysOpRet(tx.vout.back().scriptPubKey);
+    return 0;
+}
+
+/** Whether vout.0 is a txfee marker, to addr if given. Its address goes to markeraddr. */
+static bool IsGatewaysMarker(const CTransaction &tx, const char *addr, char *markeraddr)
+{
+    return tx.vout[0].nValue == 10000 && tx.vout[0].scriptPubKey.IsPayToCryptoCondition() &&
+        Getscriptaddress(markeraddr, tx.vout[0].scriptPubKey) && (addr == NULL || strcmp(markeraddr, addr) == 0);
+}
+
+class CGatewaysIndex : public CCIndex
+{
+public:
+    const char *Name() const { return "gateways"; }
+
+    void ConnectTx(CCIndexBatch &batch, const CTransaction &tx, int nHeight)
+    {
+        CGatewaysWithdraw withdraw;
+        bool fWithdraw = false;
+        if (tx.IsCoinBase())
+            return;
+        BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+            CGatewaysMarker marker;
+            if (txin.prevout.n != 0 || !IsCCInput(txin.scriptSig) || !batch.Read(std::make_pair(DB_GATEWAYS_MARKER, txin.prevout.hash), marker))
+                continue;
+            batch.Erase(std::make_pair(DB_GATEWAYS_MARKER, txin.prevout.hash));
+            gateways_txid_type key(marker.bindtxid, marker.reftxid);
+            if (marker.funcid == 'D') {
+                batch.Erase(std::make_pair(DB_GATEWAYS_DEPOSIT, key));
+            } else {
+                fWithdraw = batch.Read(std::make_pair(DB_GATEWAYS_WITHDRAW, key), withdraw) || fWithdraw;
+                batch.Erase(std::make_pair(DB_GATEWAYS_WITHDRAW, key));
+            }
+        }
+
+        struct CCcontract_info *cp, C;
+        char markeraddr[64], tokensaddr[64], destaddr[64];
+        uint256 txid = tx.GetHash(), withdrawtxid;
+        std::string coin;
+        uint8_t funcid = GatewaysFuncId(tx);
+        if (funcid == 0 || tx.vout.size() < 2)
+            return;
+        cp = CCinit(&C, EVAL_GATEWAYS);
+        const CScript &opret = tx.vout.back().scriptPubKey;
+        switch (funcid) {
+            case 'D': {
+                CGatewaysDeposit deposit;
+                std::vector<CPubKey> publishers;
+                std::vector<uint256> txids;
+                std::vector<uint8_t> proof;
+                std::string deposithex;
+                int32_t height;
+                if (DecodeGatewaysDepositOpRet(opret, deposit.bindtxid, deposit.coin, publishers, txids, height, deposit.cointxid,
+                                               deposit.claimvout, deposithex, proof, deposit.destpub, deposit.amount) != 'D' ||
+                    !IsGatewaysMarker(tx, NULL, markeraddr))
+                    return;
+                deposit.deposittxid = txid;
+                deposit.markeraddr = markeraddr;
+                batch.Write(std::make_pair(DB_GATEWAYS_MARKER, txid), CGatewaysMarker(funcid, deposit.bindtxid, txid));
+                batch.Write(std::make_pair(DB_GATEWAYS_DEPOSIT, gateways_txid_type(deposit.bindtxid, txid)), deposit);
+                // gatewaysdeposit pays the txidaddr of the coin tx so that it is not deposited twice
+                char txidaddr[64];
+                CPubKey txidpk = CCtxidaddr(txidaddr, deposit.cointxid);
+                if (tx.vout.size() > 2 && tx.vout[1].scriptPubKey == CScript() << ParseHex(HexStr(txidpk)) << OP_CHECKSIG &&
+                    !batch.Exists(std::make_pair(DB_GATEWAYS_COINTXID, deposit.cointxid)))
+                    batch.Write(std::make_pair(DB_GATEWAYS_COINTXID, deposit.cointxid), txid);
+                break;
+            }
+            case 'W':
+                if (DecodeGatewaysWithdrawOpRet(opret, withdraw.tokenid, withdraw.bindtxid, withdraw.coin, withdraw.withdrawpub, withdraw.amount) != 'W' ||
+                    tx.vout.size() < 3 || !IsGatewaysMarker(tx, cp->unspendableCCaddr, markeraddr))
+                    return;
+                GetTokensCCaddress(cp, tokensaddr, GetUnspendable(cp, 0));
+                if (!Getscriptaddress(destaddr, tx.vout[1].scriptPubKey) || strcmp(destaddr, tokensaddr) != 0)
+                    return;
+                withdraw.withdrawtxid = withdraw.lasttxid = txid;
+                withdraw.amount = tx.vout[1].nValue;
+                withdraw.K = 0;
+                withdraw.hex.clear();
+                withdraw.fComplete = false;
+                Mark(batch, funcid, withdraw);
+                break;
+            case 'P': {
+                CPubKey signerpk;
+                // the next step of the withdraw whose marker it spent
+                if (!fWithdraw || withdraw.fComplete ||
+                    DecodeGatewaysPartialOpRet(opret, withdrawtxid, coin, withdraw.K, signerpk, withdraw.hex) != 'P' ||
+                    withdrawtxid != withdraw.withdrawtxid || !IsGatewaysMarker(tx, cp->unspendableCCaddr, markeraddr))
+                    return;
+                withdraw.lasttxid = txid;
+                Mark(batch, funcid, withdraw);
+                break;
+            }
+            case 'S':
+                if (!fWithdraw || withdraw.fComplete ||
+                    DecodeGatewaysCompleteSigningOpRet(opret, withdrawtxid, coin, withdraw.K, withdraw.hex) != 'S' ||
+                    withdrawtxid != withdraw.withdrawtxid || !IsGatewaysMarker(tx, cp->unspendableCCaddr, markeraddr))
+                    return;
+                withdraw.lasttxid = txid;
+                withdraw.fComplete = true;
+                Mark(batch, funcid, withdraw);
+                break;
+        }
+    }
+
+    bool Build(CCIndexBatch &batch)
+    {
+        // Every deposit and withdraw follows the 'B' tx of its gateway, which pays the global CC address
+        struct CCcontract_info *cp, C;
+        cp = CCinit(&C, EVAL_GATEWAYS);
+        return ReplayCCIndex(*this, batch, cp->unspendableCCaddr);
+    }
+
+private:
+    static void Mark(CCIndexBatch &batch, uint8_t funcid, const CGatewaysWithdraw &withdraw)
+    {
+        batch.Write(std::make_pair(DB_GATEWAYS_MARKER, withdraw.lasttxid), CGatewaysMarker(funcid, withdraw.bindtxid, withdraw.withdrawtxid));
+        batch.Write(std::make_pair(DB_GATEWAYS_WITHDRAW, gateways_txid_type(withdraw.bindtxid, withdraw.withdrawtxid)), withdraw);
+    }
+};
+
+CCIndex *GatewaysIndex()
+{
+    static CGatewaysIndex index;
+    return &index;
+}
+
+/** The records under prefix for bindtxid */
+template<typename T>
+static bool ReadGatewaysRecords(char prefix, const uint256 &bindtxid, std::vector<T> &records)
+{
+    records.clear();
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    for (pcursor->Seek(std::make_pair(prefix, bindtxid)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, gateways_txid_type> key;
+        T record;
+        if (!pcursor->GetKey(key) || key.first != prefix || key.second.first != bindtxid)
+            break;
+        if (!pcursor->GetValue(record))
+            return error("%s: unreadable record %s", __func__, key.second.second.ToString());
+        records.push_back(record);
+    }
+    return true;
+}
+
+bool GetGatewaysDeposits(uint256 bindtxid, std::vector<CGatewaysDeposit> &deposits)
+{
+    if (!IsCCIndexReady())
+        return false;
+    return ReadGatewaysRecords(DB_GATEWAYS_DEPOSIT, bindtxid, deposits);
+}
+
+bool GetGatewaysWithdraws(uint256 bindtxid, std::vector<CGatewaysWithdraw> &withdraws)
+{
+    if (!IsCCIndexReady())
+        return false;
+    return ReadGatewaysRecords(DB_GATEWAYS_WITHDRAW, bindtxid, withdraws);
+}
+
+bool GetGatewaysCointxidDeposit(uint256 cointxid, uint256 &deposittxid, bool &fFound)
+{
+    if (!IsCCIndexReady())
+        return false;
+    fFound = pccindex->Read(std::make_pair(DB_GATEWAYS_COINTXID, cointxid), deposittxid);
+    return true;
+}
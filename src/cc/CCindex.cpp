@@ -0,0 +1,264 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "CCindex.h"
+#include "CCassets.h"
+#include "CCchannels.h"
+#include "CCGateways.h"
+#include "CCOracles.h"
+#include "CCrewards.h"
+#include "CCtokens.h"
+
+#include "../chain.h"
+#include "../main.h"
+#include "../util.h"
+
+#include <atomic>
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+CCIndexDB *pccindex = NULL;
+
+static const char DB_CCINDEX_BEST = 'B';
+static const char DB_CCINDEX_UNDO = 'U';
+
+//! Whether the records describe the tip. Changed under cs_main.
+static std::atomic<bool> fCCIndexReady(false);
+
+CCIndexDB::CCIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "ccindex", nCacheSize, fMemory, fWipe, false, 64) { }
+
+bool CCIndexBatch::ReadRaw(const std::string &key, std::string &value) const
+{
+    std::map<std::string, Record>::const_iterator it = mapChanged.find(key);
+    if (it != mapChanged.end()) {
+        value = it->second.value;
+        return it->second.fExists;
+    }
+    CCIndexRaw raw;
+    if (!db.Read(CCIndexRaw(key), raw))
+        return false;
+    value.swap(raw.str);
+    return true;
+}
+
+void CCIndexBatch::Change(const std::string &key, bool fExists, const std::string &value)
+{
+    if (!mapBefore.count(key)) {
+        Record before;
+        before.fExists = ReadRaw(key, before.value);
+        mapBefore[key] = before;
+    }
+    Record &record = mapChanged[key];
+    record.fExists = fExists;
+    record.value = value;
+}
+
+void CCIndexBatch::WriteTo(CDBBatch &batch) const
+{
+    for (std::map<std::string, Record>::const_iterator it = mapChanged.begin(); it != mapChanged.end(); ++it) {
+        if (it->second.fExists)
+            batch.Write(CCIndexRaw(it->first), CCIndexRaw(it->second.value));
+        else
+            batch.Erase(CCIndexRaw(it->first));
+    }
+}
+
+std::vector<CCIndexUndoEntry> CCIndexBatch::GetUndo() const
+{
+    std::vector<CCIndexUndoEntry> vUndo;
+    vUndo.reserve(mapBefore.size());
+    for (std::map<std::string, Record>::const_iterator it = mapBefore.begin(); it != mapBefore.end(); ++it) {
+        CCIndexUndoEntry entry;
+        entry.key = it->first;
+        entry.fExists = it->second.fExists;
+        entry.value = it->second.value;
+        vUndo.push_back(entry);
+    }
+    return vUndo;
+}
+
+bool ReplayCCIndex(CCIndex &index, CCIndexBatch &batch, char *addr)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    SetCCtxids(addressIndex, addr);
+    int nStart = -1;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
+        if (nStart < 0 || it->first.blockHeight < nStart)
+            nStart = it->first.blockHeight;
+    }
+    if (nStart < 0)
+        return true;
+    return ReplayCCIndex(index, batch, nStart);
+}
+
+bool ReplayCCIndex(CCIndex &index, CCIndexBatch &batch, int nStart)
+{
+    for (int nHeight = nStart; nHeight <= chainActive.Height(); nHeight++) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, chainActive[nHeight], false))
+            return error("%s: cannot read block %d for the %s index", __func__, nHeight, index.Name());
+        BOOST_FOREACH(const CTransaction &tx, block.vtx)
+            index.ConnectTx(batch, tx, nHeight);
+    }
+    return true;
+}
+
+static const std::vector<CCIndex*> &GetCCIndexes()
+{
+    static const std::vector<CCIndex*> vIndexes = {
+        AssetOrderIndex(),
+        TokenIndex(),
+        OracleIndex(),
+        GatewaysIndex(),
+        RewardsIndex(),
+        ChannelsIndex(),
+    };
+    return vIndexes;
+}
+
+static void SetCCIndexReady(bool fReady)
+{
+    if (fCCIndexReady && !fReady)
+        LogPrintf("%s: contract indexes out of step with the chain, they are rebuilt at the next start\n", __func__);
+    fCCIndexReady = fReady;
+}
+
+bool IsCCIndexReady()
+{
+    return pccindex != NULL && fCCIndexReady;
+}
+
+bool InitCCIndexes()
+{
+    if (pccindex == NULL)
+        return true;
+    if (!fAddressIndex) {
+        LogPrintf("%s: the contract indexes are built from the address index, enable it with -addressindex\n", __func__);
+        return true;
+    }
+    LOCK(cs_main);
+    uint256 hashTip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+    uint256 hashBest;
+    if (pccindex->Read(DB_CCINDEX_BEST, hashBest) && hashBest == hashTip) {
+        fCCIndexReady = true;
+        return true;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    {
+        CDBBatch batch(*pccindex);
+        boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+        for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+            CCIndexRaw key;
+            if (pcursor->GetKey(key))
+                batch.Erase(key);
+        }
+        if (!pccindex->WriteBatch(batch, true))
+            return error("%s: failed to clear the contract indexes", __func__);
+    }
+    // Indexes may read each other's records while building, so they go into one batch
+    CCIndexBatch records(*pccindex);
+    BOOST_FOREACH(CCIndex *index, GetCCIndexes()) {
+        if (!index->Build(records)) {
+            LogPrintf("%s: building the %s index failed, contract RPCs scan the chain instead\n", __func__, index->Name());
+            return true;
+        }
+    }
+    CDBBatch batch(*pccindex);
+    records.WriteTo(batch);
+    batch.Write(DB_CCINDEX_BEST, hashTip);
+    if (!pccindex->WriteBatch(batch, true))
+        return error("%s: failed to write the contract indexes", __func__);
+    fCCIndexReady = true;
+    LogPrintf("%s: built the contract indexes at %s in %dms\n", __func__, hashTip.ToString(), GetTimeMillis() - nStart);
+    return true;
+}
+
+void ConnectCCIndexes(const CBlock &block, const CBlockIndex *pindex)
+{
+    if (!IsCCIndexReady())
+        return;
+    uint256 hashBest;
+    uint256 hashPrev = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256();
+    if (!pccindex->Read(DB_CCINDEX_BEST, hashBest) || hashBest != hashPrev) {
+        SetCCIndexReady(false);
+        return;
+    }
+
+    CCIndexBatch records(*pccindex);
+    BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+        BOOST_FOREACH(CCIndex *index, GetCCIndexes())
+            index->ConnectTx(records, tx, pindex->GetHeight());
+    }
+    CDBBatch batch(*pccindex);
+    records.WriteTo(batch);
+    batch.Write(std::make_pair(DB_CCINDEX_UNDO, pindex->GetBlockHash()), records.GetUndo());
+    // Blocks this deep are not disconnected any more
+    int nUndoDepth = MAX_REORG_LENGTH + 10;
+    if (pindex->GetHeight() > nUndoDepth)
+        batch.Erase(std::make_pair(DB_CCINDEX_UNDO, pindex->GetAncestor(pindex->GetHeight() - nUndoDepth)->GetBlockHash()));
+    batch.Write(DB_CCINDEX_BEST, pindex->GetBlockHash());
+    if (!pccindex->WriteBatch(batch))
+        SetCCIndexReady(false);
+}
+
+void DisconnectCCIndexes(const CBlock &block, const CBlockIndex *pindex)
+{
+    if (!IsCCIndexReady())
+        return;
+    uint256 hashBest;
+    if (!pccindex->Read(DB_CCINDEX_BEST, hashBest) || hashBest != pindex->GetBlockHash()) {
+        SetCCIndexReady(false);
+        return;
+    }
+
+    CDBBatch batch(*pccindex);
+    std::pair<char, uint256> undoKey(DB_CCINDEX_UNDO, pindex->GetBlockHash());
+    std::vector<CCIndexUndoEntry> vUndo;
+    if (pccindex->Read(undoKey, vUndo)) {
+        BOOST_FOREACH(const CCIndexUndoEntry &entry, vUndo) {
+            if (entry.fExists)
+                batch.Write(CCIndexRaw(entry.key), CCIndexRaw(entry.value));
+            else
+                batch.Erase(CCIndexRaw(entry.key));
+        }
+        batch.Erase(undoKey);
+    } else {
+        // Connected before the indexes were built, or deeper than any reorg: its changes can't be taken back
+        SetCCIndexReady(false);
+        return;
+    }
+    batch.Write(DB_CCINDEX_BEST, pindex->pprev ? pindex->pprev->GetBlockHash() : uint256());
+    if (!pccindex->WriteBatch(batch))
+        SetCCIndexReady(false);
+}
+
+void AddCCIndexesMempoolTx(const CTransaction &tx)
+{
+    if (!IsCCIndexReady())
+        return;
+    BOOST_FOREACH(CCIndex *index, GetCCIndexes())
+        index->AddMempoolTx(tx);
+}
+
+void RemoveCCIndexesMempoolTx(const CTransaction &tx)
+{
+    // Also when not ready, so that nothing added before is left behind
+    if (pccindex == NULL)
+        return;
+    BOOST_FOREACH(CCIndex *index, GetCCIndexes())
+        index->RemoveMempoolTx(tx);
+}
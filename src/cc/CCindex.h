@@ -0,0 +1,200 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ Contract state indexes. The CC modules answer their RPCs and validation by scanning the unspents
+ and the history of their CC addresses and decoding every opreturn they find. An index keeps the
+ decoded state of one contract in the ccindex database instead, updated as blocks connect and
+ disconnect, so that the lookups cost O(log n) in the size of the contract.
+
+ An index only says how a transaction changes its records. The records it writes for a block go
+ through a CCIndexBatch, which remembers what each record held before, and that is stored as the
+ undo data of the block: disconnecting a block puts the records back without the index's help.
+ Transactions entering the mempool are handed to the indexes too, for the unconfirmed state they
+ keep in memory.
+
+ The database records the block it is in step with. If that is not the tip at startup (a new
+ index, a crash between the chainstate and the index writes), everything is rebuilt from the
+ chain state. An index out of step with the chain is not used: IsCCIndexReady() is false and the
+ callers fall back to scanning.
+
+ Key prefixes: 'B' best block, 'U' block undo data; 'o' 'O' 'p' asset orders; 'T' 'L' 'u' 'h' 'b' tokens;
+ 'd' 'D' 'n' oracle samples; 'k' 'e' 'w' 'x' gateways; 'R' 'N' 'q' 'Q' rewards;
+ 'c' 'y' channels.
+ */
+
+#ifndef CC_INDEX_H
+#define CC_INDEX_H
+
+#include "../dbwrapper.h"
+#include "../primitives/block.h"
+#include "../uint256.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class CBlockIndex;
+
+class CCIndexDB : public CDBWrapper
+{
+public:
+    CCIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+};
+
+/** Bytes that are already serialized, written and read back as they are */
+struct CCIndexRaw
+{
+    std::string str;
+
+    CCIndexRaw() {}
+    explicit CCIndexRaw(const std::string &strIn) : str(strIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const
+    {
+        s.write(str.data(), str.size());
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s)
+    {
+        str.resize(s.size());
+        if (!str.empty())
+            s.read(&str[0], str.size());
+    }
+};
+
+/** A record as it was before a block changed it */
+struct CCIndexUndoEntry
+{
+    std::string key;
+    bool fExists;
+    std::string value;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(key);
+        READWRITE(fExists);
+        READWRITE(value);
+    }
+};
+
+/**
+ * The changes of one block to the index records. Reads see the changes made so far, so the
+ * transactions of a block can build on each other.
+ */
+class CCIndexBatch
+{
+public:
+    explicit CCIndexBatch(const CCIndexDB &dbIn) : db(dbIn) {}
+
+    template <typename K, typename V>
+    bool Read(const K &key, V &value) const
+    {
+        std::string strValue;
+        if (!ReadRaw(Serialized(key), strValue))
+            return false;
+        try {
+            CDataStream ss(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            ss >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    template <typename K>
+    bool Exists(const K &key) const
+    {
+        std::string strValue;
+        return ReadRaw(Serialized(key), strValue);
+    }
+
+    template <typename K, typename V>
+    void Write(const K &key, const V &value)
+    {
+        Change(Serialized(key), true, Serialized(value));
+    }
+
+    template <typename K>
+    void Erase(const K &key)
+    {
+        Change(Serialized(key), false, std::string());
+    }
+
+    //! Queue the changes for the database
+    void WriteTo(CDBBatch &batch) const;
+    //! The records the changes overwrite, for undoing them
+    std::vector<CCIndexUndoEntry> GetUndo() const;
+
+private:
+    struct Record
+    {
+        bool fExists;
+        std::string value;
+    };
+
+    const CCIndexDB &db;
+    std::map<std::string, Record> mapChanged;
+    std::map<std::string, Record> mapBefore;
+
+    template <typename T>
+    static std::string Serialized(const T &obj)
+    {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << obj;
+        return ss.str();
+    }
+
+    bool ReadRaw(const std::string &key, std::string &value) const;
+    void Change(const std::string &key, bool fExists, const std::string &value);
+};
+
+/** The state of one contract, as kept in the ccindex database */
+class CCIndex
+{
+public:
+    virtual ~CCIndex() {}
+
+    virtual const char *Name() const = 0;
+    //! Apply a transaction of a block connected at nHeight
+    virtual void ConnectTx(CCIndexBatch &batch, const CTransaction &tx, int nHeight) = 0;
+    //! Fill an empty index from the chain state at the tip
+    virtual bool Build(CCIndexBatch &batch) = 0;
+    //! Note a transaction accepted to the mempool
+    virtual void AddMempoolTx(const CTransaction &tx) {}
+    //! Note a transaction leaving the mempool, mined or dropped. Called under mempool.cs.
+    virtual void RemoveMempoolTx(const CTransaction &tx) {}
+};
+
+extern CCIndexDB *pccindex;
+
+/** Build an index by connecting the blocks from the first one with a tx at the contract address addr */
+bool ReplayCCIndex(CCIndex &index, CCIndexBatch &batch, char *addr);
+/** Build an index by connecting the blocks from nStart */
+bool ReplayCCIndex(CCIndex &index, CCIndexBatch &batch, int nStart);
+
+/** Bring the indexes in step with the tip, rebuilding them if needed. Called at startup. */
+bool InitCCIndexes();
+bool IsCCIndexReady();
+void ConnectCCIndexes(const CBlock &block, const CBlockIndex *pindex);
+void DisconnectCCIndexes(const CBlock &block, const CBlockIndex *pindex);
+void AddCCIndexesMempoolTx(const CTransaction &tx);
+void RemoveCCIndexesMempoolTx(const CTransaction &tx);
+
+#endif
@@ -0,0 +1,210 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ The data samples of the oracles, per publisher. In the ccindex database:
+
+   'd' oracletxid publisher height seq   a sample, in the order of its publisher's baton chain
+   'D' txid                              where the sample of a data tx is
+   'n' oracletxid publisher              the seq of the next sample of the publisher
+
+ A data tx is only taken with oracles CC inputs: then OraclesValidate() has checked that the
+ publisher paid its datafee out of its own CC funds, so nobody else can publish in its name.
+ */
+
+#include "CCOracles.h"
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+static const char DB_ORACLE_SAMPLE = 'd';
+static const char DB_ORACLE_SAMPLE_TXID = 'D';
+static const char DB_ORACLE_PUBLISHER = 'n';
+
+/** Key of a sample. Numbers are big-endian so that LevelDB sorts by them. */
+struct COracleSampleKey
+{
+    char prefix;
+    uint256 oracletxid;
+    CPubKey publisher;
+    int32_t nHeight;
+    uint32_t nSeq;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, prefix);
+        oracletxid.Serialize(s);
+        publisher.Serialize(s);
+        ser_writedata32be(s, nHeight);
+        ser_writedata32be(s, nSeq);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        prefix = ser_readdata8(s);
+        oracletxid.Unserialize(s);
+        publisher.Unserialize(s);
+        nHeight = ser_readdata32be(s);
+        nSeq = ser_readdata32be(s);
+    }
+
+    COracleSampleKey() : prefix(0), nHeight(0), nSeq(0) {}
+    COracleSampleKey(const uint256 &oracletxidIn, const CPubKey &publisherIn, int32_t nHeightIn, uint32_t nSeqIn) :
+        prefix(DB_ORACLE_SAMPLE), oracletxid(oracletxidIn), publisher(publisherIn), nHeight(nHeightIn), nSeq(nSeqIn) {}
+};
+
+class COracleIndex : public CCIndex
+{
+public:
+    const char *Name() const { return "oracle samples"; }
+
+    void ConnectTx(CCIndexBatch &batch, const CTransaction &tx, int nHeight)
+    {
+        struct CCcontract_info *cp, C;
+        uint256 oracletxid;
+        COracleSample sample;
+        CPubKey publisher;
+        int32_t numvouts = tx.vout.size();
+
+        if (tx.IsCoinBase() || tx.vin.size() < 2 || numvouts < 3)
+            return;
+        std::vector<uint8_t> vopret;
+        GetOpReturnData(tx.vout[numvouts - 1].scriptPubKey, vopret);
+        if (vopret.size() <= 2 || vopret[0] != EVAL_ORACLES || vopret[1] != 'D')
+            return;
+        if (DecodeOraclesData(tx.vout[numvouts - 1].scriptPubKey, oracletxid, sample.batontxid, publisher, sample.data) != 'D')
+            return;
+        cp = CCinit(&C, EVAL_ORACLES);
+        bool fValidated = false;
+        BOOST_FOREACH(const CTxIn &txin, tx.vin)
+            fValidated = fValidated || (*cp->ismyvin)(txin.scriptSig);
+        if (!fValidated)
+            return;
+
+        sample.txid = tx.GetHash();
+        sample.nHeight = nHeight;
+        std::pair<char, std::pair<uint256, CPubKey> > publisherKey(DB_ORACLE_PUBLISHER, std::make_pair(oracletxid, publisher));
+        uint32_t nSeq = 0;
+        batch.Read(publisherKey, nSeq);
+        COracleSampleKey key(oracletxid, publisher, nHeight, nSeq);
+        batch.Write(key, sample);
+        batch.Write(std::make_pair(DB_ORACLE_SAMPLE_TXID, sample.txid), key);
+        batch.Write(publisherKey, nSeq + 1);
+    }
+
+    bool Build(CCIndexBatch &batch)
+    {
+        // Samples are of oracles created by 'C' txs, which all pay the oracles contract
+        struct CCcontract_info *cp, C;
+        cp = CCinit(&C, EVAL_ORACLES);
+        return ReplayCCIndex(*this, batch, cp->normaladdr);
+    }
+};
+
+CCIndex *OracleIndex()
+{
+    static COracleIndex index;
+    return &index;
+}
+
+/** Add the samples at or before the key, newest first, down to nFromHeight */
+static bool ReadOracleSamples(const COracleSampleKey &last, int32_t nFromHeight, int32_t nMax, std::vector<COracleSample> &samples)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    COracleSampleKey key;
+    pcursor->Seek(last);
+    if (!pcursor->Valid())
+        pcursor->SeekToLast();
+    else if (!pcursor->GetKey(key) || key.prefix != last.prefix || key.oracletxid != last.oracletxid || key.publisher != last.publisher ||
+             std::make_pair(key.nHeight, key.nSeq) > std::make_pair(last.nHeight, last.nSeq))
+        pcursor->Prev();
+    for (; pcursor->Valid() && (nMax < 0 || (int32_t)samples.size() < nMax); pcursor->Prev()) {
+        COracleSample sample;
+        if (!pcursor->GetKey(key) || key.prefix != DB_ORACLE_SAMPLE || key.oracletxid != last.oracletxid || key.publisher != last.publisher ||
+            key.nHeight < nFromHeight)
+            break;
+        if (!pcursor->GetValue(sample))
+            return error("%s: unreadable sample at height %d", __func__, key.nHeight);
+        samples.push_back(sample);
+    }
+    return true;
+}
+
+bool GetOracleSamples(uint256 oracletxid, CPubKey publisher, int32_t nFromHeight, int32_t nToHeight, int32_t nMax, std::vector<COracleSample> &samples)
+{
+    if (!IsCCIndexReady())
+        return false;
+    samples.clear();
+    return ReadOracleSamples(COracleSampleKey(oracletxid, publisher, nToHeight, std::numeric_limits<uint32_t>::max()), nFromHeight, nMax, samples);
+}
+
+bool GetOracleSamplesFrom(uint256 txid, int32_t nMax, uint256 &oracletxid, std::vector<COracleSample> &samples, bool &fFound)
+{
+    if (!IsCCIndexReady())
+        return false;
+    samples.clear();
+    COracleSampleKey key;
+    if (!(fFound = pccindex->Read(std::make_pair(DB_ORACLE_SAMPLE_TXID, txid), key)))
+        return true;
+    oracletxid = key.oracletxid;
+    return ReadOracleSamples(key, 0, nMax, samples);
+}
+
+bool GetOraclePublishers(uint256 oracletxid, std::vector<CPubKey> &publishers)
+{
+    if (!IsCCIndexReady())
+        return false;
+    publishers.clear();
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_ORACLE_PUBLISHER, oracletxid)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, std::pair<uint256, CPubKey> > key;
+        if (!pcursor->GetKey(key) || key.first != DB_ORACLE_PUBLISHER || key.second.first != oracletxid)
+            break;
+        publishers.push_back(key.second.second);
+    }
+    return true;
+}
+
+bool GetOracleCorrelatedPrice(uint256 oracletxid, int32_t height, int64_t &price)
+{
+    std::vector<CPubKey> publishers;
+    std::vector<struct oracleprice_info> latest;
+    int32_t maxheight = 0;
+    if (!GetOraclePublishers(oracletxid, publishers))
+        return false;
+    BOOST_FOREACH(const CPubKey &pk, publishers) {
+        std::vector<COracleSample> samples;
+        if (!GetOracleSamples(oracletxid, pk, 0, height > 0 ? height : std::numeric_limits<int32_t>::max(), 1, samples))
+            return false;
+        if (samples.empty())
+            continue;
+        struct oracleprice_info item;
+        item.pk = pk;
+        item.data = samples[0].data;
+        item.height = samples[0].nHeight;
+        latest.push_back(item);
+        maxheight = std::max(maxheight, item.height);
+    }
+
+    // like OraclePrice(): the prices published within 10 blocks of the newest
+    std::vector<int64_t> prices;
+    BOOST_FOREACH(const struct oracleprice_info &item, latest) {
+        uint256 hash;
+        int64_t val = 0;
+        if (item.height >= maxheight - 10 && item.data.size() >= 8 && oracle_format(&hash, &val, 0, 'L', (uint8_t *)item.data.data(), 0, (int32_t)item.data.size()) > 0 && val != 0)
+            prices.push_back(val);
+    }
+    price = prices.empty() ? 0 : OracleCorrelatedPrice(height, prices);
+    return true;
+}
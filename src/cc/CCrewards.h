@@ -18,6 +18,7 @@
 #define CC_REWARDS_H
 
 #include "CCinclude.h"
+#include "CCindex.h"
 
 #define EVAL_REWARDS 0xe5
 #define REWARDSCC_MAXAPR (COIN * 25)
@@ -30,5 +31,83 @@ std::string RewardsCreateFunding(uint64_t txfee,char *planstr,int64_t funds,int6
 std::string RewardsAddfunding(uint64_t txfee,char *planstr,uint256 fundingtxid,int64_t amount);
 std::string RewardsLock(uint64_t txfee,char *planstr,uint256 fundingtxid,int64_t amount);
 std::string RewardsUnlock(uint64_t txfee,char *planstr,uint256 fundingtxid,uint256 locktxid);
+CScript EncodeRewardsFundingOpRet(uint8_t funcid,uint64_t sbits,uint64_t APR,uint64_t minseconds,uint64_t maxseconds,uint64_t mindeposit);
+uint8_t DecodeRewardsFundingOpRet(const CScript &scriptPubKey,uint64_t &sbits,uint64_t &APR,uint64_t &minseconds,uint64_t &maxseconds,uint64_t &mindeposit);
+CScript EncodeRewardsOpRet(uint8_t funcid,uint64_t sbits,uint256 fundingtxid);
+uint8_t DecodeRewardsOpRet(uint256 txid,const CScript &scriptPubKey,uint64_t &sbits,uint256 &fundingtxid);
+int64_t RewardsCalcDuration(int64_t amount,uint64_t duration,uint64_t APR,uint64_t minseconds,uint64_t maxseconds);
+uint64_t RewardsLockDuration(int32_t height,CBlockIndex *tipindex);
+
+// CCrewardsindex
+/** A rewards plan with the totals of its unspent vouts */
+struct CRewardsPlan
+{
+    uint256 fundingtxid;
+    uint64_t sbits;
+    uint64_t APR;
+    uint64_t minseconds;
+    uint64_t maxseconds;
+    uint64_t mindeposit;
+    int32_t nHeight;
+    int64_t nFunding;                   // 'F' 'A' and 'U' vouts
+    int64_t nLocked;                    // 'L' vouts
+    int32_t nLocks;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(fundingtxid);
+        READWRITE(sbits);
+        READWRITE(APR);
+        READWRITE(minseconds);
+        READWRITE(maxseconds);
+        READWRITE(mindeposit);
+        READWRITE(nHeight);
+        READWRITE(nFunding);
+        READWRITE(nLocked);
+        READWRITE(nLocks);
+    }
+
+    CRewardsPlan() : sbits(0), APR(0), minseconds(0), maxseconds(0), mindeposit(0), nHeight(0), nFunding(0), nLocked(0), nLocks(0) {}
+};
+
+/** An unspent vout of a plan at the rewards CC address */
+struct CRewardsUtxo
+{
+    uint8_t funcid;
+    uint64_t sbits;
+    int64_t nValue;
+    int32_t nHeight;
+    CScript scriptPubKey;               // vout.1 of the tx, where a lock unlocks to
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(funcid);
+        READWRITE(sbits);
+        READWRITE(nValue);
+        READWRITE(nHeight);
+        READWRITE(*(CScriptBase*)(&scriptPubKey));
+    }
+
+    CRewardsUtxo() : funcid(0), sbits(0), nValue(0), nHeight(0) {}
+};
+
+typedef std::vector<std::pair<COutPoint, CRewardsUtxo> > rewards_utxos_type;
+
+CCIndex *RewardsIndex();
+//! False if the index is not in use
+bool GetRewardsPlan(uint256 fundingtxid, CRewardsPlan &plan, bool &fFound);
+//! The first plan created with the name
+bool GetRewardsPlanBySbits(uint64_t sbits, CRewardsPlan &plan, bool &fFound);
+//! All plans, in the order they were created
+bool GetRewardsPlans(std::vector<CRewardsPlan> &plans);
+bool GetRewardsUtxos(uint256 fundingtxid, rewards_utxos_type &utxos);
+bool GetRewardsUtxo(const COutPoint &outpoint, uint256 &fundingtxid, CRewardsUtxo &utxo, bool &fFound);
+//! The rewards the locks of a plan have earned by the tip, at once. rewards has one entry per utxo, 0 for
+//! the ones that are no lock; the sum is returned.
+int64_t RewardsPlanAccrual(const CRewardsPlan &plan, const rewards_utxos_type &utxos, std::vector<int64_t> &rewards);
 
 #endif
@@ -0,0 +1,234 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ The rewards plans and their locks. In the ccindex database:
+
+   'R' fundingtxid            the plan, with the totals of its funding and locked vouts
+   'N' sbits                  the first plan with the name, the one rewardslock and rewardsunlock use
+   'q' fundingtxid outpoint   an unspent vout of the plan at the rewards CC address
+   'Q' outpoint               the plan of such a vout
+
+ A plan is its 'F' tx funding the rewards CC address, as RewardsPlanExists() wants it. The vouts
+ are the ones IsRewardsvout() takes, so the totals are what RewardsPlanFunds() added up.
+ */
+
+#include "CCrewards.h"
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+static const char DB_REWARDS_PLAN = 'R';
+static const char DB_REWARDS_NAME = 'N';
+static const char DB_REWARDS_UTXO = 'q';
+static const char DB_REWARDS_OUTPOINT = 'Q';
+
+typedef std::pair<uint256, COutPoint> rewards_outpoint_type;
+
+/** The funcid of a rewards tx, without DecodeRewardsOpRet() complaining about the ones that aren't */
+static uint8_t RewardsFuncId(const CTransaction &tx, uint64_t &sbits, uint256 &fundingtxid)
+{
+    std::vector<uint8_t> vopret;
+    if (tx.vout.size() < 2)
+        return 0;
+    GetOpReturnData(tx.vout.back().scriptPubKey, vopret);
+    if (vopret.size() <= 2 || vopret[0] != EVAL_REWARDS)
+        return 0;
+    return DecodeRewardsOpRet(tx.GetHash(), tx.vout.back().scriptPubKey, sbits, fundingtxid);
+}
+
+class CRewardsIndex : public CCIndex
+{
+public:
+    const char *Name() const { return "rewards"; }
+
+    void ConnectTx(CCIndexBatch &batch, const CTransaction &tx, int nHeight)
+    {
+        if (tx.IsCoinBase())
+            return;
+        BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+            uint256 fundingtxid;
+            if (IsCCInput(txin.scriptSig) && batch.Read(std::make_pair(DB_REWARDS_OUTPOINT, txin.prevout), fundingtxid))
+                Spend(batch, fundingtxid, txin.prevout);
+        }
+
+        struct CCcontract_info *cp, C;
+        char destaddr[64];
+        uint256 txid = tx.GetHash(), fundingtxid;
+        CRewardsPlan plan;
+        uint64_t sbits;
+        uint8_t funcid = RewardsFuncId(tx, sbits, fundingtxid);
+        if (funcid == 0)
+            return;
+        cp = CCinit(&C, EVAL_REWARDS);
+        if (funcid == 'F') {
+            if (DecodeRewardsFundingOpRet(tx.vout.back().scriptPubKey, plan.sbits, plan.APR, plan.minseconds, plan.maxseconds, plan.mindeposit) != 'F' ||
+                !tx.vout[0].scriptPubKey.IsPayToCryptoCondition() || !Getscriptaddress(destaddr, tx.vout[0].scriptPubKey) ||
+                strcmp(destaddr, cp->unspendableCCaddr) != 0)
+                return;
+            plan.fundingtxid = txid;
+            plan.nHeight = nHeight;
+            batch.Write(std::make_pair(DB_REWARDS_PLAN, txid), plan);
+            if (!batch.Exists(std::make_pair(DB_REWARDS_NAME, plan.sbits)))
+                batch.Write(std::make_pair(DB_REWARDS_NAME, plan.sbits), txid);
+        } else if (!batch.Read(std::make_pair(DB_REWARDS_PLAN, fundingtxid), plan) || sbits != plan.sbits) {
+            // IsRewardsvout() only takes the vouts of a tx with the name of the plan
+            return;
+        }
+
+        for (int32_t v = 0; v < (int32_t)tx.vout.size() - 1; v++) {
+            CRewardsUtxo utxo;
+            if (!tx.vout[v].scriptPubKey.IsPayToCryptoCondition() || !Getscriptaddress(destaddr, tx.vout[v].scriptPubKey) ||
+                strcmp(destaddr, cp->unspendableCCaddr) != 0)
+                continue;
+            utxo.funcid = funcid;
+            utxo.sbits = sbits;
+            utxo.nValue = tx.vout[v].nValue;
+            utxo.nHeight = nHeight;
+            if (tx.vout.size() > 2)
+                utxo.scriptPubKey = tx.vout[1].scriptPubKey;
+            Receive(batch, plan, COutPoint(txid, v), utxo);
+        }
+    }
+
+    bool Build(CCIndexBatch &batch)
+    {
+        // Every plan starts with its 'F' tx, and all its vouts are at the global CC address
+        struct CCcontract_info *cp, C;
+        cp = CCinit(&C, EVAL_REWARDS);
+        return ReplayCCIndex(*this, batch, cp->unspendableCCaddr);
+    }
+
+private:
+    static void Receive(CCIndexBatch &batch, CRewardsPlan &plan, const COutPoint &outpoint, const CRewardsUtxo &utxo)
+    {
+        if (utxo.funcid == 'L') {
+            plan.nLocked += utxo.nValue;
+            plan.nLocks++;
+        } else {
+            plan.nFunding += utxo.nValue;
+        }
+        batch.Write(std::make_pair(DB_REWARDS_PLAN, plan.fundingtxid), plan);
+        batch.Write(std::make_pair(DB_REWARDS_UTXO, rewards_outpoint_type(plan.fundingtxid, outpoint)), utxo);
+        batch.Write(std::make_pair(DB_REWARDS_OUTPOINT, outpoint), plan.fundingtxid);
+    }
+
+    static void Spend(CCIndexBatch &batch, const uint256 &fundingtxid, const COutPoint &outpoint)
+    {
+        CRewardsPlan plan;
+        CRewardsUtxo utxo;
+        rewards_outpoint_type key(fundingtxid, outpoint);
+        if (batch.Read(std::make_pair(DB_REWARDS_PLAN, fundingtxid), plan) && batch.Read(std::make_pair(DB_REWARDS_UTXO, key), utxo)) {
+            if (utxo.funcid == 'L') {
+                plan.nLocked -= utxo.nValue;
+                plan.nLocks--;
+            } else {
+                plan.nFunding -= utxo.nValue;
+            }
+            batch.Write(std::make_pair(DB_REWARDS_PLAN, fundingtxid), plan);
+        }
+        batch.Erase(std::make_pair(DB_REWARDS_UTXO, key));
+        batch.Erase(std::make_pair(DB_REWARDS_OUTPOINT, outpoint));
+    }
+};
+
+CCIndex *RewardsIndex()
+{
+    static CRewardsIndex index;
+    return &index;
+}
+
+bool GetRewardsPlan(uint256 fundingtxid, CRewardsPlan &plan, bool &fFound)
+{
+    if (!IsCCIndexReady())
+        return false;
+    fFound = pccindex->Read(std::make_pair(DB_REWARDS_PLAN, fundingtxid), plan);
+    return true;
+}
+
+bool GetRewardsPlanBySbits(uint64_t sbits, CRewardsPlan &plan, bool &fFound)
+{
+    uint256 fundingtxid;
+    if (!IsCCIndexReady())
+        return false;
+    fFound = pccindex->Read(std::make_pair(DB_REWARDS_NAME, sbits), fundingtxid) &&
+        pccindex->Read(std::make_pair(DB_REWARDS_PLAN, fundingtxid), plan);
+    return true;
+}
+
+static bool CompareRewardsPlanHeight(const CRewardsPlan &a, const CRewardsPlan &b)
+{
+    return a.nHeight < b.nHeight;
+}
+
+bool GetRewardsPlans(std::vector<CRewardsPlan> &plans)
+{
+    if (!IsCCIndexReady())
+        return false;
+    plans.clear();
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    for (pcursor->Seek(DB_REWARDS_PLAN); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        CRewardsPlan plan;
+        if (!pcursor->GetKey(key) || key.first != DB_REWARDS_PLAN)
+            break;
+        if (!pcursor->GetValue(plan))
+            return error("%s: unreadable plan %s", __func__, key.second.ToString());
+        plans.push_back(plan);
+    }
+    std::stable_sort(plans.begin(), plans.end(), CompareRewardsPlanHeight);
+    return true;
+}
+
+bool GetRewardsUtxos(uint256 fundingtxid, rewards_utxos_type &utxos)
+{
+    if (!IsCCIndexReady())
+        return false;
+    utxos.clear();
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_REWARDS_UTXO, fundingtxid)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, rewards_outpoint_type> key;
+        CRewardsUtxo utxo;
+        if (!pcursor->GetKey(key) || key.first != DB_REWARDS_UTXO || key.second.first != fundingtxid)
+            break;
+        if (!pcursor->GetValue(utxo))
+            return error("%s: unreadable utxo %s", __func__, key.second.second.ToString());
+        utxos.push_back(std::make_pair(key.second.second, utxo));
+    }
+    return true;
+}
+
+bool GetRewardsUtxo(const COutPoint &outpoint, uint256 &fundingtxid, CRewardsUtxo &utxo, bool &fFound)
+{
+    if (!IsCCIndexReady())
+        return false;
+    fFound = pccindex->Read(std::make_pair(DB_REWARDS_OUTPOINT, outpoint), fundingtxid) &&
+        pccindex->Read(std::make_pair(DB_REWARDS_UTXO, rewards_outpoint_type(fundingtxid, outpoint)), utxo);
+    return true;
+}
+
+int64_t RewardsPlanAccrual(const CRewardsPlan &plan, const rewards_utxos_type &utxos, std::vector<int64_t> &rewards)
+{
+    CBlockIndex *pindexTip = chainActive.LastTip();
+    int64_t nTotal = 0;
+    rewards.assign(utxos.size(), 0);
+    for (size_t i = 0; i < utxos.size(); i++) {
+        if (utxos[i].second.funcid != 'L')
+            continue;
+        rewards[i] = RewardsCalcDuration(utxos[i].second.nValue, RewardsLockDuration(utxos[i].second.nHeight, pindexTip), plan.APR, plan.minseconds, plan.maxseconds);
+        nTotal += rewards[i];
+    }
+    return nTotal;
+}
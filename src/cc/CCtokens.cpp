@@ -14,6 +14,7 @@
  ******************************************************************************/
 
 #include "CCtokens.h"
+#include "../random.h"
 
 /* TODO: correct this:
 -----------------------------
@@ -350,10 +351,9 @@ uint8_t ValidateTokenOpret(CTransaction tx, int32_t v, uint256 tokenid, std::vec
 
 // Checks if the vout is a really Tokens CC vout
 // also checks tokenid in opret or txid if this is 'c' tx
-// goDeeper is true: the func also validates amounts of the passed transaction: 
-// it should be either sum(cc vins) == sum(cc vouts) or the transaction is the 'tokenbase' ('c') tx
 // checkPubkeys is true: validates if the vout is token vout1 or token vout1of2. Should always be true!
-int64_t IsTokensvout(bool goDeeper, bool checkPubkeys, struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, int32_t v, uint256 reftokenid)
+// Whether the tokens were paid for by the inputs of the tx is left to IsTokensvout()
+static int64_t CheckTokensvout(bool checkPubkeys, struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, int32_t v, uint256 reftokenid)
 {
 
 	// this is just for log messages indentation fur debugging recursive calls:
@@ -370,26 +370,6 @@ int64_t IsTokensvout(bool goDeeper, bool checkPubkeys, struct CCcontract_info *c
 			return(0);
 		}
 
-		if (goDeeper) {
-			//std::cerr << indentStr << "IsTokensvout() maxTokenExactAmountDepth=" << maxTokenExactAmountDepth << std::endl;
-			//validate all tx
-			int64_t myCCVinsAmount = 0, myCCVoutsAmount = 0;
-
-			tokenValIndentSize++;
-			// false --> because we already at the 1-st level ancestor tx and do not need to dereference ancestors of next levels
-			bool isEqual = TokensExactAmounts(false, cp, myCCVinsAmount, myCCVoutsAmount, eval, tx, reftokenid);
-			tokenValIndentSize--;
-
-			if (!isEqual) {
-				// if ccInputs != ccOutputs and it is not the tokenbase tx 
-				// this means it is possibly a fake tx (dimxy):
-				if (reftokenid != tx.GetHash()) {	// checking that this is the true tokenbase tx, by verifying that funcid=c, is done further in this function (dimxy)
-					std::cerr << indentStr << "IsTokensvout() warning: for the verified tx detected a bad vintx=" << tx.GetHash().GetHex() << ": cc inputs != cc outputs and not the 'tokenbase' tx, skipping the verified tx" << std::endl;
-					return 0;
-				}
-			}
-		}
-
 		// moved opret checking to this new reusable func (dimxy):
 		std::vector<CPubKey> voutPubkeys;
 		std::vector<uint8_t> vopretExtra;
@@ -486,12 +466,112 @@ int64_t IsTokensvout(bool goDeeper, bool checkPubkeys, struct CCcontract_info *c
 	return(0);
 }
 
+CTokenVoutCache tokenVoutCache(DEFAULT_TOKEN_VOUT_CACHE_SIZE);
+
+bool CTokenVoutCache::Get(const COutPoint &outpoint, const uint256 &tokenid, CTokenVoutValue &value)
+{
+	LOCK(cs);
+	std::map<key_type, CTokenVoutValue>::const_iterator it = mapValues.find(key_type(outpoint, tokenid));
+	if (it == mapValues.end())
+		return false;
+	value = it->second;
+	return true;
+}
+
+void CTokenVoutCache::Set(const COutPoint &outpoint, const uint256 &tokenid, const CTokenVoutValue &value)
+{
+	LOCK(cs);
+	if (nMaxSize == 0)
+		return;
+	key_type key(outpoint, tokenid);
+	if (!mapValues.count(key)) {
+		while (mapValues.size() >= nMaxSize) {
+			// Evict a random entry, as the signature cache does, so that transactions made up to
+			// push out the values of others can't pick what goes
+			std::map<key_type, CTokenVoutValue>::iterator it = mapValues.lower_bound(key_type(COutPoint(GetRandHash(), 0), uint256()));
+			if (it == mapValues.end())
+				it = mapValues.begin();
+			mapValues.erase(it);
+		}
+	}
+	mapValues[key] = value;
+}
+
+size_t CTokenVoutCache::Size()
+{
+	LOCK(cs);
+	return mapValues.size();
+}
+
+// whether the token inputs of the tx pay for its token outputs, or it is the tokenbase tx
+static bool TokensPaidFor(struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, uint256 reftokenid)
+{
+	int64_t myCCVinsAmount = 0, myCCVoutsAmount = 0;
+
+	tokenValIndentSize++;
+	// false --> because we already at the 1-st level ancestor tx and do not need to dereference ancestors of next levels
+	bool isEqual = TokensExactAmounts(false, cp, myCCVinsAmount, myCCVoutsAmount, eval, tx, reftokenid);
+	tokenValIndentSize--;
+
+	// if ccInputs != ccOutputs and it is not the tokenbase tx 
+	// this means it is possibly a fake tx (dimxy):
+	if (!isEqual && reftokenid != tx.GetHash()) {	// checking that this is the true tokenbase tx, by verifying that funcid=c, is done by CheckTokensvout (dimxy)
+		std::string indentStr = std::string().append(tokenValIndentSize, '.');
+		std::cerr << indentStr << "IsTokensvout() warning: for the verified tx detected a bad vintx=" << tx.GetHash().GetHex() << ": cc inputs != cc outputs and not the 'tokenbase' tx, skipping the verified tx" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// the values of a token vout, from the cache if it was checked before
+static CTokenVoutValue GetTokensvoutValue(bool goDeeper, struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, int32_t v, uint256 reftokenid)
+{
+	COutPoint outpoint(tx.GetHash(), v);
+	CTokenVoutValue value;
+	bool fChanged = false;
+
+	if (!tokenVoutCache.Get(outpoint, reftokenid, value)) {
+		value.nValue = CheckTokensvout(true, cp, eval, tx, v, reftokenid);
+		value.nVerified = value.nValue == 0 ? 0 : -1;
+		fChanged = true;
+	}
+	// a missing vintx fails the check too, so only a passed one is remembered
+	if (goDeeper && value.nVerified < 0 && TokensPaidFor(cp, eval, tx, reftokenid)) {
+		value.nVerified = value.nValue;
+		fChanged = true;
+	}
+	if (fChanged && tx.vout[v].scriptPubKey.IsPayToCryptoCondition())
+		tokenVoutCache.Set(outpoint, reftokenid, value);
+	return value;
+}
+
+// Checks if the vout is a really Tokens CC vout, see CheckTokensvout()
+// goDeeper is true: the func also validates amounts of the passed transaction: 
+// it should be either sum(cc vins) == sum(cc vouts) or the transaction is the 'tokenbase' ('c') tx
+int64_t IsTokensvout(bool goDeeper, bool checkPubkeys, struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, int32_t v, uint256 reftokenid)
+{
+	if (!checkPubkeys) {
+		int64_t nValue = CheckTokensvout(false, cp, eval, tx, v, reftokenid);
+		if (nValue != 0 && goDeeper && !TokensPaidFor(cp, eval, tx, reftokenid))
+			return 0;
+		return nValue;
+	}
+
+	CTokenVoutValue value = GetTokensvoutValue(goDeeper, cp, eval, tx, v, reftokenid);
+	if (!goDeeper)
+		return value.nValue;
+	return value.nVerified > 0 ? value.nVerified : 0;
+}
+
 // compares cc inputs vs cc outputs (to prevent feeding vouts from normal inputs)
 bool TokensExactAmounts(bool goDeeper, struct CCcontract_info *cp, int64_t &inputs, int64_t &outputs, Eval* eval, const CTransaction &tx, uint256 tokenid)
 {
 	CTransaction vinTx; 
 	uint256 hashBlock; 
 	int64_t tokenoshis; 
+	// the inputs as the vouts themselves tell, to know if the vouts of this tx are paid for
+	int64_t paidInputs = 0;
+	std::vector<int32_t> tokenVouts;
 
 	struct CCcontract_info *cpTokens, tokensC;
 	cpTokens = CCinit(&tokensC, EVAL_TOKENS);
@@ -508,23 +588,28 @@ bool TokensExactAmounts(bool goDeeper, struct CCcontract_info *cp, int64_t &inpu
 		if ((*cpTokens->ismyvin)(tx.vin[i].scriptSig) /*|| IsVinAllowed(tx.vin[i].scriptSig) != 0*/)
 		{
 			//std::cerr << indentStr << "TokensExactAmounts() eval is true=" << (eval != NULL) << " ismyvin=ok for_i=" << i << std::endl;
-			// we are not inside the validation code -- dimxy
-			if ((eval && eval->GetTxUnconfirmed(tx.vin[i].prevout.hash, vinTx, hashBlock) == 0) || (!eval && !myGetTransaction(tx.vin[i].prevout.hash, vinTx, hashBlock)))
+			// vouts checked before need no vintx, so a transfer costs a lookup per vin
+			CTokenVoutValue value;
+			if (!tokenVoutCache.Get(tx.vin[i].prevout, tokenid, value) || (goDeeper && value.nVerified < 0))
 			{
-				std::cerr << indentStr << "TokensExactAmounts() cannot read vintx for i." << i << " numvins." << numvins << std::endl;
-				return (!eval) ? false : eval->Invalid("always should find vin tx, but didnt");
-			}
-			else {
+				// we are not inside the validation code -- dimxy
+				if ((eval && eval->GetTxUnconfirmed(tx.vin[i].prevout.hash, vinTx, hashBlock) == 0) || (!eval && !myGetTransaction(tx.vin[i].prevout.hash, vinTx, hashBlock)))
+				{
+					std::cerr << indentStr << "TokensExactAmounts() cannot read vintx for i." << i << " numvins." << numvins << std::endl;
+					return (!eval) ? false : eval->Invalid("always should find vin tx, but didnt");
+				}
 				tokenValIndentSize++;
 				// validate vouts of vintx  
 				//std::cerr << indentStr << "TokenExactAmounts() check vin i=" << i << " nValue=" << vinTx.vout[tx.vin[i].prevout.n].nValue << std::endl;
-				tokenoshis = IsTokensvout(goDeeper, true, cpTokens, eval, vinTx, tx.vin[i].prevout.n, tokenid);
+				value = GetTokensvoutValue(goDeeper, cpTokens, eval, vinTx, tx.vin[i].prevout.n, tokenid);
 				tokenValIndentSize--;
-				if (tokenoshis != 0)
-				{
-					std::cerr << indentStr << "TokensExactAmounts() vin i=" << i << " tokenoshis=" << tokenoshis << std::endl;
-					inputs += tokenoshis;
-				}
+			}
+			tokenoshis = goDeeper ? std::max(value.nVerified, (int64_t)0) : value.nValue;
+			paidInputs += value.nValue;
+			if (tokenoshis != 0)
+			{
+				std::cerr << indentStr << "TokensExactAmounts() vin i=" << i << " tokenoshis=" << tokenoshis << std::endl;
+				inputs += tokenoshis;
 			}
 		}
 	}
@@ -543,6 +628,16 @@ bool TokensExactAmounts(bool goDeeper, struct CCcontract_info *cp, int64_t &inpu
 		{
 			std::cerr << indentStr << "TokensExactAmounts() vout i=" << i << " tokenoshis=" << tokenoshis << std::endl;
 			outputs += tokenoshis;
+			tokenVouts.push_back(i);
+		}
+	}
+
+	// the vouts are paid for: spending them later needs no look at the inputs of this tx again
+	if (paidInputs == outputs || tx.GetHash() == tokenid) {
+		for (std::vector<int32_t>::const_iterator it = tokenVouts.begin(); it != tokenVouts.end(); it++) {
+			CTokenVoutValue value;
+			value.nValue = value.nVerified = tx.vout[*it].nValue;
+			tokenVoutCache.Set(COutPoint(tx.GetHash(), *it), tokenid, value);
 		}
 	}
 
@@ -696,6 +791,97 @@ std::string TokenTransfer(int64_t txfee, uint256 assetid, std::vector<uint8_t> d
 	return("");
 }
 
+// Start a tx of a TokenTransferMany() batch on the change of the one before, as TokenTransferManyVouts()
+// and FinalizeCCTx() laid it out: the normal change is the last vout before the opret, the token change vout.1.
+// The normal change goes first, FinalizeCCTx() wants the CC vins after it.
+void TokenTransferManyChain(CMutableTransaction &mtx, const CTransaction &prevtx)
+{
+	mtx.vin.push_back(CTxIn(prevtx.GetHash(), prevtx.vout.size() - 2, CScript()));
+	mtx.vin.push_back(CTxIn(prevtx.GetHash(), 1, CScript()));
+}
+
+// The token vouts of a tx of a TokenTransferMany() batch: the transfer, then the token change left for the next ones
+void TokenTransferManyVouts(CMutableTransaction &mtx, CPubKey mypk, const std::vector<uint8_t> &destpubkey, int64_t amount, int64_t change)
+{
+	mtx.vout.push_back(MakeCC1vout(EVAL_TOKENS, amount, pubkey2pk(destpubkey)));
+	if (change != 0)
+		mtx.vout.push_back(MakeCC1vout(EVAL_TOKENS, change, mypk));
+}
+
+// A tx of its own for each of the outputs, every one chained on the normal and token change of the one before.
+// The first takes in what all of them need, and each goes to the mempool before the next is finalized,
+// as FinalizeCCTx() looks the vins up there. The key is read from the wallet once for the whole batch.
+// Returns the txs sent, which are fewer than the outputs if one could not be made or was not accepted.
+std::vector<CTransaction> TokenTransferMany(int64_t txfee, uint256 assetid, const std::vector< std::pair<std::vector<uint8_t>, int64_t> > &outputs)
+{
+	CMutableTransaction mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
+	CPubKey mypk; int64_t total = 0, normalinputs, inputs; struct CCcontract_info *cp, C;
+	uint8_t myprivkey[32]; std::string hex; CTransaction tx; std::vector<CTransaction> txs;
+	int32_t i, n = (int32_t)outputs.size();
+
+	cp = CCinit(&C, EVAL_TOKENS);
+	if (txfee == 0)
+		txfee = 10000;
+	for (i = 0; i < n; i++)
+	{
+		if (outputs[i].second <= 0)
+		{
+			fprintf(stderr, "non-positive amount %lld for output.%d\n", (long long)outputs[i].second, i);
+			return(txs);
+		}
+		total += outputs[i].second;
+	}
+	if (n == 0)
+		return(txs);
+	mypk = pubkey2pk(Mypubkey());
+	// n+1 txfee leave each tx a normal change of at least 2 txfee, which FinalizeCCTx() wants before it pays it back
+	if ((normalinputs = AddNormalinputs(mtx, mypk, (n + 1) * txfee, 60)) <= 0)
+	{
+		fprintf(stderr, "not enough normal inputs for %d txfee\n", n + 1);
+		return(txs);
+	}
+	if ((inputs = AddTokenCCInputs(cp, mtx, mypk, assetid, total, 60)) < total)
+	{
+		fprintf(stderr, "not enough CC token inputs for %.8f\n", (double)total / COIN);
+		return(txs);
+	}
+	// Myprivkey() may have copied the key before failing, so it is wiped on every way out from here
+	if (!Myprivkey(myprivkey))
+	{
+		memset(myprivkey, 0, sizeof(myprivkey));
+		return(txs);
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (i > 0)
+		{
+			mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
+			TokenTransferManyChain(mtx, tx);
+		}
+		inputs -= outputs[i].second;
+		TokenTransferManyVouts(mtx, mypk, outputs[i].first, outputs[i].second, inputs);
+
+		std::vector<CPubKey> voutTokenPubkeys;
+		voutTokenPubkeys.push_back(pubkey2pk(outputs[i].first));
+		hex = FinalizeCCTx(0, cp, mtx, mypk, txfee, EncodeTokenOpRet('t', EVAL_TOKENS, assetid, voutTokenPubkeys, CScript()), NULL_pubkeys, myprivkey);
+		if (hex.size() <= 1 || DecodeHexTx(tx, hex) == 0)
+		{
+			fprintf(stderr, "couldnt finalize tx.%d of %d\n", i, n);
+			break;
+		}
+		CValidationState state;
+		if (!myAddtomempool(tx, &state))
+		{
+			fprintf(stderr, "tx.%d of %d not accepted to mempool: %s\n", i, n, state.GetRejectReason().c_str());
+			break;
+		}
+		RelayTransaction(tx);
+		txs.push_back(tx);
+	}
+	memset(myprivkey, 0, sizeof(myprivkey));
+	return(txs);
+}
+
 
 int64_t GetTokenBalance(CPubKey pk, uint256 tokenid)
 {
@@ -706,7 +892,9 @@ int64_t GetTokenBalance(CPubKey pk, uint256 tokenid)
 	// CCerror = strprintf("obsolete, cannot return correct value without eval");
 	// return 0;
 
-	if (GetTransaction(tokenid, tokentx, hashBlock, false) == 0)
+	CTokenInfo info;
+	bool fFound = false;
+	if (!(GetTokenInfo(tokenid, info, fFound) && fFound) && GetTransaction(tokenid, tokentx, hashBlock, false) == 0)
 	{
 		fprintf(stderr, "cant find tokenid\n");
 		CCerror = strprintf("cant find tokenid");
@@ -715,12 +903,30 @@ int64_t GetTokenBalance(CPubKey pk, uint256 tokenid)
 
 	struct CCcontract_info *cp, C;
 	cp = CCinit(&C, EVAL_TOKENS);
+	char tokenaddr[64];
+	int64_t balance;
+	GetTokensCCaddress(cp, tokenaddr, pk);
+	if (GetTokenAddressBalance(tokenid, tokenaddr, true, balance))
+		return balance;
 	return(AddTokenCCInputs(cp, mtx, pk, tokenid, 0, 0));
 }
 
 UniValue TokenInfo(uint256 tokenid)
 {
 	UniValue result(UniValue::VOBJ); uint256 hashBlock; CTransaction vintx; std::vector<uint8_t> origpubkey; std::string name, description; char str[67], numstr[65];
+	CTokenInfo info;
+	bool fFound = false;
+	if (GetTokenInfo(tokenid, info, fFound) && fFound)
+	{
+		result.push_back(Pair("result", "success"));
+		result.push_back(Pair("tokenid", uint256_str(str, tokenid)));
+		result.push_back(Pair("owner", pubkey33_str(str, info.origpubkey.data())));
+		result.push_back(Pair("name", info.name));
+		result.push_back(Pair("supply", info.nSupply));
+		result.push_back(Pair("description", info.description));
+		return(result);
+	}
+	// not confirmed yet, or no index
 	if (GetTransaction(tokenid, vintx, hashBlock, false) == 0)
 	{
 		fprintf(stderr, "cant find assetid\n");
@@ -743,24 +949,35 @@ UniValue TokenInfo(uint256 tokenid)
 	return(result);
 }
 
-UniValue TokenList()
+// count tokens after skipping from, all of them if count is negative
+UniValue TokenList(int64_t count, int64_t from)
 {
 	UniValue result(UniValue::VARR);
 	std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 	struct CCcontract_info *cp, C; uint256 txid, hashBlock;
 	CTransaction vintx; std::vector<uint8_t> origpubkey;
 	std::string name, description; char str[65];
+	std::vector<uint256> tokenids;
+	int64_t n = 0;
+
+	if (GetTokenIds(from, count, tokenids))
+	{
+		for (std::vector<uint256>::const_iterator it = tokenids.begin(); it != tokenids.end(); it++)
+			result.push_back(uint256_str(str, *it));
+		return(result);
+	}
 
 	cp = CCinit(&C, EVAL_TOKENS);
 	SetCCtxids(addressIndex, cp->normaladdr);
-	for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++)
+	for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end() && (count < 0 || (int64_t)result.size() < count); it++)
 	{
 		txid = it->first.txhash;
 		if (GetTransaction(txid, vintx, hashBlock, false) != 0)
 		{
 			if (vintx.vout.size() > 0 && DecodeTokenCreateOpRet(vintx.vout[vintx.vout.size() - 1].scriptPubKey, origpubkey, name, description) != 0)
 			{
-				result.push_back(uint256_str(str, txid));
+				if (n++ >= from)
+					result.push_back(uint256_str(str, txid));
 			}
 		}
 	}
@@ -24,17 +24,94 @@
 #define CC_TOKENS_H
 
 #include "CCinclude.h"
+#include "CCindex.h"
+
+#include <map>
+
+/** Default for the number of token vouts whose checked values are kept */
+static const size_t DEFAULT_TOKEN_VOUT_CACHE_SIZE = 100000;
+
+/** What IsTokensvout() found for a vout */
+struct CTokenVoutValue
+{
+    int64_t nValue;     //!< the tokens by the vout and the opret of its tx (goDeeper false)
+    int64_t nVerified;  //!< the tokens when paid for by the token inputs of its tx (goDeeper true), -1 if not checked yet
+};
+
+/**
+ * Values of checked token vouts, keyed by outpoint and tokenid. Checking that a vout is paid for
+ * loads the transactions its tx spends, so without it validating a transfer would load every vin
+ * of every vintx, once in the mempool and again when the block connects. The values follow from
+ * transactions named by their hash only, so they hold across reorgs and are never invalidated.
+ */
+class CTokenVoutCache
+{
+public:
+    explicit CTokenVoutCache(size_t nMaxSizeIn) : nMaxSize(nMaxSizeIn) {}
+
+    bool Get(const COutPoint &outpoint, const uint256 &tokenid, CTokenVoutValue &value);
+    void Set(const COutPoint &outpoint, const uint256 &tokenid, const CTokenVoutValue &value);
+    size_t Size();
+
+private:
+    typedef std::pair<COutPoint, uint256> key_type;
+
+    CCriticalSection cs;
+    std::map<key_type, CTokenVoutValue> mapValues;
+    size_t nMaxSize;
+};
+
+extern CTokenVoutCache tokenVoutCache;
 
 // CCcustom
 bool TokensValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
 bool TokensExactAmounts(bool goDeeper, struct CCcontract_info *cpTokens, int64_t &inputs, int64_t &outputs, Eval* eval, const CTransaction &tx, uint256 tokenid);
 //int64_t IsTokensvout(bool goDeeper, bool checkPubkeys, struct CCcontract_info *cp, Eval* eval, std::vector<uint8_t> &origpubkey, const CTransaction& tx, int32_t v, uint256 reftokenid, std::vector<CPubKey> vinPubkeys);
+CScript EncodeTokenCreateOpRet(uint8_t funcid, std::vector<uint8_t> origpubkey, std::string name, std::string description);
 std::string CreateToken(int64_t txfee, int64_t assetsupply, std::string name, std::string description);
 std::string TokenTransfer(int64_t txfee, uint256 assetid, std::vector<uint8_t> destpubkey, int64_t total);
+void TokenTransferManyChain(CMutableTransaction &mtx, const CTransaction &prevtx);
+void TokenTransferManyVouts(CMutableTransaction &mtx, CPubKey mypk, const std::vector<uint8_t> &destpubkey, int64_t amount, int64_t change);
+std::vector<CTransaction> TokenTransferMany(int64_t txfee, uint256 assetid, const std::vector< std::pair<std::vector<uint8_t>, int64_t> > &outputs);
 
 int64_t GetTokenBalance(CPubKey pk, uint256 tokenid);
 UniValue TokenInfo(uint256 tokenid);
-UniValue TokenList();
+UniValue TokenList(int64_t count = -1, int64_t from = 0);
+
+// CCtokensindex
+/** A token, as its 'c' tx created it */
+struct CTokenInfo
+{
+    uint256 tokenid;
+    std::vector<uint8_t> origpubkey;
+    std::string name;
+    std::string description;
+    int64_t nSupply;
+    int32_t nHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tokenid);
+        READWRITE(origpubkey);
+        READWRITE(name);
+        READWRITE(description);
+        READWRITE(nSupply);
+        READWRITE(nHeight);
+    }
+
+    CTokenInfo() : nSupply(0), nHeight(0) {}
+};
+
+bool DecodeTokenInfo(const CTransaction &tx, int32_t nHeight, CTokenInfo &info);
+CCIndex *TokenIndex();
+//! Find the confirmed token; fFound is false if there is none. False if the index is not in use.
+bool GetTokenInfo(uint256 tokenid, CTokenInfo &info, bool &fFound);
+//! Confirmed tokens in the order they were created, count of them (all if negative) after skipping from
+bool GetTokenIds(int64_t nFrom, int64_t nCount, std::vector<uint256> &tokenids);
+//! Confirmed tokens of tokenid held by address, less the ones spent in the mempool if fMempoolSpent
+bool GetTokenAddressBalance(uint256 tokenid, const std::string &address, bool fMempoolSpent, int64_t &nBalance);
 
 //this is in CCinclude.h int64_t AddTokenCCInputs(struct CCcontract_info *cp, CMutableTransaction &mtx, CPubKey pk, uint256 tokenid, int64_t total, int32_t maxinputs);
 
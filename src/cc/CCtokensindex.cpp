@@ -0,0 +1,257 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+/*
+ The token registry and the token holdings. In the ccindex database:
+
+   'T' tokenid                   the token as its 'c' tx created it
+   'L' height tokenid            the tokens in the order they were created, for listing them a page at a time
+   'u' outpoint                  an unspent token vout: its tokenid, address and value
+   'h' tokenid address outpoint  the unspent token vouts of an address
+   'b' tokenid address           the sum of them
+
+ Only the vouts IsTokensvout() takes as paid for count, the ones AddTokenCCInputs() would spend.
+ Addresses are those of the vouts, so 1of2 and dual-eval vouts are held by their own address.
+ */
+
+#include "CCtokens.h"
+
+#include "../txmempool.h"
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+static const char DB_TOKEN = 'T';
+static const char DB_TOKEN_LIST = 'L';
+static const char DB_TOKEN_OUTPOINT = 'u';
+static const char DB_TOKEN_HOLDING = 'h';
+static const char DB_TOKEN_BALANCE = 'b';
+
+/** Key of a listing entry. The height is big-endian so that LevelDB sorts by it. */
+struct CTokenListKey
+{
+    char prefix;
+    int32_t nHeight;
+    uint256 tokenid;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, prefix);
+        ser_writedata32be(s, nHeight);
+        tokenid.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        prefix = ser_readdata8(s);
+        nHeight = ser_readdata32be(s);
+        tokenid.Unserialize(s);
+    }
+
+    CTokenListKey() : prefix(0), nHeight(0) {}
+    explicit CTokenListKey(const CTokenInfo &info) : prefix(DB_TOKEN_LIST), nHeight(info.nHeight), tokenid(info.tokenid) {}
+};
+
+/** An unspent token vout */
+struct CTokenHolding
+{
+    uint256 tokenid;
+    std::string address;
+    int64_t nValue;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tokenid);
+        READWRITE(address);
+        READWRITE(nValue);
+    }
+
+    CTokenHolding() : nValue(0) {}
+};
+
+typedef std::pair<uint256, std::string> token_address_type;
+
+/** Whether the tx carries a tokens opret, without DecodeTokenOpRet() complaining about the ones that aren't */
+static bool HasTokenOpRet(const CTransaction &tx)
+{
+    std::vector<uint8_t> vopret;
+    if (tx.vout.size() < 2)
+        return false;
+    GetOpReturnData(tx.vout.back().scriptPubKey, vopret);
+    return vopret.size() > 2 && vopret[0] == EVAL_TOKENS;
+}
+
+bool DecodeTokenInfo(const CTransaction &tx, int32_t nHeight, CTokenInfo &info)
+{
+    struct CCcontract_info *cpTokens, tokensC;
+    cpTokens = CCinit(&tokensC, EVAL_TOKENS);
+    if (!HasTokenOpRet(tx) || DecodeTokenCreateOpRet(tx.vout.back().scriptPubKey, info.origpubkey, info.name, info.description) == 0)
+        return false;
+    // tokenlist took the 'c' txs that pay the tokens contract
+    bool fPaid = false;
+    for (int32_t i = 0; i < (int32_t)tx.vout.size() - 1 && !fPaid; i++) {
+        char destaddr[64];
+        fPaid = Getscriptaddress(destaddr, tx.vout[i].scriptPubKey) && strcmp(destaddr, cpTokens->normaladdr) == 0;
+    }
+    if (!fPaid)
+        return false;
+    info.tokenid = tx.GetHash();
+    info.nSupply = tx.vout[0].nValue;
+    info.nHeight = nHeight;
+    return true;
+}
+
+class CTokenIndex : public CCIndex
+{
+public:
+    const char *Name() const { return "tokens"; }
+
+    void ConnectTx(CCIndexBatch &batch, const CTransaction &tx, int nHeight)
+    {
+        if (tx.IsCoinBase())
+            return;
+        BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+            CTokenHolding holding;
+            if (IsCCInput(txin.scriptSig) && batch.Read(std::make_pair(DB_TOKEN_OUTPOINT, txin.prevout), holding))
+                Spend(batch, txin.prevout, holding);
+        }
+        if (!HasTokenOpRet(tx))
+            return;
+
+        uint8_t evalCode;
+        uint256 tokenid;
+        std::vector<CPubKey> voutPubkeys;
+        std::vector<uint8_t> vopretExtra;
+        uint8_t funcid = DecodeTokenOpRet(tx.vout.back().scriptPubKey, evalCode, tokenid, voutPubkeys, vopretExtra);
+        if (funcid == 'c') {
+            CTokenInfo info;
+            if (!DecodeTokenInfo(tx, nHeight, info))
+                return;
+            batch.Write(std::make_pair(DB_TOKEN, info.tokenid), info);
+            batch.Write(CTokenListKey(info), info.tokenid);
+            tokenid = info.tokenid;
+        } else if (funcid == 0 || tokenid.IsNull()) {
+            return;
+        }
+
+        struct CCcontract_info *cpTokens, tokensC;
+        cpTokens = CCinit(&tokensC, EVAL_TOKENS);
+        for (int32_t v = 0; v < (int32_t)tx.vout.size() - 1; v++) {
+            char destaddr[64];
+            CTokenHolding holding;
+            if (!tx.vout[v].scriptPubKey.IsPayToCryptoCondition() || !Getscriptaddress(destaddr, tx.vout[v].scriptPubKey))
+                continue;
+            if ((holding.nValue = IsTokensvout(true, true, cpTokens, NULL, tx, v, tokenid)) <= 0)
+                continue;
+            holding.tokenid = tokenid;
+            holding.address = destaddr;
+            Receive(batch, COutPoint(tx.GetHash(), v), holding);
+        }
+    }
+
+    bool Build(CCIndexBatch &batch)
+    {
+        // No token tx comes before the first 'c' tx, which all pay the tokens contract. Holdings
+        // follow the history of every token, so they are replayed from there.
+        struct CCcontract_info *cpTokens, tokensC;
+        cpTokens = CCinit(&tokensC, EVAL_TOKENS);
+        return ReplayCCIndex(*this, batch, cpTokens->normaladdr);
+    }
+
+private:
+    static void Receive(CCIndexBatch &batch, const COutPoint &outpoint, const CTokenHolding &holding)
+    {
+        token_address_type tokenAddress(holding.tokenid, holding.address);
+        int64_t nBalance = 0;
+        batch.Read(std::make_pair(DB_TOKEN_BALANCE, tokenAddress), nBalance);
+        batch.Write(std::make_pair(DB_TOKEN_BALANCE, tokenAddress), nBalance + holding.nValue);
+        batch.Write(std::make_pair(DB_TOKEN_OUTPOINT, outpoint), holding);
+        batch.Write(std::make_pair(DB_TOKEN_HOLDING, std::make_pair(tokenAddress, outpoint)), holding.nValue);
+    }
+
+    static void Spend(CCIndexBatch &batch, const COutPoint &outpoint, const CTokenHolding &holding)
+    {
+        token_address_type tokenAddress(holding.tokenid, holding.address);
+        int64_t nBalance = 0;
+        batch.Read(std::make_pair(DB_TOKEN_BALANCE, tokenAddress), nBalance);
+        if (nBalance - holding.nValue > 0)
+            batch.Write(std::make_pair(DB_TOKEN_BALANCE, tokenAddress), nBalance - holding.nValue);
+        else
+            batch.Erase(std::make_pair(DB_TOKEN_BALANCE, tokenAddress));
+        batch.Erase(std::make_pair(DB_TOKEN_OUTPOINT, outpoint));
+        batch.Erase(std::make_pair(DB_TOKEN_HOLDING, std::make_pair(tokenAddress, outpoint)));
+    }
+};
+
+CCIndex *TokenIndex()
+{
+    static CTokenIndex index;
+    return &index;
+}
+
+bool GetTokenInfo(uint256 tokenid, CTokenInfo &info, bool &fFound)
+{
+    if (!IsCCIndexReady())
+        return false;
+    fFound = pccindex->Read(std::make_pair(DB_TOKEN, tokenid), info);
+    return true;
+}
+
+bool GetTokenIds(int64_t nFrom, int64_t nCount, std::vector<uint256> &tokenids)
+{
+    if (!IsCCIndexReady())
+        return false;
+    tokenids.clear();
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    pcursor->Seek(DB_TOKEN_LIST);
+    for (int64_t i = 0; pcursor->Valid() && (nCount < 0 || (int64_t)tokenids.size() < nCount); pcursor->Next(), i++) {
+        CTokenListKey key;
+        if (!pcursor->GetKey(key) || key.prefix != DB_TOKEN_LIST)
+            break;
+        if (i >= nFrom)
+            tokenids.push_back(key.tokenid);
+    }
+    return true;
+}
+
+bool GetTokenAddressBalance(uint256 tokenid, const std::string &address, bool fMempoolSpent, int64_t &nBalance)
+{
+    if (!IsCCIndexReady())
+        return false;
+    token_address_type tokenAddress(tokenid, address);
+    nBalance = 0;
+    pccindex->Read(std::make_pair(DB_TOKEN_BALANCE, tokenAddress), nBalance);
+    if (!fMempoolSpent || nBalance == 0)
+        return true;
+
+    std::vector<std::pair<COutPoint, int64_t> > vHoldings;
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_TOKEN_HOLDING, tokenAddress)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, std::pair<token_address_type, COutPoint> > key;
+        int64_t nValue;
+        if (!pcursor->GetKey(key) || key.first != DB_TOKEN_HOLDING || key.second.first != tokenAddress)
+            break;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: unreadable holding %s", __func__, key.second.second.ToString());
+        vHoldings.push_back(std::make_pair(key.second.second, nValue));
+    }
+    LOCK(mempool.cs);
+    for (std::vector<std::pair<COutPoint, int64_t> >::const_iterator it = vHoldings.begin(); it != vHoldings.end(); it++) {
+        if (mempool.mapNextTx.count(it->first))
+            nBalance -= it->second;
+    }
+    return true;
+}
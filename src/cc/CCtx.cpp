@@ -14,6 +14,7 @@
  ******************************************************************************/
 
 #include "CCinclude.h"
+#include "CCtokens.h"
 #include "key_io.h"
 
 std::vector<CPubKey> NULL_pubkeys;
@@ -40,7 +41,8 @@ bool SignTx(CMutableTransaction &mtx,int32_t vini,int64_t utxovalue,const CScrip
     return(false);
 }
 
-std::string FinalizeCCTx(uint64_t CCmask,struct CCcontract_info *cp,CMutableTransaction &mtx,CPubKey mypk,uint64_t txfee,CScript opret,std::vector<CPubKey> pubkeys)
+// mypriv is the key of mypk when the caller already has it, as a batch of txs does; otherwise it is read from the wallet
+std::string FinalizeCCTx(uint64_t CCmask,struct CCcontract_info *cp,CMutableTransaction &mtx,CPubKey mypk,uint64_t txfee,CScript opret,std::vector<CPubKey> pubkeys,const uint8_t *mypriv)
 {
     auto consensusBranchId = CurrentEpochBranchId(chainActive.Height() + 1, Params().GetConsensus());
     CTransaction vintx; std::string hex; CPubKey globalpk; uint256 hashBlock; uint64_t mask=0,nmask=0,vinimask=0;
@@ -64,7 +66,9 @@ std::string FinalizeCCTx(uint64_t CCmask,struct CCcontract_info *cp,CMutableTran
         fprintf(stderr,"FinalizeCCTx: %d is too many vins\n",n);
         return("0");
     }
-    Myprivkey(myprivkey);
+    if ( mypriv != 0 )
+        memcpy(myprivkey,mypriv,sizeof(myprivkey));
+    else Myprivkey(myprivkey);
 
     GetCCaddress(cp,myaddr,mypk);
     mycond = MakeCCcond1(cp->evalcode,mypk);
@@ -397,6 +401,8 @@ int64_t CCtoken_balance(char *coinaddr,uint256 reftokenid)
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 	uint8_t evalCode;
 
+    if ( GetTokenAddressBalance(reftokenid,coinaddr,false,sum) )
+        return(sum);
     SetCCunspents(unspentOutputs,coinaddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
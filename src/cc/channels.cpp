@@ -397,18 +397,39 @@ bool ChannelsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &
 
 // helper functions for rpc calls in rpcwallet.cpp
 
+// the secret n payments further up the hashchain
+static uint256 ChannelsHashSecret(uint256 secret,int32_t n)
+{
+    uint8_t hash[32],hashdest[32]; int32_t i;
+    endiancpy(hash,(uint8_t *)&secret,32);
+    for (i=0; i<n; i++)
+    {
+        vcalc_sha256(0,hashdest,hash,32);
+        memcpy(hash,hashdest,32);
+    }
+    endiancpy((uint8_t *)&secret,hash,32);
+    return(secret);
+}
+
 int64_t AddChannelsInputs(struct CCcontract_info *cp,CMutableTransaction &mtx, CTransaction openTx, uint256 &prevtxid, CPubKey mypk)
 {
     char coinaddr[65]; int64_t param2,totalinputs = 0,numvouts; uint256 txid=zeroid,tmp_txid,hashBlock,param3,tokenid; CTransaction tx; int32_t marker,param1;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
-    CPubKey srcpub,destpub;
+    CPubKey srcpub,destpub; CChannelState state; bool fIndexed,fFound;
     uint8_t myprivkey[32];    
 
     if ((numvouts=openTx.vout.size()) > 0 && DecodeChannelsOpRet(openTx.vout[numvouts-1].scriptPubKey,tokenid,tmp_txid,srcpub,destpub,param1,param2,param3)=='O')
     {
         if (tokenid!=zeroid) GetTokensCCaddress1of2(cp,coinaddr,srcpub,destpub);
         else GetCCaddress1of2(cp,coinaddr,srcpub,destpub);
-        SetCCunspents(unspentOutputs,coinaddr);
+        // the channel's last tx, with the mempool's payments on it
+        if ((fIndexed=GetChannelState(openTx.GetHash(),true,state,fFound)) == 0)
+            SetCCunspents(unspentOutputs,coinaddr);
+        else if (fFound != 0 && state.nFunds > 0)
+        {
+            txid = state.txid;
+            totalinputs = state.nFunds;
+        }
     }
     else
     {
@@ -430,7 +451,7 @@ int64_t AddChannelsInputs(struct CCcontract_info *cp,CMutableTransaction &mtx, C
             }
         }
     }
-    if (txid!=zeroid && myIsutxo_spentinmempool(txid,0) != 0)
+    if (fIndexed == 0 && txid!=zeroid && myIsutxo_spentinmempool(txid,0) != 0)
     {
         txid=zeroid;
         int32_t mindepth=CHANNELS_MAXPAYMENTS;
@@ -514,7 +535,7 @@ std::string ChannelPayment(uint64_t txfee,uint256 opentxid,int64_t amount, uint2
     struct CCcontract_info *cp,C; int32_t i,funcid,prevdepth,numvouts,numpayments,totalnumpayments;
     int64_t payment,change,funds,param2;
     uint8_t hash[32],hashdest[32];
-    CTransaction channelOpenTx,prevTx;
+    CTransaction channelOpenTx,prevTx; CChannelState state; bool fFound;
 
     cp = CCinit(&C,EVAL_CHANNELS);
     if ( txfee == 0 )
@@ -552,9 +573,16 @@ std::string ChannelPayment(uint64_t txfee,uint256 opentxid,int64_t amount, uint2
         if ((funds=AddChannelsInputs(cp,mtx,channelOpenTx,prevtxid,mypk)) !=0 && (change=funds-amount)>=0)
         {            
             numpayments=amount/payment;
-            if (GetTransaction(prevtxid,prevTx,hashblock,false) != 0 && (numvouts=prevTx.vout.size()) > 0 &&
-                ((funcid = DecodeChannelsOpRet(prevTx.vout[numvouts-1].scriptPubKey, tokenid, txid, srcpub, destpub, prevdepth, param2, param3)) != 0) &&
-                (funcid == 'P' || funcid=='O'))
+            // the index knows the depth and the last secret of the channel, so a secret is checked by hashing it numpayments times only
+            if (GetChannelState(opentxid,true,state,fFound) != 0 && fFound != 0 && state.txid == prevtxid)
+            {
+                funcid = state.funcid;
+                prevdepth = state.depth;
+            }
+            else if (GetTransaction(prevtxid,prevTx,hashblock,false) == 0 || (numvouts=prevTx.vout.size()) == 0 ||
+                (funcid = DecodeChannelsOpRet(prevTx.vout[numvouts-1].scriptPubKey, tokenid, txid, srcpub, destpub, prevdepth, param2, param3)) == 0)
+                funcid = 0;
+            if (funcid == 'P' || funcid=='O')
             {
                 if (numpayments > prevdepth)
                 {
@@ -567,7 +595,16 @@ std::string ChannelPayment(uint64_t txfee,uint256 opentxid,int64_t amount, uint2
                     fprintf(stderr,"%s\n",CCerror.c_str());
                     return ("");
                 }
-                if (secret!=zeroid)
+                if (secret!=zeroid && state.txid == prevtxid)
+                {
+                    if (ChannelsHashSecret(secret,numpayments)!=state.secret)
+                    {
+                        CCerror = strprintf("invalid secret supplied");
+                        fprintf(stderr,"%s\n",CCerror.c_str());
+                        return("");
+                    }
+                }
+                else if (secret!=zeroid)
                 {
                     endiancpy(hash, (uint8_t * ) & secret, 32);
                     for (i = 0; i < totalnumpayments-(prevdepth-numpayments); i++)
@@ -796,7 +833,7 @@ UniValue ChannelsInfo(uint256 channeltxid)
     UniValue result(UniValue::VOBJ),array(UniValue::VARR); CTransaction tx,opentx; uint256 txid,tmp_txid,hashBlock,param3,opentxid,hashchain,prevtxid,tokenid;
     struct CCcontract_info *cp,C; char CCaddr[65],addr[65],str[512]; int32_t vout,numvouts,param1,numpayments;
     int64_t param2,payment; CPubKey srcpub,destpub,mypk;
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex; std::vector<uint256> txids;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex; std::vector<uint256> txids; std::vector<CChannelTx> ctxs;
     
     cp = CCinit(&C,EVAL_CHANNELS);
     mypk = pubkey2pk(Mypubkey());
@@ -821,6 +858,39 @@ UniValue ChannelsInfo(uint256 channeltxid)
             result.push_back(Pair("Denomination (satoshi)",i64tostr(param2)));
             result.push_back(Pair("Amount (satoshi)",i64tostr(param1*param2)));
         }        
+        if (GetChannelTxs(channeltxid,true,ctxs) != 0)
+        {
+            payment=param2;
+            BOOST_FOREACH(const CChannelTx &ctx,ctxs)
+            {
+                UniValue obj(UniValue::VOBJ);
+                switch (ctx.funcid)
+                {
+                    case 'O':
+                        obj.push_back(Pair("Open",ctx.txid.GetHex().data()));
+                        break;
+                    case 'P':
+                        obj.push_back(Pair("Payment",ctx.txid.GetHex().data()));
+                        obj.push_back(Pair("Number of payments",ctx.param2));
+                        obj.push_back(Pair("Amount",ctx.param2*payment));
+                        obj.push_back(Pair("Destination",ctx.destaddr));
+                        obj.push_back(Pair("Secret",ctx.param3.ToString().c_str()));
+                        obj.push_back(Pair("Payments left",ctx.param1));
+                        break;
+                    case 'C':
+                        obj.push_back(Pair("Close",ctx.txid.GetHex().data()));
+                        break;
+                    case 'R':
+                        obj.push_back(Pair("Refund",ctx.txid.GetHex().data()));
+                        obj.push_back(Pair("Amount",ctx.param1*ctx.param2));
+                        obj.push_back(Pair("Destination",ctx.destaddr));
+                        break;
+                }
+                array.push_back(obj);
+            }
+            result.push_back(Pair("Transactions",array));
+            return(result);
+        }
         SetCCtxids(addressIndex,CCaddr);                      
         for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++)
         {
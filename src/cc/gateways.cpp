@@ -457,11 +457,20 @@ int32_t GatewaysCointxidExists(struct CCcontract_info *cp,uint256 cointxid)
 {
     char txidaddr[64]; std::string coin; int32_t numvouts; uint256 hashBlock;
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    uint256 deposittxid; bool fFound;
     CCtxidaddr(txidaddr,cointxid);
-    SetCCtxids(addressIndex,txidaddr);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++)
+    if ( GetGatewaysCointxidDeposit(cointxid,deposittxid,fFound) != 0 )
     {
-        return(-1);
+        if ( fFound )
+            return(-1);
+    }
+    else
+    {
+        SetCCtxids(addressIndex,txidaddr);
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++)
+        {
+            return(-1);
+        }
     }
     return(myIs_coinaddr_inmempoolvout(txidaddr));
 }
@@ -1177,7 +1186,7 @@ std::string GatewaysWithdraw(uint64_t txfee,uint256 bindtxid,std::string refcoin
     CTransaction tx; CPubKey mypk,gatewayspk,signerpk; uint256 txid,tokenid,hashBlock,oracletxid,tmptokenid,tmpbindtxid,withdrawtxid; int32_t vout,numvouts;
     int64_t nValue,totalsupply,inputs,CCchange=0; uint8_t funcid,K,M,N,taddr,prefix,prefix2; std::string coin,hex;
     std::vector<CPubKey> msigpubkeys; char depositaddr[64],str[65],coinaddr[64]; struct CCcontract_info *cp,C,*cpTokens,CTokens;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; std::vector<CGatewaysWithdraw> withdraws;
 
     cp = CCinit(&C,EVAL_GATEWAYS);
     cpTokens = CCinit(&CTokens,EVAL_TOKENS);
@@ -1197,7 +1206,19 @@ std::string GatewaysWithdraw(uint64_t txfee,uint256 bindtxid,std::string refcoin
         return("");
     }
     _GetCCaddress(coinaddr,EVAL_GATEWAYS,gatewayspk);
-    SetCCunspents(unspentOutputs,coinaddr);
+    if ( GetGatewaysWithdraws(bindtxid,withdraws) != 0 )
+    {
+        for (std::vector<CGatewaysWithdraw>::const_iterator it=withdraws.begin(); it!=withdraws.end(); it++)
+        {
+            if ( !it->fComplete && it->coin == refcoin && it->tokenid == tokenid )
+            {
+                CCerror = strprintf("unable to create withdraw, another withdraw pending\n");
+                fprintf(stderr,"%s\n", CCerror.c_str() );
+                return("");
+            }
+        }
+    }
+    else SetCCunspents(unspentOutputs,coinaddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
         txid = it->first.txhash;
@@ -1466,14 +1487,29 @@ std::string GatewaysMarkDone(uint64_t txfee,uint256 completetxid,std::string ref
     return(FinalizeCCTx(0,cp,mtx,mypk,txfee,EncodeGatewaysMarkDoneOpRet('M',withdrawtxid,refcoin,completetxid)));
 }
 
+static UniValue GatewaysPendingDepositJson(const CGatewaysDeposit &deposit)
+{
+    UniValue obj(UniValue::VOBJ); char str[65],destaddr[65],txidaddr[65];
+    obj.push_back(Pair("cointxid",uint256_str(str,deposit.cointxid)));
+    obj.push_back(Pair("deposittxid",uint256_str(str,deposit.deposittxid)));
+    CCtxidaddr(txidaddr,deposit.deposittxid);
+    obj.push_back(Pair("deposittxidaddr",txidaddr));
+    _GetCCaddress(destaddr,EVAL_TOKENS,deposit.destpub);
+    obj.push_back(Pair("tokens_destination_address",destaddr));
+    obj.push_back(Pair("claim_pubkey",HexStr(deposit.destpub)));
+    obj.push_back(Pair("amount",(double)deposit.amount/COIN));
+    obj.push_back(Pair("confirmed_or_notarized",komodo_txnotarizedconfirmed(deposit.deposittxid)));
+    return(obj);
+}
+
 UniValue GatewaysPendingDeposits(uint256 bindtxid,std::string refcoin)
 {
     UniValue result(UniValue::VOBJ),pending(UniValue::VARR); CTransaction tx; std::string coin,hex,pub; 
     CPubKey mypk,gatewayspk,destpub; std::vector<CPubKey> pubkeys,publishers; std::vector<uint256> txids;
     uint256 tmpbindtxid,hashBlock,txid,tokenid,oracletxid,cointxid; uint8_t M,N,taddr,prefix,prefix2;
-    char depositaddr[65],coinaddr[65],str[65],destaddr[65],txidaddr[65]; std::vector<uint8_t> proof;
+    char depositaddr[65],coinaddr[65],str[65]; std::vector<uint8_t> proof;
     int32_t numvouts,vout,claimvout,height; int64_t totalsupply,nValue,amount; struct CCcontract_info *cp,C;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; std::vector<CGatewaysDeposit> deposits;
 
     cp = CCinit(&C,EVAL_GATEWAYS);
     mypk = pubkey2pk(Mypubkey());
@@ -1491,7 +1527,15 @@ UniValue GatewaysPendingDeposits(uint256 bindtxid,std::string refcoin)
         fprintf(stderr,"%s\n", CCerror.c_str() );
         return("");
     }  
-    SetCCunspents(unspentOutputs,coinaddr);    
+    if ( GetGatewaysDeposits(bindtxid,deposits) != 0 )
+    {
+        for (std::vector<CGatewaysDeposit>::const_iterator it=deposits.begin(); it!=deposits.end(); it++)
+        {
+            if ( it->coin == refcoin && it->markeraddr == coinaddr && myIsutxo_spentinmempool(it->deposittxid,0) == 0 )
+                pending.push_back(GatewaysPendingDepositJson(*it));
+        }
+    }
+    else SetCCunspents(unspentOutputs,coinaddr);    
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
         txid = it->first.txhash;
@@ -1501,18 +1545,12 @@ UniValue GatewaysPendingDeposits(uint256 bindtxid,std::string refcoin)
             DecodeGatewaysDepositOpRet(tx.vout[numvouts-1].scriptPubKey,tmpbindtxid,coin,publishers,txids,height,cointxid,claimvout,hex,proof,destpub,amount) == 'D'
             && tmpbindtxid==bindtxid && refcoin == coin && myIsutxo_spentinmempool(txid,vout) == 0)
         {   
-            UniValue obj(UniValue::VOBJ);
-            obj.push_back(Pair("cointxid",uint256_str(str,cointxid)));
-            obj.push_back(Pair("deposittxid",uint256_str(str,txid)));  
-            CCtxidaddr(txidaddr,txid);
-            obj.push_back(Pair("deposittxidaddr",txidaddr));              
-            _GetCCaddress(destaddr,EVAL_TOKENS,destpub);
-            obj.push_back(Pair("tokens_destination_address",destaddr));
-            pub=HexStr(destpub);
-            obj.push_back(Pair("claim_pubkey",pub));
-            obj.push_back(Pair("amount",(double)amount/COIN));
-            obj.push_back(Pair("confirmed_or_notarized",komodo_txnotarizedconfirmed(txid)));        
-            pending.push_back(obj);
+            CGatewaysDeposit deposit;
+            deposit.deposittxid = txid;
+            deposit.cointxid = cointxid;
+            deposit.destpub = destpub;
+            deposit.amount = amount;
+            pending.push_back(GatewaysPendingDepositJson(deposit));
         }
     }
     result.push_back(Pair("coin",refcoin));
@@ -1520,13 +1558,39 @@ UniValue GatewaysPendingDeposits(uint256 bindtxid,std::string refcoin)
     return(result);
 }
 
+static UniValue GatewaysPendingWithdrawJson(const CGatewaysWithdraw &withdraw,int32_t queueflag,char *depositaddr,CPubKey mypk,uint8_t N)
+{
+    UniValue obj(UniValue::VOBJ); char str[65],withaddr[65],numstr[32],signeraddr[65],txidaddr[65];
+    obj.push_back(Pair("withdrawtxid",uint256_str(str,withdraw.withdrawtxid)));
+    CCtxidaddr(txidaddr,withdraw.withdrawtxid);
+    obj.push_back(Pair("withdrawtxidaddr",txidaddr));
+    Getscriptaddress(withaddr,CScript() << ParseHex(HexStr(withdraw.withdrawpub)) << OP_CHECKSIG);
+    obj.push_back(Pair("withdrawaddr",withaddr));
+    sprintf(numstr,"%.8f",(double)withdraw.amount/COIN);
+    obj.push_back(Pair("amount",numstr));                
+    obj.push_back(Pair("confirmed_or_notarized",komodo_txnotarizedconfirmed(withdraw.withdrawtxid)));
+    if ( queueflag != 0 )
+    {
+        obj.push_back(Pair("depositaddr",depositaddr));
+        Getscriptaddress(signeraddr,CScript() << ParseHex(HexStr(mypk)) << OP_CHECKSIG);
+        obj.push_back(Pair("signeraddr",signeraddr));
+    }
+    if (N>1)
+    {
+        obj.push_back(Pair("number_of_signs",withdraw.K));
+        obj.push_back(Pair("last_txid",uint256_str(str,withdraw.lasttxid)));
+        if (withdraw.K>0) obj.push_back(Pair("hex",withdraw.hex));
+    }
+    return(obj);
+}
+
 UniValue GatewaysPendingWithdraws(uint256 bindtxid,std::string refcoin)
 {
     UniValue result(UniValue::VOBJ),pending(UniValue::VARR); CTransaction tx; std::string coin,hex; CPubKey mypk,gatewayspk,withdrawpub,signerpk;
     std::vector<CPubKey> msigpubkeys; uint256 hashBlock,tokenid,txid,tmpbindtxid,tmptokenid,oracletxid,withdrawtxid; uint8_t K,M,N,taddr,prefix,prefix2;
-    char funcid,depositaddr[65],coinaddr[65],tokensaddr[65],destaddr[65],str[65],withaddr[65],numstr[32],signeraddr[65],txidaddr[65];
+    char funcid,depositaddr[65],coinaddr[65],tokensaddr[65],destaddr[65],str[65];
     int32_t i,n,numvouts,vout,queueflag; int64_t totalsupply,amount,nValue; struct CCcontract_info *cp,C;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; std::vector<CGatewaysWithdraw> withdraws;
 
     cp = CCinit(&C,EVAL_GATEWAYS);
     mypk = pubkey2pk(Mypubkey());
@@ -1553,7 +1617,15 @@ UniValue GatewaysPendingWithdraws(uint256 bindtxid,std::string refcoin)
             queueflag = 1;
             break;
         }    
-    SetCCunspents(unspentOutputs,coinaddr);    
+    if ( GetGatewaysWithdraws(bindtxid,withdraws) != 0 )
+    {
+        for (std::vector<CGatewaysWithdraw>::const_iterator it=withdraws.begin(); it!=withdraws.end(); it++)
+        {
+            if ( !it->fComplete && it->coin == refcoin && it->tokenid == tokenid && myIsutxo_spentinmempool(it->lasttxid,0) == 0 )
+                pending.push_back(GatewaysPendingWithdrawJson(*it,queueflag,depositaddr,mypk,N));
+        }
+    }
+    else SetCCunspents(unspentOutputs,coinaddr);    
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
         txid = it->first.txhash;
@@ -1575,30 +1647,16 @@ UniValue GatewaysPendingWithdraws(uint256 bindtxid,std::string refcoin)
                     continue;                    
             }      
             Getscriptaddress(destaddr,tx.vout[1].scriptPubKey);
-            Getscriptaddress(withaddr,CScript() << ParseHex(HexStr(withdrawpub)) << OP_CHECKSIG);
             if ( strcmp(destaddr,tokensaddr) == 0 )
             {
-                UniValue obj(UniValue::VOBJ);
-                obj.push_back(Pair("withdrawtxid",uint256_str(str,tx.GetHash())));
-                CCtxidaddr(txidaddr,tx.GetHash());
-                obj.push_back(Pair("withdrawtxidaddr",txidaddr));
-                obj.push_back(Pair("withdrawaddr",withaddr));
-                sprintf(numstr,"%.8f",(double)tx.vout[1].nValue/COIN);
-                obj.push_back(Pair("amount",numstr));                
-                obj.push_back(Pair("confirmed_or_notarized",komodo_txnotarizedconfirmed(tx.GetHash())));
-                if ( queueflag != 0 )
-                {
-                    obj.push_back(Pair("depositaddr",depositaddr));
-                    Getscriptaddress(signeraddr,CScript() << ParseHex(HexStr(mypk)) << OP_CHECKSIG);
-                    obj.push_back(Pair("signeraddr",signeraddr));
-                }
-                if (N>1)
-                {
-                    obj.push_back(Pair("number_of_signs",K));
-                    obj.push_back(Pair("last_txid",uint256_str(str,txid)));
-                    if (K>0) obj.push_back(Pair("hex",hex));
-                }
-                pending.push_back(obj);
+                CGatewaysWithdraw withdraw;
+                withdraw.withdrawtxid = tx.GetHash();
+                withdraw.withdrawpub = withdrawpub;
+                withdraw.amount = tx.vout[1].nValue;
+                withdraw.lasttxid = txid;
+                withdraw.K = K;
+                withdraw.hex = hex;
+                pending.push_back(GatewaysPendingWithdrawJson(withdraw,queueflag,depositaddr,mypk,N));
             }
         }
     }
@@ -1608,14 +1666,29 @@ UniValue GatewaysPendingWithdraws(uint256 bindtxid,std::string refcoin)
     return(result);
 }
 
+static UniValue GatewaysProcessedWithdrawJson(const CGatewaysWithdraw &withdraw)
+{
+    UniValue obj(UniValue::VOBJ); char str[65],numstr[32],withaddr[65],txidaddr[65];
+    obj.push_back(Pair("completesigningtxid",uint256_str(str,withdraw.lasttxid)));
+    obj.push_back(Pair("withdrawtxid",uint256_str(str,withdraw.withdrawtxid)));  
+    CCtxidaddr(txidaddr,withdraw.withdrawtxid);
+    obj.push_back(Pair("withdrawtxidaddr",txidaddr));              
+    Getscriptaddress(withaddr,CScript() << ParseHex(HexStr(withdraw.withdrawpub)) << OP_CHECKSIG);
+    obj.push_back(Pair("withdrawaddr",withaddr));
+    sprintf(numstr,"%.8f",(double)withdraw.amount/COIN);
+    obj.push_back(Pair("amount",numstr));
+    obj.push_back(Pair("hex",withdraw.hex));                
+    return(obj);
+}
+
 UniValue GatewaysProcessedWithdraws(uint256 bindtxid,std::string refcoin)
 {
     UniValue result(UniValue::VOBJ),processed(UniValue::VARR); CTransaction tx; std::string coin,hex; 
     CPubKey mypk,gatewayspk,withdrawpub; std::vector<CPubKey> msigpubkeys;
     uint256 withdrawtxid,hashBlock,txid,tokenid,tmptokenid,oracletxid; uint8_t K,M,N,taddr,prefix,prefix2;
-    char depositaddr[65],coinaddr[65],str[65],numstr[32],withaddr[65],txidaddr[65];
+    char depositaddr[65],coinaddr[65],str[65];
     int32_t i,n,numvouts,vout,queueflag; int64_t totalsupply,nValue,amount; struct CCcontract_info *cp,C;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; std::vector<CGatewaysWithdraw> withdraws;
 
     cp = CCinit(&C,EVAL_GATEWAYS);
     mypk = pubkey2pk(Mypubkey());
@@ -1641,7 +1714,15 @@ UniValue GatewaysProcessedWithdraws(uint256 bindtxid,std::string refcoin)
             queueflag = 1;
             break;
         }    
-    SetCCunspents(unspentOutputs,coinaddr);    
+    if ( GetGatewaysWithdraws(bindtxid,withdraws) != 0 )
+    {
+        for (std::vector<CGatewaysWithdraw>::const_iterator it=withdraws.begin(); it!=withdraws.end(); it++)
+        {
+            if ( it->fComplete && it->coin == refcoin && it->tokenid == tokenid && myIsutxo_spentinmempool(it->lasttxid,0) == 0 )
+                processed.push_back(GatewaysProcessedWithdrawJson(*it));
+        }
+    }
+    else SetCCunspents(unspentOutputs,coinaddr);    
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
         txid = it->first.txhash;
@@ -1653,17 +1734,13 @@ UniValue GatewaysProcessedWithdraws(uint256 bindtxid,std::string refcoin)
             if (GetTransaction(withdrawtxid,tx,hashBlock,false) != 0 && (numvouts= tx.vout.size())>0
                 && DecodeGatewaysWithdrawOpRet(tx.vout[numvouts-1].scriptPubKey,tmptokenid,bindtxid,coin,withdrawpub,amount) == 'W' || refcoin!=coin || tmptokenid!=tokenid)          
             {
-                UniValue obj(UniValue::VOBJ);
-                obj.push_back(Pair("completesigningtxid",uint256_str(str,txid)));
-                obj.push_back(Pair("withdrawtxid",uint256_str(str,withdrawtxid)));  
-                CCtxidaddr(txidaddr,withdrawtxid);
-                obj.push_back(Pair("withdrawtxidaddr",txidaddr));              
-                Getscriptaddress(withaddr,CScript() << ParseHex(HexStr(withdrawpub)) << OP_CHECKSIG);
-                obj.push_back(Pair("withdrawaddr",withaddr));
-                sprintf(numstr,"%.8f",(double)tx.vout[1].nValue/COIN);
-                obj.push_back(Pair("amount",numstr));
-                obj.push_back(Pair("hex",hex));                
-                processed.push_back(obj);            
+                CGatewaysWithdraw withdraw;
+                withdraw.withdrawtxid = withdrawtxid;
+                withdraw.withdrawpub = withdrawpub;
+                withdraw.amount = tx.vout[1].nValue;
+                withdraw.lasttxid = txid;
+                withdraw.hex = hex;
+                processed.push_back(GatewaysProcessedWithdrawJson(withdraw));
             }
         }
     }
@@ -486,13 +486,13 @@ int64_t correlate_price(int32_t height,int64_t *prices,int32_t n)
 
 int64_t OracleCorrelatedPrice(int32_t height,std::vector <int64_t> origprices)
 {
-    std::vector <int64_t> sorted; int32_t i,n; int64_t *prices,price;
+    int32_t i,n; int64_t *prices,price;
     if ( (n= origprices.size()) == 1 )
         return(origprices[0]);
     std::sort(origprices.begin(), origprices.end());
     prices = (int64_t *)calloc(n,sizeof(*prices));
     i = 0;
-    for (std::vector<int64_t>::const_iterator it=sorted.begin(); it!=sorted.end(); it++)
+    for (std::vector<int64_t>::const_iterator it=origprices.begin(); it!=origprices.end(); it++)
         prices[i++] = *it;
     price = correlate_price(height,prices,i);
     free(prices);
@@ -531,6 +531,8 @@ int64_t OraclePrice(int32_t height,uint256 reforacletxid,char *markeraddr,char *
     CTransaction regtx; uint256 hash,txid,oracletxid,batontxid; CPubKey pk; int32_t i,ht,maxheight=0; int64_t datafee,price; char batonaddr[64]; std::vector <uint8_t> data; struct CCcontract_info *cp,C; std::vector <struct oracleprice_info> publishers; std::vector <int64_t> prices;
     if ( format[0] != 'L' )
         return(0);
+    if ( GetOracleCorrelatedPrice(reforacletxid,height,price) )
+        return(price);
     cp = CCinit(&C,EVAL_ORACLES);
     SetCCunspents(unspentOutputs,markeraddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
@@ -948,12 +950,25 @@ UniValue OracleDataSamples(uint256 reforacletxid,uint256 batontxid,int32_t num)
     {
         if ( DecodeOraclesCreateOpRet(oracletx.vout[numvouts-1].scriptPubKey,name,description,format) == 'C' )
         {
-            while ( GetTransaction(batontxid,tx,hashBlock,false) != 0 && (numvouts=tx.vout.size()) > 0 )
+            if ( (formatstr= (char *)format.c_str()) == 0 )
+                formatstr = (char *)"";
+            while ( n < num )
             {
+                // once the baton chain is confirmed the index has the rest of it
+                std::vector<COracleSample> samples; bool fFound = false;
+                if ( GetOracleSamplesFrom(batontxid,num-n,oracletxid,samples,fFound) && fFound )
+                {
+                    if ( oracletxid == reforacletxid )
+                    {
+                        for (std::vector<COracleSample>::const_iterator it=samples.begin(); it!=samples.end(); it++)
+                            a.push_back(OracleFormat((uint8_t *)it->data.data(),(int32_t)it->data.size(),formatstr,(int32_t)format.size()));
+                    }
+                    break;
+                }
+                if ( GetTransaction(batontxid,tx,hashBlock,false) == 0 || (numvouts=tx.vout.size()) <= 0 )
+                    break;
                 if ( DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) == 'D' && reforacletxid == oracletxid )
                 {
-                    if ( (formatstr= (char *)format.c_str()) == 0 )
-                        formatstr = (char *)"";
                     a.push_back(OracleFormat((uint8_t *)data.data(),(int32_t)data.size(),formatstr,(int32_t)format.size()));
                     batontxid = btxid;
                     if ( ++n >= num )
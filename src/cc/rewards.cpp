@@ -66,6 +66,32 @@
  
  */
 
+int64_t RewardsCalcDuration(int64_t amount,uint64_t duration,uint64_t APR,uint64_t minseconds,uint64_t maxseconds)
+{
+    uint64_t reward = 0;
+    if ( duration < minseconds )
+        return(0);
+    else if ( duration > maxseconds )
+        duration = maxseconds;
+    if ( 0 ) // amount * APR * duration / COIN * 100 * 365*24*3600
+        reward = (((amount * APR) / COIN) * duration) / (365*24*3600LL * 100);
+    else reward = (((amount * duration) / (365 * 24 * 3600LL)) * (APR / 1000000)) / 10000;
+    if ( reward > amount )
+        reward = amount;
+    return(reward);
+}
+
+// CCduration() of a tx confirmed at height, with the tip looked up once by the caller
+uint64_t RewardsLockDuration(int32_t height,CBlockIndex *tipindex)
+{
+    CBlockIndex *pindex;
+    if ( height <= 0 || height > chainActive.Height() || (pindex= chainActive[height]) == 0 || pindex->nTime == 0 )
+        return(0);
+    else if ( tipindex == 0 || tipindex->nTime < pindex->nTime || tipindex->GetHeight() <= height )
+        return(0);
+    return(tipindex->nTime - pindex->nTime);
+}
+
 int64_t RewardsCalc(int64_t amount,uint256 txid,uint64_t APR,uint64_t minseconds,uint64_t maxseconds,uint64_t mindeposit)
 {
     int32_t numblocks; uint64_t duration,reward = 0;
@@ -77,11 +103,7 @@ int64_t RewardsCalc(int64_t amount,uint256 txid,uint64_t APR,uint64_t minseconds
         //duration = (uint32_t)time(NULL) - (1532713903 - 3600 * 24);
     } else if ( duration > maxseconds )
         duration = maxseconds;
-    if ( 0 ) // amount * APR * duration / COIN * 100 * 365*24*3600
-        reward = (((amount * APR) / COIN) * duration) / (365*24*3600LL * 100);
-    else reward = (((amount * duration) / (365 * 24 * 3600LL)) * (APR / 1000000)) / 10000;
-    if ( reward > amount )
-        reward = amount;
+    reward = RewardsCalcDuration(amount,duration,APR,minseconds,maxseconds);
     fprintf(stderr,"amount %.8f %.8f %llu -> duration.%llu reward %.8f vals %.8f %.8f\n",(double)amount/COIN,((double)amount * APR)/COIN,(long long)((amount * APR) / (COIN * 365*24*3600)),(long long)duration,(double)reward/COIN,(double)((amount * duration) / (365 * 24 * 3600LL))/COIN,(double)(((amount * duration) / (365 * 24 * 3600LL)) * (APR / 1000000))/COIN);
     return(reward);
 }
@@ -330,10 +352,42 @@ static uint64_t myIs_unlockedtx_inmempool(uint256 &txid,int32_t &vout,uint64_t r
 int64_t AddRewardsInputs(CScript &scriptPubKey,uint64_t maxseconds,struct CCcontract_info *cp,CMutableTransaction &mtx,CPubKey pk,int64_t total,int32_t maxinputs,uint64_t refsbits,uint256 reffundingtxid)
 {
     char coinaddr[64],str[65]; uint64_t threshold,sbits,nValue,totalinputs = 0; uint256 txid,hashBlock,fundingtxid; CTransaction tx; int32_t numblocks,j,vout,n = 0; uint8_t funcid;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; rewards_utxos_type utxos; CBlockIndex *tipindex;
     GetCCaddress(cp,coinaddr,pk);
-    SetCCunspents(unspentOutputs,coinaddr);
     threshold = total/(maxinputs+1);
+    if ( GetRewardsUtxos(reffundingtxid,utxos) != 0 && strcmp(coinaddr,cp->unspendableCCaddr) == 0 )
+    {
+        // the plan's own vouts, without a tx lookup for each
+        tipindex = chainActive.LastTip();
+        for (rewards_utxos_type::const_iterator it=utxos.begin(); it!=utxos.end(); it++)
+        {
+            txid = it->first.hash;
+            vout = (int32_t)it->first.n;
+            funcid = it->second.funcid;
+            if ( it->second.nValue < threshold || it->second.sbits != refsbits )
+                continue;
+            for (j=0; j<mtx.vin.size(); j++)
+                if ( txid == mtx.vin[j].prevout.hash && vout == mtx.vin[j].prevout.n )
+                    break;
+            if ( j != mtx.vin.size() || myIsutxo_spentinmempool(txid,vout) != 0 )
+                continue;
+            if ( maxseconds == 0 && funcid != 'F' && funcid != 'A' && funcid != 'U' )
+                continue;
+            else if ( maxseconds != 0 && funcid != 'L' && RewardsLockDuration(it->second.nHeight,tipindex) < maxseconds )
+                continue;
+            if ( total != 0 && maxinputs != 0 )
+            {
+                if ( maxseconds != 0 )
+                    scriptPubKey = it->second.scriptPubKey;
+                mtx.vin.push_back(CTxIn(txid,vout,CScript()));
+            }
+            totalinputs += it->second.nValue;
+            n++;
+            if ( (total > 0 && totalinputs >= total) || (maxinputs > 0 && n >= maxinputs) )
+                break;
+        }
+    }
+    else SetCCunspents(unspentOutputs,coinaddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
         txid = it->first.txhash;
@@ -390,9 +444,16 @@ int64_t AddRewardsInputs(CScript &scriptPubKey,uint64_t maxseconds,struct CCcont
 int64_t RewardsPlanFunds(uint64_t &lockedfunds,uint64_t refsbits,struct CCcontract_info *cp,CPubKey pk,uint256 reffundingtxid)
 {
     char coinaddr[64]; uint64_t sbits; int64_t nValue,totalinputs = 0; uint256 txid,hashBlock,fundingtxid; CTransaction tx; int32_t vout; uint8_t funcid;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; CRewardsPlan plan; bool fFound;
     lockedfunds = 0;
     GetCCaddress(cp,coinaddr,pk);
+    if ( strcmp(coinaddr,cp->unspendableCCaddr) == 0 && GetRewardsPlan(reffundingtxid,plan,fFound) != 0 )
+    {
+        if ( fFound == 0 )
+            return(0);
+        lockedfunds = plan.nLocked;
+        return(plan.nFunding);
+    }
     SetCCunspents(unspentOutputs,coinaddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
@@ -420,9 +481,19 @@ int64_t RewardsPlanFunds(uint64_t &lockedfunds,uint64_t refsbits,struct CCcontra
 
 bool RewardsPlanExists(struct CCcontract_info *cp,uint64_t refsbits,CPubKey rewardspk,uint64_t &APR,uint64_t &minseconds,uint64_t &maxseconds,uint64_t &mindeposit)
 {
-    char CCaddr[64]; uint64_t sbits; uint256 txid,hashBlock; CTransaction tx;
+    char CCaddr[64]; uint64_t sbits; uint256 txid,hashBlock; CTransaction tx; CRewardsPlan plan; bool fFound;
     std::vector<std::pair<CAddressIndexKey, CAmount> > txids;
     GetCCaddress(cp,CCaddr,rewardspk);
+    if ( strcmp(CCaddr,cp->unspendableCCaddr) == 0 && GetRewardsPlanBySbits(refsbits,plan,fFound) != 0 )
+    {
+        if ( fFound == 0 )
+            return(false);
+        APR = plan.APR;
+        minseconds = plan.minseconds;
+        maxseconds = plan.maxseconds;
+        mindeposit = plan.mindeposit;
+        return(true);
+    }
     SetCCtxids(txids,CCaddr);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=txids.begin(); it!=txids.end(); it++)
     {
@@ -476,12 +547,27 @@ UniValue RewardsInfo(uint256 rewardsid)
     result.push_back(Pair("funding",numstr));
     sprintf(numstr,"%.8f",(double)lockedfunds/COIN);
     result.push_back(Pair("locked",numstr));
+    CRewardsPlan plan; rewards_utxos_type utxos; std::vector<int64_t> rewards; bool fFound;
+    if ( GetRewardsPlan(rewardsid,plan,fFound) != 0 && fFound != 0 && GetRewardsUtxos(rewardsid,utxos) != 0 )
+    {
+        // what the locks would get if they were all unlocked now
+        result.push_back(Pair("locks",plan.nLocks));
+        sprintf(numstr,"%.8f",(double)RewardsPlanAccrual(plan,utxos,rewards)/COIN);
+        result.push_back(Pair("accrued",numstr));
+    }
     return(result);
 }
 
 UniValue RewardsList()
 {
     UniValue result(UniValue::VARR); std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex; struct CCcontract_info *cp,C; uint256 txid,hashBlock; CTransaction vintx; uint64_t sbits,APR,minseconds,maxseconds,mindeposit; char str[65];
+    std::vector<CRewardsPlan> plans;
+    if ( GetRewardsPlans(plans) != 0 )
+    {
+        for (std::vector<CRewardsPlan>::const_iterator it=plans.begin(); it!=plans.end(); it++)
+            result.push_back(uint256_str(str,it->fundingtxid));
+        return(result);
+    }
     cp = CCinit(&C,EVAL_REWARDS);
     SetCCtxids(addressIndex,cp->normaladdr);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++)
@@ -615,7 +701,8 @@ std::string RewardsLock(uint64_t txfee,char *planstr,uint256 fundingtxid,int64_t
 std::string RewardsUnlock(uint64_t txfee,char *planstr,uint256 fundingtxid,uint256 locktxid)
 {
     CMutableTransaction firstmtx,mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
-    CTransaction tx; char coinaddr[64]; CPubKey mypk,rewardspk; CScript scriptPubKey,ignore; uint256 hashBlock; uint64_t sbits,APR,minseconds,maxseconds,mindeposit; int64_t funding,reward=0,amount=0,inputs,CCchange=0; struct CCcontract_info *cp,C;
+    CTransaction tx; char coinaddr[64]; CPubKey mypk,rewardspk; CScript scriptPubKey,ignore; uint256 hashBlock,lockfundingtxid; uint64_t sbits,APR,minseconds,maxseconds,mindeposit; int64_t funding,reward=0,amount=0,inputs,CCchange=0; struct CCcontract_info *cp,C;
+    CRewardsUtxo lockutxo; bool fFound;
     cp = CCinit(&C,EVAL_REWARDS);
     if ( txfee == 0 )
         txfee = 10000;
@@ -637,6 +724,24 @@ std::string RewardsUnlock(uint64_t txfee,char *planstr,uint256 fundingtxid,uint2
     fprintf(stderr,"APR %.8f minseconds.%llu maxseconds.%llu mindeposit %.8f\n",(double)APR/COIN,(long long)minseconds,(long long)maxseconds,(double)mindeposit/COIN);
     if ( locktxid == zeroid )
         amount = AddRewardsInputs(scriptPubKey,maxseconds,cp,mtx,rewardspk,(1LL << 30),1,sbits,fundingtxid);
+    else if ( GetRewardsUtxo(COutPoint(locktxid,0),lockfundingtxid,lockutxo,fFound) != 0 )
+    {
+        if ( fFound == 0 )
+        {
+            fprintf(stderr,"locktxid/v0 is spent\n");
+            CCerror = "locktxid/v0 is spent";
+            return("");
+        }
+        else if ( lockutxo.scriptPubKey.size() == 0 || lockutxo.scriptPubKey.IsPayToCryptoCondition() != 0 )
+        {
+            fprintf(stderr,"no normal vout.1 in locktxid\n");
+            CCerror = "no normal vout.1 in locktxid";
+            return("");
+        }
+        amount = lockutxo.nValue;
+        scriptPubKey = lockutxo.scriptPubKey;
+        mtx.vin.push_back(CTxIn(locktxid,0,CScript()));
+    }
     else
     {
         GetCCaddress(cp,coinaddr,rewardspk);
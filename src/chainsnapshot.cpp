@@ -0,0 +1,51 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "chainsnapshot.h"
+
+#include "chain.h"
+#include "sync.h"
+
+namespace {
+
+//! Only guards swapping the pointer, so it is never held for long
+CCriticalSection cs_snapshot;
+CChainSnapshotRef snapshotCurrent = std::make_shared<const CChainSnapshot>();
+
+}
+
+CChainSnapshot::CChainSnapshot() : pindexTip(NULL), nHeight(-1), nTipTime(0), nNotarizedHeight(0), nPrevMoMHeight(0)
+{
+}
+
+const CBlockIndex* CChainSnapshot::operator[](int nHeightIn) const
+{
+    if (pindexTip == NULL || nHeightIn < 0 || nHeightIn > nHeight)
+        return NULL;
+    return pindexTip->GetAncestor(nHeightIn);
+}
+
+CChainSnapshotRef GetChainSnapshot()
+{
+    LOCK(cs_snapshot);
+    return snapshotCurrent;
+}
+
+void PublishChainSnapshot(const CChainSnapshot& snapshot)
+{
+    CChainSnapshotRef snapshotNew = std::make_shared<const CChainSnapshot>(snapshot);
+    LOCK(cs_snapshot);
+    snapshotCurrent.swap(snapshotNew);
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef BITCOIN_CHAINSNAPSHOT_H
+#define BITCOIN_CHAINSNAPSHOT_H
+
+#include "uint256.h"
+
+#include <stdint.h>
+#include <memory>
+
+class CBlockIndex;
+
+/**
+ * Read-only view of the active chain as of one tip update. Read-only RPCs use
+ * it instead of taking cs_main, so they are not held up while blocks are being
+ * validated. A snapshot never changes once published; the block index entries
+ * it points to are never freed while the node runs, and their headers and pprev
+ * links do not change, so walking back from pindexTip needs no lock either.
+ */
+class CChainSnapshot
+{
+public:
+    const CBlockIndex* pindexTip;
+    int nHeight;
+    uint256 hashTip;
+    int64_t nTipTime;
+
+    //! Latest notarisation of this chain, as komodo_notarized_height() reports it
+    int nNotarizedHeight;
+    uint256 notarizedHash;
+    uint256 notarizedDesttxid;
+    int nPrevMoMHeight;
+
+    CChainSnapshot();
+
+    /** Block at nHeightIn on the snapshot's chain, or NULL if it is above the tip */
+    const CBlockIndex* operator[](int nHeightIn) const;
+};
+
+typedef std::shared_ptr<const CChainSnapshot> CChainSnapshotRef;
+
+/** Latest published snapshot, never NULL. Cheap enough to call per request. */
+CChainSnapshotRef GetChainSnapshot();
+
+/** Replace the published snapshot. Called with cs_main held whenever the tip changes. */
+void PublishChainSnapshot(const CChainSnapshot& snapshot);
+
+#endif // BITCOIN_CHAINSNAPSHOT_H
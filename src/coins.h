@@ -140,6 +140,8 @@ public:
             vout.pop_back();
         if (vout.empty())
             std::vector<CTxOut>().swap(vout);
+        else if (vout.capacity() > 2 * vout.size())
+            vout.shrink_to_fit(); // give a large spent tail back, the cache accounts by capacity
     }
 
     void ClearUnspendable() {
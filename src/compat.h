@@ -88,6 +88,12 @@ typedef u_int SOCKET;
 #define MAX_PATH            1024
 #endif
 
+// Where epoll is available the socket handler uses it instead of select(), and
+// sockets are no longer limited to descriptors below FD_SETSIZE
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+#define USE_EPOLL
+#endif
+
 // As Solaris does not have the MSG_NOSIGNAL flag for send(2) syscall, it is defined as 0
 #if !defined(HAVE_MSG_NOSIGNAL) && !defined(MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
@@ -109,7 +115,7 @@ size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
 bool static inline IsSelectableSocket(SOCKET s) {
-#ifdef _WIN32
+#if defined(_WIN32) || defined(USE_EPOLL)
     return true;
 #else
     return (s < FD_SETSIZE);
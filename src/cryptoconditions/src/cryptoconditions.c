@@ -191,8 +191,101 @@ CC *fulfillmentToCC(Fulfillment_t *ffill) {
 }
 
 
+/*
+ * The content of the DER element at p with the given tag, its length in len, or NULL.
+ * Only the short and the one byte long form are taken, and only when minimal.
+ */
+static const unsigned char *derElement(const unsigned char *p, const unsigned char *end, unsigned char tag, size_t *len) {
+    if (end - p < 2 || p[0] != tag) return NULL;
+    if (p[1] < 0x80) {
+        *len = p[1];
+        p += 2;
+    } else if (p[1] == 0x81 && end - p >= 3 && p[2] >= 0x80) {
+        *len = p[2];
+        p += 3;
+    } else return NULL;
+    return (size_t)(end - p) >= *len ? p : NULL;
+}
+
+
+/*
+ * Fast path for the fulfillments of MakeCCcond1() and MakeCCcond1of2(), signed by one key:
+ *
+ *   threshold 2 of { threshold 1 of { secp256k1 [, secp256k1 condition] }, eval }
+ *
+ * The bytes are matched as DER encodes them, so whatever is matched is what ber_decode()
+ * and the malleability check would have taken, and the tree is the one fulfillmentToCC()
+ * would have made of it. Anything else returns NULL and goes through the ASN.1 decoder.
+ */
+static CC *readThresholdSecp256k1EvalFast(const unsigned char *ffill_bin, size_t ffill_bin_len) {
+    const unsigned char *end = ffill_bin + ffill_bin_len, *p, *subs, *subsEnd, *inner, *innerEnd;
+    const unsigned char *secp, *ffills, *conds, *condsEnd, *code, *fingerprint = 0;
+    size_t len, codeLength;
+
+    if (!(p = derElement(ffill_bin, end, 0xa2, &len)) || p + len != end) return NULL;
+    if (!(subs = derElement(p, end, 0xa0, &len))) return NULL;
+    subsEnd = subs + len;
+    if (end - subsEnd != 2 || subsEnd[0] != 0xa1 || subsEnd[1] != 0) return NULL;
+
+    // The threshold sorts first, its tag being below the eval's
+    if (!(inner = derElement(subs, subsEnd, 0xa2, &len))) return NULL;
+    innerEnd = inner + len;
+    if (!(p = derElement(innerEnd, subsEnd, 0xaf, &len)) || p + len != subsEnd) return NULL;
+    if (!(code = derElement(p, subsEnd, 0x80, &codeLength)) || code + codeLength != subsEnd || codeLength == 0) return NULL;
+
+    if (!(ffills = derElement(inner, innerEnd, 0xa0, &len))) return NULL;
+    conds = ffills + len;
+    if (!(secp = derElement(ffills, conds, 0xa5, &len)) || secp + len != conds || len != 4 + SECP256K1_PK_SIZE + SECP256K1_SIG_SIZE) return NULL;
+    if (secp[0] != 0x80 || secp[1] != SECP256K1_PK_SIZE) return NULL;
+    p = secp + 2 + SECP256K1_PK_SIZE;
+    if (p[0] != 0x81 || p[1] != SECP256K1_SIG_SIZE) return NULL;
+
+    if (!(conds = derElement(conds, innerEnd, 0xa1, &len)) || conds + len != innerEnd) return NULL;
+    condsEnd = innerEnd;
+    if (len > 0) {
+        // The other key of a 1of2, as a condition of cost 131072
+        static const unsigned char cost[5] = { 0x81, 0x03, 0x02, 0x00, 0x00 };
+        if (!(p = derElement(conds, condsEnd, 0xa5, &len)) || p + len != condsEnd || len != 2 + 32 + sizeof(cost)) return NULL;
+        if (p[0] != 0x80 || p[1] != 32 || 0 != memcmp(p + 34, cost, sizeof(cost))) return NULL;
+        fingerprint = p + 2;
+    }
+
+    CC *sig = cc_secp256k1Condition(secp + 2, secp + 4 + SECP256K1_PK_SIZE);
+    if (!sig) return NULL;
+
+    CC *threshold1 = cc_new(CC_Threshold);
+    threshold1->threshold = 1;
+    threshold1->size = fingerprint ? 2 : 1;
+    threshold1->subconditions = calloc(threshold1->size, sizeof(CC*));
+    threshold1->subconditions[0] = sig;
+    if (fingerprint) {
+        CC *anon = cc_new(CC_Anon);
+        anon->conditionType = &CC_Secp256k1Type;
+        memcpy(anon->fingerprint, fingerprint, 32);
+        anon->cost = secp256k1Cost(anon);
+        anon->subtypes = 0;
+        threshold1->subconditions[1] = anon;
+    }
+
+    CC *eval = cc_new(CC_Eval);
+    eval->codeLength = codeLength;
+    eval->code = calloc(1, codeLength);
+    memcpy(eval->code, code, codeLength);
+
+    CC *cond = cc_new(CC_Threshold);
+    cond->threshold = 2;
+    cond->size = 2;
+    cond->subconditions = calloc(2, sizeof(CC*));
+    cond->subconditions[0] = threshold1;
+    cond->subconditions[1] = eval;
+    return cond;
+}
+
+
 CC *cc_readFulfillmentBinary(const unsigned char *ffill_bin, size_t ffill_bin_len) {
     CC *cond = 0;
+    if ((cond = readThresholdSecp256k1EvalFast(ffill_bin, ffill_bin_len)))
+        return cond;
     unsigned char *buf = calloc(1,ffill_bin_len);
     Fulfillment_t *ffill = 0;
     asn_dec_rval_t rval = ber_decode(0, &asn_DEF_Fulfillment, (void **)&ffill, ffill_bin, ffill_bin_len);
@@ -218,6 +311,9 @@ end:
 
 int cc_readFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc) {
 
+    if ((*ppcc = readThresholdSecp256k1EvalFast(ffill_bin, ffill_bin_len)))
+        return 0;
+
     int error = 0;
     unsigned char *buf = calloc(1,ffill_bin_len);
     Fulfillment_t *ffill = 0;
@@ -254,9 +350,8 @@ int cc_visit(CC *cond, CCVisitor visitor) {
     return out;
 }
 
-int cc_verify(const struct CC *cond, const unsigned char *msg, size_t msgLength, int doHashMsg,
-              const unsigned char *condBin, size_t condBinLength,
-              VerifyEval verifyEval, void *evalContext) {
+int cc_verifyFulfillment(const struct CC *cond, const unsigned char *msg, size_t msgLength, int doHashMsg,
+                         const unsigned char *condBin, size_t condBinLength) {
     unsigned char targetBinary[1000];
     //fprintf(stderr,"in cc_verify cond.%p msg.%p[%d] dohash.%d condbin.%p[%d]\n",cond,msg,(int32_t)msgLength,doHashMsg,condBin,(int32_t)condBinLength);
     const size_t binLength = cc_conditionBinary(cond, targetBinary);
@@ -277,7 +372,15 @@ int cc_verify(const struct CC *cond, const unsigned char *msg, size_t msgLength,
         fprintf(stderr,"cc_verify error C\n");
         return 0;
     }
+    return 1;
+}
 
+int cc_verify(const struct CC *cond, const unsigned char *msg, size_t msgLength, int doHashMsg,
+              const unsigned char *condBin, size_t condBinLength,
+              VerifyEval verifyEval, void *evalContext) {
+    if (!cc_verifyFulfillment(cond, msg, msgLength, doHashMsg, condBin, condBinLength)) {
+        return 0;
+    }
     if (!cc_verifyEval(cond, verifyEval, evalContext)) {
         //fprintf(stderr,"cc_verify error D\n");
         return 0;
@@ -11,6 +11,7 @@ public:
     MOCK_METHOD0(GetPeer, CService());
     MOCK_METHOD0(GetRequestMethod, HTTPRequest::RequestMethod());
     MOCK_METHOD1(GetHeader, std::pair<bool, std::string>(const std::string& hdr));
+    MOCK_METHOD1(PeekBody, std::string(size_t nMaxSize));
     MOCK_METHOD2(WriteHeader, void(const std::string& hdr, const std::string& value));
     MOCK_METHOD2(WriteReply, void(int nStatus, const std::string& strReply));
 
@@ -60,3 +61,101 @@ TEST(HTTPRPC, FailsWithBadAuth) {
     EXPECT_FALSE(HTTPReq_JSONRPC(&req, ""));
     req.CleanUp();
 }
+
+TEST(HTTPRPC, FindJSONMethods) {
+    std::vector<std::string> vMethods;
+    FindJSONMethods("[{\"method\":\"getinfo\",\"id\":1}, {\"id\":2, \"method\" :\n \"getaddressutxos\"}]", vMethods);
+    ASSERT_EQ(2, vMethods.size());
+    EXPECT_EQ("getinfo", vMethods[0]);
+    EXPECT_EQ("getaddressutxos", vMethods[1]);
+
+    // A value cut off by the end of what was looked at is not taken
+    vMethods.clear();
+    FindJSONMethods("{\"method\":\"getinfo\"}, {\"method\":\"getaddr", vMethods);
+    ASSERT_EQ(1, vMethods.size());
+    EXPECT_EQ("getinfo", vMethods[0]);
+
+    // Keys without a string value are skipped, the text is not otherwise checked
+    vMethods.clear();
+    FindJSONMethods("{\"method\" 1, \"method\": getinfo, \"method\":, \"params\": [\"method\"] \"method\":\"getblockcount\"", vMethods);
+    ASSERT_EQ(1, vMethods.size());
+    EXPECT_EQ("getblockcount", vMethods[0]);
+
+    vMethods.clear();
+    FindJSONMethods("not json at all", vMethods);
+    EXPECT_TRUE(vMethods.empty());
+}
+
+TEST(HTTPRPC, MethodWorkClass) {
+    ASSERT_TRUE(InitRPCWorkClasses());
+    EXPECT_EQ(HTTP_WORK_PRIORITY, MethodWorkClass("getblocktemplate"));
+    EXPECT_EQ(HTTP_WORK_EXPENSIVE, MethodWorkClass("getaddressutxos"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, MethodWorkClass("getrawtransaction"));
+
+    // The CC calls ending in list are expensive unless listed otherwise
+    EXPECT_EQ(HTTP_WORK_EXPENSIVE, MethodWorkClass("tokenlist"));
+    EXPECT_EQ(HTTP_WORK_EXPENSIVE, MethodWorkClass("oracleslist"));
+    EXPECT_EQ(HTTP_WORK_PRIORITY, MethodWorkClass("listunspent"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, MethodWorkClass("list"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, MethodWorkClass("listlockunspent"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, MethodWorkClass("tokenlistx"));
+
+    mapMultiArgs["-rpcworkclass"].push_back("tokenlist:cheap");
+    ASSERT_TRUE(InitRPCWorkClasses());
+    EXPECT_EQ(HTTP_WORK_CHEAP, MethodWorkClass("tokenlist"));
+    mapMultiArgs.erase("-rpcworkclass");
+    ASSERT_TRUE(InitRPCWorkClasses());
+}
+
+static HTTPWorkClass ClassifyBody(const std::string& strBody) {
+    MockHTTPRequest req;
+    EXPECT_CALL(req, GetRequestMethod())
+        .WillRepeatedly(Return(HTTPRequest::POST));
+    EXPECT_CALL(req, GetHeader("authorization"))
+        .WillRepeatedly(Return(std::make_pair(true, "Basic " + EncodeBase64(strRPCUserColonPass))));
+    EXPECT_CALL(req, PeekBody(WORK_CLASS_PEEK_SIZE + 1))
+        .WillRepeatedly(Return(strBody.substr(0, WORK_CLASS_PEEK_SIZE + 1)));
+    HTTPWorkClass workClass = HTTPReq_JSONRPCWorkClass(&req, "");
+    req.CleanUp();
+    return workClass;
+}
+
+TEST(HTTPRPC, JSONRPCWorkClass) {
+    ASSERT_TRUE(InitRPCWorkClasses());
+    strRPCUserColonPass = "user:pass";
+
+    EXPECT_EQ(HTTP_WORK_PRIORITY, ClassifyBody("{\"method\":\"getinfo\"}"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, ClassifyBody("{\"method\":\"getrawtransaction\"}"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, ClassifyBody(" \r\n"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, ClassifyBody("{\"id\":1}"));
+
+    // A batch goes where its most expensive call goes
+    EXPECT_EQ(HTTP_WORK_CHEAP, ClassifyBody("[{\"method\":\"getinfo\"}, {\"method\":\"decodescript\"}]"));
+    EXPECT_EQ(HTTP_WORK_EXPENSIVE, ClassifyBody("[{\"method\":\"getinfo\"}, {\"method\":\"tokenlist\"}]"));
+
+    // Truncated or malformed bodies are classed by the calls that can be read, the handler rejects them
+    EXPECT_EQ(HTTP_WORK_PRIORITY, ClassifyBody("{\"method\":\"getinfo\", \"params\": ["));
+    EXPECT_EQ(HTTP_WORK_CHEAP, ClassifyBody("{\"method\":\"getaddressutx"));
+    EXPECT_EQ(HTTP_WORK_CHEAP, ClassifyBody("{\"method\": getaddressutxos}"));
+
+    // A batch too large to look at in full may hold anything
+    std::string strBatch = "[";
+    while (strBatch.size() <= WORK_CLASS_PEEK_SIZE)
+        strBatch += "{\"method\":\"getinfo\"},";
+    EXPECT_EQ(HTTP_WORK_EXPENSIVE, ClassifyBody(strBatch));
+    // A single call that large is classed by its method, which comes first
+    EXPECT_EQ(HTTP_WORK_PRIORITY, ClassifyBody("{\"method\":\"sendrawtransaction\",\"params\":[\"" + std::string(2 * WORK_CLASS_PEEK_SIZE, 'a') + "\"]}"));
+
+    // Unauthorized requests are not looked at
+    MockHTTPRequest req;
+    EXPECT_CALL(req, GetRequestMethod())
+        .WillRepeatedly(Return(HTTPRequest::POST));
+    EXPECT_CALL(req, GetHeader("authorization"))
+        .WillRepeatedly(Return(std::make_pair(true, "Basic spam:eggs")));
+    EXPECT_CALL(req, PeekBody(::testing::_))
+        .Times(0);
+    EXPECT_EQ(HTTP_WORK_CHEAP, HTTPReq_JSONRPCWorkClass(&req, ""));
+    req.CleanUp();
+
+    strRPCUserColonPass = "";
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include "httpserver.cpp"
+
+class NoopClosure : public HTTPClosure {
+public:
+    void operator()() {}
+};
+
+static bool EnqueueNoop(WorkQueue<HTTPClosure>& queue, const std::string& client) {
+    std::unique_ptr<NoopClosure> item(new NoopClosure());
+    if (!queue.Enqueue(item.get(), client))
+        return false;
+    item.release();
+    return true;
+}
+
+TEST(HTTPServer, WorkQueueCapsOneClient) {
+    const size_t depths[] = {1, 2, 3, 4, 8, 16, 100};
+    for (size_t maxDepth : depths) {
+        WorkQueue<HTTPClosure> queue(maxDepth);
+
+        // One client gets at most maxDepth - maxDepth/4 of the queue
+        size_t nFirst = 0;
+        while (EnqueueNoop(queue, "10.0.0.1"))
+            nFirst++;
+        EXPECT_EQ(std::max(maxDepth - maxDepth / 4, (size_t)1), nFirst) << "maxDepth " << maxDepth;
+
+        // The rest is left to the others, up to the depth of the queue
+        size_t nSecond = 0;
+        while (EnqueueNoop(queue, "10.0.0.2"))
+            nSecond++;
+        EXPECT_EQ(maxDepth - nFirst, nSecond) << "maxDepth " << maxDepth;
+        EXPECT_FALSE(EnqueueNoop(queue, "10.0.0.3"));
+
+        HTTPWorkQueueStats stats;
+        queue.GetStats(stats);
+        EXPECT_EQ(maxDepth, stats.nDepth);
+        EXPECT_EQ(nSecond > 0 ? 2 : 1, stats.nClients);
+        EXPECT_EQ(3, stats.nRejected);
+    }
+}
@@ -24,6 +24,7 @@
 #include "streams.h"
 
 #include "zcash/IncrementalMerkleTree.hpp"
+#include "zcash/NoteEncryption.hpp"
 #include "zcash/util.h"
 
 #include <libsnark/common/default_types/r1cs_ppzksnark_pp.hpp>
@@ -342,3 +343,38 @@ TEST(merkletree, testZeroElements) {
         ASSERT_TRUE(newTree.root() == oldroot);
     }
 }
+
+TEST(merkletree, fastForwardMatchesAppend) {
+    SproutMerkleTree tree;
+    std::vector<SproutWitness> appended;
+    std::vector<SproutWitness> forwarded;
+
+    // Grow the tree a few commitments at a time, witnessing some of them,
+    // and bring one copy of each witness up to date commitment by commitment
+    // and the other from the roots of the subtrees completed in each batch.
+    for (size_t batch = 0; batch < 200; batch++) {
+        SproutWitness::SubtreeRoots roots;
+        for (size_t i = 0; i < batch % 5; i++) {
+            uint256 cm = random_uint256();
+            std::vector<libzcash::SHA256Compress> completed = tree.completed_roots(cm);
+            for (size_t depth = 0; depth < completed.size(); depth++) {
+                roots[std::make_pair(depth, uint64_t(tree.size()) >> depth)] = completed[depth];
+            }
+            tree.append(cm);
+
+            for (SproutWitness& witness : appended) {
+                witness.append(cm);
+            }
+            if (tree.size() % 13 == 0) {
+                appended.push_back(tree.witness());
+                forwarded.push_back(tree.witness());
+            }
+        }
+
+        for (size_t i = 0; i < forwarded.size(); i++) {
+            forwarded[i].fast_forward(tree, roots);
+            ASSERT_TRUE(forwarded[i] == appended[i]);
+            ASSERT_TRUE(forwarded[i].root() == tree.root());
+        }
+    }
+}
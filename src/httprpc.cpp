@@ -18,6 +18,7 @@
 #include "chainparams.h"
 #include "httpserver.h"
 #include "key_io.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -27,6 +28,8 @@
 #include "ui_interface.h"
 
 #include <boost/algorithm/string.hpp> // boost::trim
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 
 // WWW-Authenticate to present with 401 Unauthorized response
 static const char *WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
@@ -86,10 +89,15 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
 
     std::string strReply = JSONRPCReply(NullUniValue, objError, id);
 
+    // The call may have failed after part of its result was written; none of it has been sent
+    req->ClearReply();
     req->WriteHeader("Content-Type", "application/json");
     req->WriteReply(nStatus, strReply);
 }
 
+//! Replies are handed to libevent in pieces of this size
+static const size_t REPLY_FLUSH_SIZE = 65536;
+
 static bool RPCAuthorized(const std::string& strAuth)
 {
     if (strRPCUserColonPass.empty()) // Belt-and-suspenders measure if InitRPCAuthentication was not called
@@ -102,6 +110,114 @@ static bool RPCAuthorized(const std::string& strAuth)
     return TimingResistantEqual(strUserPass, strRPCUserColonPass);
 }
 
+//! Methods that do not go to the cheap work queue, and where they go instead
+static std::map<std::string, HTTPWorkClass> mapMethodWorkClass;
+
+//! Mining and notary calls, which must not wait behind anything else
+static const char* PRIORITY_METHODS[] = {
+    "getblocktemplate", "submitblock", "getmininginfo", "sendrawtransaction", "signrawtransaction",
+    "getinfo", "getblockcount", "getbestblockhash", "getblockhash", "listunspent", "notaries",
+    "calc_MoM", "height_MoM", "MoMoMdata", "getNotarisationsForBlock", "scanNotarisationsDB", "getimports",
+};
+
+//! Calls that scan an index or the UTXO set and can take seconds
+static const char* EXPENSIVE_METHODS[] = {
+    "getsnapshot", "getaddressdeltas", "getaddresstxids", "getaddressutxos", "getaddressbalance",
+    "getaddressmempool", "getblockdeltas", "getblockhashes", "gettxoutsetinfo", "coinsupply",
+    "oraclessamples",
+};
+
+static HTTPWorkClass MethodWorkClass(const std::string& strMethod)
+{
+    std::map<std::string, HTTPWorkClass>::const_iterator it = mapMethodWorkClass.find(strMethod);
+    if (it != mapMethodWorkClass.end())
+        return it->second;
+    // The CC *list calls walk every transaction of their contract
+    if (strMethod.size() > 4 && strMethod.compare(strMethod.size() - 4, 4, "list") == 0)
+        return HTTP_WORK_EXPENSIVE;
+    return HTTP_WORK_CHEAP;
+}
+
+static bool InitRPCWorkClasses()
+{
+    mapMethodWorkClass.clear();
+    for (size_t i = 0; i < sizeof(PRIORITY_METHODS) / sizeof(PRIORITY_METHODS[0]); i++)
+        mapMethodWorkClass[PRIORITY_METHODS[i]] = HTTP_WORK_PRIORITY;
+    for (size_t i = 0; i < sizeof(EXPENSIVE_METHODS) / sizeof(EXPENSIVE_METHODS[0]); i++)
+        mapMethodWorkClass[EXPENSIVE_METHODS[i]] = HTTP_WORK_EXPENSIVE;
+
+    if (mapMultiArgs.count("-rpcworkclass")) {
+        BOOST_FOREACH(const std::string& strArg, mapMultiArgs["-rpcworkclass"]) {
+            size_t nColon = strArg.find(':');
+            std::string strMethod = strArg.substr(0, nColon);
+            std::string strClass = nColon == std::string::npos ? "" : strArg.substr(nColon + 1);
+            int i = 0;
+            while (i < HTTP_WORK_CLASSES && HTTPWorkClassName((HTTPWorkClass)i) != strClass)
+                i++;
+            if (strMethod.empty() || i == HTTP_WORK_CLASSES) {
+                uiInterface.ThreadSafeMessageBox(
+                    strprintf("Invalid -rpcworkclass: %s. Use <method>:<priority|cheap|expensive>.", strArg),
+                    "", CClientUIInterface::MSG_ERROR);
+                return false;
+            }
+            mapMethodWorkClass[strMethod] = (HTTPWorkClass)i;
+        }
+    }
+    return true;
+}
+
+//! The classifier looks at this much of a request at most, it runs on the event loop thread
+static const size_t WORK_CLASS_PEEK_SIZE = 4096;
+
+/** The values of the "method" keys in a JSON text, found without parsing it */
+static void FindJSONMethods(const std::string& strBody, std::vector<std::string>& vMethods)
+{
+    static const std::string strKey = "\"method\"";
+    size_t nPos = 0;
+    while ((nPos = strBody.find(strKey, nPos)) != std::string::npos) {
+        nPos += strKey.size();
+        size_t nColon = strBody.find_first_not_of(" \t\r\n", nPos);
+        if (nColon == std::string::npos || strBody[nColon] != ':')
+            continue;
+        size_t nQuote = strBody.find_first_not_of(" \t\r\n", nColon + 1);
+        if (nQuote == std::string::npos || strBody[nQuote] != '"')
+            continue;
+        size_t nEnd = strBody.find('"', nQuote + 1);
+        if (nEnd == std::string::npos)
+            break;
+        vMethods.push_back(strBody.substr(nQuote + 1, nEnd - nQuote - 1));
+        nPos = nEnd + 1;
+    }
+}
+
+/**
+ * Queue JSON-RPC requests by the calls they make, from the start of their body only; a batch goes
+ * where its most expensive call goes, and one too large to look at in full with the expensive calls.
+ * The handler parses the request for real.
+ */
+static HTTPWorkClass HTTPReq_JSONRPCWorkClass(HTTPRequest* req, const std::string &)
+{
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    if (req->GetRequestMethod() != HTTPRequest::POST || !authHeader.first || !RPCAuthorized(authHeader.second))
+        return HTTP_WORK_CHEAP;
+
+    std::string strBody = req->PeekBody(WORK_CLASS_PEEK_SIZE + 1);
+    size_t nStart = strBody.find_first_not_of(" \t\r\n");
+    if (nStart == std::string::npos)
+        return HTTP_WORK_CHEAP;
+    if (strBody[nStart] == '[' && strBody.size() > WORK_CLASS_PEEK_SIZE)
+        return HTTP_WORK_EXPENSIVE;
+
+    std::vector<std::string> vMethods;
+    FindJSONMethods(strBody.substr(0, WORK_CLASS_PEEK_SIZE), vMethods);
+    if (vMethods.empty())
+        return HTTP_WORK_CHEAP;
+    HTTPWorkClass workClass = HTTP_WORK_PRIORITY;
+    for (size_t i = 0; i < vMethods.size(); i++)
+        workClass = std::max(workClass, MethodWorkClass(vMethods[i]));
+    return workClass;
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -151,10 +267,22 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                 return false;
             }
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+            // Write the reply straight into the request, the same as JSONRPCReply(result, NullUniValue, id).
+            // Calls with large results write them directly, the others return a UniValue.
+            CJSONTextWriter writer(boost::bind(&HTTPRequest::AppendReply, req, _1), REPLY_FLUSH_SIZE);
+            writer.BeginObject();
+            writer.Key("result");
+            if (!tableRPC.executeWriter(jreq.strMethod, jreq.params, writer))
+                writer.Value(tableRPC.execute(jreq.strMethod, jreq.params));
+            writer.PushKV("error", NullUniValue);
+            writer.PushKV("id", jreq.id);
+            writer.EndObject();
+            writer.Flush();
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, "\n");
+            return true;
 
         // array of requests
         } else if (valRequest.isArray())
@@ -194,10 +322,10 @@ static bool InitRPCAuthentication()
 bool StartHTTPRPC()
 {
     LogPrint("rpc", "Starting HTTP RPC server\n");
-    if (!InitRPCAuthentication())
+    if (!InitRPCAuthentication() || !InitRPCWorkClasses())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTPReq_JSONRPCWorkClass);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
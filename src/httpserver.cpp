@@ -19,6 +19,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <signal.h>
+#ifdef WIN32
+#include <io.h>
+#endif
 
 #include <event2/event.h>
 #include <event2/http.h>
@@ -58,8 +61,9 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+/** Work queue for distributing work over multiple threads.
+ * Work items are simply callable objects. Items are queued per client and
+ * clients are served in turn, so one busy client cannot starve the others.
  */
 template <typename WorkItem>
 class WorkQueue
@@ -69,10 +73,17 @@ private:
     CWaitableCriticalSection cs;
     CConditionVariable cond;
     /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
-    std::deque<WorkItem*> queue;
+    /** Pending items of each client with the time they were queued, oldest first */
+    std::map<std::string, std::deque<std::pair<WorkItem*, int64_t> > > mapClients;
+    /** Clients with pending items, in the order they are served */
+    std::deque<std::string> ready;
+    size_t depth;
     bool running;
     size_t maxDepth;
     int numThreads;
+    uint64_t nProcessed;
+    uint64_t nRejected;
+    int64_t nWaitMicros;
 
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
@@ -93,9 +104,13 @@ private:
     };
 
 public:
-    WorkQueue(size_t maxDepth) : running(true),
+    WorkQueue(size_t maxDepth) : depth(0),
+                                 running(true),
                                  maxDepth(maxDepth),
-                                 numThreads(0)
+                                 numThreads(0),
+                                 nProcessed(0),
+                                 nRejected(0),
+                                 nWaitMicros(0)
     {
     }
     /*( Precondition: worker threads have all stopped
@@ -103,19 +118,29 @@ public:
      */
     ~WorkQueue()
     {
-        while (!queue.empty()) {
-            delete queue.front();
-            queue.pop_front();
+        for (typename std::map<std::string, std::deque<std::pair<WorkItem*, int64_t> > >::iterator it = mapClients.begin(); it != mapClients.end(); ++it) {
+            while (!it->second.empty()) {
+                delete it->second.front().first;
+                it->second.pop_front();
+            }
         }
     }
-    /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    /** Enqueue a work item of a client */
+    bool Enqueue(WorkItem* item, const std::string& client)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        std::deque<std::pair<WorkItem*, int64_t> >& pending = mapClients[client];
+        // A quarter of the queue is kept for clients other than the one filling it
+        if (depth >= maxDepth || pending.size() >= std::max(maxDepth - maxDepth / 4, (size_t)1)) {
+            if (pending.empty())
+                mapClients.erase(client);
+            nRejected++;
             return false;
         }
-        queue.push_back(item);
+        if (pending.empty())
+            ready.push_back(client);
+        pending.push_back(std::make_pair(item, GetTimeMicros()));
+        depth++;
         cond.notify_one();
         return true;
     }
@@ -127,12 +152,22 @@ public:
             WorkItem* i = 0;
             {
                 boost::unique_lock<boost::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && ready.empty())
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = queue.front();
-                queue.pop_front();
+                std::string client = ready.front();
+                ready.pop_front();
+                std::deque<std::pair<WorkItem*, int64_t> >& pending = mapClients[client];
+                i = pending.front().first;
+                nWaitMicros += GetTimeMicros() - pending.front().second;
+                pending.pop_front();
+                depth--;
+                nProcessed++;
+                if (pending.empty())
+                    mapClients.erase(client);
+                else
+                    ready.push_back(client);
             }
             (*i)();
             delete i;
@@ -157,20 +192,34 @@ public:
     size_t Depth()
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        return queue.size();
+        return depth;
+    }
+
+    /** Fill in the queue's part of stats */
+    void GetStats(HTTPWorkQueueStats& stats)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        stats.nThreads = numThreads;
+        stats.nDepth = depth;
+        stats.nMaxDepth = maxDepth;
+        stats.nClients = ready.size();
+        stats.nProcessed = nProcessed;
+        stats.nRejected = nRejected;
+        stats.nWaitMicros = nWaitMicros;
     }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler):
-        prefix(prefix), exactMatch(exactMatch), handler(handler)
+    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler, HTTPWorkClassifier classifier):
+        prefix(prefix), exactMatch(exactMatch), handler(handler), classifier(classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkClassifier classifier;
 };
 
 /** HTTP module state */
@@ -181,8 +230,8 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queues for handling longer requests off the event loop thread, one per HTTPWorkClass
+static WorkQueue<HTTPClosure>* workQueues[HTTP_WORK_CLASSES] = {0};
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -246,6 +295,16 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+/**
+ * Key that requests are queued fairly by: the peer address. The user named in the Authorization
+ * header is not taken, a client could name a new one for each request; and an authorized one is
+ * always the same, the RPC having a single set of credentials.
+ */
+static std::string RequestClient(HTTPRequest* req)
+{
+    return req->GetPeer().ToStringIP();
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -285,9 +344,11 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkClass workClass = i->classifier ? i->classifier(hreq.get(), path) : HTTP_WORK_CHEAP;
+        std::string client = RequestClient(hreq.get());
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
-        assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        assert(workQueues[workClass]);
+        if (workQueues[workClass]->Enqueue(item.get(), client))
             item.release(); /* if true, queue took ownership */
         else
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
@@ -430,9 +491,10 @@ bool InitHTTPServer()
 
     LogPrint("http", "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    LogPrintf("HTTP: creating work queues of depth %d\n", workQueueDepth);
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    for (int i = 0; i < HTTP_WORK_CLASSES; i++)
+        workQueues[i] = new WorkQueue<HTTPClosure>(workQueueDepth);
     eventBase = base;
     eventHTTP = http;
     return true;
@@ -443,13 +505,18 @@ boost::thread threadHTTP;
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
-    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
+    int rpcThreads[HTTP_WORK_CLASSES];
+    rpcThreads[HTTP_WORK_PRIORITY] = std::max((long)GetArg("-rpcprioritythreads", DEFAULT_HTTP_PRIORITY_THREADS), 1L);
+    rpcThreads[HTTP_WORK_CHEAP] = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    rpcThreads[HTTP_WORK_EXPENSIVE] = std::max((long)GetArg("-rpcexpensivethreads", DEFAULT_HTTP_EXPENSIVE_THREADS), 1L);
     threadHTTP = boost::thread(boost::bind(&ThreadHTTP, eventBase, eventHTTP));
 
-    for (int i = 0; i < rpcThreads; i++) {
-        boost::thread rpc_worker(HTTPWorkQueueRun, workQueue);
-        rpc_worker.detach();
+    for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+        LogPrintf("HTTP: starting %d %s worker threads\n", rpcThreads[i], HTTPWorkClassName((HTTPWorkClass)i));
+        for (int j = 0; j < rpcThreads[i]; j++) {
+            boost::thread rpc_worker(HTTPWorkQueueRun, workQueues[i]);
+            rpc_worker.detach();
+        }
     }
     return true;
 }
@@ -465,17 +532,22 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, NULL);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+        if (workQueues[i])
+            workQueues[i]->Interrupt();
+    }
 }
 
 void StopHTTPServer()
 {
     LogPrint("http", "Stopping HTTP server\n");
-    if (workQueue) {
-        LogPrint("http", "Waiting for HTTP worker threads to exit\n");
-        workQueue->WaitExit();
-        delete workQueue;
+    for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+        if (workQueues[i]) {
+            LogPrint("http", "Waiting for HTTP %s worker threads to exit\n", HTTPWorkClassName((HTTPWorkClass)i));
+            workQueues[i]->WaitExit();
+            delete workQueues[i];
+            workQueues[i] = 0;
+        }
     }
     if (eventBase) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
@@ -509,6 +581,34 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+std::string HTTPWorkClassName(HTTPWorkClass workClass)
+{
+    switch (workClass) {
+    case HTTP_WORK_PRIORITY:
+        return "priority";
+    case HTTP_WORK_CHEAP:
+        return "cheap";
+    case HTTP_WORK_EXPENSIVE:
+        return "expensive";
+    default:
+        return "unknown";
+    }
+}
+
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> vStats;
+    for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+        if (!workQueues[i])
+            continue;
+        HTTPWorkQueueStats stats;
+        stats.workClass = (HTTPWorkClass)i;
+        workQueues[i]->GetStats(stats);
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -580,6 +680,18 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = std::min(evbuffer_get_length(buf), nMaxSize);
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data)
+        return "";
+    return std::string(data, size);
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -587,6 +699,52 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+void HTTPRequest::AppendReply(const std::string& strPart)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_add(evb, strPart.data(), strPart.size());
+}
+
+void HTTPRequest::ClearReply()
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_drain(evb, evbuffer_get_length(evb));
+}
+
+bool HTTPRequest::AppendReplyFile(FILE* file, const std::vector<std::pair<int64_t, int64_t> >& vRanges)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    // The segment owns a duplicate of the descriptor until the reply has been sent
+#ifdef WIN32
+    int fd = _dup(_fileno(file));
+#else
+    int fd = dup(fileno(file));
+#endif
+    if (fd < 0)
+        return false;
+    struct evbuffer_file_segment* seg = evbuffer_file_segment_new(fd, 0, -1, EVBUF_FS_CLOSE_ON_FREE);
+    if (!seg) {
+#ifdef WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+        return false;
+    }
+    bool fRet = true;
+    for (size_t i = 0; i < vRanges.size() && fRet; i++)
+        fRet = evbuffer_add_file_segment(evb, seg, vRanges[i].first, vRanges[i].second) == 0;
+    // Drops our reference; the chains added to evb keep the segment alive
+    evbuffer_file_segment_free(seg);
+    return fRet;
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -646,10 +804,11 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const HTTPWorkClassifier &classifier)
 {
     LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -5,8 +5,10 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <stdio.h>
 #include <string>
 #include <stdint.h>
+#include <vector>
 #ifdef _WIN32
 #undef __cpuid
 #endif
@@ -15,6 +17,8 @@
 #include <boost/function.hpp>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_PRIORITY_THREADS=2;
+static const int DEFAULT_HTTP_EXPENSIVE_THREADS=2;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
@@ -37,13 +41,48 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Work queues that requests are scheduled on. Each has its own worker
+ * threads, so requests of one class never wait behind those of another.
+ */
+enum HTTPWorkClass
+{
+    HTTP_WORK_PRIORITY,  //!< mining and notary calls
+    HTTP_WORK_CHEAP,     //!< everything else
+    HTTP_WORK_EXPENSIVE, //!< index scans and listings
+    HTTP_WORK_CLASSES
+};
+
+/** Name of a work class, as used in options and statistics */
+std::string HTTPWorkClassName(HTTPWorkClass workClass);
+
+/** State and counters of one work queue */
+struct HTTPWorkQueueStats
+{
+    HTTPWorkClass workClass;
+    int nThreads;
+    size_t nDepth;
+    size_t nMaxDepth;
+    //! Clients with requests waiting
+    size_t nClients;
+    uint64_t nProcessed;
+    uint64_t nRejected;
+    //! Total time processed requests spent waiting for a worker
+    int64_t nWaitMicros;
+};
+
+/** Statistics of all work queues, in HTTPWorkClass order */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** Handler for requests to a certain HTTP path */
 typedef boost::function<void(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the work queue of a request. Runs on the event loop thread, so it must be quick. */
+typedef boost::function<HTTPWorkClass(HTTPRequest* req, const std::string &)> HTTPWorkClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Without a classifier, requests go to the HTTP_WORK_CHEAP queue.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const HTTPWorkClassifier &classifier = HTTPWorkClassifier());
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -102,6 +141,11 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * The first nMaxSize bytes of the request body at most, leaving it in place for ReadBody.
+     */
+    virtual std::string PeekBody(size_t nMaxSize);
+
     /**
      * Write output header.
      *
@@ -109,6 +153,26 @@ public:
      */
     virtual void WriteHeader(const std::string& hdr, const std::string& value);
 
+    /**
+     * Append to the body of the reply without sending it yet.
+     * Lets large replies be produced piecewise instead of as one string;
+     * WriteReply sends what was appended followed by its own strReply.
+     */
+    virtual void AppendReply(const std::string& strPart);
+
+    /**
+     * Drop what was appended to the body of the reply, to send another one instead.
+     */
+    virtual void ClearReply();
+
+    /**
+     * Append byte ranges (offset, length) of an open file to the body of the reply.
+     * The data is not copied: libevent sends it from the file, with sendfile or
+     * mmap where available. The caller keeps ownership of file. On failure some
+     * of the ranges may already be in the reply; ClearReply() drops them.
+     */
+    virtual bool AppendReplyFile(FILE* file, const std::vector<std::pair<int64_t, int64_t> >& vRanges);
+
     /**
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
@@ -35,17 +35,20 @@
 #include "httprpc.h"
 #include "key.h"
 #include "notarisationdb.h"
+#include "cc/CCindex.h"
 #ifdef ENABLE_MINING
 #include "key_io.h"
 #endif
 #include "main.h"
 #include "metrics.h"
 #include "miner.h"
+#include "msgprepare.h"
 #include "net.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
 #include "script/standard.h"
 #include "scheduler.h"
+#include "txcache.h"
 #include "txdb.h"
 #include "torcontrol.h"
 #include "ui_interface.h"
@@ -233,6 +236,7 @@ void Shutdown()
  #endif
 #endif
     StopNode();
+    StopMessagePreparation();
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
 
@@ -254,12 +258,16 @@ void Shutdown()
         }
         delete pcoinsTip;
         pcoinsTip = NULL;
+        delete pcoinsflushbuffer;
+        pcoinsflushbuffer = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
         delete pblocktree;
         pblocktree = NULL;
+        delete pccindex;
+        pccindex = NULL;
     }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
@@ -376,6 +384,7 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
+    strUsage += HelpMessageOpt("-blockreadcache=<n>", strprintf(_("Keep up to <n> megabytes of recently read blocks in memory (default: %u)"), DEFAULT_BLOCK_READ_CACHE_SIZE));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
@@ -388,12 +397,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+    strUsage += HelpMessageOpt("-rawblockcache=<n>", strprintf(_("Keep up to <n> megabytes of blocks recently sent to peers in memory (default: %u)"), DEFAULT_RAW_BLOCK_CACHE_SIZE));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files on startup"));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
+    strUsage += HelpMessageOpt("-txcache=<n>", strprintf(_("Keep up to <n> megabytes of recently loaded confirmed transactions in memory (default: %u)"), DEFAULT_TX_CACHE_SIZE));
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 0));
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-ccindex", strprintf(_("Maintain indexes of the contract state, used by the CC RPCs; needs -addressindex (default: %u)"), DEFAULT_CCINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
     strUsage += HelpMessageGroup(_("Connection options:"));
@@ -412,6 +424,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), 5000));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 1000));
+    strUsage += HelpMessageOpt("-msgpreparethreads=<n>", strprintf(_("Number of threads that deserialize and check tx, block and headers messages ahead of processing, 0 to disable (default: %u)"), DEFAULT_MSG_PREPARE_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
@@ -548,8 +561,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 7771, 17771));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcprioritythreads=<n>", strprintf(_("Set the number of threads to service mining and notary RPC calls (default: %d)"), DEFAULT_HTTP_PRIORITY_THREADS));
+    strUsage += HelpMessageOpt("-rpcexpensivethreads=<n>", strprintf(_("Set the number of threads to service index scans and other slow RPC calls (default: %d)"), DEFAULT_HTTP_EXPENSIVE_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchparallel=<n>", strprintf(_("Run up to <n> read-only calls of a JSON-RPC batch at once (default: %d)"), DEFAULT_RPC_BATCH_PARALLEL));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Set the number of threads that help run JSON-RPC batches (default: %d)"), DEFAULT_RPC_BATCH_THREADS));
+    strUsage += HelpMessageOpt("-rpcworkclass=<method>:<class>", _("Serve an RPC method from the priority, cheap or expensive work queue. This option can be specified multiple times"));
     if (showDebug) {
-        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of each work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -940,9 +958,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
 
     // Make sure enough file descriptors are available
-    int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     nMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
+#ifdef USE_EPOLL
+    // Any descriptor can be polled, so only the descriptor limit below applies
+    nMaxConnections = std::max(nMaxConnections, 0);
+#else
+    int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+#endif
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1498,6 +1521,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    nBlockReadCacheSize = std::max((int64_t)0, GetArg("-blockreadcache", DEFAULT_BLOCK_READ_CACHE_SIZE)) << 20;
+    nRawBlockCacheSize = std::max((int64_t)0, GetArg("-rawblockcache", DEFAULT_RAW_BLOCK_CACHE_SIZE)) << 20;
+    LogPrintf("* Using %.1fMiB for recently read blocks\n", nBlockReadCacheSize * (1.0 / 1024 / 1024));
+    int64_t nTxCacheSize = std::max((int64_t)0, GetArg("-txcache", DEFAULT_TX_CACHE_SIZE)) << 20;
+    txcache.SetMaxUsage(nTxCacheSize);
+    LogPrintf("* Using %.1fMiB for recently loaded transactions\n", nTxCacheSize * (1.0 / 1024 / 1024));
 
     if ( fReindex == 0 )
     {
@@ -1535,16 +1564,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
+                delete pcoinsflushbuffer;
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
                 delete pnotarisations;
+                delete pccindex;
+                pccindex = NULL;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
-                pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                pcoinsflushbuffer = new CCoinsViewFlushBuffer(pcoinscatcher);
+                pcoinsTip = new CCoinsViewCache(pcoinsflushbuffer);
                 pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
+                if (GetBoolArg("-ccindex", DEFAULT_CCINDEX))
+                    pccindex = new CCIndexDB(32*1024*1024, false, fReindex);
 
 
                 if (fReindex) {
@@ -1598,12 +1633,18 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 }
                 if ( KOMODO_REWIND == 0 )
                 {
-                    if (!CVerifyDB().VerifyDB(pcoinsdbview, GetArg("-checklevel", 3),
+                    if (!CVerifyDB().VerifyDB(pcoinsflushbuffer, GetArg("-checklevel", 3),
                                               GetArg("-checkblocks", 288))) {
                         strLoadError = _("Corrupted block database detected");
                         break;
                     }
                 }
+
+                uiInterface.InitMessage(_("Loading contract indexes..."));
+                if (!InitCCIndexes()) {
+                    strLoadError = _("Error writing the contract indexes");
+                    break;
+                }
             } catch (const std::exception& e) {
                 if (fDebug) LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database");
@@ -1885,6 +1926,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (GetBoolArg("-listenonion", DEFAULT_LISTEN_ONION))
         StartTorControl(threadGroup, scheduler);
 
+    StartMessagePreparation(std::max((int)GetArg("-msgpreparethreads", DEFAULT_MSG_PREPARE_THREADS), 0));
     StartNode(threadGroup, scheduler);
 
 #ifdef ENABLE_MINING
@@ -776,18 +776,17 @@ int32_t komodo_block2pubkey33(uint8_t *pubkey33,CBlock *block)
 
 int32_t komodo_blockload(CBlock& block,CBlockIndex *pindex)
 {
-    block.SetNull();
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pindex->GetBlockPos(),true),SER_DISK,CLIENT_VERSION);
-    if (filein.IsNull())
+    // goes through the recently read block cache, the notary and segid code reloads the same blocks
+    if ( ReadBlockFromDisk(block,pindex,0) == 0 )
         return(-1);
-    // Read block
-    try { filein >> block; }
-    catch (const std::exception& e)
-    {
-        fprintf(stderr,"readblockfromdisk err B\n");
+    return(0);
+}
+
+int32_t komodo_blockload(CBlockRef& pblock,CBlockIndex *pindex)
+{
+    // shares the cached block instead of copying it
+    if ( ReadBlock(pindex,pblock) == 0 )
         return(-1);
-    }
     return(0);
 }
 
@@ -901,17 +900,18 @@ void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height)
 
 int32_t komodo_eligiblenotary(uint8_t pubkeys[66][33],int32_t *mids,uint32_t blocktimes[66],int32_t *nonzpkeysp,int32_t height)
 {
-    int32_t i,j,n,duplicate; CBlock block; CBlockIndex *pindex; uint8_t notarypubs33[64][33];
+    int32_t i,j,n,duplicate; CBlockRef pblock; CBlockIndex *pindex; uint8_t notarypubs33[64][33];
     memset(mids,-1,sizeof(*mids)*66);
     n = komodo_notaries(notarypubs33,height,0);
+    PrefetchBlockRange(height-65,height);
     for (i=duplicate=0; i<66; i++)
     {
         if ( (pindex= komodo_chainactive(height-i)) != 0 )
         {
             blocktimes[i] = pindex->nTime;
-            if ( komodo_blockload(block,pindex) == 0 )
+            if ( komodo_blockload(pblock,pindex) == 0 )
             {
-                komodo_block2pubkey33(pubkeys[i],&block);
+                komodo_block2pubkey33(pubkeys[i],(CBlock *)pblock.get());
                 for (j=0; j<n; j++)
                 {
                     if ( memcmp(notarypubs33[j],pubkeys[i],33) == 0 )
@@ -1220,13 +1220,14 @@ uint32_t komodo_segid32(char *coinaddr)
 
 int8_t komodo_segid(int32_t nocache,int32_t height)
 {
-    CTxDestination voutaddress; CBlock block; CBlockIndex *pindex; uint64_t value; uint32_t txtime; char voutaddr[64],destaddr[64]; int32_t txn_count,vout; uint256 txid; CScript opret; int8_t segid = -1;
+    CTxDestination voutaddress; CBlockRef pblock; CBlockIndex *pindex; uint64_t value; uint32_t txtime; char voutaddr[64],destaddr[64]; int32_t txn_count,vout; uint256 txid; CScript opret; int8_t segid = -1;
     if ( height > 0 && (pindex= komodo_chainactive(height)) != 0 )
     {
         if ( nocache == 0 && pindex->segid >= -1 )
             return(pindex->segid);
-        if ( komodo_blockload(block,pindex) == 0 )
+        if ( komodo_blockload(pblock,pindex) == 0 )
         {
+            const CBlock &block = *pblock;
             txn_count = block.vtx.size();
             if ( txn_count > 1 && block.vtx[txn_count-1].vin.size() == 1 && block.vtx[txn_count-1].vout.size() == 1 )
             {
@@ -1257,6 +1258,7 @@ void komodo_segids(uint8_t *hashbuf,int32_t height,int32_t n)
     else
     {
         memset(hashbuf,0xff,n);
+        PrefetchBlockRange(height,height+n-1);
         for (i=0; i<n; i++)
         {
             hashbuf[i] = (uint8_t)komodo_segid(1,height+i);
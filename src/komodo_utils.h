@@ -2148,20 +2148,11 @@ struct komodo_state *komodo_stateptr(char *symbol,char *dest)
 
 void komodo_prefetch(FILE *fp)
 {
-    long fsize,fpos; int32_t incr = 16*1024*1024;
+    long fsize,fpos;
     fpos = ftell(fp);
     fseek(fp,0,SEEK_END);
     fsize = ftell(fp);
-    if ( fsize > incr )
-    {
-        char *ignore = (char *)malloc(incr);
-        if ( ignore != 0 )
-        {
-            rewind(fp);
-            while ( fread(ignore,1,incr,fp) == incr ) // prefetch
-                fprintf(stderr,".");
-            free(ignore);
-        }
-    }
     fseek(fp,fpos,SEEK_SET);
+    if ( fsize > 0 ) // let the OS read it in the background instead of reading it all here
+        PrefetchFileRange(fp,0,(unsigned int)fsize);
 }
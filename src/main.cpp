@@ -28,18 +28,24 @@
 #include "importcoin.h"
 #include "chainparams.h"
 #include "checkpoints.h"
+#include "chainsnapshot.h"
 #include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
+#include "crypto/equihash.h"
 #include "deprecation.h"
 #include "init.h"
 #include "merkleblock.h"
+#include "core_memusage.h"
 #include "metrics.h"
+#include "msgprepare.h"
 #include "notarisationdb.h"
+#include "cc/CCindex.h"
 #include "net.h"
 #include "pow.h"
 #include "script/interpreter.h"
 #include "txdb.h"
+#include "txcache.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "undo.h"
@@ -107,6 +113,8 @@ bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = true;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
+size_t nBlockReadCacheSize = DEFAULT_BLOCK_READ_CACHE_SIZE << 20;
+size_t nRawBlockCacheSize = DEFAULT_RAW_BLOCK_CACHE_SIZE << 20;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
 /* If the tip is older than this (in seconds), the node is considered to be in initial block download.
@@ -612,6 +620,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache *pcoinsTip = NULL;
+CCoinsViewFlushBuffer *pcoinsflushbuffer = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
 // Komodo globals
@@ -1617,6 +1626,9 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
 }
 
 
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
+
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, bool fSkipExpiry)
 {
     AssertLockHeld(cs_main);
@@ -1880,10 +1892,28 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
         PrecomputedTransactionData txdata(tx);
-        if (!fSkipExpiry && !ContextualCheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+
+        if (!fSkipExpiry)
         {
-            //fprintf(stderr,"accept failure.9\n");
-            return error("AcceptToMemoryPool: ConnectInputs failed %s", hash.ToString());
+            // The scripts of a standard tx with many inputs, such as a notarization, are checked on the
+            // script check threads, which stop at the first failing one. The queue may be taken by the
+            // block being connected.
+            std::vector<CScriptCheck> vChecks;
+            bool fParallel = nScriptCheckThreads && Params().RequireStandard() &&
+                             tx.vin.size() >= MEMPOOL_SCRIPT_CHECK_MIN_INPUTS && scriptcheckqueue.IsIdle();
+            bool fValid = ContextualCheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId, fParallel ? &vChecks : NULL);
+            if (fValid && fParallel)
+            {
+                CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+                control.Add(vChecks);
+                // On a failure the inputs are checked again one at a time, to tell which and why
+                fValid = control.Wait() || ContextualCheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId);
+            }
+            if (!fValid)
+            {
+                //fprintf(stderr,"accept failure.9\n");
+                return error("AcceptToMemoryPool: ConnectInputs failed %s", hash.ToString());
+            }
         }
 
         // Check again against just the consensus-critical mandatory script
@@ -1925,6 +1955,9 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                 pool.addSpentIndex(entry, view);
             }
         }
+
+        if (&pool == &mempool)
+            AddCCIndexesMempoolTx(tx);
     }
 
     SyncWithWallets(tx, NULL);
@@ -1981,6 +2014,41 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressSummary(uint160 addressHash, int type, CAddressSummaryValue &summary)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressSummary(addressHash, type, summary))
+        return error("unable to get summary for address");
+
+    return true;
+}
+
+bool GetAddressIndexPage(uint160 addressHash, int type, const CAddressIndexKey *pafter, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int end)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndexPage(addressHash, type, pafter, nLimit, addressIndex, end))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentHeightKey *pafter, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentPage(addressHash, type, pafter, nLimit, unspentOutputs))
+        return error("unable to get unspent outputs for address");
+
+    return true;
+}
+
 struct CompareBlocksByHeightMain
 {
     bool operator()(const CBlockIndex* a, const CBlockIndex* b) const
@@ -2085,6 +2153,9 @@ bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlo
     }
     //fprintf(stderr,"check disk\n");
 
+    if (txcache.Lookup(hash, txOut, hashBlock))
+        return true;
+
     if (fTxIndex) {
         CDiskTxPos postx;
         //fprintf(stderr,"ReadTxIndex\n");
@@ -2106,6 +2177,11 @@ bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlo
             if (txOut.GetHash() != hash)
                 return error("%s: txid mismatch", __func__);
             //fprintf(stderr,"found on disk\n");
+            // As in GetTransaction, without waiting for cs_main: the tx just isn't cached if it is busy
+            TRY_LOCK(cs_main, lockMain);
+            CBlockIndex *pindex = lockMain ? komodo_getblockindex(hashBlock) : 0;
+            if (pindex != 0 && chainActive.Contains(pindex))
+                txcache.Add(txOut, hashBlock, pindex->GetHeight());
             return true;
         }
     }
@@ -2119,13 +2195,16 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     CBlockIndex *pindexSlow = NULL;
     memset(&hashBlock,0,sizeof(hashBlock));
 
-    LOCK(cs_main);
-
+    // The mempool, the cache and the tx index have locks of their own, and block
+    // files are append only, so only the block index and coins need cs_main
     if (mempool.lookup(hash, txOut))
     {
         return true;
     }
 
+    if (txcache.Lookup(hash, txOut, hashBlock))
+        return true;
+
     if (fTxIndex) {
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
@@ -2143,10 +2222,18 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
             hashBlock = header.GetHash();
             if (txOut.GetHash() != hash)
                 return error("%s: txid mismatch", __func__);
+            // The block may have been disconnected since the tx index was read, and the cache
+            // emptied of it; only txs of the active chain go in, under the lock DisconnectTip holds
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+            if (mi != mapBlockIndex.end() && mi->second != 0 && chainActive.Contains(mi->second))
+                txcache.Add(txOut, hashBlock, mi->second->GetHeight());
             return true;
         }
     }
 
+    LOCK(cs_main);
+
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
         int nHeight = -1;
         {
@@ -2166,6 +2253,7 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
                 if (tx.GetHash() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
+                    txcache.Add(txOut, hashBlock, pindexSlow->GetHeight());
                     return true;
                 }
             }
@@ -2253,15 +2341,203 @@ bool ReadBlockFromDisk(int32_t height,CBlock& block, const CDiskBlockPos& pos,bo
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex,bool checkPOW)
+namespace {
+    /**
+     * Recently read blocks, most recent first. The komodo notary, segid and
+     * staking code as well as the RPC and wallet keep coming back to the same
+     * blocks near the tip, so they are kept deserialized up to
+     * nBlockReadCacheSize bytes of memory.
+     */
+    CCriticalSection cs_blockReadCache;
+    typedef std::list<std::pair<uint256, std::shared_ptr<const CBlock> > > BlockReadCacheList;
+    BlockReadCacheList listBlockReadCache;
+    std::map<uint256, BlockReadCacheList::iterator> mapBlockReadCache;
+    size_t nBlockReadCacheUsage = 0;
+
+    CBlockRef GetCachedBlock(const uint256& hash)
+    {
+        LOCK(cs_blockReadCache);
+        std::map<uint256, BlockReadCacheList::iterator>::iterator it = mapBlockReadCache.find(hash);
+        if (it == mapBlockReadCache.end())
+            return CBlockRef();
+        listBlockReadCache.splice(listBlockReadCache.begin(), listBlockReadCache, it->second);
+        return it->second->second;
+    }
+
+    bool IsBlockCached(const uint256& hash)
+    {
+        LOCK(cs_blockReadCache);
+        return mapBlockReadCache.count(hash) != 0;
+    }
+
+    void AddCachedBlock(const uint256& hash, const CBlockRef& pblock)
+    {
+        size_t nUsage = RecursiveDynamicUsage(*pblock);
+        if (nUsage > nBlockReadCacheSize / 4)
+            return;
+        LOCK(cs_blockReadCache);
+        if (mapBlockReadCache.count(hash))
+            return;
+        listBlockReadCache.push_front(std::make_pair(hash, pblock));
+        mapBlockReadCache[hash] = listBlockReadCache.begin();
+        nBlockReadCacheUsage += nUsage;
+        while (nBlockReadCacheUsage > nBlockReadCacheSize && !listBlockReadCache.empty()) {
+            nBlockReadCacheUsage -= RecursiveDynamicUsage(*listBlockReadCache.back().second);
+            mapBlockReadCache.erase(listBlockReadCache.back().first);
+            listBlockReadCache.pop_back();
+        }
+    }
+}
+
+bool ReadBlock(const CBlockIndex* pindex, CBlockRef& pblock, bool checkPOW)
 {
     if ( pindex == 0 )
         return false;
-    if (!ReadBlockFromDisk(pindex->GetHeight(),block, pindex->GetBlockPos(),checkPOW))
+    pblock = GetCachedBlock(pindex->GetBlockHash());
+    if (pblock)
+        return true;
+    std::shared_ptr<CBlock> pread = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(pindex->GetHeight(), *pread, pindex->GetBlockPos(), checkPOW))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash())
-        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
+    if (pread->GetHash() != pindex->GetBlockHash())
+        return error("%s: GetHash() doesn't match index for %s at %s", __func__,
                      pindex->ToString(), pindex->GetBlockPos().ToString());
+    pblock = pread;
+    AddCachedBlock(pindex->GetBlockHash(), pblock);
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex,bool checkPOW)
+{
+    CBlockRef pblock;
+    if (!ReadBlock(pindex, pblock, checkPOW)) {
+        block.SetNull();
+        return false;
+    }
+    block = *pblock;
+    return true;
+}
+
+void PrefetchBlockRange(int nStartHeight, int nEndHeight)
+{
+    // Only a hint, not worth waiting for the chain or risking the lock order of the caller
+    TRY_LOCK(cs_main, lockMain);
+    if (!lockMain)
+        return;
+    nStartHeight = std::max(nStartHeight, 0);
+    nEndHeight = std::min(nEndHeight, chainActive.Height());
+    // Collect the extent of the range within each block file, then hint each once
+    std::map<int, std::pair<unsigned int, unsigned int> > mapFileRanges;
+    for (int nHeight = nStartHeight; nHeight <= nEndHeight; nHeight++) {
+        CBlockIndex* pindex = chainActive[nHeight];
+        if (pindex == 0 || !(pindex->nStatus & BLOCK_HAVE_DATA) || IsBlockCached(pindex->GetBlockHash()))
+            continue;
+        CDiskBlockPos pos = pindex->GetBlockPos();
+        std::map<int, std::pair<unsigned int, unsigned int> >::iterator it = mapFileRanges.find(pos.nFile);
+        if (it == mapFileRanges.end())
+            mapFileRanges[pos.nFile] = std::make_pair(pos.nPos, pos.nPos);
+        else {
+            it->second.first = std::min(it->second.first, pos.nPos);
+            it->second.second = std::max(it->second.second, pos.nPos);
+        }
+    }
+    for (std::map<int, std::pair<unsigned int, unsigned int> >::iterator it = mapFileRanges.begin(); it != mapFileRanges.end(); ++it) {
+        FILE* file = OpenBlockFile(CDiskBlockPos(it->first, 0), true);
+        if (file == NULL)
+            continue;
+        // The last block starts at the end of the extent; include up to a full block after it
+        PrefetchFileRange(file, it->second.first, it->second.second - it->second.first + MAX_BLOCK_SIZE(nEndHeight));
+        fclose(file);
+    }
+}
+
+bool ReadBlockSizeFromFile(FILE* file, const CDiskBlockPos& pos, unsigned int& nSize)
+{
+    // WriteBlockToDisk puts the message start and the block size just before the block
+    unsigned char buf[MESSAGE_START_SIZE + sizeof(nSize)];
+    if (pos.nPos < sizeof(buf) || fseek(file, pos.nPos - sizeof(buf), SEEK_SET) != 0)
+        return error("%s: no block size header at %s", __func__, pos.ToString());
+    if (fread(buf, 1, sizeof(buf), file) != sizeof(buf))
+        return error("%s: read failed at %s", __func__, pos.ToString());
+    if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return error("%s: no message start before the block at %s", __func__, pos.ToString());
+    nSize = ReadLE32(buf + MESSAGE_START_SIZE);
+    if (nSize > MAX_SIZE)
+        return error("%s: bad block size %u at %s", __func__, nSize, pos.ToString());
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos)
+{
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, 0), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    unsigned int nSize;
+    if (!ReadBlockSizeFromFile(filein.Get(), pos, nSize))
+        return false;
+    vchBlock.resize(nSize);
+    if (nSize > 0 && fread(&vchBlock[0], 1, nSize, filein.Get()) != nSize)
+        return error("%s: read failed at %s", __func__, pos.ToString());
+    return true;
+}
+
+namespace {
+    /**
+     * Serialized blocks recently sent to peers, most recent first. Syncing peers
+     * ask for the same stretch of blocks one after the other, so up to
+     * nRawBlockCacheSize bytes of them are kept the way they are on disk.
+     */
+    CCriticalSection cs_rawBlockCache;
+    typedef std::list<std::pair<uint256, CRawBlockRef> > RawBlockCacheList;
+    RawBlockCacheList listRawBlockCache;
+    std::map<uint256, RawBlockCacheList::iterator> mapRawBlockCache;
+    size_t nRawBlockCacheUsage = 0;
+    //! Enough of a block for its header with the largest Equihash solution in use
+    const size_t MAX_RAW_HEADER_BYTES = CBlockHeader::HEADER_SIZE + 3 + equihash_solution_size(200, 9);
+}
+
+bool ReadRawBlock(const CBlockIndex* pindex, CRawBlockRef& pblock)
+{
+    const uint256& hash = pindex->GetBlockHash();
+    {
+        LOCK(cs_rawBlockCache);
+        std::map<uint256, RawBlockCacheList::iterator>::iterator it = mapRawBlockCache.find(hash);
+        if (it != mapRawBlockCache.end()) {
+            listRawBlockCache.splice(listRawBlockCache.begin(), listRawBlockCache, it->second);
+            pblock = it->second->second;
+            return true;
+        }
+    }
+
+    std::shared_ptr<std::vector<unsigned char> > pvch = std::make_shared<std::vector<unsigned char> >();
+    if (!ReadRawBlockFromDisk(*pvch, pindex->GetBlockPos()))
+        return false;
+    // The header has to hash to the block asked for; damage past it fails the merkle root check of the peer
+    CBlockHeader header;
+    try {
+        CDataStream ss((const char*)pvch->data(), (const char*)pvch->data() + std::min(pvch->size(), MAX_RAW_HEADER_BYTES), SER_NETWORK, PROTOCOL_VERSION);
+        ss >> header;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+    }
+    if (header.GetHash() != hash)
+        return error("%s: GetHash() doesn't match index for %s at %s", __func__, pindex->ToString(), pindex->GetBlockPos().ToString());
+    pblock = pvch;
+
+    size_t nUsage = memusage::DynamicUsage(*pvch);
+    if (nUsage > nRawBlockCacheSize / 4)
+        return true;
+    LOCK(cs_rawBlockCache);
+    if (mapRawBlockCache.count(hash))
+        return true;
+    listRawBlockCache.push_front(std::make_pair(hash, pblock));
+    mapRawBlockCache[hash] = listRawBlockCache.begin();
+    nRawBlockCacheUsage += nUsage;
+    while (nRawBlockCacheUsage > nRawBlockCacheSize && !listRawBlockCache.empty()) {
+        nRawBlockCacheUsage -= memusage::DynamicUsage(*listRawBlockCache.back().second);
+        mapRawBlockCache.erase(listRawBlockCache.back().first);
+        listRawBlockCache.pop_back();
+    }
     return true;
 }
 
@@ -3148,8 +3424,6 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck() {
     RenameThread("zcash-scriptch");
     scriptcheckqueue.Thread();
@@ -3611,6 +3885,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     }
 
     ConnectNotarisations(block, pindex->GetHeight());
+    ConnectCCIndexes(block, pindex);
 
     if (fTxIndex)
         if (!pblocktree->WriteTxIndex(vPos))
@@ -3763,11 +4038,15 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
-            // Flush the chainstate (which may refer to block index entries).
+            // Flush the chainstate (which may refer to block index entries). The
+            // database write itself happens in the background, see CCoinsViewFlushBuffer.
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
+        // Callers of a forced flush (shutdown, gettxoutsetinfo) expect the state to be on disk.
+        if (mode == FLUSH_STATE_ALWAYS && pcoinsflushbuffer != NULL && !pcoinsflushbuffer->WaitForFlush())
+            return AbortNode(state, "Failed to write to coin database");
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
             // Update best block in wallet (so we can detect restored wallets).
             GetMainSignals().SetBestChain(chainActive.GetLocator());
@@ -3790,10 +4069,26 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+/** Publish chainActive's tip for the RPCs that read the chain without cs_main. */
+static void PublishTipSnapshot()
+{
+    AssertLockHeld(cs_main);
+    CChainSnapshot snapshot;
+    snapshot.pindexTip = chainActive.Tip();
+    if (snapshot.pindexTip != NULL) {
+        snapshot.nHeight = snapshot.pindexTip->GetHeight();
+        snapshot.hashTip = snapshot.pindexTip->GetBlockHash();
+        snapshot.nTipTime = snapshot.pindexTip->GetBlockTime();
+        snapshot.nNotarizedHeight = komodo_notarized_height(&snapshot.nPrevMoMHeight, &snapshot.notarizedHash, &snapshot.notarizedDesttxid);
+    }
+    PublishChainSnapshot(snapshot);
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew) {
     const CChainParams& chainParams = Params();
     chainActive.SetTip(pindexNew);
+    PublishTipSnapshot();
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -3872,6 +4167,8 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         assert(view.Flush());
         DisconnectNotarisations(block);
+        DisconnectCCIndexes(block, pindexDelete);
+        txcache.EraseBlock(block.vtx);
     }
     pindexDelete->segid = -2;
     pindexDelete->newcoins = 0;
@@ -5736,6 +6033,17 @@ bool static LoadBlockIndexDB()
     // Check whether we have an address index
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
+    if (fAddressIndex) {
+        // Address indexes built before the per-address summaries existed get them added once
+        bool fAddressSummary = false;
+        pblocktree->ReadFlag("addresssummaryindex", fAddressSummary);
+        if (!fAddressSummary) {
+            LogPrintf("%s: building address summary index...\n", __func__);
+            if (!pblocktree->BuildAddressSummaryIndex())
+                return error("%s: failed to build address summary index", __func__);
+            pblocktree->WriteFlag("addresssummaryindex", true);
+        }
+    }
 
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
@@ -5766,6 +6074,7 @@ bool static LoadBlockIndexDB()
         return true;
 
     chainActive.SetTip(it->second);
+    PublishTipSnapshot();
 
     // Set hashFinalSproutRoot for the end of best chain
     it->second->hashFinalSproutRoot = pcoinsTip->GetBestAnchor(SPROUT);
@@ -6042,6 +6351,7 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    PublishTipSnapshot();
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -6101,6 +6411,7 @@ bool InitBlockIndex() {
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addresssummaryindex", fAddressIndex);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
@@ -6540,8 +6851,6 @@ void static ProcessGetData(CNode* pfrom)
 
     vector<CInv> vNotFound;
 
-    LOCK(cs_main);
-
     while (it != pfrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
         if (pfrom->nSendSize >= SendBufferSize())
@@ -6555,44 +6864,54 @@ void static ProcessGetData(CNode* pfrom)
             if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
             {
                 bool send = false;
-                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end())
+                CBlockIndex* pindex = NULL;
+                uint256 hashContinueTip;
                 {
-                    if (chainActive.Contains(mi->second)) {
-                        send = true;
-                    } else {
-                        static const int nOneMonth = 30 * 24 * 60 * 60;
-                        // To prevent fingerprinting attacks, only send blocks outside of the active
-                        // chain if they are valid, and no more than a month older (both in time, and in
-                        // best equivalent proof of work) than the best header chain we know about.
-                        send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
-                        (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
-                        (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, Params().GetConsensus()) < nOneMonth);
-                        if (!send) {
-                            LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                    // Only the lookup needs cs_main; the block is read without it, so that
+                    // serving blocks doesn't hold up tx relay and header processing
+                    LOCK(cs_main);
+                    BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+                    if (mi != mapBlockIndex.end())
+                    {
+                        pindex = mi->second;
+                        if (chainActive.Contains(pindex)) {
+                            send = true;
+                        } else {
+                            static const int nOneMonth = 30 * 24 * 60 * 60;
+                            // To prevent fingerprinting attacks, only send blocks outside of the active
+                            // chain if they are valid, and no more than a month older (both in time, and in
+                            // best equivalent proof of work) than the best header chain we know about.
+                            send = pindex->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
+                            (pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() < nOneMonth) &&
+                            (GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, Params().GetConsensus()) < nOneMonth);
+                            if (!send) {
+                                LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                            }
                         }
                     }
+                    // Pruned nodes may have deleted the block, so check whether
+                    // it's available before trying to send.
+                    send = send && (pindex->nStatus & BLOCK_HAVE_DATA);
+                    if (send && inv.hash == pfrom->hashContinue)
+                        hashContinueTip = chainActive.Tip()->GetBlockHash();
                 }
-                // Pruned nodes may have deleted the block, so check whether
-                // it's available before trying to send.
-                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                if (send)
                 {
-                    // Send block from disk
+                    // Send block from disk. A whole block goes out as the bytes on disk,
+                    // without deserializing and serializing it again
+                    CRawBlockRef pblockRaw;
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second,1))
+                    if (inv.type == MSG_BLOCK ? !ReadRawBlock(pindex, pblockRaw) : !ReadBlockFromDisk(block, pindex, 1))
                     {
-                        assert(!"cannot load block from disk");
+                        // With pruning the file may have gone since the lookup
+                        if (!fPruneMode)
+                            assert(!"cannot load block from disk");
                     }
                     else
                     {
                         if (inv.type == MSG_BLOCK)
                         {
-                            //uint256 hash; int32_t z;
-                            //hash = block.GetHash();
-                            //for (z=31; z>=0; z--)
-                            //    fprintf(stderr,"%02x",((uint8_t *)&hash)[z]);
-                            //fprintf(stderr," send block %d\n",komodo_block2height(&block));
-                            pfrom->PushMessage("block", block);
+                            pfrom->PushMessage("block", CFlatData((void*)pblockRaw->data(), (void*)(pblockRaw->data() + pblockRaw->size())));
                         }
                         else // MSG_FILTERED_BLOCK)
                         {
@@ -6617,13 +6936,13 @@ void static ProcessGetData(CNode* pfrom)
                         }
                     }
                     // Trigger the peer node to send a getblocks request for the next batch of inventory
-                    if (inv.hash == pfrom->hashContinue)
+                    if (!hashContinueTip.IsNull())
                     {
                         // Bypass PushInventory, this must send even if redundant,
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
                         vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        vInv.push_back(CInv(MSG_BLOCK, hashContinueTip));
                         pfrom->PushMessage("inv", vInv);
                         pfrom->hashContinue.SetNull();
                     }
@@ -6678,10 +6997,10 @@ void static ProcessGetData(CNode* pfrom)
     }
 }
 
-bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
+bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CPreparedMessage* prepared)
 {
     const CChainParams& chainparams = Params();
-    LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
+    LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), prepared ? prepared->nPayloadSize : vRecv.size(), pfrom->id);
     //fprintf(stderr, "recv: %s peer=%d\n", SanitizeString(strCommand).c_str(), (int32_t)pfrom->GetId());
     if (mapArgs.count("-dropmessagestest") && GetRand(atoi(mapArgs["-dropmessagestest"])) == 0)
     {
@@ -7123,8 +7442,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
         vector<uint256> vWorkQueue;
         vector<uint256> vEraseQueue;
-        CTransaction tx;
-        vRecv >> tx;
+        CTransaction txRecv;
+        if (prepared)
+            prepared->ThrowIfFailed();
+        else
+            vRecv >> txRecv;
+        const CTransaction& tx = prepared ? prepared->tx : txRecv;
 
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
@@ -7257,15 +7580,21 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         std::vector<CBlockHeader> headers;
 
         // Bypass the normal CBlock deserialization, as we don't want to risk deserializing 2000 full blocks.
-        unsigned int nCount = ReadCompactSize(vRecv);
+        if (prepared)
+            prepared->ThrowIfFailed();
+        unsigned int nCount = prepared ? prepared->nHeaders : ReadCompactSize(vRecv);
         if (nCount > MAX_HEADERS_RESULTS) {
             Misbehaving(pfrom->GetId(), 20);
             return error("headers message size = %u", nCount);
         }
-        headers.resize(nCount);
-        for (unsigned int n = 0; n < nCount; n++) {
-            vRecv >> headers[n];
-            ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
+        if (prepared)
+            headers.swap(prepared->vHeaders);
+        else {
+            headers.resize(nCount);
+            for (unsigned int n = 0; n < nCount; n++) {
+                vRecv >> headers[n];
+                ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
+            }
         }
 
         LOCK(cs_main);
@@ -7317,8 +7646,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
     else if (strCommand == "block" && !fImporting && !fReindex) // Ignore blocks received while importing
     {
-        CBlock block;
-        vRecv >> block;
+        CBlock blockRecv;
+        if (prepared)
+            prepared->ThrowIfFailed();
+        else
+            vRecv >> blockRecv;
+        CBlock& block = prepared ? prepared->block : blockRecv;
 
         CInv inv(MSG_BLOCK, block.GetHash());
         LogPrint("net", "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
@@ -7621,6 +7954,18 @@ bool ProcessMessages(CNode* pfrom)
     //
     bool fOk = true;
 
+    // Hand the complete tx, block and headers messages to the preparation workers, so they
+    // get deserialized while the messages before them are processed. Not before the version
+    // message was processed, which sets the version the payload is read with.
+    if (pfrom->nVersion != 0) {
+        BOOST_FOREACH(CNetMessage& msg, pfrom->vRecvMsg) {
+            if (!msg.complete())
+                break;
+            if (!msg.prepared && IsPreparedCommand(msg.hdr.GetCommand()) && !QueueMessagePreparation(msg))
+                break;
+        }
+    }
+
     if (!pfrom->vRecvGetData.empty())
         ProcessGetData(pfrom);
 
@@ -7641,8 +7986,8 @@ bool ProcessMessages(CNode* pfrom)
         //            msg.hdr.nMessageSize, msg.vRecv.size(),
         //            msg.complete() ? "Y" : "N");
 
-        // end, if an incomplete message is found
-        if (!msg.complete())
+        // end, if an incomplete message is found, or one the workers are not done with
+        if (!msg.ready())
             break;
 
         // at this point, any failure means we can delete the current message
@@ -7667,10 +8012,16 @@ bool ProcessMessages(CNode* pfrom)
         // Message size
         unsigned int nMessageSize = hdr.nMessageSize;
 
-        // Checksum
-        CDataStream& vRecv = msg.vRecv;
-        uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
-        unsigned int nChecksum = ReadLE32((unsigned char*)&hash);
+        // Checksum, computed by the workers for prepared messages
+        CPreparedMessage* prepared = msg.prepared.get();
+        CDataStream& vRecv = prepared ? prepared->vRecv : msg.vRecv;
+        unsigned int nChecksum;
+        if (prepared)
+            nChecksum = prepared->nChecksum;
+        else {
+            uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
+            nChecksum = ReadLE32((unsigned char*)&hash);
+        }
         if (nChecksum != hdr.nChecksum)
         {
             LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n", __func__,
@@ -7682,7 +8033,7 @@ bool ProcessMessages(CNode* pfrom)
         bool fRet = false;
         try
         {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, prepared);
             boost::this_thread::interruption_point();
         }
         catch (const std::ios_base::failure& e)
@@ -58,6 +58,7 @@
 class CBlockIndex;
 class CBlockTreeDB;
 class CBloomFilter;
+class CCoinsViewFlushBuffer;
 class CInv;
 class CScriptCheck;
 class CValidationInterface;
@@ -97,6 +98,8 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
+/** Standard txs entering the mempool with at least this many inputs have their scripts checked on the script check threads */
+static const unsigned int MEMPOOL_SCRIPT_CHECK_MIN_INPUTS = 8;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
@@ -123,9 +126,16 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 //static const bool DEFAULT_SPENTINDEX = false;
 #define DEFAULT_ADDRESSINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 #define DEFAULT_SPENTINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
+#define DEFAULT_CCINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const unsigned int DEFAULT_DB_MAX_OPEN_FILES = 1000;
 static const bool DEFAULT_DB_COMPRESSION = true;
+/** Default for -blockreadcache, the memory in MiB used to keep recently read blocks */
+static const unsigned int DEFAULT_BLOCK_READ_CACHE_SIZE = 16;
+/** Default for -rawblockcache, the memory in MiB used to keep serialized blocks recently sent to peers */
+static const unsigned int DEFAULT_RAW_BLOCK_CACHE_SIZE = 32;
+/** How many blocks ahead of the current one sequential readers ask the OS to read in */
+static const int BLOCK_PREFETCH_WINDOW = 128;
 
 // Sanity check the magic numbers when we change them
 //BOOST_STATIC_ASSERT(DEFAULT_BLOCK_MAX_SIZE <= MAX_BLOCK_SIZE());
@@ -156,6 +166,7 @@ extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
@@ -163,6 +174,8 @@ extern bool fCheckpointsEnabled;
 // it is unneeded for testing
 extern bool fCoinbaseEnforcedProtectionEnabled;
 extern size_t nCoinCacheUsage;
+extern size_t nBlockReadCacheSize;
+extern size_t nRawBlockCacheSize;
 extern CFeeRate minRelayTxFee;
 extern bool fAlerts;
 extern int64_t nMaxTipAge;
@@ -631,6 +644,96 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+struct CAddressUnspentHeightKey {
+    unsigned int type;
+    uint160 hashBytes;
+    int blockHeight;
+    uint256 txhash;
+    size_t index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 61;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+
+    CAddressUnspentHeightKey(unsigned int addressType, uint160 addressHash, int height, uint256 txid, size_t indexValue) {
+        type = addressType;
+        hashBytes = addressHash;
+        blockHeight = height;
+        txhash = txid;
+        index = indexValue;
+    }
+
+    CAddressUnspentHeightKey(const CAddressUnspentKey &key, int height) {
+        type = key.type;
+        hashBytes = key.hashBytes;
+        blockHeight = height;
+        txhash = key.txhash;
+        index = key.index;
+    }
+
+    CAddressUnspentHeightKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        blockHeight = 0;
+        txhash.SetNull();
+        index = 0;
+    }
+};
+
+/** Running totals for an address, kept in step with its address index entries */
+struct CAddressSummaryValue {
+    CAmount balance;
+    CAmount received;
+    int64_t txCount;
+    int64_t utxoCount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(txCount);
+        READWRITE(utxoCount);
+    }
+
+    CAddressSummaryValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+        utxoCount = 0;
+    }
+
+    bool IsNull() const {
+        return txCount == 0 && utxoCount == 0 && balance == 0 && received == 0;
+    }
+};
+
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
@@ -801,11 +904,31 @@ bool GetAddressIndex(uint160 addressHash, int type,
                      int start = 0, int end = 0);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressSummary(uint160 addressHash, int type, CAddressSummaryValue &summary);
+bool GetAddressIndexPage(uint160 addressHash, int type, const CAddressIndexKey *pafter, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int end = 0);
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentHeightKey *pafter, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos,bool checkPOW);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex,bool checkPOW);
+typedef std::shared_ptr<const CBlock> CBlockRef;
+/** Read the block of pindex through the cache of recently read blocks, sharing it rather than copying it */
+bool ReadBlock(const CBlockIndex* pindex, CBlockRef& pblock, bool checkPOW = false);
+/**
+ * Hint the OS to read ahead the block files holding the active chain from nStartHeight to nEndHeight,
+ * leaving out the blocks in the read cache. Does nothing when cs_main is busy in another thread.
+ */
+void PrefetchBlockRange(int nStartHeight, int nEndHeight);
+/** Read the size of the serialized block at pos from the header written before it in an open block file */
+bool ReadBlockSizeFromFile(FILE* file, const CDiskBlockPos& pos, unsigned int& nSize);
+/** Read the serialized bytes of the block at pos without deserializing them */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos);
+typedef std::shared_ptr<const std::vector<unsigned char> > CRawBlockRef;
+/** Read the serialized bytes of the block of pindex, checked against its hash, through a cache of recently served blocks */
+bool ReadRawBlock(const CBlockIndex* pindex, CRawBlockRef& pblock);
 bool RemoveOrphanedBlocks(int32_t notarized_height);
 
 /** Functions for validating blocks and updating the block tree */
@@ -931,6 +1054,9 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** Background writer between pcoinsTip and the coin database */
+extern CCoinsViewFlushBuffer *pcoinsflushbuffer;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
@@ -0,0 +1,203 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "msgprepare.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "main.h"
+#include "net.h"
+#include "pow.h"
+#include "util.h"
+
+#include <deque>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+CPreparedMessage::CPreparedMessage(const std::string& strCommandIn, unsigned int nHeaderChecksumIn, int nTypeIn, int nVersionIn) :
+    strCommand(strCommandIn), vRecv(nTypeIn, nVersionIn), nPayloadSize(0), nChecksum(0), nHeaders(0), nHeaderChecksum(nHeaderChecksumIn), fReady(false)
+{
+}
+
+void CPreparedMessage::Prepare()
+{
+    nPayloadSize = vRecv.size();
+    uint256 hash = Hash(vRecv.begin(), vRecv.end());
+    nChecksum = ReadLE32((unsigned char*)&hash);
+    // The message handler rejects it without looking at the payload
+    if (nChecksum != nHeaderChecksum) {
+        fReady = true;
+        return;
+    }
+
+    try {
+        if (strCommand == "tx") {
+            vRecv >> tx;
+        } else if (strCommand == "block") {
+            vRecv >> block;
+            CheckEquihashSolution(&block, Params());
+        } else if (strCommand == "headers") {
+            nHeaders = ReadCompactSize(vRecv);
+            if (nHeaders <= MAX_HEADERS_RESULTS) {
+                vHeaders.resize(nHeaders);
+                for (unsigned int n = 0; n < nHeaders; n++) {
+                    vRecv >> vHeaders[n];
+                    ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
+                }
+                // The handler skips the headers it already has and stops at the
+                // first one that does not connect or has a bad solution, so
+                // there is no use checking those
+                std::vector<uint256> vHash(nHeaders);
+                std::vector<bool> vKnown(nHeaders, false);
+                for (unsigned int n = 0; n < nHeaders; n++)
+                    vHash[n] = vHeaders[n].GetHash();
+                {
+                    LOCK(cs_main);
+                    for (unsigned int n = 0; n < nHeaders; n++)
+                        vKnown[n] = mapBlockIndex.count(vHash[n]) != 0;
+                }
+                for (unsigned int n = 0; n < nHeaders; n++) {
+                    if (n > 0 && vHeaders[n].hashPrevBlock != vHash[n - 1])
+                        break;
+                    if (!vKnown[n] && !CheckEquihashSolution(&vHeaders[n], Params()))
+                        break;
+                }
+            }
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    fReady = true;
+}
+
+void CPreparedMessage::ThrowIfFailed() const
+{
+    if (error)
+        std::rethrow_exception(error);
+}
+
+bool IsPreparedCommand(const std::string& strCommand)
+{
+    return strCommand == "tx" || strCommand == "block" || strCommand == "headers";
+}
+
+namespace {
+
+class CMessagePreparer
+{
+private:
+    boost::mutex cs;
+    boost::condition_variable cond;
+    std::deque<std::shared_ptr<CPreparedMessage> > queue;
+    boost::thread_group threads;
+    bool fRunning;
+
+    void Thread()
+    {
+        RenameThread("komodo-msgprep");
+        while (true) {
+            std::shared_ptr<CPreparedMessage> prepared;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (fRunning && queue.empty())
+                    cond.wait(lock);
+                if (!fRunning)
+                    return;
+                prepared = queue.front();
+                queue.pop_front();
+            }
+            prepared->Prepare();
+            WakeMessageHandler();
+        }
+    }
+
+public:
+    CMessagePreparer() : fRunning(false) {}
+
+    void Start(int nThreads)
+    {
+        fRunning = nThreads > 0;
+        for (int i = 0; i < nThreads; i++)
+            threads.create_thread(boost::bind(&CMessagePreparer::Thread, this));
+    }
+
+    void Stop()
+    {
+        std::deque<std::shared_ptr<CPreparedMessage> > vLeft;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fRunning = false;
+            vLeft.swap(queue);
+            cond.notify_all();
+        }
+        threads.join_all();
+        // Messages of connected peers may still wait for these
+        BOOST_FOREACH(std::shared_ptr<CPreparedMessage>& prepared, vLeft)
+            prepared->Prepare();
+    }
+
+    bool Running() { return fRunning; }
+    int Size() { return threads.size(); }
+
+    void Push(const std::shared_ptr<CPreparedMessage>& prepared)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        queue.push_back(prepared);
+        cond.notify_one();
+    }
+};
+
+CMessagePreparer messagePreparer;
+//! Guards starting and stopping the workers against messages being queued
+CCriticalSection cs_messagePreparer;
+
+}
+
+bool QueueMessagePreparation(CNetMessage& msg)
+{
+    LOCK(cs_messagePreparer);
+    if (!messagePreparer.Running())
+        return false;
+    if (!msg.hdr.IsValid(Params().MessageStart()) || msg.hdr.nMessageSize != msg.vRecv.size())
+        return false;
+
+    std::shared_ptr<CPreparedMessage> prepared = std::make_shared<CPreparedMessage>(
+        msg.hdr.GetCommand(), msg.hdr.nChecksum, msg.vRecv.GetType(), msg.vRecv.GetVersion());
+    prepared->vRecv.swap(msg.vRecv);
+    msg.prepared = prepared;
+    messagePreparer.Push(prepared);
+    return true;
+}
+
+void StartMessagePreparation(int nThreads)
+{
+    LOCK(cs_messagePreparer);
+    messagePreparer.Stop();
+    messagePreparer.Start(nThreads);
+    LogPrintf("Using %d threads to prepare peer messages\n", nThreads);
+}
+
+void StopMessagePreparation()
+{
+    LOCK(cs_messagePreparer);
+    messagePreparer.Stop();
+}
+
+int GetMessagePreparationThreads()
+{
+    LOCK(cs_messagePreparer);
+    return messagePreparer.Size();
+}
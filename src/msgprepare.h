@@ -0,0 +1,89 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef BITCOIN_MSGPREPARE_H
+#define BITCOIN_MSGPREPARE_H
+
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "streams.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CNetMessage;
+
+/** Default for -msgpreparethreads, the threads that deserialize peer messages ahead of the message handler */
+static const int DEFAULT_MSG_PREPARE_THREADS = 2;
+
+/**
+ * A tx, block or headers message that a worker thread checksums and
+ * deserializes while the message handler is still busy with earlier messages.
+ * For blocks and headers the equihash solutions are verified as well, which
+ * leaves the result in the verified solution cache of CheckEquihashSolution().
+ * Of the headers, only those the handler would go on to check are verified.
+ *
+ * The payload is moved out of the CNetMessage when it is handed to the
+ * workers. The message handler only takes the message once IsReady(), so each
+ * peer's messages are still processed in the order they arrived.
+ */
+class CPreparedMessage
+{
+public:
+    std::string strCommand;
+    //! The payload, consumed by deserialization
+    CDataStream vRecv;
+    size_t nPayloadSize;
+    //! Checksum of the payload, for the message handler to compare with the header
+    unsigned int nChecksum;
+
+    CTransaction tx;
+    CBlock block;
+    //! Number of headers announced; they are only read if it is within MAX_HEADERS_RESULTS
+    unsigned int nHeaders;
+    std::vector<CBlockHeader> vHeaders;
+
+    CPreparedMessage(const std::string& strCommandIn, unsigned int nHeaderChecksumIn, int nTypeIn, int nVersionIn);
+
+    /** Run by a worker: checksum, deserialize and check the proof of work */
+    void Prepare();
+    bool IsReady() const { return fReady.load(); }
+    /** Throws what deserialization threw, at the point ProcessMessage would have read the payload */
+    void ThrowIfFailed() const;
+
+private:
+    unsigned int nHeaderChecksum;
+    std::exception_ptr error;
+    std::atomic<bool> fReady;
+};
+
+/** Whether the workers handle this kind of message */
+bool IsPreparedCommand(const std::string& strCommand);
+
+/**
+ * Hands a complete message to the workers, unless they are not running.
+ * requires LOCK(cs_vRecvMsg) of the node the message belongs to.
+ */
+bool QueueMessagePreparation(CNetMessage& msg);
+
+/** (Re)starts the workers with nThreads threads; 0 stops them and messages are handled inline */
+void StartMessagePreparation(int nThreads);
+void StopMessagePreparation();
+int GetMessagePreparationThreads();
+
+#endif // BITCOIN_MSGPREPARE_H
@@ -28,6 +28,7 @@
 #include "addrman.h"
 #include "chainparams.h"
 #include "clientversion.h"
+#include "msgprepare.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
 #include "ui_interface.h"
@@ -37,6 +38,11 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
 #endif
 
 #include <boost/filesystem.hpp>
@@ -65,6 +71,12 @@ using namespace std;
 namespace {
     const int MAX_OUTBOUND_CONNECTIONS = 16;
     const int MAX_INBOUND_FROMIP = 5;
+    /** Most queued messages handed to one sendmsg() call */
+    const int SEND_IOV_MAX = 64;
+    /** Most socket events taken from one epoll_wait() call */
+    const int EPOLL_MAX_EVENTS = 256;
+    /** Marks the epoll data of a listen socket, whose index it carries; node sockets carry the node id */
+    const uint64_t EPOLL_LISTEN_SOCKET = 1ULL << 63;
 
     struct ListenSocket {
         SOCKET socket;
@@ -427,12 +439,41 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
     return NULL;
 }
 
+#ifdef USE_EPOLL
+//! The epoll instance of ThreadSocketHandler, or INVALID_SOCKET while it is not running
+static SOCKET hSocketPoll = INVALID_SOCKET;
+
+void SetSocketPoll(SOCKET hPoll)
+{
+    hSocketPoll = hPoll;
+}
+
+bool RegisterNodeSocket(CNode* pnode)
+{
+    // Edge triggered: an event only says the state changed, the flags
+    // remember it until recv() or send() runs dry
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = (uint64_t)pnode->GetId();
+    if (hSocketPoll == INVALID_SOCKET || epoll_ctl(hSocketPoll, EPOLL_CTL_ADD, pnode->hSocket, &event) == SOCKET_ERROR)
+        return false;
+    pnode->fPollRegistered = true;
+    return true;
+}
+#endif
+
 void CNode::CloseSocketDisconnect()
 {
     fDisconnect = true;
     if (hSocket != INVALID_SOCKET)
     {
         LogPrint("net", "disconnecting peer=%d\n", id);
+#ifdef USE_EPOLL
+        // A duplicate of the descriptor would keep it in the set after the close
+        if (fPollRegistered && hSocketPoll != INVALID_SOCKET)
+            epoll_ctl(hSocketPoll, EPOLL_CTL_DEL, hSocket, NULL);
+        fPollRegistered = false;
+#endif
         CloseSocket(hSocket);
     }
 
@@ -591,6 +632,16 @@ void CNode::copyStats(CNodeStats &stats)
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
 }
 
+bool CNetMessage::ready() const
+{
+    return complete() && (!prepared || prepared->IsReady());
+}
+
+void WakeMessageHandler()
+{
+    messageHandlerCondition.notify_one();
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 {
@@ -691,20 +742,40 @@ void SocketSendData(CNode *pnode)
     std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
+        assert(it->size() > pnode->nSendOffset);
+#ifdef _WIN32
         const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
         int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+        // Hand the queued messages to the kernel straight from their buffers, as many as fit in one call
+        struct iovec iov[SEND_IOV_MAX];
+        int nIov = 0;
+        for (std::deque<CSerializeData>::iterator itSend = it; itSend != pnode->vSendMsg.end() && nIov < SEND_IOV_MAX; itSend++, nIov++) {
+            size_t nOffset = nIov == 0 ? pnode->nSendOffset : 0;
+            iov[nIov].iov_base = &(*itSend)[nOffset];
+            iov[nIov].iov_len = itSend->size() - nOffset;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nIov;
+        int nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetTime();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             pnode->RecordBytesSent(nBytes);
-            if (pnode->nSendOffset == data.size()) {
+            // Move past the messages that went out in full
+            size_t nLeft = nBytes;
+            while (nLeft > 0 && nLeft >= it->size() - pnode->nSendOffset) {
+                nLeft -= it->size() - pnode->nSendOffset;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
+            }
+            if (nLeft > 0) {
                 // could not send full message; stop sending more
+                pnode->nSendOffset += nLeft;
                 break;
             }
         } else {
@@ -1008,9 +1079,76 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+/**
+ * Whether the socket handler should send to, or receive from, a node:
+ * - If there is data to send, wait for sending data. As this only
+ *   happens when optimistic write failed, we choose to first drain the
+ *   write buffer in this case before receiving more. This avoids
+ *   needlessly queueing received data, if the remote peer is not themselves
+ *   receiving data. This means properly utilizing TCP flow control signaling.
+ * - Otherwise, if there is no (complete) message in the receive buffer,
+ *   or there is space left in the buffer, wait for receiving data.
+ * - (if neither of the above applies, there is certainly one message
+ *   in the receiver buffer ready to be processed).
+ * Together, that means that at least one of the following is always possible,
+ * so we don't deadlock:
+ * - We send some data.
+ * - We wait for data to be received (and disconnect after timeout).
+ * - We process a message in the buffer (message handler thread).
+ */
+static void GetSocketInterest(CNode* pnode, bool& fWantSend, bool& fWantRecv)
+{
+    fWantSend = false;
+    fWantRecv = false;
+    {
+        TRY_LOCK(pnode->cs_vSend, lockSend);
+        if (lockSend && !pnode->vSendMsg.empty()) {
+            fWantSend = true;
+            return;
+        }
+    }
+    {
+        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+        if (lockRecv && (
+            pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+            pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+            fWantRecv = true;
+    }
+}
+
+#ifdef USE_EPOLL
+/** Closes the epoll instance when the socket handler thread is interrupted */
+class CEpollHandle
+{
+public:
+    int fd;
+
+    CEpollHandle() : fd(epoll_create1(EPOLL_CLOEXEC)) { if (fd != SOCKET_ERROR) SetSocketPoll(fd); }
+    ~CEpollHandle() { if (fd != SOCKET_ERROR) { SetSocketPoll(INVALID_SOCKET); close(fd); } }
+};
+#endif
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+#ifdef USE_EPOLL
+    CEpollHandle epoll;
+    int hEpoll = epoll.fd;
+    if (hEpoll == SOCKET_ERROR) {
+        LogPrintf("socket epoll_create error %s\n", NetworkErrorString(WSAGetLastError()));
+        return;
+    }
+    // Listen sockets stay level triggered, one connection is accepted per event
+    for (size_t i = 0; i < vhListenSocket.size(); i++) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u64 = EPOLL_LISTEN_SOCKET | i;
+        if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, vhListenSocket[i].socket, &event) == SOCKET_ERROR)
+            LogPrintf("socket epoll_ctl error %s\n", NetworkErrorString(WSAGetLastError()));
+    }
+    // Whether there is more to do right away than the events say
+    bool fSocketsBusy = false;
+#endif
     while (true)
     {
         //
@@ -1076,6 +1214,72 @@ void ThreadSocketHandler()
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+#ifdef USE_EPOLL
+        //
+        // Register new sockets, and collect the readiness of registered ones
+        //
+        {
+            LOCK(cs_vNodes);
+            BOOST_FOREACH(CNode* pnode, vNodes)
+            {
+                if (pnode->hSocket == INVALID_SOCKET || pnode->fPollRegistered)
+                    continue;
+                if (!RegisterNodeSocket(pnode)) {
+                    LogPrintf("socket epoll_ctl error %s\n", NetworkErrorString(WSAGetLastError()));
+                    pnode->fDisconnect = true;
+                    continue;
+                }
+                // Data may have arrived before the socket was registered
+                pnode->fRecvReady = true;
+                pnode->fSendReady = true;
+                fSocketsBusy = true;
+            }
+        }
+
+        struct epoll_event events[EPOLL_MAX_EVENTS];
+        // frequency to poll for room in pnode->vRecvMsg
+        int nEvents = epoll_wait(hEpoll, events, EPOLL_MAX_EVENTS, fSocketsBusy ? 0 : 50);
+        boost::this_thread::interruption_point();
+
+        if (nEvents == SOCKET_ERROR)
+        {
+            int nErr = WSAGetLastError();
+            if (nErr != WSAEINTR)
+            {
+                LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+                MilliSleep(50);
+            }
+            nEvents = 0;
+        }
+
+        std::map<NodeId, uint32_t> mapNodeEvents;
+        for (int i = 0; i < nEvents; i++)
+        {
+            if (events[i].data.u64 & EPOLL_LISTEN_SOCKET)
+            {
+                // Accept new connections
+                AcceptConnection(vhListenSocket[events[i].data.u64 & ~EPOLL_LISTEN_SOCKET]);
+                continue;
+            }
+            mapNodeEvents[(NodeId)events[i].data.u64] |= events[i].events;
+        }
+        if (!mapNodeEvents.empty())
+        {
+            // The events name nodes by id, those disconnected since are not found
+            LOCK(cs_vNodes);
+            BOOST_FOREACH(CNode* pnode, vNodes)
+            {
+                std::map<NodeId, uint32_t>::const_iterator it = mapNodeEvents.find(pnode->GetId());
+                if (it == mapNodeEvents.end())
+                    continue;
+                if (it->second & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                    pnode->fRecvReady = true;
+                if (it->second & EPOLLOUT)
+                    pnode->fSendReady = true;
+            }
+        }
+        fSocketsBusy = false;
+#else
         //
         // Find which sockets have data to receive
         //
@@ -1108,35 +1312,12 @@ void ThreadSocketHandler()
                 hSocketMax = max(hSocketMax, pnode->hSocket);
                 have_fds = true;
 
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signaling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-                {
-                    TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
-                    }
-                }
-                {
-                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (
-                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+                bool fWantSend, fWantRecv;
+                GetSocketInterest(pnode, fWantSend, fWantRecv);
+                if (fWantSend)
+                    FD_SET(pnode->hSocket, &fdsetSend);
+                else if (fWantRecv)
+                    FD_SET(pnode->hSocket, &fdsetRecv);
             }
         }
 
@@ -1168,6 +1349,7 @@ void ThreadSocketHandler()
                 AcceptConnection(hListenSocket);
             }
         }
+#endif
 
         //
         // Service each socket
@@ -1183,12 +1365,22 @@ void ThreadSocketHandler()
         {
             boost::this_thread::interruption_point();
 
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+#ifdef USE_EPOLL
+            bool fWantSend, fWantRecv;
+            GetSocketInterest(pnode, fWantSend, fWantRecv);
+            bool fRecv = pnode->fRecvReady && fWantRecv;
+            bool fSend = pnode->fSendReady && fWantSend;
+#else
+            bool fRecv = FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError);
+            bool fSend = FD_ISSET(pnode->hSocket, &fdsetSend);
+#endif
+
             //
             // Receive
             //
-            if (pnode->hSocket == INVALID_SOCKET)
-                continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+            if (fRecv)
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
@@ -1223,8 +1415,19 @@ void ThreadSocketHandler()
                                 pnode->CloseSocketDisconnect();
                             }
                         }
+#ifdef USE_EPOLL
+                        // A short read drained the socket; anything arriving later raises a new event
+                        if (nBytes == (int)sizeof(pchBuf))
+                            fSocketsBusy = true;
+                        else
+                            pnode->fRecvReady = false;
+#endif
                     }
                 }
+#ifdef USE_EPOLL
+                else
+                    fSocketsBusy = true;
+#endif
             }
 
             //
@@ -1232,11 +1435,17 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            if (fSend)
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
+                if (lockSend) {
                     SocketSendData(pnode);
+#ifdef USE_EPOLL
+                    // Data left means the socket buffer is full, until EPOLLOUT says otherwise
+                    if (!pnode->vSendMsg.empty())
+                        pnode->fSendReady = false;
+#endif
+                }
             }
 
             //
@@ -1599,7 +1808,7 @@ void ThreadMessageHandler()
 
                     if (pnode->nSendSize < SendBufferSize())
                     {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
+                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].ready()))
                         {
                             fSleep = false;
                         }
@@ -2121,6 +2330,9 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nPingUsecStart = 0;
     nPingUsecTime = 0;
     fPingQueued = false;
+    fPollRegistered = false;
+    fRecvReady = false;
+    fSendReady = false;
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
 
     {
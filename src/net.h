@@ -36,6 +36,7 @@
 #include "util.h"
 
 #include <deque>
+#include <memory>
 #include <stdint.h>
 
 #ifndef _WIN32
@@ -94,6 +95,17 @@ bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhite
 void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler);
 bool StopNode();
 void SocketSendData(CNode *pnode);
+#ifdef USE_EPOLL
+/** Sets the epoll instance the socket handler waits on; INVALID_SOCKET when there is none */
+void SetSocketPoll(SOCKET hPoll);
+/**
+ * Adds the socket of a node to that epoll instance, with the node id as the
+ * event data. CNode::CloseSocketDisconnect() takes it out before the close.
+ */
+bool RegisterNodeSocket(CNode* pnode);
+#endif
+/** Wake the message handler thread, e.g. when a message became ready to process */
+void WakeMessageHandler();
 
 typedef int NodeId;
 
@@ -210,6 +222,8 @@ public:
 
 
 
+class CPreparedMessage;
+
 class CNetMessage {
 public:
     bool in_data;                   // parsing header (false) or data (true)
@@ -223,6 +237,9 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
+    // set once the payload was handed to the message preparation workers, see msgprepare.h
+    std::shared_ptr<CPreparedMessage> prepared;
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
@@ -238,6 +255,9 @@ public:
         return (hdr.nMessageSize == nDataPos);
     }
 
+    // complete, and not waiting for the preparation workers
+    bool ready() const;
+
     void SetVersion(int nVersionIn)
     {
         hdrbuf.SetVersion(nVersionIn);
@@ -348,6 +368,12 @@ public:
     // Whether a ping is requested.
     bool fPingQueued;
 
+    // Socket readiness as reported by epoll, only used by ThreadSocketHandler,
+    // and whether the socket is in its epoll set
+    bool fPollRegistered;
+    bool fRecvReady;
+    bool fSendReady;
+
     CNode(SOCKET hSocketIn, const CAddress &addrIn, const std::string &addrNameIn = "", bool fInboundIn = false);
     ~CNode();
 
@@ -377,8 +403,9 @@ public:
     unsigned int GetTotalRecvSize()
     {
         unsigned int total = 0;
+        // count the bytes received, the payload may have been handed to the preparation workers
         BOOST_FOREACH(const CNetMessage &msg, vRecvMsg)
-            total += msg.vRecv.size() + 24;
+            total += std::max((unsigned int)msg.vRecv.size(), msg.nDataPos) + 24;
         return total;
     }
 
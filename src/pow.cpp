@@ -27,9 +27,12 @@
 #include "crypto/equihash.h"
 #include "primitives/block.h"
 #include "streams.h"
+#include "sync.h"
 #include "uint256.h"
 #include "util.h"
 
+#include <set>
+
 #include "sodium.h"
 
 #ifdef ENABLE_RUST
@@ -327,6 +330,41 @@ uint32_t lwmaGetNextPOSRequired(const CBlockIndex* pindexLast, const Consensus::
     return nextTarget.GetCompact();
 }
 
+namespace {
+    /**
+     * Hashes of headers whose solution verified. The same header is checked when it
+     * arrives in a headers message, again with its block, and by the message
+     * preparation workers ahead of both; the hash covers the solution, so a hit
+     * stands for the same solution.
+     */
+    CCriticalSection cs_equihashCache;
+    std::set<uint256> setEquihashVerified;
+    const size_t MAX_EQUIHASH_CACHE_ENTRIES = 10000;
+
+    bool IsEquihashVerified(const uint256& hash)
+    {
+        LOCK(cs_equihashCache);
+        return setEquihashVerified.count(hash) != 0;
+    }
+
+    void AddEquihashVerified(const uint256& hash)
+    {
+        LOCK(cs_equihashCache);
+        if (setEquihashVerified.size() >= MAX_EQUIHASH_CACHE_ENTRIES) {
+            // Hashes are random, so the one after the new entry is as good as any to evict
+            std::set<uint256>::iterator it = setEquihashVerified.lower_bound(hash);
+            setEquihashVerified.erase(it != setEquihashVerified.end() ? it : setEquihashVerified.begin());
+        }
+        setEquihashVerified.insert(hash);
+    }
+}
+
+void ClearEquihashCache()
+{
+    LOCK(cs_equihashCache);
+    setEquihashVerified.clear();
+}
+
 bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& params)
 {
     if (ASSETCHAINS_ALGO != ASSETCHAINS_EQUIHASH)
@@ -337,6 +375,10 @@ bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& param
 
     if ( Params().NetworkIDString() == "regtest" )
         return(true);
+
+    uint256 hash = pblock->GetHash();
+    if (IsEquihashVerified(hash))
+        return true;
     // Hash state
     crypto_generichash_blake2b_state state;
     EhInitialiseState(n, k, state);
@@ -357,6 +399,7 @@ bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& param
     if (!isValid)
         return error("CheckEquihashSolution(): invalid solution");
 
+    AddEquihashVerified(hash);
     return true;
 }
 
@@ -41,6 +41,8 @@ unsigned int lwmaGetNextPOSRequired(const CBlockIndex* pindexLast, const Consens
 
 /** Check whether the Equihash solution in a block header is valid */
 bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams&);
+/** Forget which solutions were verified, for benchmarks */
+void ClearEquihashCache();
 
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(const CBlockHeader &blkHeader, uint8_t *pubkey33, int32_t height, const Consensus::Params& params);
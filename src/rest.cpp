@@ -20,8 +20,10 @@
 
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "base58.h"
 #include "main.h"
 #include "httpserver.h"
+#include "notarisationdb.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -30,6 +32,7 @@
 #include "version.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/dynamic_bitset.hpp>
 
 #include <univalue.h>
@@ -37,6 +40,8 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const long MAX_REST_BLOCKS = 1000; //allow a max of 1000 raw blocks to be requested at once
+static const int NOTARISATION_SCAN_BLOCKS = 1440; //how far back /rest/notarisations/<height>/<symbol> looks
 
 enum RetFormat {
     RF_UNDEF,
@@ -130,6 +135,80 @@ static bool CheckWarmup(HTTPRequest* req)
     return true;
 }
 
+/**
+ * Reply with the blocks at positions, concatenated, as they are stored in the block files.
+ * The binary format is sent from the files without copying. Returns false before
+ * anything was written when a block cannot be read.
+ */
+static bool WriteRawBlocks(HTTPRequest* req, enum RetFormat rf, const std::vector<CDiskBlockPos>& positions)
+{
+    if (rf == RF_HEX) {
+        std::string strHex;
+        std::vector<unsigned char> vchBlock;
+        BOOST_FOREACH(const CDiskBlockPos& pos, positions) {
+            if (!ReadRawBlockFromDisk(vchBlock, pos))
+                return false;
+            strHex += HexStr(vchBlock.begin(), vchBlock.end());
+        }
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex + "\n");
+        return true;
+    }
+
+    // One open file and a list of ranges per run of blocks from the same block file
+    std::vector<std::pair<FILE*, std::vector<std::pair<int64_t, int64_t> > > > files;
+    bool fOk = true;
+    for (size_t i = 0; i < positions.size() && fOk; i++) {
+        if (i == 0 || positions[i].nFile != positions[i - 1].nFile) {
+            FILE* file = OpenBlockFile(CDiskBlockPos(positions[i].nFile, 0), true);
+            if (file == NULL) {
+                fOk = false;
+                break;
+            }
+            files.push_back(std::make_pair(file, std::vector<std::pair<int64_t, int64_t> >()));
+        }
+        unsigned int nSize;
+        fOk = ReadBlockSizeFromFile(files.back().first, positions[i], nSize);
+        files.back().second.push_back(std::make_pair((int64_t)positions[i].nPos, (int64_t)nSize));
+    }
+    for (size_t i = 0; i < files.size() && fOk; i++)
+        fOk = req->AppendReplyFile(files[i].first, files[i].second);
+    for (size_t i = 0; i < files.size(); i++)
+        fclose(files[i].first);
+    if (!fOk) {
+        // Ranges of the earlier files may already be in the reply
+        req->ClearReply();
+        return false;
+    }
+
+    req->WriteHeader("Content-Type", "application/octet-stream");
+    req->WriteReply(HTTP_OK);
+    return true;
+}
+
+/** Reply with serialized data in one of the binary formats */
+static bool WriteSerializedReply(HTTPRequest* req, enum RetFormat rf, const CDataStream& ss)
+{
+    switch (rf) {
+    case RF_BINARY: {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ss.str());
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ss.begin(), ss.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+    }
+    }
+}
+
 static bool rest_headers(HTTPRequest* req,
                          const std::string& strURIPart)
 {
@@ -228,26 +307,20 @@ static bool rest_block(HTTPRequest* req,
         pblockindex = mapBlockIndex[hash];
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
+        if (!(pblockindex->nStatus & BLOCK_HAVE_DATA))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
-        if (!ReadBlockFromDisk(block, pblockindex,1))
+        // The binary formats are the bytes on disk, only the json one needs the block itself
+        if (rf == RF_JSON && !ReadBlockFromDisk(block, pblockindex,1))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
-
     switch (rf) {
-    case RF_BINARY: {
-        string binaryBlock = ssBlock.str();
-        req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryBlock);
-        return true;
-    }
-
+    case RF_BINARY:
     case RF_HEX: {
-        string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
-        req->WriteHeader("Content-Type", "text/plain");
-        req->WriteReply(HTTP_OK, strHex);
+        std::vector<CDiskBlockPos> positions(1, pblockindex->GetBlockPos());
+        if (!WriteRawBlocks(req, rf, positions))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
         return true;
     }
 
@@ -409,6 +482,171 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_blocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block count specified. Use /rest/blocks/<count>/<hash>.<ext>.");
+    if (rf != RF_BINARY && rf != RF_HEX)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+
+    long count = strtol(path[0].c_str(), NULL, 10);
+    if (count < 1 || count > MAX_REST_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[0]);
+
+    string hashStr = path[1];
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    std::vector<CDiskBlockPos> positions;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        const CBlockIndex *pindex = (it != mapBlockIndex.end()) ? it->second : NULL;
+        if (pindex == NULL || !chainActive.Contains(pindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        while (pindex != NULL && (long)positions.size() < count) {
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            positions.push_back(pindex->GetBlockPos());
+            pindex = chainActive.Next(pindex);
+        }
+    }
+
+    if (!WriteRawBlocks(req, rf, positions))
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Error reading blocks");
+    return true;
+}
+
+static bool ParseAddressStr(const string& strAddress, uint160& hashBytes, int& type)
+{
+    CBitcoinAddress address(strAddress);
+    return address.GetIndexKey(hashBytes, type);
+}
+
+static bool rest_addressdeltas(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 1 && path.size() != 3)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/addressdeltas/<address>.<ext> or /rest/addressdeltas/<address>/<start>/<end>.<ext>.");
+
+    uint160 hashBytes;
+    int type = 0;
+    if (!ParseAddressStr(path[0], hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + path[0]);
+
+    int32_t start = 0, end = 0;
+    if (path.size() == 3 && (!ParseInt32(path[1], &start) || !ParseInt32(path[2], &end) || start <= 0 || end < start))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height range: " + path[1] + "/" + path[2]);
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    if (!GetAddressIndex(hashBytes, type, addressIndex, start, end))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address " + path[0]);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << addressIndex;
+    return WriteSerializedReply(req, rf, ss);
+}
+
+static bool rest_addressutxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    uint160 hashBytes;
+    int type = 0;
+    if (!ParseAddressStr(params[0], hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + params[0]);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    if (!GetAddressUnspentPage(hashBytes, type, NULL, 0, unspentOutputs))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address " + params[0]);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << unspentOutputs;
+    return WriteSerializedReply(req, rf, ss);
+}
+
+static bool rest_spentindex(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    uint256 txid;
+    int32_t nOutput;
+    if (path.size() != 2 || !ParseHashStr(path[0], txid) || !ParseInt32(path[1], &nOutput) || nOutput < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/spentindex/<txid>/<n>.<ext>.");
+
+    CSpentIndexKey key(txid, nOutput);
+    CSpentIndexValue value;
+    if (!GetSpentIndex(key, value))
+        return RESTERR(req, HTTP_NOT_FOUND, "Unable to get spent info");
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << value;
+    return WriteSerializedReply(req, rf, ss);
+}
+
+static bool rest_notarisations(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    int32_t nHeight;
+    if ((path.size() != 1 && path.size() != 2) || !ParseInt32(path[0], &nHeight) || nHeight < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/notarisations/<height>.<ext> or /rest/notarisations/<height>/<symbol>.<ext>.");
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    if (path.size() == 1) {
+        // The notarisations in the block at that height
+        uint256 blockHash;
+        {
+            LOCK(cs_main);
+            if (nHeight > chainActive.Height())
+                return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range: " + path[0]);
+            blockHash = chainActive[nHeight]->GetBlockHash();
+        }
+        NotarisationsInBlock notarisations;
+        GetBlockNotarisations(blockHash, notarisations);
+        ss << notarisations;
+    } else {
+        // The latest notarisation of a symbol at or below that height
+        Notarisation notarisation;
+        int nFoundHeight;
+        {
+            LOCK(cs_main);
+            nFoundHeight = ScanNotarisationsDB(nHeight, path[1], NOTARISATION_SCAN_BLOCKS, notarisation);
+        }
+        if (nFoundHeight <= 0)
+            return RESTERR(req, HTTP_NOT_FOUND, "No notarisation of " + path[1] + " found");
+        ss << nFoundHeight << notarisation;
+    }
+    return WriteSerializedReply(req, rf, ss);
+}
+
 static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -608,21 +846,33 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
+    HTTPWorkClass workClass;
 } uri_prefixes[] = {
-      {"/rest/tx/", rest_tx},
-      {"/rest/block/notxdetails/", rest_block_notxdetails},
-      {"/rest/block/", rest_block_extended},
-      {"/rest/chaininfo", rest_chaininfo},
-      {"/rest/mempool/info", rest_mempool_info},
-      {"/rest/mempool/contents", rest_mempool_contents},
-      {"/rest/headers/", rest_headers},
-      {"/rest/getutxos", rest_getutxos},
+      {"/rest/tx/", rest_tx, HTTP_WORK_CHEAP},
+      {"/rest/block/notxdetails/", rest_block_notxdetails, HTTP_WORK_CHEAP},
+      {"/rest/block/", rest_block_extended, HTTP_WORK_CHEAP},
+      {"/rest/chaininfo", rest_chaininfo, HTTP_WORK_CHEAP},
+      {"/rest/mempool/info", rest_mempool_info, HTTP_WORK_CHEAP},
+      {"/rest/mempool/contents", rest_mempool_contents, HTTP_WORK_CHEAP},
+      {"/rest/headers/", rest_headers, HTTP_WORK_CHEAP},
+      {"/rest/getutxos", rest_getutxos, HTTP_WORK_CHEAP},
+      {"/rest/blocks/", rest_blocks, HTTP_WORK_EXPENSIVE},
+      {"/rest/addressdeltas/", rest_addressdeltas, HTTP_WORK_EXPENSIVE},
+      {"/rest/addressutxos/", rest_addressutxos, HTTP_WORK_EXPENSIVE},
+      {"/rest/spentindex/", rest_spentindex, HTTP_WORK_CHEAP},
+      {"/rest/notarisations/", rest_notarisations, HTTP_WORK_EXPENSIVE},
 };
 
+static HTTPWorkClass rest_work_class(HTTPWorkClass workClass, HTTPRequest* req, const std::string& strReq)
+{
+    return workClass;
+}
+
 bool StartREST()
 {
     for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
-        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler);
+        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler,
+                            boost::bind(rest_work_class, uri_prefixes[i].workClass, _1, _2));
     return true;
 }
 
@@ -21,6 +21,7 @@
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "crosschain.h"
 #include "base58.h"
@@ -28,6 +29,7 @@
 #include "cc/eval.h"
 #include "main.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -46,6 +48,7 @@
 using namespace std;
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
+extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, CJSONWriter& entry);
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 int32_t komodo_longestchain();
 int32_t komodo_dpowconfs(int32_t height,int32_t numconfs);
@@ -278,54 +281,63 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+void blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, CJSONWriter& result)
 {
-    UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hash", block.GetHash().GetHex()));
+    result.PushKV("hash", block.GetHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
     if (chainActive.Contains(blockindex))
         confirmations = chainActive.Height() - blockindex->GetHeight() + 1;
-    result.push_back(Pair("confirmations", komodo_dpowconfs(blockindex->GetHeight(),confirmations)));
-    result.push_back(Pair("rawconfirmations", confirmations));
-    result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
-    result.push_back(Pair("height", blockindex->GetHeight()));
-    result.push_back(Pair("version", block.nVersion));
-    result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    result.push_back(Pair("segid", (int64_t)blockindex->segid));
-    result.push_back(Pair("finalsaplingroot", block.hashFinalSaplingRoot.GetHex()));
-    UniValue txs(UniValue::VARR);
+    result.PushKVInt("confirmations", komodo_dpowconfs(blockindex->GetHeight(),confirmations));
+    result.PushKVInt("rawconfirmations", confirmations);
+    result.PushKVInt("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    result.PushKVInt("height", blockindex->GetHeight());
+    result.PushKVInt("version", block.nVersion);
+    result.PushKV("merkleroot", block.hashMerkleRoot.GetHex());
+    result.PushKVInt("segid", (int64_t)blockindex->segid);
+    result.PushKV("finalsaplingroot", block.hashFinalSaplingRoot.GetHex());
+    result.Key("tx");
+    result.BeginArray();
     BOOST_FOREACH(const CTransaction&tx, block.vtx)
     {
         if(txDetails)
         {
-            UniValue objTx(UniValue::VOBJ);
-            TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
+            result.BeginObject();
+            TxToJSON(tx, uint256(), result);
+            result.EndObject();
         }
         else
-            txs.push_back(tx.GetHash().GetHex());
+            result.String(tx.GetHash().GetHex());
     }
-    result.push_back(Pair("tx", txs));
-    result.push_back(Pair("time", block.GetBlockTime()));
-    result.push_back(Pair("nonce", block.nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(block.nSolution)));
-    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
-    result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("chainwork", blockindex->chainPower.chainWork.GetHex()));
-    result.push_back(Pair("anchor", blockindex->hashFinalSproutRoot.GetHex()));
-    result.push_back(Pair("blocktype", block.IsVerusPOSBlock() ? "minted" : "mined"));
-
-    UniValue valuePools(UniValue::VARR);
-    valuePools.push_back(ValuePoolDesc("sprout", blockindex->nChainSproutValue, blockindex->nSproutValue));
-    valuePools.push_back(ValuePoolDesc("sapling", blockindex->nChainSaplingValue, blockindex->nSaplingValue));
-    result.push_back(Pair("valuePools", valuePools));
+    result.EndArray();
+    result.PushKVInt("time", block.GetBlockTime());
+    result.PushKV("nonce", block.nNonce.GetHex());
+    result.PushKV("solution", HexStr(block.nSolution));
+    result.PushKV("bits", strprintf("%08x", block.nBits));
+    result.Key("difficulty");
+    result.Double(GetDifficulty(blockindex));
+    result.PushKV("chainwork", blockindex->chainPower.chainWork.GetHex());
+    result.PushKV("anchor", blockindex->hashFinalSproutRoot.GetHex());
+    result.PushKV("blocktype", block.IsVerusPOSBlock() ? "minted" : "mined");
+
+    result.Key("valuePools");
+    result.BeginArray();
+    result.Value(ValuePoolDesc("sprout", blockindex->nChainSproutValue, blockindex->nSproutValue));
+    result.Value(ValuePoolDesc("sapling", blockindex->nChainSaplingValue, blockindex->nSaplingValue));
+    result.EndArray();
 
     if (blockindex->pprev)
-        result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
+        result.PushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
-        result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
+        result.PushKV("nextblockhash", pnext->GetBlockHash().GetHex());
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    UniValue result(UniValue::VOBJ);
+    CJSONValueWriter writer(result);
+    blockToJSON(block, blockindex, txDetails, writer);
     return result;
 }
 
@@ -342,8 +354,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainSnapshot()->nHeight;
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp)
@@ -359,8 +370,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.LastTip()->GetBlockHash().GetHex();
+    return GetChainSnapshot()->hashTip.GetHex();
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp)
@@ -376,8 +386,7 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getdifficulty", "")
         );
 
-    LOCK(cs_main);
-    return GetNetworkDifficulty();
+    return GetNetworkDifficulty(GetChainSnapshot()->pindexTip);
 }
 
 bool myIsutxo_spentinmempool(uint256 txid,int32_t vout)
@@ -611,13 +620,13 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
+    CChainSnapshotRef snapshot = GetChainSnapshot();
 
     int nHeight = params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > snapshot->nHeight)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    const CBlockIndex* pblockindex = (*snapshot)[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -740,6 +749,62 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     return blockheaderToJSON(pblockindex);
 }
 
+/** The block getblock asks for and the verbosity; cs_main must be held */
+static CBlockIndex* ReadBlockForRPC(const UniValue& params, CBlock& block, int& verbosity)
+{
+    std::string strHash = params[0].get_str();
+
+    // If height is supplied, find the hash
+    if (strHash.size() < (2 * sizeof(uint256))) {
+        // std::stoi allows characters, whereas we want to be strict
+        regex r("[[:digit:]]+");
+        if (!regex_match(strHash, r)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        int nHeight = -1;
+        try {
+            nHeight = std::stoi(strHash);
+        }
+        catch (const std::exception &e) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        if (nHeight < 0 || nHeight > chainActive.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+    }
+
+    uint256 hash(uint256S(strHash));
+
+    verbosity = 1;
+    if (params.size() > 1) {
+        if(params[1].isNum()) {
+            verbosity = params[1].get_int();
+        } else {
+            verbosity = params[1].get_bool() ? 1 : 0;
+        }
+    }
+
+    if (verbosity < 0 || verbosity > 2) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
+    }
+
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    CBlockIndex* pblockindex = mapBlockIndex[hash];
+
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+
+    if(!ReadBlockFromDisk(block, pblockindex,1))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
+    return pblockindex;
+}
+
 UniValue getblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -791,66 +856,44 @@ UniValue getblock(const UniValue& params, bool fHelp)
 
     LOCK(cs_main);
 
-    std::string strHash = params[0].get_str();
-
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        // std::stoi allows characters, whereas we want to be strict
-        regex r("[[:digit:]]+");
-        if (!regex_match(strHash, r)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        int nHeight = -1;
-        try {
-            nHeight = std::stoi(strHash);
-        }
-        catch (const std::exception &e) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
+    CBlock block;
+    int verbosity;
+    CBlockIndex* pblockindex = ReadBlockForRPC(params, block, verbosity);
 
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
-        }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+    if (verbosity == 0)
+    {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        ssBlock << block;
+        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+        return strHex;
     }
 
-    uint256 hash(uint256S(strHash));
-
-    int verbosity = 1;
-    if (params.size() > 1) {
-        if(params[1].isNum()) {
-            verbosity = params[1].get_int();
-        } else {
-            verbosity = params[1].get_bool() ? 1 : 0;
-        }
-    }
+    return blockToJSON(block, pblockindex, verbosity >= 2);
+}
 
-    if (verbosity < 0 || verbosity > 2) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
-    }
+/** getblock writing its result directly, so a verbose block is never built as a UniValue */
+void getblock_write(const UniValue& params, CJSONWriter& result)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getblock(params, true); // throws the usage
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    LOCK(cs_main);
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
-
-    if(!ReadBlockFromDisk(block, pblockindex,1))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    int verbosity;
+    CBlockIndex* pblockindex = ReadBlockForRPC(params, block, verbosity);
 
     if (verbosity == 0)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        result.String(HexStr(ssBlock.begin(), ssBlock.end()));
+        return;
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    result.BeginObject();
+    blockToJSON(block, pblockindex, verbosity >= 2, result);
+    result.EndObject();
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -1025,19 +1068,19 @@ UniValue notaries(const UniValue& params, bool fHelp)
     UniValue a(UniValue::VARR); uint32_t timestamp=0; UniValue ret(UniValue::VOBJ); int32_t i,j,n,m; char *hexstr;  uint8_t pubkeys[64][33]; char btcaddr[64],kmdaddr[64],*ptr;
     if ( fHelp || (params.size() != 1 && params.size() != 2) )
         throw runtime_error("notaries height timestamp\n");
-    LOCK(cs_main);
+    CChainSnapshotRef snapshot = GetChainSnapshot();
     int32_t height = atoi(params[0].get_str().c_str());
     if ( params.size() == 2 )
         timestamp = (uint32_t)atol(params[1].get_str().c_str());
     else timestamp = (uint32_t)time(NULL);
     if ( height < 0 )
     {
-        height = chainActive.LastTip()->GetHeight();
-        timestamp = chainActive.LastTip()->GetBlockTime();
+        height = snapshot->nHeight;
+        timestamp = snapshot->nTipTime;
     }
     else if ( params.size() < 2 )
     {
-        CBlockIndex *pblockindex = chainActive[height];
+        const CBlockIndex *pblockindex = (*snapshot)[height];
         if ( pblockindex != 0 )
             timestamp = pblockindex->GetBlockTime();
     }
@@ -1714,7 +1757,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
+    { "blockchain",         "getblock",               &getblock,               true,  &getblock_write },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
@@ -159,6 +159,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "minerids", 1 },
     { "kvsearch", 1 },
     { "kvupdate", 4 },
+    { "tokenlist", 0 },
+    { "tokenlist", 1 },
+    { "tokentransfermany", 1 },
     { "z_importkey", 2 },
     { "z_importviewingkey", 2 },
     { "z_getpaymentdisclosure", 1},
@@ -0,0 +1,257 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "rpc/jsonwriter.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+void CJSONWriter::Amount(const CAmount& amount)
+{
+    bool sign = amount < 0;
+    int64_t n_abs = (sign ? -amount : amount);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%" PRId64 ".%08" PRId64, sign ? "-" : "", n_abs / COIN, n_abs % COIN);
+    Number(buf);
+}
+
+void CJSONWriter::Double(double d)
+{
+    Number(UniValue(d).getValStr());
+}
+
+void CJSONTextWriter::Separate()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vHasElements.empty()) {
+        if (vHasElements.back())
+            strOut += ',';
+        vHasElements.back() = true;
+    }
+}
+
+void CJSONTextWriter::Escape(const std::string& str)
+{
+    // The same escapes as univalue's json_escape
+    for (size_t i = 0; i < str.size(); i++) {
+        unsigned char ch = str[i];
+        switch (ch) {
+        case '"': strOut += "\\\""; break;
+        case '\\': strOut += "\\\\"; break;
+        case '\b': strOut += "\\b"; break;
+        case '\f': strOut += "\\f"; break;
+        case '\n': strOut += "\\n"; break;
+        case '\r': strOut += "\\r"; break;
+        case '\t': strOut += "\\t"; break;
+        default:
+            if (ch < 0x20 || ch == 0x7f) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                strOut += buf;
+            } else {
+                strOut += ch;
+            }
+        }
+    }
+}
+
+void CJSONTextWriter::Written()
+{
+    if (flush && strOut.size() >= nFlushSize)
+        Flush();
+}
+
+void CJSONTextWriter::Flush()
+{
+    if (flush && !strOut.empty()) {
+        flush(strOut);
+        strOut.clear();
+    }
+}
+
+void CJSONTextWriter::BeginObject()
+{
+    Separate();
+    strOut += '{';
+    vHasElements.push_back(false);
+}
+
+void CJSONTextWriter::EndObject()
+{
+    vHasElements.pop_back();
+    strOut += '}';
+    Written();
+}
+
+void CJSONTextWriter::BeginArray()
+{
+    Separate();
+    strOut += '[';
+    vHasElements.push_back(false);
+}
+
+void CJSONTextWriter::EndArray()
+{
+    vHasElements.pop_back();
+    strOut += ']';
+    Written();
+}
+
+void CJSONTextWriter::Key(const std::string& key)
+{
+    Separate();
+    strOut += '"';
+    Escape(key);
+    strOut += "\":";
+    fAfterKey = true;
+}
+
+void CJSONTextWriter::String(const std::string& str)
+{
+    Separate();
+    strOut += '"';
+    Escape(str);
+    strOut += '"';
+    Written();
+}
+
+void CJSONTextWriter::Int(int64_t n)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%" PRId64, n);
+    Number(buf);
+}
+
+void CJSONTextWriter::Number(const std::string& str)
+{
+    Separate();
+    strOut += str;
+    Written();
+}
+
+void CJSONTextWriter::Bool(bool f)
+{
+    Separate();
+    strOut += f ? "true" : "false";
+}
+
+void CJSONTextWriter::Null()
+{
+    Separate();
+    strOut += "null";
+}
+
+void CJSONTextWriter::Value(const UniValue& val)
+{
+    if (val.isArray() && val.size() >= MIN_WALKED_SIZE) {
+        BeginArray();
+        for (size_t i = 0; i < val.size(); i++)
+            Value(val[i]);
+        EndArray();
+    } else if (val.isObject() && val.size() >= MIN_WALKED_SIZE) {
+        const std::vector<std::string>& keys = val.getKeys();
+        BeginObject();
+        for (size_t i = 0; i < keys.size(); i++) {
+            Key(keys[i]);
+            Value(val[i]);
+        }
+        EndObject();
+    } else {
+        Separate();
+        strOut += val.write();
+        Written();
+    }
+}
+
+static void AddTo(UniValue& container, const std::string& key, const UniValue& val)
+{
+    if (container.isObject())
+        container.pushKV(key, val);
+    else if (container.isArray())
+        container.push_back(val);
+    else
+        container = val;
+}
+
+void CJSONValueWriter::Add(const UniValue& val)
+{
+    AddTo(vOpen.empty() ? root : vOpen.back().second, strKey, val);
+}
+
+void CJSONValueWriter::End()
+{
+    // Added to the parent before being popped, so the container is copied once
+    strKey = vOpen.back().first;
+    AddTo(vOpen.size() > 1 ? vOpen[vOpen.size() - 2].second : root, strKey, vOpen.back().second);
+    vOpen.pop_back();
+}
+
+void CJSONValueWriter::BeginObject()
+{
+    vOpen.push_back(std::make_pair(strKey, UniValue(UniValue::VOBJ)));
+}
+
+void CJSONValueWriter::EndObject()
+{
+    End();
+}
+
+void CJSONValueWriter::BeginArray()
+{
+    vOpen.push_back(std::make_pair(strKey, UniValue(UniValue::VARR)));
+}
+
+void CJSONValueWriter::EndArray()
+{
+    End();
+}
+
+void CJSONValueWriter::Key(const std::string& key)
+{
+    strKey = key;
+}
+
+void CJSONValueWriter::String(const std::string& str)
+{
+    Add(UniValue(str));
+}
+
+void CJSONValueWriter::Int(int64_t n)
+{
+    Add(UniValue(n));
+}
+
+void CJSONValueWriter::Number(const std::string& str)
+{
+    Add(UniValue(UniValue::VNUM, str));
+}
+
+void CJSONValueWriter::Bool(bool f)
+{
+    Add(UniValue(f));
+}
+
+void CJSONValueWriter::Null()
+{
+    Add(NullUniValue);
+}
+
+void CJSONValueWriter::Value(const UniValue& val)
+{
+    Add(val);
+}
@@ -0,0 +1,147 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef BITCOIN_RPCJSONWRITER_H
+#define BITCOIN_RPCJSONWRITER_H
+
+#include "amount.h"
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <univalue.h>
+
+/**
+ * Receives a JSON value one token at a time. RPC results that get large, like
+ * verbose blocks and transactions, are produced through this interface so they
+ * can be written out as text directly instead of being built up as a UniValue.
+ */
+class CJSONWriter
+{
+public:
+    virtual ~CJSONWriter() {}
+
+    virtual void BeginObject() = 0;
+    virtual void EndObject() = 0;
+    virtual void BeginArray() = 0;
+    virtual void EndArray() = 0;
+    /** Name of the next value, inside an object */
+    virtual void Key(const std::string& key) = 0;
+    virtual void String(const std::string& str) = 0;
+    virtual void Int(int64_t n) = 0;
+    virtual void Bool(bool f) = 0;
+    virtual void Null() = 0;
+    virtual void Value(const UniValue& val) = 0;
+
+    /** Formatted like ValueFromAmount */
+    void Amount(const CAmount& amount);
+    /** Formatted like UniValue(double) */
+    void Double(double d);
+
+    void PushKV(const std::string& key, const std::string& str) { Key(key); String(str); }
+    void PushKV(const std::string& key, const char* str) { Key(key); String(str); }
+    void PushKV(const std::string& key, const UniValue& val) { Key(key); Value(val); }
+    void PushKVInt(const std::string& key, int64_t n) { Key(key); Int(n); }
+    void PushKVBool(const std::string& key, bool f) { Key(key); Bool(f); }
+    void PushKVAmount(const std::string& key, const CAmount& amount) { Key(key); Amount(amount); }
+
+protected:
+    /** A number already in its JSON text form */
+    virtual void Number(const std::string& str) = 0;
+};
+
+/**
+ * Writes compact JSON text, byte for byte what UniValue::write() gives for the
+ * same value. With a flush function the text is handed over in pieces of about
+ * nFlushSize bytes instead of being kept whole.
+ */
+class CJSONTextWriter : public CJSONWriter
+{
+public:
+    typedef boost::function<void (const std::string&)> FlushFn;
+
+    CJSONTextWriter() : nFlushSize(0), fAfterKey(false) {}
+    CJSONTextWriter(const FlushFn& flushIn, size_t nFlushSizeIn) : flush(flushIn), nFlushSize(nFlushSizeIn), fAfterKey(false) {}
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const std::string& key);
+    void String(const std::string& str);
+    void Int(int64_t n);
+    void Bool(bool f);
+    void Null();
+    void Value(const UniValue& val);
+
+    /** Text not handed to the flush function yet */
+    const std::string& str() const { return strOut; }
+    void Flush();
+
+protected:
+    void Number(const std::string& str);
+
+private:
+    //! Containers with fewer elements are written with UniValue::write()
+    static const size_t MIN_WALKED_SIZE = 64;
+
+    FlushFn flush;
+    size_t nFlushSize;
+    std::string strOut;
+    //! Whether each open container has had an element yet
+    std::vector<bool> vHasElements;
+    bool fAfterKey;
+
+    void Separate();
+    void Escape(const std::string& str);
+    void Written();
+};
+
+/** Builds the UniValue the tokens describe, for callers that need one */
+class CJSONValueWriter : public CJSONWriter
+{
+public:
+    /** Tokens outside any container go into root: set it, or add to it if it is an object or array */
+    explicit CJSONValueWriter(UniValue& rootIn) : root(rootIn) {}
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const std::string& key);
+    void String(const std::string& str);
+    void Int(int64_t n);
+    void Bool(bool f);
+    void Null();
+    void Value(const UniValue& val);
+
+protected:
+    void Number(const std::string& str);
+
+private:
+    UniValue& root;
+    //! Open containers and the keys they go under once closed
+    std::vector<std::pair<std::string, UniValue> > vOpen;
+    std::string strKey;
+
+    void Add(const UniValue& val);
+    void End();
+};
+
+#endif // BITCOIN_RPCJSONWRITER_H
@@ -18,6 +18,7 @@
  *                                                                            *
  ******************************************************************************/
 
+#include "chainsnapshot.h"
 #include "clientversion.h"
 #include "init.h"
 #include "key_io.h"
@@ -26,6 +27,8 @@
 #include "netbase.h"
 #include "rpc/server.h"
 #include "timedata.h"
+#include "txcache.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "util.h"
 #include "cc/eval.h"
@@ -108,21 +111,34 @@ UniValue getinfo(const UniValue& params, bool fHelp)
             "  \"unlocked_until\": ttt,      (numeric) the timestamp in seconds since epoch (midnight Jan 1 1970 GMT) that the wallet is unlocked for transfers, or 0 if the wallet is locked\n"
             "  \"paytxfee\": x.xxxx,         (numeric) the transaction fee set in " + CURRENCY_UNIT + "/kB\n"
             "  \"relayfee\": x.xxxx,         (numeric) minimum relay fee for non-free transactions in " + CURRENCY_UNIT + "/kB\n"
+            "  \"txcache\": {                (object) the confirmed transaction cache used by getrawtransaction and the CC contracts\n"
+            "    \"hits\": xxxxx,            (numeric) lookups answered from the cache\n"
+            "    \"misses\": xxxxx,          (numeric) lookups that had to go to disk\n"
+            "    \"entries\": xxxxx,         (numeric) transactions currently cached\n"
+            "    \"usage\": xxxxx            (numeric) approximate memory used in bytes\n"
+            "  },\n"
+            "  \"coinsflush\": {             (object) the background writer of the chainstate database\n"
+            "    \"flushes\": xxxxx,         (numeric) batches committed since startup\n"
+            "    \"lastflushms\": xxxxx,     (numeric) duration of the last database write in milliseconds\n"
+            "    \"waitms\": xxxxx,          (numeric) total time flushes waited for the previous write in milliseconds\n"
+            "    \"queued\": n,              (numeric) batches waiting to be committed\n"
+            "    \"pendingcoins\": xxxxx     (numeric) coin entries in the batch being written\n"
+            "  },\n"
             "  \"errors\": \"...\"           (string) any error messages\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getinfo", "")
             + HelpExampleRpc("getinfo", "")
         );
-//#ifdef ENABLE_WALLET
-//    LOCK2(cs_main, pwalletMain ? &pwalletMain->cs_wallet : NULL);
-//#else
-    LOCK(cs_main);
-//#endif
+    // Chain fields come from the published snapshot so getinfo does not wait for block validation
+    CChainSnapshotRef snapshot = GetChainSnapshot();
 
     proxyType proxy;
     GetProxy(NET_IPV4, proxy);
-    notarized_height = komodo_notarized_height(&prevMoMheight,&notarized_hash,&notarized_desttxid);
+    notarized_height = snapshot->nNotarizedHeight;
+    prevMoMheight = snapshot->nPrevMoMHeight;
+    notarized_hash = snapshot->notarizedHash;
+    notarized_desttxid = snapshot->notarizedDesttxid;
     //fprintf(stderr,"after notarized_height %u\n",(uint32_t)time(NULL));
 
     UniValue obj(UniValue::VOBJ);
@@ -157,21 +173,22 @@ UniValue getinfo(const UniValue& params, bool fHelp)
     }
 #endif
     //fprintf(stderr,"after wallet %u\n",(uint32_t)time(NULL));
-    obj.push_back(Pair("blocks",        (int)chainActive.Height()));
-    if ( (longestchain= KOMODO_LONGESTCHAIN) != 0 && chainActive.Height() > longestchain )
-        longestchain = chainActive.Height();
+    obj.push_back(Pair("blocks",        snapshot->nHeight));
+    if ( (longestchain= KOMODO_LONGESTCHAIN) != 0 && snapshot->nHeight > longestchain )
+        longestchain = snapshot->nHeight;
     //fprintf(stderr,"after longestchain %u\n",(uint32_t)time(NULL));
     obj.push_back(Pair("longestchain",        longestchain));
     obj.push_back(Pair("timeoffset",    GetTimeOffset()));
-    if ( chainActive.LastTip() != 0 )
-        obj.push_back(Pair("tiptime", (int)chainActive.LastTip()->nTime));
+    if ( snapshot->pindexTip != 0 )
+        obj.push_back(Pair("tiptime", (int)snapshot->nTipTime));
     obj.push_back(Pair("connections",   (int)vNodes.size()));
     obj.push_back(Pair("proxy",         (proxy.IsValid() ? proxy.proxy.ToStringIPPort() : string())));
-    obj.push_back(Pair("difficulty",    (double)GetDifficulty()));
+    obj.push_back(Pair("difficulty",    (double)GetDifficulty(snapshot->pindexTip)));
     obj.push_back(Pair("testnet",       Params().TestnetToBeDeprecatedFieldRPC()));
 #ifdef ENABLE_WALLET
     if (pwalletMain) {
         obj.push_back(Pair("keypoololdest", pwalletMain->GetOldestKeyPoolTime()));
+        LOCK(pwalletMain->cs_wallet);
         obj.push_back(Pair("keypoolsize",   (int)pwalletMain->GetKeyPoolSize()));
     }
     if (pwalletMain && pwalletMain->IsCrypted())
@@ -179,10 +196,28 @@ UniValue getinfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("paytxfee",      ValueFromAmount(payTxFee.GetFeePerK())));
 #endif
     obj.push_back(Pair("relayfee",      ValueFromAmount(::minRelayTxFee.GetFeePerK())));
+    {
+        UniValue txcacheObj(UniValue::VOBJ);
+        txcacheObj.push_back(Pair("hits",       txcache.Hits()));
+        txcacheObj.push_back(Pair("misses",     txcache.Misses()));
+        txcacheObj.push_back(Pair("entries",    (uint64_t)txcache.Size()));
+        txcacheObj.push_back(Pair("usage",      (uint64_t)txcache.DynamicMemoryUsage()));
+        obj.push_back(Pair("txcache",       txcacheObj));
+    }
+    if (pcoinsflushbuffer != NULL) {
+        CCoinsFlushStats flushStats = pcoinsflushbuffer->GetFlushStats();
+        UniValue flushObj(UniValue::VOBJ);
+        flushObj.push_back(Pair("flushes",      flushStats.nFlushes));
+        flushObj.push_back(Pair("lastflushms",  flushStats.nLastFlushMicros / 1000));
+        flushObj.push_back(Pair("waitms",       flushStats.nWaitMicros / 1000));
+        flushObj.push_back(Pair("queued",       (int)flushStats.nQueued));
+        flushObj.push_back(Pair("pendingcoins", (uint64_t)flushStats.nPendingCoins));
+        obj.push_back(Pair("coinsflush",    flushObj));
+    }
     obj.push_back(Pair("errors",        GetWarnings("statusbar")));
     {
         char pubkeystr[65]; int32_t notaryid;
-        if ( (notaryid= komodo_whoami(pubkeystr,(int32_t)chainActive.LastTip()->GetHeight(),komodo_chainactive_timestamp())) >= 0 )
+        if ( (notaryid= komodo_whoami(pubkeystr,snapshot->nHeight,(uint32_t)snapshot->nTipTime)) >= 0 )
         {
             obj.push_back(Pair("notaryid",        notaryid));
             obj.push_back(Pair("pubkey",        pubkeystr));
@@ -793,6 +828,117 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+/**
+ * Paging options of the address index calls: {"limit": n, "cursor": "..."}.
+ * Returns false when the caller asked for the whole result at once.
+ */
+static bool getAddressPageFromParams(const UniValue& params, size_t &limit, std::string &cursor)
+{
+    if (!params[0].isObject())
+        return false;
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull() && cursorValue.isNull())
+        return false;
+    if (!limitValue.isNum() || limitValue.get_int() <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+    limit = limitValue.get_int();
+    if (cursorValue.isStr())
+        cursor = cursorValue.get_str();
+    else if (!cursorValue.isNull())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor is expected to be a string");
+    return true;
+}
+
+/** A cursor is the position in the address list and the last index key returned, hex encoded */
+template <typename Key>
+static std::string encodeAddressCursor(size_t pos, const Key &key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (uint32_t)pos << key;
+    return HexStr(ss.begin(), ss.end());
+}
+
+template <typename Key>
+static size_t decodeAddressCursor(const std::string &cursor, const std::vector<std::pair<uint160, int> > &addresses, Key &key)
+{
+    uint32_t pos = 0;
+    try {
+        if (!IsHex(cursor))
+            throw std::runtime_error("not hex");
+        CDataStream ss(ParseHex(cursor), SER_DISK, CLIENT_VERSION);
+        ss >> pos >> key;
+    } catch (const std::exception&) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    if (pos >= addresses.size() || key.type != (unsigned int)addresses[pos].second || key.hashBytes != addresses[pos].first)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not match the addresses");
+    return pos;
+}
+
+/**
+ * Read up to limit address index entries of the addresses, in address then height order,
+ * resuming after cursor. As in the unpaged calls, the start and end heights only apply when
+ * both are given. Returns the cursor of the next page, or an empty string after the last one.
+ */
+static std::string getAddressIndexPage(const std::vector<std::pair<uint160, int> > &addresses, const std::string &cursor,
+                                       size_t limit, int start, int end, std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex)
+{
+    if (start <= 0 || end <= 0)
+        start = end = 0;
+
+    CAddressIndexKey after;
+    bool resume = !cursor.empty();
+    size_t pos = resume ? decodeAddressCursor(cursor, addresses, after) : 0;
+
+    for (; pos < addresses.size(); pos++) {
+        const uint160 &hash = addresses[pos].first;
+        int type = addresses[pos].second;
+        if (!resume && start > 0)
+            after = CAddressIndexKey(type, hash, start, 0, uint256(), 0, false);
+        // One entry more than needed tells whether another page follows
+        if (!GetAddressIndexPage(hash, type, (resume || start > 0) ? &after : NULL, limit - addressIndex.size() + 1, addressIndex, end)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        resume = false;
+        if (addressIndex.size() > limit || (addressIndex.size() == limit && pos + 1 < addresses.size())) {
+            if (addressIndex.size() > limit)
+                addressIndex.pop_back();
+            return encodeAddressCursor(pos, addressIndex.back().first);
+        }
+    }
+    return "";
+}
+
+/** Same as getAddressIndexPage for unspent outputs, which come in height order */
+static std::string getAddressUnspentPage(const std::vector<std::pair<uint160, int> > &addresses, const std::string &cursor,
+                                         size_t limit, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    CAddressUnspentHeightKey after;
+    bool resume = !cursor.empty();
+    size_t pos = resume ? decodeAddressCursor(cursor, addresses, after) : 0;
+
+    for (; pos < addresses.size(); pos++) {
+        if (!GetAddressUnspentPage(addresses[pos].first, addresses[pos].second, resume ? &after : NULL,
+                                   limit - unspentOutputs.size() + 1, unspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        resume = false;
+        if (unspentOutputs.size() > limit || (unspentOutputs.size() == limit && pos + 1 < addresses.size())) {
+            if (unspentOutputs.size() > limit)
+                unspentOutputs.pop_back();
+            const std::pair<CAddressUnspentKey, CAddressUnspentValue> &last = unspentOutputs.back();
+            return encodeAddressCursor(pos, CAddressUnspentHeightKey(last.first, last.second.blockHeight));
+        }
+    }
+    return "";
+}
+
+static UniValue addressCursorValue(const std::string &cursor)
+{
+    return cursor.empty() ? NullUniValue : UniValue(cursor);
+}
+
 UniValue getaddressmempool(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -878,8 +1024,10 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "      ,...\n"
             "    ],\n"
             "  \"chainInfo\"  (boolean) Include chain info with results\n"
+            "  \"limit\"  (number, optional) Return at most this many outputs, with a cursor for the next ones\n"
+            "  \"cursor\"  (string, optional) The cursor returned by the previous call\n"
             "}\n"
-            "\nResult\n"
+            "\nResult (with limit, an object with \"utxos\" and \"cursor\", null after the last page)\n"
             "[\n"
             "  {\n"
             "    \"address\"  (string) The address base58check encoded\n"
@@ -909,15 +1057,25 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t limit = 0;
+    std::string cursor, nextCursor;
+    bool paged = getAddressPageFromParams(params, limit, cursor);
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    if (paged) {
+        nextCursor = getAddressUnspentPage(addresses, cursor, limit, unspentOutputs);
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressUnspentPage((*it).first, (*it).second, NULL, 0, unspentOutputs)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
         }
-    }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+        // Each address comes back in height order already
+        if (addresses.size() > 1)
+            std::stable_sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue utxos(UniValue::VARR);
 
@@ -937,13 +1095,17 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         utxos.push_back(output);
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || paged) {
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("utxos", utxos));
+        if (paged)
+            result.push_back(Pair("cursor", addressCursorValue(nextCursor)));
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.LastTip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
+        if (includeChainInfo) {
+            CChainSnapshotRef snapshot = GetChainSnapshot();
+            result.push_back(Pair("hash", snapshot->hashTip.GetHex()));
+            result.push_back(Pair("height", snapshot->nHeight));
+        }
         return result;
     } else {
         return utxos;
@@ -966,8 +1128,10 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
+            "  \"limit\" (number, optional) Return at most this many deltas, with a cursor for the next ones\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous call\n"
             "}\n"
-            "\nResult:\n"
+            "\nResult (with limit, an object with \"deltas\" and \"cursor\", null after the last page):\n"
             "[\n"
             "  {\n"
             "    \"satoshis\"  (number) The difference of satoshis\n"
@@ -1012,16 +1176,24 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t limit = 0;
+    std::string cursor, nextCursor;
+    bool paged = getAddressPageFromParams(params, limit, cursor);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    if (paged) {
+        nextCursor = getAddressIndexPage(addresses, cursor, limit, start, end, addressIndex);
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -1047,14 +1219,14 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
     UniValue result(UniValue::VOBJ);
 
     if (includeChainInfo && start > 0 && end > 0) {
-        LOCK(cs_main);
+        CChainSnapshotRef snapshot = GetChainSnapshot();
 
-        if (start > chainActive.Height() || end > chainActive.Height()) {
+        if (start > snapshot->nHeight || end > snapshot->nHeight) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
         }
 
-        CBlockIndex* startIndex = chainActive[start];
-        CBlockIndex* endIndex = chainActive[end];
+        const CBlockIndex* startIndex = (*snapshot)[start];
+        const CBlockIndex* endIndex = (*snapshot)[end];
 
         UniValue startInfo(UniValue::VOBJ);
         UniValue endInfo(UniValue::VOBJ);
@@ -1066,9 +1238,15 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         endInfo.push_back(Pair("height", end));
 
         result.push_back(Pair("deltas", deltas));
+        if (paged)
+            result.push_back(Pair("cursor", addressCursorValue(nextCursor)));
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
 
+        return result;
+    } else if (paged) {
+        result.push_back(Pair("deltas", deltas));
+        result.push_back(Pair("cursor", addressCursorValue(nextCursor)));
         return result;
     } else {
         return deltas;
@@ -1093,6 +1271,8 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
             "{\n"
             "  \"balance\"  (string) The current balance in satoshis\n"
             "  \"received\"  (string) The total number of satoshis received (including change)\n"
+            "  \"txcount\"  (number) The number of transactions involving the address(es)\n"
+            "  \"utxocount\"  (number) The number of unspent outputs\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
@@ -1105,27 +1285,27 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
+    int64_t txcount = 0;
+    int64_t utxocount = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAddressSummaryValue summary;
+        if (!GetAddressSummary((*it).first, (*it).second, summary)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
+        balance += summary.balance;
+        received += summary.received;
+        txcount += summary.txCount;
+        utxocount += summary.utxoCount;
     }
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("balance", balance));
     result.push_back(Pair("received", received));
+    result.push_back(Pair("txcount", txcount));
+    result.push_back(Pair("utxocount", utxocount));
 
     return result;
 
@@ -1200,8 +1380,10 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Read at most this many index entries, with a cursor for the next ones\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous call\n"
             "}\n"
-            "\nResult:\n"
+            "\nResult (with limit, an object with \"txids\" in address then height order and \"cursor\", null after the last page):\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
@@ -1230,6 +1412,32 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
+    size_t limit = 0;
+    std::string cursor;
+    if (getAddressPageFromParams(params, limit, cursor)) {
+        std::string nextCursor = getAddressIndexPage(addresses, cursor, limit, start, end, addressIndex);
+
+        // The entries of a transaction are adjacent; skip those that ended the previous page
+        uint256 lastTxid;
+        if (!cursor.empty()) {
+            CAddressIndexKey lastKey;
+            decodeAddressCursor(cursor, addresses, lastKey);
+            lastTxid = lastKey.txhash;
+        }
+        UniValue txidsValue(UniValue::VARR);
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+            if (it->first.txhash != lastTxid) {
+                txidsValue.push_back(it->first.txhash.GetHex());
+                lastTxid = it->first.txhash;
+            }
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("txids", txidsValue));
+        result.push_back(Pair("cursor", addressCursorValue(nextCursor)));
+        return result;
+    }
+
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
             if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
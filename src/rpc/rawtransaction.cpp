@@ -29,6 +29,7 @@
 #include "merkleblock.h"
 #include "net.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "script/script.h"
 #include "script/script_error.h"
@@ -52,121 +53,149 @@ using namespace std;
 extern char ASSETCHAINS_SYMBOL[];
 int32_t komodo_dpowconfs(int32_t height,int32_t numconfs);
 
-void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex)
+void ScriptPubKeyToJSON(const CScript& scriptPubKey, CJSONWriter& out, bool fIncludeHex)
 {
     txnouttype type;
     vector<CTxDestination> addresses;
     int nRequired;
 
-    out.push_back(Pair("asm", ScriptToAsmStr(scriptPubKey)));
+    out.PushKV("asm", ScriptToAsmStr(scriptPubKey));
     if (fIncludeHex)
-        out.push_back(Pair("hex", HexStr(scriptPubKey.begin(), scriptPubKey.end())));
+        out.PushKV("hex", HexStr(scriptPubKey.begin(), scriptPubKey.end()));
 
     if (!ExtractDestinations(scriptPubKey, type, addresses, nRequired))
     {
-        out.push_back(Pair("type", GetTxnOutputType(type)));
+        out.PushKV("type", GetTxnOutputType(type));
         return;
     }
 
-    out.push_back(Pair("reqSigs", nRequired));
-    out.push_back(Pair("type", GetTxnOutputType(type)));
+    out.PushKVInt("reqSigs", nRequired);
+    out.PushKV("type", GetTxnOutputType(type));
 
-    UniValue a(UniValue::VARR);
+    out.Key("addresses");
+    out.BeginArray();
     for (const CTxDestination& addr : addresses) {
-        a.push_back(EncodeDestination(addr));
+        out.String(EncodeDestination(addr));
     }
-    out.push_back(Pair("addresses", a));
+    out.EndArray();
 }
 
-UniValue TxJoinSplitToJSON(const CTransaction& tx) {
+void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex)
+{
+    CJSONValueWriter writer(out);
+    ScriptPubKeyToJSON(scriptPubKey, writer, fIncludeHex);
+}
+
+static void TxJoinSplitToJSON(const CTransaction& tx, CJSONWriter& out) {
     bool useGroth = tx.fOverwintered && tx.nVersion >= SAPLING_TX_VERSION;
-    UniValue vjoinsplit(UniValue::VARR);
+    out.BeginArray();
     for (unsigned int i = 0; i < tx.vjoinsplit.size(); i++) {
         const JSDescription& jsdescription = tx.vjoinsplit[i];
-        UniValue joinsplit(UniValue::VOBJ);
+        out.BeginObject();
 
-        joinsplit.push_back(Pair("vpub_old", ValueFromAmount(jsdescription.vpub_old)));
-        joinsplit.push_back(Pair("vpub_oldZat", jsdescription.vpub_old));
-        joinsplit.push_back(Pair("vpub_new", ValueFromAmount(jsdescription.vpub_new)));
-        joinsplit.push_back(Pair("vpub_newZat", jsdescription.vpub_new));
+        out.PushKVAmount("vpub_old", jsdescription.vpub_old);
+        out.PushKVInt("vpub_oldZat", jsdescription.vpub_old);
+        out.PushKVAmount("vpub_new", jsdescription.vpub_new);
+        out.PushKVInt("vpub_newZat", jsdescription.vpub_new);
 
-        joinsplit.push_back(Pair("anchor", jsdescription.anchor.GetHex()));
+        out.PushKV("anchor", jsdescription.anchor.GetHex());
 
-        {
-            UniValue nullifiers(UniValue::VARR);
-            BOOST_FOREACH(const uint256 nf, jsdescription.nullifiers) {
-                nullifiers.push_back(nf.GetHex());
-            }
-            joinsplit.push_back(Pair("nullifiers", nullifiers));
+        out.Key("nullifiers");
+        out.BeginArray();
+        BOOST_FOREACH(const uint256 nf, jsdescription.nullifiers) {
+            out.String(nf.GetHex());
         }
+        out.EndArray();
 
-        {
-            UniValue commitments(UniValue::VARR);
-            BOOST_FOREACH(const uint256 commitment, jsdescription.commitments) {
-                commitments.push_back(commitment.GetHex());
-            }
-            joinsplit.push_back(Pair("commitments", commitments));
+        out.Key("commitments");
+        out.BeginArray();
+        BOOST_FOREACH(const uint256 commitment, jsdescription.commitments) {
+            out.String(commitment.GetHex());
         }
+        out.EndArray();
 
-        joinsplit.push_back(Pair("onetimePubKey", jsdescription.ephemeralKey.GetHex()));
-        joinsplit.push_back(Pair("randomSeed", jsdescription.randomSeed.GetHex()));
+        out.PushKV("onetimePubKey", jsdescription.ephemeralKey.GetHex());
+        out.PushKV("randomSeed", jsdescription.randomSeed.GetHex());
 
-        {
-            UniValue macs(UniValue::VARR);
-            BOOST_FOREACH(const uint256 mac, jsdescription.macs) {
-                macs.push_back(mac.GetHex());
-            }
-            joinsplit.push_back(Pair("macs", macs));
+        out.Key("macs");
+        out.BeginArray();
+        BOOST_FOREACH(const uint256 mac, jsdescription.macs) {
+            out.String(mac.GetHex());
         }
+        out.EndArray();
 
         CDataStream ssProof(SER_NETWORK, PROTOCOL_VERSION);
         auto ps = SproutProofSerializer<CDataStream>(ssProof, useGroth);
         boost::apply_visitor(ps, jsdescription.proof);
-        joinsplit.push_back(Pair("proof", HexStr(ssProof.begin(), ssProof.end())));
+        out.PushKV("proof", HexStr(ssProof.begin(), ssProof.end()));
 
-        {
-            UniValue ciphertexts(UniValue::VARR);
-            for (const ZCNoteEncryption::Ciphertext ct : jsdescription.ciphertexts) {
-                ciphertexts.push_back(HexStr(ct.begin(), ct.end()));
-            }
-            joinsplit.push_back(Pair("ciphertexts", ciphertexts));
+        out.Key("ciphertexts");
+        out.BeginArray();
+        for (const ZCNoteEncryption::Ciphertext ct : jsdescription.ciphertexts) {
+            out.String(HexStr(ct.begin(), ct.end()));
         }
+        out.EndArray();
 
-        vjoinsplit.push_back(joinsplit);
+        out.EndObject();
     }
+    out.EndArray();
+}
+
+UniValue TxJoinSplitToJSON(const CTransaction& tx) {
+    UniValue vjoinsplit;
+    CJSONValueWriter writer(vjoinsplit);
+    TxJoinSplitToJSON(tx, writer);
     return vjoinsplit;
 }
 
 uint64_t komodo_accrued_interest(int32_t *txheightp,uint32_t *locktimep,uint256 hash,int32_t n,int32_t checkheight,uint64_t checkvalue,int32_t tipheight);
 
-UniValue TxShieldedSpendsToJSON(const CTransaction& tx) {
-    UniValue vdesc(UniValue::VARR);
+static void TxShieldedSpendsToJSON(const CTransaction& tx, CJSONWriter& out) {
+    out.BeginArray();
     for (const SpendDescription& spendDesc : tx.vShieldedSpend) {
-        UniValue obj(UniValue::VOBJ);
-        obj.push_back(Pair("cv", spendDesc.cv.GetHex()));
-        obj.push_back(Pair("anchor", spendDesc.anchor.GetHex()));
-        obj.push_back(Pair("nullifier", spendDesc.nullifier.GetHex()));
-        obj.push_back(Pair("rk", spendDesc.rk.GetHex()));
-        obj.push_back(Pair("proof", HexStr(spendDesc.zkproof.begin(), spendDesc.zkproof.end())));
-        obj.push_back(Pair("spendAuthSig", HexStr(spendDesc.spendAuthSig.begin(), spendDesc.spendAuthSig.end())));
-        vdesc.push_back(obj);
+        out.BeginObject();
+        out.PushKV("cv", spendDesc.cv.GetHex());
+        out.PushKV("anchor", spendDesc.anchor.GetHex());
+        out.PushKV("nullifier", spendDesc.nullifier.GetHex());
+        out.PushKV("rk", spendDesc.rk.GetHex());
+        out.PushKV("proof", HexStr(spendDesc.zkproof.begin(), spendDesc.zkproof.end()));
+        out.PushKV("spendAuthSig", HexStr(spendDesc.spendAuthSig.begin(), spendDesc.spendAuthSig.end()));
+        out.EndObject();
     }
-    return vdesc;
+    out.EndArray();
 }
 
-UniValue TxShieldedOutputsToJSON(const CTransaction& tx) {
-    UniValue vdesc(UniValue::VARR);
+static void TxShieldedOutputsToJSON(const CTransaction& tx, CJSONWriter& out) {
+    out.BeginArray();
     for (const OutputDescription& outputDesc : tx.vShieldedOutput) {
-        UniValue obj(UniValue::VOBJ);
-        obj.push_back(Pair("cv", outputDesc.cv.GetHex()));
-        obj.push_back(Pair("cmu", outputDesc.cm.GetHex()));
-        obj.push_back(Pair("ephemeralKey", outputDesc.ephemeralKey.GetHex()));
-        obj.push_back(Pair("encCiphertext", HexStr(outputDesc.encCiphertext.begin(), outputDesc.encCiphertext.end())));
-        obj.push_back(Pair("outCiphertext", HexStr(outputDesc.outCiphertext.begin(), outputDesc.outCiphertext.end())));
-        obj.push_back(Pair("proof", HexStr(outputDesc.zkproof.begin(), outputDesc.zkproof.end())));
-        vdesc.push_back(obj);
+        out.BeginObject();
+        out.PushKV("cv", outputDesc.cv.GetHex());
+        out.PushKV("cmu", outputDesc.cm.GetHex());
+        out.PushKV("ephemeralKey", outputDesc.ephemeralKey.GetHex());
+        out.PushKV("encCiphertext", HexStr(outputDesc.encCiphertext.begin(), outputDesc.encCiphertext.end()));
+        out.PushKV("outCiphertext", HexStr(outputDesc.outCiphertext.begin(), outputDesc.outCiphertext.end()));
+        out.PushKV("proof", HexStr(outputDesc.zkproof.begin(), outputDesc.zkproof.end()));
+        out.EndObject();
+    }
+    out.EndArray();
+}
+
+/** The shielded part of a transaction, the same for TxToJSON and TxToJSONExpanded */
+static void TxShieldedToJSON(const CTransaction& tx, CJSONWriter& entry)
+{
+    entry.Key("vjoinsplit");
+    TxJoinSplitToJSON(tx, entry);
+
+    if (tx.fOverwintered && tx.nVersion >= SAPLING_TX_VERSION) {
+        entry.PushKVAmount("valueBalance", tx.valueBalance);
+        entry.Key("vShieldedSpend");
+        TxShieldedSpendsToJSON(tx, entry);
+        entry.Key("vShieldedOutput");
+        TxShieldedOutputsToJSON(tx, entry);
+        if (!(tx.vShieldedSpend.empty() && tx.vShieldedOutput.empty())) {
+            entry.PushKV("bindingSig", HexStr(tx.bindingSig.begin(), tx.bindingSig.end()));
+        }
     }
-    return vdesc;
 }
 
 int32_t myIsutxo_spent(uint256 &spenttxid,uint256 txid,int32_t vout)
@@ -182,210 +211,231 @@ int32_t myIsutxo_spent(uint256 &spenttxid,uint256 txid,int32_t vout)
     return(-1);
 }
 
-void TxToJSONExpanded(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, int nHeight = 0, int nConfirmations = 0, int nBlockTime = 0)
+void TxToJSONExpanded(const CTransaction& tx, const uint256 hashBlock, CJSONWriter& entry, int nHeight = 0, int nConfirmations = 0, int nBlockTime = 0)
 {
     uint256 txid = tx.GetHash();
-    entry.push_back(Pair("txid", txid.GetHex()));
-    entry.push_back(Pair("overwintered", tx.fOverwintered));
-    entry.push_back(Pair("version", tx.nVersion));
+    entry.PushKV("txid", txid.GetHex());
+    entry.PushKVBool("overwintered", tx.fOverwintered);
+    entry.PushKVInt("version", tx.nVersion);
     if (tx.fOverwintered) {
-        entry.push_back(Pair("versiongroupid", HexInt(tx.nVersionGroupId)));
+        entry.PushKV("versiongroupid", HexInt(tx.nVersionGroupId));
     }
-    entry.push_back(Pair("locktime", (int64_t)tx.nLockTime));
+    entry.PushKVInt("locktime", (int64_t)tx.nLockTime);
     if (tx.fOverwintered) {
-        entry.push_back(Pair("expiryheight", (int64_t)tx.nExpiryHeight));
+        entry.PushKVInt("expiryheight", (int64_t)tx.nExpiryHeight);
     }
-    UniValue vin(UniValue::VARR);
+    entry.Key("vin");
+    entry.BeginArray();
     BOOST_FOREACH(const CTxIn& txin, tx.vin) {
-        UniValue in(UniValue::VOBJ);
+        entry.BeginObject();
         if (tx.IsCoinBase())
-            in.push_back(Pair("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end())));
+            entry.PushKV("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
         else if (tx.IsCoinImport()) {
-            in.push_back(Pair("is_import", "1"));
+            entry.PushKV("is_import", "1");
         }
         else {
-            in.push_back(Pair("txid", txin.prevout.hash.GetHex()));
-            in.push_back(Pair("vout", (int64_t)txin.prevout.n));
+            entry.PushKV("txid", txin.prevout.hash.GetHex());
+            entry.PushKVInt("vout", (int64_t)txin.prevout.n);
             {
                 uint256 hash; CTransaction tx; CTxDestination address;
                 if (GetTransaction(txin.prevout.hash,tx,hash,false))
                 {
                     if (ExtractDestination(tx.vout[txin.prevout.n].scriptPubKey, address))
-                        in.push_back(Pair("address", CBitcoinAddress(address).ToString()));
+                        entry.PushKV("address", CBitcoinAddress(address).ToString());
                 }
             }
-            UniValue o(UniValue::VOBJ);
-            o.push_back(Pair("asm", ScriptToAsmStr(txin.scriptSig, true)));
-            o.push_back(Pair("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end())));
-            in.push_back(Pair("scriptSig", o));
+            entry.Key("scriptSig");
+            entry.BeginObject();
+            entry.PushKV("asm", ScriptToAsmStr(txin.scriptSig, true));
+            entry.PushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            entry.EndObject();
 
             // Add address and value info if spentindex enabled
             CSpentIndexValue spentInfo;
             CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
             if (GetSpentIndex(spentKey, spentInfo)) {
-                in.push_back(Pair("value", ValueFromAmount(spentInfo.satoshis)));
-                in.push_back(Pair("valueSat", spentInfo.satoshis));
+                entry.PushKVAmount("value", spentInfo.satoshis);
+                entry.PushKVInt("valueSat", spentInfo.satoshis);
                 if (spentInfo.addressType == 1) {
-                    in.push_back(Pair("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString()));
+                    entry.PushKV("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString());
                 }
                 else if (spentInfo.addressType == 2)  {
-                    in.push_back(Pair("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString()));
+                    entry.PushKV("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString());
                 }
             }
         }
-        in.push_back(Pair("sequence", (int64_t)txin.nSequence));
-        vin.push_back(in);
+        entry.PushKVInt("sequence", (int64_t)txin.nSequence);
+        entry.EndObject();
     }
-    entry.push_back(Pair("vin", vin));
+    entry.EndArray();
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     CBlockIndex *tipindex,*pindex = it->second;
-    uint64_t interest;
-    UniValue vout(UniValue::VARR);
+    entry.Key("vout");
+    entry.BeginArray();
     for (unsigned int i = 0; i < tx.vout.size(); i++)
     {
         const CTxOut& txout = tx.vout[i];
-        UniValue out(UniValue::VOBJ);
-        out.push_back(Pair("value", ValueFromAmount(txout.nValue)));
+        entry.BeginObject();
+        entry.PushKVAmount("value", txout.nValue);
         if ( ASSETCHAINS_SYMBOL[0] == 0 && pindex != 0 && tx.nLockTime >= 500000000 && (tipindex= chainActive.LastTip()) != 0 )
         {
             int64_t interest; int32_t txheight; uint32_t locktime;
             interest = komodo_accrued_interest(&txheight,&locktime,tx.GetHash(),i,0,txout.nValue,(int32_t)tipindex->GetHeight());
-            out.push_back(Pair("interest", ValueFromAmount(interest)));
+            entry.PushKVAmount("interest", interest);
         }
-        out.push_back(Pair("valueSat", txout.nValue)); // [+] Decker
-        out.push_back(Pair("n", (int64_t)i));
-        UniValue o(UniValue::VOBJ);
-        ScriptPubKeyToJSON(txout.scriptPubKey, o, true);
-        out.push_back(Pair("scriptPubKey", o));
+        entry.PushKVInt("valueSat", txout.nValue); // [+] Decker
+        entry.PushKVInt("n", (int64_t)i);
+        entry.Key("scriptPubKey");
+        entry.BeginObject();
+        ScriptPubKeyToJSON(txout.scriptPubKey, entry, true);
+        entry.EndObject();
 
         // Add spent information if spentindex is enabled
         CSpentIndexValue spentInfo;
         CSpentIndexKey spentKey(txid, i);
         if (GetSpentIndex(spentKey, spentInfo)) {
-            out.push_back(Pair("spentTxId", spentInfo.txid.GetHex()));
-            out.push_back(Pair("spentIndex", (int)spentInfo.inputIndex));
-            out.push_back(Pair("spentHeight", spentInfo.blockHeight));
+            entry.PushKV("spentTxId", spentInfo.txid.GetHex());
+            entry.PushKVInt("spentIndex", (int)spentInfo.inputIndex);
+            entry.PushKVInt("spentHeight", spentInfo.blockHeight);
         }
 
-        vout.push_back(out);
+        entry.EndObject();
     }
-    entry.push_back(Pair("vout", vout));
+    entry.EndArray();
 
-    UniValue vjoinsplit = TxJoinSplitToJSON(tx);
-    entry.push_back(Pair("vjoinsplit", vjoinsplit));
-
-    if (tx.fOverwintered && tx.nVersion >= SAPLING_TX_VERSION) {
-        entry.push_back(Pair("valueBalance", ValueFromAmount(tx.valueBalance)));
-        UniValue vspenddesc = TxShieldedSpendsToJSON(tx);
-        entry.push_back(Pair("vShieldedSpend", vspenddesc));
-        UniValue voutputdesc = TxShieldedOutputsToJSON(tx);
-        entry.push_back(Pair("vShieldedOutput", voutputdesc));
-        if (!(vspenddesc.empty() && voutputdesc.empty())) {
-            entry.push_back(Pair("bindingSig", HexStr(tx.bindingSig.begin(), tx.bindingSig.end())));
-        }
-    }
+    TxShieldedToJSON(tx, entry);
 
     if (!hashBlock.IsNull()) {
-        entry.push_back(Pair("blockhash", hashBlock.GetHex()));
+        entry.PushKV("blockhash", hashBlock.GetHex());
 
         if (nConfirmations > 0) {
-            entry.push_back(Pair("height", nHeight));
-            entry.push_back(Pair("confirmations", komodo_dpowconfs(nHeight,nConfirmations)));
-            entry.push_back(Pair("rawconfirmations", nConfirmations));
-            entry.push_back(Pair("time", nBlockTime));
-            entry.push_back(Pair("blocktime", nBlockTime));
+            entry.PushKVInt("height", nHeight);
+            entry.PushKVInt("confirmations", komodo_dpowconfs(nHeight,nConfirmations));
+            entry.PushKVInt("rawconfirmations", nConfirmations);
+            entry.PushKVInt("time", nBlockTime);
+            entry.PushKVInt("blocktime", nBlockTime);
         } else {
-            entry.push_back(Pair("height", -1));
-            entry.push_back(Pair("confirmations", 0));
-            entry.push_back(Pair("rawconfirmations", 0));
+            entry.PushKVInt("height", -1);
+            entry.PushKVInt("confirmations", 0);
+            entry.PushKVInt("rawconfirmations", 0);
         }
     }
 
 }
 
-void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
+void TxToJSON(const CTransaction& tx, const uint256 hashBlock, CJSONWriter& entry)
 {
-    entry.push_back(Pair("txid", tx.GetHash().GetHex()));
-    entry.push_back(Pair("overwintered", tx.fOverwintered));
-    entry.push_back(Pair("version", tx.nVersion));
+    entry.PushKV("txid", tx.GetHash().GetHex());
+    entry.PushKVBool("overwintered", tx.fOverwintered);
+    entry.PushKVInt("version", tx.nVersion);
     if (tx.fOverwintered) {
-        entry.push_back(Pair("versiongroupid", HexInt(tx.nVersionGroupId)));
+        entry.PushKV("versiongroupid", HexInt(tx.nVersionGroupId));
     }
-    entry.push_back(Pair("locktime", (int64_t)tx.nLockTime));
+    entry.PushKVInt("locktime", (int64_t)tx.nLockTime);
     if (tx.fOverwintered) {
-        entry.push_back(Pair("expiryheight", (int64_t)tx.nExpiryHeight));
+        entry.PushKVInt("expiryheight", (int64_t)tx.nExpiryHeight);
     }
-    UniValue vin(UniValue::VARR);
+    entry.Key("vin");
+    entry.BeginArray();
     BOOST_FOREACH(const CTxIn& txin, tx.vin) {
-        UniValue in(UniValue::VOBJ);
+        entry.BeginObject();
         if (tx.IsCoinBase())
-            in.push_back(Pair("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end())));
+            entry.PushKV("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
         else {
-            in.push_back(Pair("txid", txin.prevout.hash.GetHex()));
-            in.push_back(Pair("vout", (int64_t)txin.prevout.n));
-            UniValue o(UniValue::VOBJ);
-            o.push_back(Pair("asm", ScriptToAsmStr(txin.scriptSig, true)));
-            o.push_back(Pair("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end())));
-            in.push_back(Pair("scriptSig", o));
+            entry.PushKV("txid", txin.prevout.hash.GetHex());
+            entry.PushKVInt("vout", (int64_t)txin.prevout.n);
+            entry.Key("scriptSig");
+            entry.BeginObject();
+            entry.PushKV("asm", ScriptToAsmStr(txin.scriptSig, true));
+            entry.PushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            entry.EndObject();
         }
-        in.push_back(Pair("sequence", (int64_t)txin.nSequence));
-        vin.push_back(in);
+        entry.PushKVInt("sequence", (int64_t)txin.nSequence);
+        entry.EndObject();
     }
-    entry.push_back(Pair("vin", vin));
-    UniValue vout(UniValue::VARR);
+    entry.EndArray();
+    entry.Key("vout");
+    entry.BeginArray();
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     CBlockIndex *tipindex,*pindex = it->second;
-    uint64_t interest;
     for (unsigned int i = 0; i < tx.vout.size(); i++) {
         const CTxOut& txout = tx.vout[i];
-        UniValue out(UniValue::VOBJ);
-        out.push_back(Pair("value", ValueFromAmount(txout.nValue)));
+        entry.BeginObject();
+        entry.PushKVAmount("value", txout.nValue);
         if ( ASSETCHAINS_SYMBOL[0] == 0 && pindex != 0 && tx.nLockTime >= 500000000 && (tipindex= chainActive.LastTip()) != 0 )
         {
             int64_t interest; int32_t txheight; uint32_t locktime;
             interest = komodo_accrued_interest(&txheight,&locktime,tx.GetHash(),i,0,txout.nValue,(int32_t)tipindex->GetHeight());
-            out.push_back(Pair("interest", ValueFromAmount(interest)));
-        }        
-        out.push_back(Pair("valueZat", txout.nValue));
-        out.push_back(Pair("n", (int64_t)i));
-        UniValue o(UniValue::VOBJ);
-        ScriptPubKeyToJSON(txout.scriptPubKey, o, true);
-        out.push_back(Pair("scriptPubKey", o));
-        vout.push_back(out);
+            entry.PushKVAmount("interest", interest);
+        }
+        entry.PushKVInt("valueZat", txout.nValue);
+        entry.PushKVInt("n", (int64_t)i);
+        entry.Key("scriptPubKey");
+        entry.BeginObject();
+        ScriptPubKeyToJSON(txout.scriptPubKey, entry, true);
+        entry.EndObject();
+        entry.EndObject();
     }
-    entry.push_back(Pair("vout", vout));
+    entry.EndArray();
 
-    UniValue vjoinsplit = TxJoinSplitToJSON(tx);
-    entry.push_back(Pair("vjoinsplit", vjoinsplit));
+    TxShieldedToJSON(tx, entry);
 
-    if (tx.fOverwintered && tx.nVersion >= SAPLING_TX_VERSION) {
-        entry.push_back(Pair("valueBalance", ValueFromAmount(tx.valueBalance)));
-        UniValue vspenddesc = TxShieldedSpendsToJSON(tx);
-        entry.push_back(Pair("vShieldedSpend", vspenddesc));
-        UniValue voutputdesc = TxShieldedOutputsToJSON(tx);
-        entry.push_back(Pair("vShieldedOutput", voutputdesc));
-        if (!(vspenddesc.empty() && voutputdesc.empty())) {
-            entry.push_back(Pair("bindingSig", HexStr(tx.bindingSig.begin(), tx.bindingSig.end())));
+    if (!hashBlock.IsNull()) {
+        entry.PushKV("blockhash", hashBlock.GetHex());
+        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+        if (mi != mapBlockIndex.end() && (*mi).second) {
+            CBlockIndex* pindex = (*mi).second;
+            if (chainActive.Contains(pindex)) {
+                entry.PushKVInt("height", pindex->GetHeight());
+                entry.PushKVInt("rawconfirmations", 1 + chainActive.Height() - pindex->GetHeight());
+                entry.PushKVInt("confirmations", komodo_dpowconfs(pindex->GetHeight(),1 + chainActive.Height() - pindex->GetHeight()));
+                entry.PushKVInt("time", pindex->GetBlockTime());
+                entry.PushKVInt("blocktime", pindex->GetBlockTime());
+            } else {
+                entry.PushKVInt("confirmations", 0);
+                entry.PushKVInt("rawconfirmations", 0);
+            }
         }
     }
+}
 
-    if (!hashBlock.IsNull()) {
-        entry.push_back(Pair("blockhash", hashBlock.GetHex()));
+void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
+{
+    CJSONValueWriter writer(entry);
+    TxToJSON(tx, hashBlock, writer);
+}
+
+/** The transaction getrawtransaction asks for and where it is in the chain; returns whether verbose output is wanted */
+static bool GetTransactionForRPC(const UniValue& params, CTransaction& tx, uint256& hashBlock, int& nHeight, int& nConfirmations, int& nBlockTime)
+{
+    uint256 hash = ParseHashV(params[0], "parameter 1");
+
+    bool fVerbose = false;
+    if (params.size() > 1)
+        fVerbose = (params[1].get_int() != 0);
+
+    // GetTransaction takes cs_main only when it has to, so parallel calls overlap their disk reads
+    if (!GetTransaction(hash, tx, hashBlock, true))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
+
+    {
+        LOCK(cs_main);
         BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
         if (mi != mapBlockIndex.end() && (*mi).second) {
             CBlockIndex* pindex = (*mi).second;
             if (chainActive.Contains(pindex)) {
-                entry.push_back(Pair("height", pindex->GetHeight()));
-                entry.push_back(Pair("rawconfirmations", 1 + chainActive.Height() - pindex->GetHeight()));
-                entry.push_back(Pair("confirmations", komodo_dpowconfs(pindex->GetHeight(),1 + chainActive.Height() - pindex->GetHeight())));
-                entry.push_back(Pair("time", pindex->GetBlockTime()));
-                entry.push_back(Pair("blocktime", pindex->GetBlockTime()));
+                nHeight = pindex->GetHeight();
+                nConfirmations = 1 + chainActive.Height() - pindex->GetHeight();
+                nBlockTime = pindex->GetBlockTime();
             } else {
-                entry.push_back(Pair("confirmations", 0));
-                entry.push_back(Pair("rawconfirmations", 0));
+                nHeight = -1;
+                nConfirmations = 0;
+                nBlockTime = pindex->GetBlockTime();
             }
         }
     }
+
+    return fVerbose;
 }
 
 UniValue getrawtransaction(const UniValue& params, bool fHelp)
@@ -484,37 +534,12 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
         );
 
 
-    uint256 hash = ParseHashV(params[0], "parameter 1");
-
-    bool fVerbose = false;
-    if (params.size() > 1)
-        fVerbose = (params[1].get_int() != 0);
-
     CTransaction tx;
     uint256 hashBlock;
     int nHeight = 0;
     int nConfirmations = 0;
     int nBlockTime = 0;
-
-    {
-        LOCK(cs_main);
-        if (!GetTransaction(hash, tx, hashBlock, true))
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
-
-        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
-        if (mi != mapBlockIndex.end() && (*mi).second) {
-            CBlockIndex* pindex = (*mi).second;
-            if (chainActive.Contains(pindex)) {
-                nHeight = pindex->GetHeight();
-                nConfirmations = 1 + chainActive.Height() - pindex->GetHeight();
-                nBlockTime = pindex->GetBlockTime();
-            } else {
-                nHeight = -1;
-                nConfirmations = 0;
-                nBlockTime = pindex->GetBlockTime();
-            }
-        }
-    }
+    bool fVerbose = GetTransactionForRPC(params, tx, hashBlock, nHeight, nConfirmations, nBlockTime);
 
     string strHex = EncodeHexTx(tx);
 
@@ -523,10 +548,37 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hex", strHex));
-    TxToJSONExpanded(tx, hashBlock, result, nHeight, nConfirmations, nBlockTime);
+    CJSONValueWriter writer(result);
+    TxToJSONExpanded(tx, hashBlock, writer, nHeight, nConfirmations, nBlockTime);
     return result;
 }
 
+/** getrawtransaction writing its result directly */
+void getrawtransaction_write(const UniValue& params, CJSONWriter& result)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getrawtransaction(params, true); // throws the usage
+
+    CTransaction tx;
+    uint256 hashBlock;
+    int nHeight = 0;
+    int nConfirmations = 0;
+    int nBlockTime = 0;
+    bool fVerbose = GetTransactionForRPC(params, tx, hashBlock, nHeight, nConfirmations, nBlockTime);
+
+    string strHex = EncodeHexTx(tx);
+
+    if (!fVerbose) {
+        result.String(strHex);
+        return;
+    }
+
+    result.BeginObject();
+    result.PushKV("hex", strHex);
+    TxToJSONExpanded(tx, hashBlock, result, nHeight, nConfirmations, nBlockTime);
+    result.EndObject();
+}
+
 int32_t gettxout_scriptPubKey(uint8_t *scriptPubKey,int32_t maxsize,uint256 txid,int32_t n)
 {
     int32_t i,m; uint8_t *ptr;
@@ -1313,7 +1365,7 @@ UniValue sendrawtransaction(const UniValue& params, bool fHelp)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  &getrawtransaction_write },
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
     { "rawtransactions",    "decodescript",           &decodescript,           true  },
@@ -20,6 +20,7 @@
 
 #include "rpc/server.h"
 
+#include "httpserver.h"
 #include "init.h"
 #include "key_io.h"
 #include "random.h"
@@ -29,7 +30,9 @@
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
 #include <memory>
+#include <set>
 
 #include <univalue.h>
 
@@ -56,6 +59,56 @@ static std::vector<RPCTimerInterface*> timerInterfaces;
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
 
+//! Upper bounds of the latency histogram buckets in milliseconds; the last bucket has no bound
+static const int64_t RPC_LATENCY_BUCKETS_MS[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000};
+static const size_t RPC_LATENCY_BUCKETS = sizeof(RPC_LATENCY_BUCKETS_MS) / sizeof(RPC_LATENCY_BUCKETS_MS[0]) + 1;
+
+/** Latencies of the calls of one method since startup */
+struct CRPCMethodStats
+{
+    uint64_t nCalls;
+    uint64_t nErrors;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+    uint64_t vHistogram[RPC_LATENCY_BUCKETS];
+
+    CRPCMethodStats() : nCalls(0), nErrors(0), nTotalMicros(0), nMaxMicros(0)
+    {
+        std::fill(vHistogram, vHistogram + RPC_LATENCY_BUCKETS, 0);
+    }
+};
+
+static CCriticalSection cs_rpcStats;
+static std::map<std::string, CRPCMethodStats> mapRPCStats;
+
+/** Records the latency of a call when it goes out of scope, as an error if it is left by an exception */
+class CRPCLatencyTimer
+{
+private:
+    const std::string& strMethod;
+    int64_t nTimeStart;
+
+public:
+    CRPCLatencyTimer(const std::string& strMethodIn) : strMethod(strMethodIn), nTimeStart(GetTimeMicros()) {}
+
+    ~CRPCLatencyTimer()
+    {
+        int64_t nMicros = GetTimeMicros() - nTimeStart;
+        size_t nBucket = 0;
+        while (nBucket < RPC_LATENCY_BUCKETS - 1 && nMicros > RPC_LATENCY_BUCKETS_MS[nBucket] * 1000)
+            nBucket++;
+
+        LOCK(cs_rpcStats);
+        CRPCMethodStats& stats = mapRPCStats[strMethod];
+        stats.nCalls++;
+        if (std::uncaught_exception())
+            stats.nErrors++;
+        stats.nTotalMicros += nMicros;
+        stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+        stats.vHistogram[nBucket]++;
+    }
+};
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -283,6 +336,90 @@ UniValue stop(const UniValue& params, bool fHelp)
     return buf;
 }
 
+UniValue getrpcstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getrpcstats ( \"method\" )\n"
+            "\nReturns the state of the RPC work queues and the latencies of the calls made since startup.\n"
+            "\nArguments:\n"
+            "1. \"method\"     (string, optional) Only report this method\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queues\": [                (array) one entry per work queue\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",        (string) priority, cheap or expensive\n"
+            "      \"threads\": n,            (numeric) worker threads serving the queue\n"
+            "      \"depth\": n,              (numeric) requests waiting\n"
+            "      \"maxdepth\": n,           (numeric) requests that can wait before new ones are rejected\n"
+            "      \"clients\": n,            (numeric) clients with requests waiting\n"
+            "      \"processed\": n,          (numeric) requests handed to a worker\n"
+            "      \"rejected\": n,           (numeric) requests turned away because the queue was full\n"
+            "      \"avgwaitms\": x.xxx       (numeric) average time requests waited for a worker\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"bucketsms\": [n, ...],       (array) upper bounds of the histogram buckets, the last bucket is unbounded\n"
+            "  \"methods\": {\n"
+            "    \"method\": {\n"
+            "      \"calls\": n,              (numeric) calls made\n"
+            "      \"errors\": n,             (numeric) calls that failed\n"
+            "      \"avgms\": x.xxx,          (numeric) average latency\n"
+            "      \"maxms\": x.xxx,          (numeric) highest latency\n"
+            "      \"histogram\": [n, ...]    (array) calls per latency bucket\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcstats", "")
+            + HelpExampleCli("getrpcstats", "\"getblock\"")
+            + HelpExampleRpc("getrpcstats", "\"getblock\"")
+        );
+
+    UniValue queues(UniValue::VARR);
+    BOOST_FOREACH(const HTTPWorkQueueStats& stats, GetHTTPWorkQueueStats()) {
+        UniValue queue(UniValue::VOBJ);
+        queue.push_back(Pair("name", HTTPWorkClassName(stats.workClass)));
+        queue.push_back(Pair("threads", stats.nThreads));
+        queue.push_back(Pair("depth", (uint64_t)stats.nDepth));
+        queue.push_back(Pair("maxdepth", (uint64_t)stats.nMaxDepth));
+        queue.push_back(Pair("clients", (uint64_t)stats.nClients));
+        queue.push_back(Pair("processed", stats.nProcessed));
+        queue.push_back(Pair("rejected", stats.nRejected));
+        queue.push_back(Pair("avgwaitms", stats.nProcessed ? stats.nWaitMicros / 1000.0 / stats.nProcessed : 0.0));
+        queues.push_back(queue);
+    }
+
+    UniValue buckets(UniValue::VARR);
+    for (size_t i = 0; i < RPC_LATENCY_BUCKETS - 1; i++)
+        buckets.push_back(RPC_LATENCY_BUCKETS_MS[i]);
+
+    UniValue methods(UniValue::VOBJ);
+    {
+        LOCK(cs_rpcStats);
+        for (std::map<std::string, CRPCMethodStats>::const_iterator it = mapRPCStats.begin(); it != mapRPCStats.end(); ++it) {
+            if (params.size() > 0 && it->first != params[0].get_str())
+                continue;
+            const CRPCMethodStats& stats = it->second;
+            UniValue method(UniValue::VOBJ);
+            method.push_back(Pair("calls", stats.nCalls));
+            method.push_back(Pair("errors", stats.nErrors));
+            method.push_back(Pair("avgms", stats.nCalls ? stats.nTotalMicros / 1000.0 / stats.nCalls : 0.0));
+            method.push_back(Pair("maxms", stats.nMaxMicros / 1000.0));
+            UniValue histogram(UniValue::VARR);
+            for (size_t i = 0; i < RPC_LATENCY_BUCKETS; i++)
+                histogram.push_back(stats.vHistogram[i]);
+            method.push_back(Pair("histogram", histogram));
+            methods.push_back(Pair(it->first, method));
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("queues", queues));
+    result.push_back(Pair("bucketsms", buckets));
+    result.push_back(Pair("methods", methods));
+    return result;
+}
+
 /**
  * Call Table
  */
@@ -292,6 +429,7 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true  },
     { "control",            "stop",                   &stop,                   true  },
+    { "control",            "getrpcstats",            &getrpcstats,            true  },
 
     /* P2P networking */
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
@@ -312,7 +450,7 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
+    { "blockchain",         "getblock",               &getblock,               true,  &getblock_write },
     { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
@@ -372,7 +510,7 @@ static const CRPCCommand vRPCCommands[] =
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
     { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  &getrawtransaction_write },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
@@ -497,10 +635,12 @@ static const CRPCCommand vRPCCommands[] =
     { "tokens",       "tokeninfo",        &tokeninfo,         true },
     { "tokens",       "tokenlist",        &tokenlist,         true },
     { "tokens",       "tokenorders",      &tokenorders,       true },
+    { "tokens",       "mytokenorders",    &mytokenorders,     true },
     { "tokens",       "tokenaddress",     &tokenaddress,      true },
     { "tokens",       "tokenbalance",     &tokenbalance,      true },
     { "tokens",       "tokencreate",      &tokencreate,       true },
     { "tokens",       "tokentransfer",    &tokentransfer,     true },
+    { "tokens",       "tokentransfermany", &tokentransfermany, true },
     { "tokens",       "tokenbid",         &tokenbid,          true },
     { "tokens",       "tokencancelbid",   &tokencancelbid,    true },
     { "tokens",       "tokenfillbid",     &tokenfillbid,      true },
@@ -648,12 +788,77 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+/** Threads that help HTTP workers run the read-only entries of batches */
+class CRPCBatchPool
+{
+private:
+    boost::mutex cs;
+    boost::condition_variable cond;
+    std::deque<boost::function<void()> > queue;
+    boost::thread_group threads;
+    bool fRunning;
+
+    void Thread()
+    {
+        RenameThread("komodo-rpcbatch");
+        while (true) {
+            boost::function<void()> job;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (fRunning && queue.empty())
+                    cond.wait(lock);
+                if (!fRunning)
+                    return;
+                job = queue.front();
+                queue.pop_front();
+            }
+            job();
+        }
+    }
+
+public:
+    CRPCBatchPool() : fRunning(false) {}
+
+    void Start(int nThreads)
+    {
+        fRunning = true;
+        for (int i = 0; i < nThreads; i++)
+            threads.create_thread(boost::bind(&CRPCBatchPool::Thread, this));
+    }
+
+    void Stop()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fRunning = false;
+            queue.clear();
+            cond.notify_all();
+        }
+        threads.join_all();
+    }
+
+    size_t Size() { return threads.size(); }
+
+    void Push(const boost::function<void()>& job)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        queue.push_back(job);
+        cond.notify_one();
+    }
+};
+
+static CRPCBatchPool rpcBatchPool;
+static int nRPCBatchParallel = DEFAULT_RPC_BATCH_PARALLEL;
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
     fRPCRunning = true;
     g_rpcSignals.Started();
 
+    nRPCBatchParallel = std::max((int)GetArg("-rpcbatchparallel", DEFAULT_RPC_BATCH_PARALLEL), 1);
+    rpcBatchPool.Start(std::max((int)GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 0));
+
     // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
     getAsyncRPCQueue()->addWorker();
 /*
@@ -687,6 +892,8 @@ void StopRPC()
     // Tells async queue to cancel all operations and shutdown.
     LogPrintf("%s: waiting for async rpc workers to stop\n", __func__);
     getAsyncRPCQueue()->closeAndWait();
+
+    rpcBatchPool.Stop();
 }
 
 bool IsRPCRunning()
@@ -769,11 +976,88 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+//! Read-only calls that the entries of a batch may run concurrently
+static const char* PARALLEL_BATCH_METHODS[] = {
+    "getrawtransaction", "decoderawtransaction", "decodescript", "gettxout", "getblock", "getblockheader",
+    "getblockhash", "getblockcount", "getbestblockhash", "getspentinfo", "getaddressbalance",
+    "getaddressdeltas", "getaddresstxids", "getaddressutxos", "getaddressmempool", "validateaddress",
+};
+
+static bool IsParallelBatchEntry(const UniValue& req)
+{
+    static const std::set<std::string> setMethods(PARALLEL_BATCH_METHODS,
+        PARALLEL_BATCH_METHODS + sizeof(PARALLEL_BATCH_METHODS) / sizeof(PARALLEL_BATCH_METHODS[0]));
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req, "method");
+    return method.isStr() && setMethods.count(method.get_str());
+}
+
+/**
+ * A run of consecutive read-only entries of a batch. Every lane takes the next
+ * entry until none are left. Lanes pushed to the pool may start only after the
+ * caller has finished, so the state is shared and done counts entries, not lanes.
+ */
+struct CBatchRun
+{
+    const UniValue& vReq;
+    size_t nEnd;
+    std::vector<UniValue> vResult;
+    std::atomic<size_t> nNext;
+    boost::mutex cs;
+    boost::condition_variable cond;
+    size_t nDone;
+
+    CBatchRun(const UniValue& vReqIn, size_t nBegin, size_t nEndIn) :
+        vReq(vReqIn), nEnd(nEndIn), vResult(nEndIn - nBegin), nNext(nBegin), nDone(0) {}
+};
+
+static void RunBatchLane(boost::shared_ptr<CBatchRun> run, size_t nBegin)
+{
+    size_t i;
+    while ((i = run->nNext++) < run->nEnd) {
+        run->vResult[i - nBegin] = JSONRPCExecOne(run->vReq[i]);
+        boost::unique_lock<boost::mutex> lock(run->cs);
+        if (++run->nDone == run->vResult.size())
+            run->cond.notify_all();
+    }
+}
+
+std::string JSONRPCExecBatch(const UniValue& vReq, int nMaxParallel)
 {
+    if (nMaxParallel < 0)
+        nMaxParallel = nRPCBatchParallel;
+    nMaxParallel = std::min(nMaxParallel, (int)rpcBatchPool.Size() + 1);
+
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        size_t nEnd = reqIdx;
+        while (nEnd < vReq.size() && IsParallelBatchEntry(vReq[nEnd]))
+            nEnd++;
+        if (nMaxParallel <= 1 || nEnd - reqIdx < 2) {
+            // Calls that may change state run alone, in order, as do lone read-only ones
+            nEnd = std::max(nEnd, reqIdx + 1);
+            for (; reqIdx < nEnd; reqIdx++)
+                ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+            continue;
+        }
+
+        // Fan the run out over the pool, with this thread as one of the lanes
+        boost::shared_ptr<CBatchRun> run(new CBatchRun(vReq, reqIdx, nEnd));
+        size_t nLanes = std::min((size_t)nMaxParallel, nEnd - reqIdx);
+        for (size_t i = 1; i < nLanes; i++)
+            rpcBatchPool.Push(boost::bind(&RunBatchLane, run, reqIdx));
+        RunBatchLane(run, reqIdx);
+        {
+            boost::unique_lock<boost::mutex> lock(run->cs);
+            while (run->nDone < run->vResult.size())
+                run->cond.wait(lock);
+        }
+        for (size_t i = 0; i < run->vResult.size(); i++)
+            ret.push_back(run->vResult[i]);
+        reqIdx = nEnd;
+    }
 
     return ret.write() + "\n";
 }
@@ -796,6 +1080,7 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    CRPCLatencyTimer timer(pcmd->name);
     try
     {
         // Execute
@@ -809,6 +1094,35 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+bool CRPCTable::executeWriter(const std::string &strMethod, const UniValue &params, CJSONWriter &result) const
+{
+    const CRPCCommand *pcmd = (*this)[strMethod];
+    if (!pcmd || !pcmd->writer)
+        return false;
+
+    // Return immediately if in warmup
+    {
+        LOCK(cs_rpcWarmup);
+        if (fRPCInWarmup)
+            throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
+    }
+
+    g_rpcSignals.PreCommand(*pcmd);
+
+    CRPCLatencyTimer timer(pcmd->name);
+    try
+    {
+        pcmd->writer(params, result);
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+
+    g_rpcSignals.PostCommand(*pcmd);
+    return true;
+}
+
 std::string HelpExampleCli(const std::string& methodname, const std::string& args)
 {
     return "> komodo-cli " + methodname + " " + args + "\n";
@@ -35,6 +35,11 @@
 
 #include <univalue.h>
 
+//! Default for -rpcbatchthreads, the threads that help run read-only batch entries
+static const int DEFAULT_RPC_BATCH_THREADS = 4;
+//! Default for -rpcbatchparallel, the most entries of one batch that run at once
+static const int DEFAULT_RPC_BATCH_PARALLEL = 4;
+
 class AsyncRPCQueue;
 class CRPCCommand;
 
@@ -47,6 +52,7 @@ namespace RPCServer
 }
 
 class CBlockIndex;
+class CJSONWriter;
 class CNetAddr;
 
 class JSONRequest
@@ -133,6 +139,7 @@ void RPCUnregisterTimerInterface(RPCTimerInterface *iface);
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds);
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
+typedef void(*rpcwritefn_type)(const UniValue& params, CJSONWriter& result);
 
 class CRPCCommand
 {
@@ -141,6 +148,8 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    //! Optional, writes the same result as actor without building it as a UniValue
+    rpcwritefn_type writer;
 };
 
 /**
@@ -164,6 +173,12 @@ public:
      */
     UniValue execute(const std::string &method, const UniValue &params) const;
 
+    /**
+     * Execute a method that can write its result directly.
+     * Returns false, without executing anything, when method has no writer;
+     * otherwise the same as execute.
+     */
+    bool executeWriter(const std::string &method, const UniValue &params, CJSONWriter &result) const;
 
     /**
      * Appends a CRPCCommand to the dispatch table.
@@ -198,7 +213,12 @@ extern void EnsureWalletIsUnlocked();
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const UniValue& vReq);
+/**
+ * Execute the requests of a batch and return the replies, in order.
+ * Runs of read-only calls are spread over up to nMaxParallel threads;
+ * a negative nMaxParallel uses -rpcbatchparallel.
+ */
+std::string JSONRPCExecBatch(const UniValue& vReq, int nMaxParallel = -1);
 
 extern std::string experimentalDisabledHelpMsg(const std::string& rpc, const std::string& enableArg);
 
@@ -241,11 +261,13 @@ extern UniValue coinsupply(const UniValue& params, bool fHelp);
 extern UniValue tokeninfo(const UniValue& params, bool fHelp);
 extern UniValue tokenlist(const UniValue& params, bool fHelp);
 extern UniValue tokenorders(const UniValue& params, bool fHelp);
+extern UniValue mytokenorders(const UniValue& params, bool fHelp);
 extern UniValue tokenbalance(const UniValue& params, bool fHelp);
 extern UniValue assetsaddress(const UniValue& params, bool fHelp);
 extern UniValue tokenaddress(const UniValue& params, bool fHelp);
 extern UniValue tokencreate(const UniValue& params, bool fHelp);
 extern UniValue tokentransfer(const UniValue& params, bool fHelp);
+extern UniValue tokentransfermany(const UniValue& params, bool fHelp);
 extern UniValue tokenbid(const UniValue& params, bool fHelp);
 extern UniValue tokencancelbid(const UniValue& params, bool fHelp);
 extern UniValue tokenfillbid(const UniValue& params, bool fHelp);
@@ -394,6 +416,7 @@ extern UniValue jumblr_pause(const UniValue& params, bool fHelp);
 extern UniValue jumblr_resume(const UniValue& params, bool fHelp);
 
 extern UniValue getrawtransaction(const UniValue& params, bool fHelp); // in rcprawtransaction.cpp
+extern void getrawtransaction_write(const UniValue& params, CJSONWriter& result);
 extern UniValue listunspent(const UniValue& params, bool fHelp);
 extern UniValue lockunspent(const UniValue& params, bool fHelp);
 extern UniValue listlockunspent(const UniValue& params, bool fHelp);
@@ -418,6 +441,7 @@ extern UniValue getblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblockheader(const UniValue& params, bool fHelp);
 extern UniValue getlastsegidstakes(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
+extern void getblock_write(const UniValue& params, CJSONWriter& result);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp);
 extern UniValue gettxout(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
@@ -1392,6 +1392,14 @@ int TransactionSignatureChecker::CheckCryptoCondition(
         fprintf(stderr,"%02x",((uint8_t *)&sighash)[z]);
     fprintf(stderr," sighash nIn.%d nHashType.%d %.8f id.%d\n",(int32_t)nIn,(int32_t)nHashType,(double)amount/COIN,(int32_t)consensusBranchId);
      */
+    int out = VerifyCryptoCondition(cond, sighash, condBin, ffillBin);
+    cc_free(cond);
+    return out;
+}
+
+
+int TransactionSignatureChecker::VerifyCryptoCondition(const CC *cond, const uint256& sighash, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin) const
+{
     VerifyEval eval = [] (CC *cond, void *checker) {
         //fprintf(stderr,"checker.%p\n",(TransactionSignatureChecker*)checker);
         return ((TransactionSignatureChecker*)checker)->CheckEvalCondition(cond);
@@ -1400,7 +1408,6 @@ int TransactionSignatureChecker::CheckCryptoCondition(
     int out = cc_verify(cond, (const unsigned char*)&sighash, 32, 0,
                         condBin.data(), condBin.size(), eval, (void*)this);
     //fprintf(stderr,"out.%d from cc_verify\n",(int32_t)out);
-    cc_free(cond);
     return out;
 }
 
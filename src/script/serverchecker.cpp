@@ -22,6 +22,7 @@
 #include "script/cc.h"
 #include "cc/eval.h"
 
+#include "hash.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
@@ -90,6 +91,50 @@ public:
     }
 };
 
+/**
+ * Valid crypto-condition fulfillment cache, the same for the secp256k1 and ed25519
+ * signatures of a CC spend and the match of its condition. The evals are not in it:
+ * what they check depends on the chain, so they run every time.
+ */
+class CCryptoConditionCache
+{
+private:
+     //! ccdata_type is (signature hash, hash of the fulfillment and of the condition it meets):
+    typedef std::pair<uint256, uint256> ccdata_type;
+    std::set< ccdata_type> setValid;
+    boost::shared_mutex cs_ccverify;
+
+public:
+    bool
+    Get(const uint256 &hash, const uint256 &ffillHash)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_ccverify);
+
+        return setValid.count(ccdata_type(hash, ffillHash)) != 0;
+    }
+
+    void Set(const uint256 &hash, const uint256 &ffillHash)
+    {
+        // Shares the limit of the signature cache, an entry being much smaller
+        int64_t nMaxCacheSize = GetArg("-maxservercheckersize", 50000);
+        if (nMaxCacheSize <= 0) return;
+
+        boost::unique_lock<boost::shared_mutex> lock(cs_ccverify);
+
+        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
+        {
+            // Evict a random entry, as the signature cache does
+            std::set<ccdata_type>::iterator it =
+                setValid.lower_bound(ccdata_type(GetRandHash(), uint256()));
+            if (it == setValid.end())
+                it = setValid.begin();
+            setValid.erase(it);
+        }
+
+        setValid.insert(ccdata_type(hash, ffillHash));
+    }
+};
+
 }
 
 bool ServerTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
@@ -107,6 +152,24 @@ bool ServerTransactionSignatureChecker::VerifySignature(const std::vector<unsign
     return true;
 }
 
+int ServerTransactionSignatureChecker::VerifyCryptoCondition(const CC *cond, const uint256& sighash, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin) const
+{
+    static CCryptoConditionCache fulfillmentCache;
+
+    uint256 ffillHash = Hash(ffillBin.begin(), ffillBin.end(), condBin.begin(), condBin.end());
+    if (!fulfillmentCache.Get(sighash, ffillHash))
+    {
+        if (!cc_verifyFulfillment(cond, sighash.begin(), 32, 0, condBin.data(), condBin.size()))
+            return 0;
+        if (store)
+            fulfillmentCache.Set(sighash, ffillHash);
+    }
+    VerifyEval eval = [] (CC *cond, void *checker) {
+        return ((TransactionSignatureChecker*)checker)->CheckEvalCondition(cond);
+    };
+    return cc_verifyEval(cond, eval, (void*)this) ? 1 : 0;
+}
+
 /*
  * The reason that these functions are here is that the what used to be the
  * CachingTransactionSignatureChecker, now the ServerTransactionSignatureChecker,
@@ -175,6 +175,14 @@ public:
         return (std::string(begin(), end()));
     }
 
+    void swap(CBaseDataStream& other)
+    {
+        vch.swap(other.vch);
+        std::swap(nReadPos, other.nReadPos);
+        std::swap(nType, other.nType);
+        std::swap(nVersion, other.nVersion);
+    }
+
 
     //
     // Vector subset
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include "main.h"
+#include "txdb.h"
+
+
+namespace TestAddressIndex {
+
+
+typedef std::vector<std::pair<CAddressIndexKey, CAmount> > AddressIndexVec;
+typedef std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > AddressUnspentVec;
+
+static const int TYPE = 1;
+static const uint160 ADDR(std::vector<unsigned char>(20, 0xaa));
+static const uint160 OTHER(std::vector<unsigned char>(20, 0xbb));
+
+/** Records the index changes of one block, the way ConnectBlock and DisconnectBlock do */
+class BlockChanges
+{
+public:
+    int nHeight;
+    AddressIndexVec addressIndex;
+    AddressUnspentVec unspentAdd;
+    AddressUnspentVec unspentUndo;
+
+    BlockChanges(int height) : nHeight(height) {}
+
+    void Receive(const uint160 &addr, const uint256 &txid, int txindex, int n, CAmount nValue)
+    {
+        addressIndex.push_back(std::make_pair(CAddressIndexKey(TYPE, addr, nHeight, txindex, txid, n, false), nValue));
+        unspentAdd.push_back(std::make_pair(CAddressUnspentKey(TYPE, addr, txid, n), CAddressUnspentValue(nValue, CScript(), nHeight)));
+        unspentUndo.push_back(std::make_pair(CAddressUnspentKey(TYPE, addr, txid, n), CAddressUnspentValue()));
+    }
+
+    void Spend(const uint160 &addr, const uint256 &txid, int txindex, int nIn,
+               const uint256 &prevTxid, int prevN, CAmount nValue, int nPrevHeight)
+    {
+        addressIndex.push_back(std::make_pair(CAddressIndexKey(TYPE, addr, nHeight, txindex, txid, nIn, true), -nValue));
+        unspentAdd.push_back(std::make_pair(CAddressUnspentKey(TYPE, addr, prevTxid, prevN), CAddressUnspentValue()));
+        unspentUndo.push_back(std::make_pair(CAddressUnspentKey(TYPE, addr, prevTxid, prevN), CAddressUnspentValue(nValue, CScript(), nPrevHeight)));
+    }
+
+    void Connect(CBlockTreeDB &db)
+    {
+        ASSERT_TRUE(db.WriteAddressIndex(addressIndex));
+        ASSERT_TRUE(db.UpdateAddressUnspentIndex(unspentAdd));
+    }
+
+    void Disconnect(CBlockTreeDB &db)
+    {
+        // DisconnectBlock undoes the transactions in reverse order
+        AddressUnspentVec undo(unspentUndo.rbegin(), unspentUndo.rend());
+        ASSERT_TRUE(db.EraseAddressIndex(addressIndex));
+        ASSERT_TRUE(db.UpdateAddressUnspentIndex(undo));
+    }
+};
+
+static void CheckSummary(CBlockTreeDB &db, CAmount balance, CAmount received, int64_t txCount, int64_t utxoCount)
+{
+    CAddressSummaryValue summary;
+    ASSERT_TRUE(db.ReadAddressSummary(ADDR, TYPE, summary));
+    EXPECT_EQ(balance, summary.balance);
+    EXPECT_EQ(received, summary.received);
+    EXPECT_EQ(txCount, summary.txCount);
+    EXPECT_EQ(utxoCount, summary.utxoCount);
+}
+
+
+TEST(TestAddressIndex, test_summary_and_pages)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+    uint256 tx1 = uint256S("01"), tx2 = uint256S("02"), tx3 = uint256S("03");
+    uint256 tx4 = uint256S("04"), tx5 = uint256S("05");
+
+    BlockChanges block10(10);
+    block10.Receive(ADDR, tx1, 1, 0, 100);
+    block10.Connect(db);
+    CheckSummary(db, 100, 100, 1, 1);
+
+    // tx2 spends tx1 and pays change back; tx3 is unrelated income
+    BlockChanges block11(11);
+    block11.Spend(ADDR, tx2, 1, 0, tx1, 0, 100, 10);
+    block11.Receive(ADDR, tx2, 1, 0, 30);
+    block11.Receive(OTHER, tx2, 1, 1, 70);
+    block11.Receive(ADDR, tx3, 2, 0, 5);
+    block11.Connect(db);
+    CheckSummary(db, 35, 135, 3, 2);
+
+    // ConnectBlock runs again for the blocks after the coins best block when restarting after a crash
+    block11.Connect(db);
+    CheckSummary(db, 35, 135, 3, 2);
+
+    // An output created and spent within the same block
+    BlockChanges block12(12);
+    block12.Receive(ADDR, tx4, 1, 0, 7);
+    block12.Spend(ADDR, tx5, 2, 0, tx4, 0, 7, 12);
+    block12.Connect(db);
+    CheckSummary(db, 35, 142, 5, 2);
+    block12.Connect(db);
+    CheckSummary(db, 35, 142, 5, 2);
+
+    // Unspent outputs come back in height order, a page at a time
+    AddressUnspentVec unspent;
+    ASSERT_TRUE(db.ReadAddressUnspentPage(ADDR, TYPE, NULL, 1, unspent));
+    ASSERT_EQ(1, unspent.size());
+    EXPECT_EQ(tx2, unspent[0].first.txhash);
+    CAddressUnspentHeightKey cursor(unspent[0].first, unspent[0].second.blockHeight);
+    ASSERT_TRUE(db.ReadAddressUnspentPage(ADDR, TYPE, &cursor, 10, unspent));
+    ASSERT_EQ(2, unspent.size());
+    EXPECT_EQ(tx3, unspent[1].first.txhash);
+
+    // Deltas likewise, resuming after the last key seen
+    AddressIndexVec deltas;
+    ASSERT_TRUE(db.ReadAddressIndexPage(ADDR, TYPE, NULL, 2, deltas));
+    ASSERT_EQ(2, deltas.size());
+    EXPECT_EQ(10, deltas[0].first.blockHeight);
+    CAddressIndexKey after = deltas.back().first;
+    ASSERT_TRUE(db.ReadAddressIndexPage(ADDR, TYPE, &after, 0, deltas));
+    EXPECT_EQ(6, deltas.size());
+    after = deltas.back().first;
+    ASSERT_TRUE(db.ReadAddressIndexPage(ADDR, TYPE, &after, 0, deltas));
+    EXPECT_EQ(6, deltas.size());
+
+    block12.Disconnect(db);
+    CheckSummary(db, 35, 135, 3, 2);
+    block11.Disconnect(db);
+    CheckSummary(db, 100, 100, 1, 1);
+    unspent.clear();
+    ASSERT_TRUE(db.ReadAddressUnspentPage(ADDR, TYPE, NULL, 0, unspent));
+    ASSERT_EQ(1, unspent.size());
+    EXPECT_EQ(tx1, unspent[0].first.txhash);
+    block10.Disconnect(db);
+    CheckSummary(db, 0, 0, 0, 0);
+}
+
+TEST(TestAddressIndex, test_build_summary)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+    uint256 tx1 = uint256S("01"), tx2 = uint256S("02");
+
+    BlockChanges block10(10);
+    block10.Receive(ADDR, tx1, 1, 0, 100);
+    block10.Connect(db);
+    BlockChanges block11(11);
+    block11.Spend(ADDR, tx2, 1, 0, tx1, 0, 100, 10);
+    block11.Receive(ADDR, tx2, 1, 0, 30);
+    block11.Connect(db);
+
+    // Rebuilding from the address index gives the same totals as maintaining them
+    ASSERT_TRUE(db.BuildAddressSummaryIndex());
+    CheckSummary(db, 30, 130, 2, 1);
+    AddressUnspentVec unspent;
+    ASSERT_TRUE(db.ReadAddressUnspentPage(ADDR, TYPE, NULL, 0, unspent));
+    ASSERT_EQ(1, unspent.size());
+    EXPECT_EQ(11, unspent[0].second.blockHeight);
+}
+
+
+} /* namespace TestAddressIndex */
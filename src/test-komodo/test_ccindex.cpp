@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "cc/CCindex.h"
+
+#include <boost/foreach.hpp>
+
+
+namespace TestCCIndex {
+
+
+static void Commit(CCIndexDB &db, const CCIndexBatch &batch)
+{
+    CDBBatch dbbatch(db);
+    batch.WriteTo(dbbatch);
+    ASSERT_TRUE(db.WriteBatch(dbbatch));
+}
+
+/** What DisconnectCCIndexes does with the undo data of a block */
+static void Undo(CCIndexDB &db, const std::vector<CCIndexUndoEntry> &vUndo)
+{
+    CDBBatch dbbatch(db);
+    BOOST_FOREACH(const CCIndexUndoEntry &entry, vUndo) {
+        if (entry.fExists)
+            dbbatch.Write(CCIndexRaw(entry.key), CCIndexRaw(entry.value));
+        else
+            dbbatch.Erase(CCIndexRaw(entry.key));
+    }
+    ASSERT_TRUE(db.WriteBatch(dbbatch));
+}
+
+
+TEST(TestCCIndex, test_batch_reads_its_writes)
+{
+    CCIndexDB db(1 << 20, true, true);
+    ASSERT_TRUE(db.Write(std::make_pair('x', 1), std::string("one")));
+
+    CCIndexBatch batch(db);
+    std::string str;
+    ASSERT_TRUE(batch.Read(std::make_pair('x', 1), str));
+    EXPECT_EQ("one", str);
+    batch.Write(std::make_pair('x', 2), std::string("two"));
+    batch.Erase(std::make_pair('x', 1));
+    EXPECT_FALSE(batch.Exists(std::make_pair('x', 1)));
+    ASSERT_TRUE(batch.Read(std::make_pair('x', 2), str));
+    EXPECT_EQ("two", str);
+
+    // Nothing reaches the database before the batch is written
+    EXPECT_TRUE(db.Exists(std::make_pair('x', 1)));
+    EXPECT_FALSE(db.Exists(std::make_pair('x', 2)));
+    Commit(db, batch);
+    EXPECT_FALSE(db.Exists(std::make_pair('x', 1)));
+    ASSERT_TRUE(db.Read(std::make_pair('x', 2), str));
+    EXPECT_EQ("two", str);
+}
+
+TEST(TestCCIndex, test_undo_restores_records)
+{
+    CCIndexDB db(1 << 20, true, true);
+    ASSERT_TRUE(db.Write(std::make_pair('x', 1), std::string("one")));
+    ASSERT_TRUE(db.Write(std::make_pair('x', 3), std::string("three")));
+
+    // Records changed more than once in a block are undone to what they held before it
+    CCIndexBatch batch(db);
+    batch.Write(std::make_pair('x', 1), std::string("uno"));
+    batch.Write(std::make_pair('x', 1), std::string("eins"));
+    batch.Write(std::make_pair('x', 2), std::string("two"));
+    batch.Erase(std::make_pair('x', 2));
+    batch.Erase(std::make_pair('x', 3));
+    batch.Write(std::make_pair('x', 4), std::string("four"));
+    std::vector<CCIndexUndoEntry> vUndo = batch.GetUndo();
+    EXPECT_EQ(4, vUndo.size());
+    Commit(db, batch);
+
+    std::string str;
+    ASSERT_TRUE(db.Read(std::make_pair('x', 1), str));
+    EXPECT_EQ("eins", str);
+    EXPECT_FALSE(db.Exists(std::make_pair('x', 2)));
+    EXPECT_FALSE(db.Exists(std::make_pair('x', 3)));
+
+    // The undo data goes through the database like any record
+    ASSERT_TRUE(db.Write('U', vUndo));
+    std::vector<CCIndexUndoEntry> vRead;
+    ASSERT_TRUE(db.Read('U', vRead));
+    Undo(db, vRead);
+    ASSERT_TRUE(db.Read(std::make_pair('x', 1), str));
+    EXPECT_EQ("one", str);
+    ASSERT_TRUE(db.Read(std::make_pair('x', 3), str));
+    EXPECT_EQ("three", str);
+    EXPECT_FALSE(db.Exists(std::make_pair('x', 2)));
+    EXPECT_FALSE(db.Exists(std::make_pair('x', 4)));
+}
+
+
+} /* namespace TestCCIndex */
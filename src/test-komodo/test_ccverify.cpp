@@ -0,0 +1,163 @@
+#include <cryptoconditions.h>
+#include <gtest/gtest.h>
+
+#include "cc/CCinclude.h"
+#include "script/cc.h"
+#include "script/interpreter.h"
+#include "script/serverchecker.h"
+#include "utiltime.h"
+
+#include "testutils.h"
+
+
+namespace TestCCVerify {
+
+
+/** A checker that counts the evals it is asked for instead of running them */
+class EvalCountingChecker : public ServerTransactionSignatureChecker
+{
+public:
+    mutable int nEvals;
+    int fEvalValid;
+
+    EvalCountingChecker(const CTransaction* txToIn, bool storeIn, const PrecomputedTransactionData& txdataIn) :
+        ServerTransactionSignatureChecker(txToIn, 0, 0, storeIn, txdataIn), nEvals(0), fEvalValid(1) {}
+
+    int CheckEvalCondition(const CC *cond) const
+    {
+        nEvals++;
+        return fEvalValid;
+    }
+};
+
+
+class CCVerifyTest : public ::testing::Test {
+protected:
+    CPubKey pk, otherpk;
+
+    virtual void SetUp() {
+        ASSETCHAINS_CC = 1;
+        pk = notaryKey.GetPubKey();
+        CKey key;
+        key.MakeNewKey(true);
+        otherpk = key.GetPubKey();
+    }
+
+    /** A tx of its own spending cond, signed by the notary key */
+    CTransaction SignedTx(CC *cond)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        PrecomputedTransactionData txdata(mtx);
+        uint256 sighash = SignatureHash(CCPubKey(cond), mtx, 0, SIGHASH_ALL, 0, 0, &txdata);
+        cc_signTreeSecp256k1Msg32(cond, notaryKey.begin(), sighash.begin());
+        mtx.vin[0].scriptSig = CCSig(cond);
+        return CTransaction(mtx);
+    }
+
+    bool Verify(const CTransaction &tx, CC *cond, EvalCountingChecker &checker)
+    {
+        ScriptError error;
+        return VerifyScript(tx.vin[0].scriptSig, CCPubKey(cond), 0, checker, 0, &error);
+    }
+
+    std::vector<unsigned char> Fulfillment(CC *cond)
+    {
+        std::vector<unsigned char> ffill(1000);
+        ffill.resize(cc_fulfillmentBinary(cond, ffill.data(), ffill.size()));
+        return ffill;
+    }
+};
+
+
+TEST_F(CCVerifyTest, test_fast_decode_round_trips)
+{
+    CC *conds[] = { MakeCCcond1(EVAL_TOKENS, pk), MakeCCcond1of2(EVAL_TOKENS, pk, otherpk), MakeCCcond1of2(EVAL_TOKENS, otherpk, pk) };
+    for (int i = 0; i < 3; i++) {
+        SignedTx(conds[i]);
+        std::vector<unsigned char> ffill = Fulfillment(conds[i]);
+        CC *read = NULL;
+        ASSERT_EQ(0, cc_readFulfillmentBinaryExt(ffill.data(), ffill.size(), &read));
+        ASSERT_TRUE(read != NULL);
+        EXPECT_EQ(ffill, Fulfillment(read));
+        EXPECT_EQ(CCPubKey(conds[i]), CCPubKey(read));
+        EXPECT_EQ(cc_typeMask(conds[i]), cc_typeMask(read));
+        EXPECT_EQ(cc_getCost(conds[i]), cc_getCost(read));
+        cc_free(read);
+
+        // The same with a length that isn't minimal, which DER doesn't allow
+        std::vector<unsigned char> longForm(ffill);
+        if (longForm[1] < 0x80) {
+            longForm.insert(longForm.begin() + 1, 0x81);
+            read = NULL;
+            EXPECT_NE(0, cc_readFulfillmentBinaryExt(longForm.data(), longForm.size(), &read));
+        }
+        cc_free(conds[i]);
+    }
+}
+
+TEST_F(CCVerifyTest, test_cached_fulfillment_still_evals)
+{
+    CC *cond = MakeCCcond1of2(EVAL_TOKENS, pk, otherpk);
+    CTransaction tx = SignedTx(cond);
+    PrecomputedTransactionData txdata(tx);
+    EvalCountingChecker checker(&tx, true, txdata);
+
+    ASSERT_TRUE(Verify(tx, cond, checker));
+    ASSERT_TRUE(Verify(tx, cond, checker));
+    EXPECT_EQ(2, checker.nEvals);
+    checker.fEvalValid = 0;
+    EXPECT_FALSE(Verify(tx, cond, checker));
+
+    // A bad signature fails every time, it is never taken in
+    CMutableTransaction mtx(tx);
+    mtx.vin[0].prevout.n = 1;
+    CTransaction other(mtx);
+    PrecomputedTransactionData otherdata(other);
+    EvalCountingChecker otherchecker(&other, true, otherdata);
+    EXPECT_FALSE(Verify(other, cond, otherchecker));
+    EXPECT_FALSE(Verify(other, cond, otherchecker));
+    EXPECT_EQ(0, otherchecker.nEvals);
+    cc_free(cond);
+}
+
+TEST_F(CCVerifyTest, bench_decode_and_verify)
+{
+    const int N = 200;
+    CC *cond = MakeCCcond1of2(EVAL_TOKENS, pk, otherpk);
+    CC *tokensCond = MakeTokensCCcond1of2(EVAL_ASSETS, pk, otherpk);
+    CTransaction tx = SignedTx(cond);
+    SignedTx(tokensCond);
+    std::vector<unsigned char> ffill = Fulfillment(cond), tokensFfill = Fulfillment(tokensCond);
+
+    // The 1of2 takes the fast path, the tokens 1of2 with its two evals the ASN.1 decoder
+    int64_t nStart = GetTimeMicros();
+    for (int i = 0; i < N; i++)
+        cc_free(cc_readFulfillmentBinary(ffill.data(), ffill.size()));
+    int64_t nFast = GetTimeMicros() - nStart;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < N; i++)
+        cc_free(cc_readFulfillmentBinary(tokensFfill.data(), tokensFfill.size()));
+    int64_t nAsn = GetTimeMicros() - nStart;
+
+    PrecomputedTransactionData txdata(tx);
+    EvalCountingChecker uncached(&tx, false, txdata), cached(&tx, true, txdata);
+    nStart = GetTimeMicros();
+    for (int i = 0; i < N; i++)
+        ASSERT_TRUE(Verify(tx, cond, uncached));
+    int64_t nUncached = GetTimeMicros() - nStart;
+    ASSERT_TRUE(Verify(tx, cond, cached));
+    nStart = GetTimeMicros();
+    for (int i = 0; i < N; i++)
+        ASSERT_TRUE(Verify(tx, cond, cached));
+    int64_t nCached = GetTimeMicros() - nStart;
+    EXPECT_EQ(N + 1, cached.nEvals);
+
+    printf("decode: fast %.2fus asn.1 %.2fus, verify: uncached %.2fus cached %.2fus\n",
+           (double)nFast / N, (double)nAsn / N, (double)nUncached / N, (double)nCached / N);
+    cc_free(cond);
+    cc_free(tokensCond);
+}
+
+
+} /* namespace TestCCVerify */
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "chainsnapshot.h"
+
+
+namespace TestChainSnapshot {
+
+
+TEST(TestChainSnapshot, test_publish_and_lookup)
+{
+    std::vector<CBlockIndex> chain(10);
+    for (size_t i = 0; i < chain.size(); i++) {
+        chain[i].SetHeight(i);
+        chain[i].pprev = i ? &chain[i - 1] : NULL;
+        chain[i].BuildSkip();
+    }
+
+    CChainSnapshot snapshot;
+    snapshot.pindexTip = &chain[5];
+    snapshot.nHeight = 5;
+    snapshot.nNotarizedHeight = 3;
+    PublishChainSnapshot(snapshot);
+
+    CChainSnapshotRef before = GetChainSnapshot();
+    EXPECT_EQ(5, before->nHeight);
+    EXPECT_EQ(&chain[2], (*before)[2]);
+    EXPECT_EQ(&chain[5], (*before)[5]);
+    EXPECT_TRUE((*before)[6] == NULL);
+    EXPECT_TRUE((*before)[-1] == NULL);
+
+    // A reader keeps its view while the tip moves on
+    snapshot.pindexTip = &chain[9];
+    snapshot.nHeight = 9;
+    PublishChainSnapshot(snapshot);
+    EXPECT_EQ(5, before->nHeight);
+    EXPECT_EQ(3, before->nNotarizedHeight);
+    EXPECT_EQ(9, GetChainSnapshot()->nHeight);
+    EXPECT_EQ(&chain[7], (*GetChainSnapshot())[7]);
+
+    PublishChainSnapshot(CChainSnapshot());
+    EXPECT_EQ(-1, GetChainSnapshot()->nHeight);
+    EXPECT_TRUE((*GetChainSnapshot())[0] == NULL);
+}
+
+
+} /* namespace TestChainSnapshot */
@@ -0,0 +1,164 @@
+#include <cryptoconditions.h>
+#include <gtest/gtest.h>
+
+#include "cc/CCchannels.h"
+#include "chain.h"
+#include "script/cc.h"
+#include "txmempool.h"
+
+#include "testutils.h"
+
+#include <boost/foreach.hpp>
+
+
+namespace TestChannelsIndex {
+
+
+class ChannelsIndexTest : public CCIndexTest {
+protected:
+    CPubKey srcpk, destpk;
+
+    virtual void SetUp() {
+        CCIndexTest::SetUp();
+        srcpk = notaryKey.GetPubKey();
+        CKey key;
+        key.MakeNewKey(true);
+        destpk = key.GetPubKey();
+    }
+
+    CTransaction MakeOpenTx(int32_t numpayments, int64_t payment, const uint256 &hashchain)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        mtx.vout.push_back(MakeCC1of2vout(EVAL_CHANNELS, numpayments * payment, srcpk, destpk));
+        mtx.vout.push_back(MakeCC1vout(EVAL_CHANNELS, 10000, srcpk));
+        mtx.vout.push_back(MakeCC1vout(EVAL_CHANNELS, 10000, destpk));
+        mtx.vout.push_back(CTxOut(0, EncodeChannelsOpRet('O', zeroid, zeroid, srcpk, destpk, numpayments, payment, hashchain)));
+        return CTransaction(mtx);
+    }
+
+    /** A payment spending the funds and the sender marker of prevtxid */
+    CTransaction MakePaymentTx(const uint256 &opentxid, const uint256 &prevtxid, int64_t funds, int32_t depth, int32_t numpayments, int64_t payment, const uint256 &secret)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        CC *cond = MakeCCcond1of2(EVAL_CHANNELS, srcpk, destpk);
+        cc_signTreeSecp256k1Msg32(cond, notaryKey.begin(), GetRandHash().begin());
+        mtx.vin.push_back(CTxIn(prevtxid, 0, CCSig(cond)));
+        mtx.vin.push_back(CTxIn(prevtxid, 1, CCSig(cond)));
+        cc_free(cond);
+        mtx.vout.push_back(MakeCC1of2vout(EVAL_CHANNELS, funds - numpayments * payment, srcpk, destpk));
+        mtx.vout.push_back(MakeCC1vout(EVAL_CHANNELS, 10000, srcpk));
+        mtx.vout.push_back(MakeCC1vout(EVAL_CHANNELS, 10000, destpk));
+        mtx.vout.push_back(CTxOut(numpayments * payment, CScript() << ParseHex(HexStr(destpk)) << OP_CHECKSIG));
+        mtx.vout.push_back(CTxOut(0, EncodeChannelsOpRet('P', zeroid, opentxid, srcpk, destpk, depth, numpayments, secret)));
+        return CTransaction(mtx);
+    }
+
+    CChannelState State(const uint256 &opentxid, bool fMempool)
+    {
+        CChannelState state;
+        bool fFound = false;
+        EXPECT_TRUE(GetChannelState(opentxid, fMempool, state, fFound));
+        EXPECT_TRUE(fFound);
+        return state;
+    }
+};
+
+
+TEST_F(ChannelsIndexTest, test_state_follows_payments)
+{
+    uint256 hashchain = GetRandHash(), secret1 = GetRandHash(), secret2 = GetRandHash();
+    CTransaction openTx = MakeOpenTx(10, 1000, hashchain);
+    uint256 opentxid = openTx.GetHash();
+    ConnectBlock(openTx);
+    ASSERT_TRUE(IsCCIndexReady());
+
+    CChannelState state = State(opentxid, false);
+    EXPECT_EQ(srcpk, state.srcpub);
+    EXPECT_EQ(destpk, state.destpub);
+    EXPECT_EQ(10, state.numpayments);
+    EXPECT_EQ(1000, state.payment);
+    EXPECT_EQ(opentxid, state.txid);
+    EXPECT_EQ('O', state.funcid);
+    EXPECT_EQ(10, state.depth);
+    EXPECT_EQ(hashchain, state.secret);
+    EXPECT_EQ(10000, state.nFunds);
+
+    CTransaction payTx1 = MakePaymentTx(opentxid, opentxid, 10000, 7, 3, 1000, secret1);
+    ConnectBlock(payTx1);
+    CTransaction payTx2 = MakePaymentTx(opentxid, payTx1.GetHash(), 7000, 5, 2, 1000, secret2);
+    ConnectBlock(payTx2);
+    state = State(opentxid, false);
+    EXPECT_EQ(payTx2.GetHash(), state.txid);
+    EXPECT_EQ(5, state.depth);
+    EXPECT_EQ(secret2, state.secret);
+    EXPECT_EQ(5000, state.nFunds);
+
+    std::vector<CChannelTx> txs;
+    ASSERT_TRUE(GetChannelTxs(opentxid, false, txs));
+    ASSERT_EQ(3, txs.size());
+    EXPECT_EQ(opentxid, txs[0].txid);
+    EXPECT_EQ(payTx1.GetHash(), txs[1].txid);
+    EXPECT_EQ(3, txs[1].param2);
+    EXPECT_EQ(payTx2.GetHash(), txs[2].txid);
+    char destaddr[64];
+    Getscriptaddress(destaddr, payTx2.vout[3].scriptPubKey);
+    EXPECT_EQ(destaddr, txs[2].destaddr);
+
+    DisconnectBlock();
+    state = State(opentxid, false);
+    EXPECT_EQ(payTx1.GetHash(), state.txid);
+    EXPECT_EQ(7, state.depth);
+    EXPECT_EQ(secret1, state.secret);
+    ASSERT_TRUE(GetChannelTxs(opentxid, false, txs));
+    EXPECT_EQ(2, txs.size());
+}
+
+TEST_F(ChannelsIndexTest, test_stray_payment_not_taken)
+{
+    CTransaction openTx = MakeOpenTx(10, 1000, GetRandHash());
+    uint256 opentxid = openTx.GetHash();
+    ConnectBlock(openTx);
+    // Not spending the funds of the channel's last tx
+    ConnectBlock(MakePaymentTx(opentxid, GetRandHash(), 10000, 9, 1, 1000, GetRandHash()));
+    CChannelState state = State(opentxid, false);
+    EXPECT_EQ(opentxid, state.txid);
+    EXPECT_EQ(10, state.depth);
+}
+
+TEST_F(ChannelsIndexTest, test_mempool_payments_chain_on)
+{
+    CTransaction openTx = MakeOpenTx(10, 1000, GetRandHash());
+    uint256 opentxid = openTx.GetHash();
+    ConnectBlock(openTx);
+
+    CTransaction payTx1 = MakePaymentTx(opentxid, opentxid, 10000, 9, 1, 1000, GetRandHash());
+    CTransaction payTx2 = MakePaymentTx(opentxid, payTx1.GetHash(), 9000, 8, 1, 1000, GetRandHash());
+    std::vector<CTransaction> vtx;
+    vtx.push_back(payTx1);
+    vtx.push_back(payTx2);
+    BOOST_FOREACH(const CTransaction &tx, vtx) {
+        mempool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 0, true, false, 0));
+        AddCCIndexesMempoolTx(tx);
+    }
+
+    CChannelState state = State(opentxid, true);
+    EXPECT_EQ(payTx2.GetHash(), state.txid);
+    EXPECT_EQ(8, state.depth);
+    EXPECT_EQ(8000, state.nFunds);
+    EXPECT_EQ(opentxid, State(opentxid, false).txid);
+    std::vector<CChannelTx> txs;
+    ASSERT_TRUE(GetChannelTxs(opentxid, true, txs));
+    EXPECT_EQ(3, txs.size());
+
+    // Once the mempool lets go of the payments, they are no longer followed
+    std::list<CTransaction> removed;
+    mempool.remove(payTx1, removed, true);
+    state = State(opentxid, true);
+    EXPECT_EQ(opentxid, state.txid);
+    EXPECT_EQ(10, state.depth);
+}
+
+
+} /* namespace TestChannelsIndex */
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include "coins.h"
+#include "txdb.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+namespace TestCoinsFlush {
+
+
+/** In-memory coins view whose BatchWrite blocks until it is released */
+class GatedCoinsView : public CCoinsView
+{
+public:
+    mutable boost::mutex cs;
+    boost::condition_variable cond;
+    bool fOpen;
+    bool fFail;
+    std::map<uint256, CCoins> mapCoins;
+    uint256 hashBestBlock;
+
+    GatedCoinsView() : fOpen(false), fFail(false) {}
+
+    void Open()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fOpen = true;
+        cond.notify_all();
+    }
+
+    bool GetCoins(const uint256 &txid, CCoins &coins) const
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        std::map<uint256, CCoins>::const_iterator it = mapCoins.find(txid);
+        if (it == mapCoins.end())
+            return false;
+        coins = it->second;
+        return true;
+    }
+
+    bool HaveCoins(const uint256 &txid) const
+    {
+        CCoins coins;
+        return GetCoins(txid, coins);
+    }
+
+    uint256 GetBestBlock() const
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return hashBestBlock;
+    }
+
+    bool BatchWrite(CCoinsMap &mapCoinsIn,
+                    const uint256 &hashBlock,
+                    const uint256 &hashSproutAnchor,
+                    const uint256 &hashSaplingAnchor,
+                    CAnchorsSproutMap &mapSproutAnchors,
+                    CAnchorsSaplingMap &mapSaplingAnchors,
+                    CNullifiersMap &mapSproutNullifiers,
+                    CNullifiersMap &mapSaplingNullifiers)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (!fOpen)
+            cond.wait(lock);
+        if (fFail)
+            return false;
+        for (CCoinsMap::iterator it = mapCoinsIn.begin(); it != mapCoinsIn.end(); ++it) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+                if (it->second.coins.IsPruned())
+                    mapCoins.erase(it->first);
+                else
+                    mapCoins[it->first] = it->second.coins;
+            }
+        }
+        if (!hashBlock.IsNull())
+            hashBestBlock = hashBlock;
+        return true;
+    }
+};
+
+static void AddCoin(CCoinsViewCache &cache, const uint256 &txid, CAmount nValue)
+{
+    CCoinsModifier coins = cache.ModifyCoins(txid);
+    coins->nHeight = 1;
+    coins->vout.resize(1);
+    coins->vout[0].nValue = nValue;
+    coins->vout[0].scriptPubKey = CScript() << OP_TRUE;
+}
+
+
+TEST(TestCoinsFlush, test_reads_during_write)
+{
+    GatedCoinsView base;
+    CCoinsViewFlushBuffer buffer(&base);
+    uint256 txid = uint256S("01"), hashBlock = uint256S("02");
+    CCoins coins;
+
+    {
+        CCoinsViewCache cache(&buffer);
+        AddCoin(cache, txid, 5);
+        cache.SetBestBlock(hashBlock);
+        ASSERT_TRUE(cache.Flush());
+    }
+
+    // The write is held back, so the coin is only in the buffer
+    EXPECT_FALSE(base.HaveCoins(txid));
+    ASSERT_TRUE(buffer.GetCoins(txid, coins));
+    EXPECT_EQ(5, coins.vout[0].nValue);
+    EXPECT_EQ(hashBlock, buffer.GetBestBlock());
+    EXPECT_EQ(1, buffer.GetFlushStats().nQueued);
+
+    base.Open();
+    ASSERT_TRUE(buffer.WaitForFlush());
+    EXPECT_TRUE(base.HaveCoins(txid));
+    EXPECT_EQ(hashBlock, base.GetBestBlock());
+    EXPECT_EQ(0, buffer.GetFlushStats().nQueued);
+    EXPECT_EQ(1, buffer.GetFlushStats().nFlushes);
+
+    // Spending the coin erases it from the base
+    {
+        CCoinsViewCache cache(&buffer);
+        cache.ModifyCoins(txid)->Clear();
+        ASSERT_TRUE(cache.Flush());
+    }
+    ASSERT_TRUE(buffer.WaitForFlush());
+    EXPECT_FALSE(buffer.HaveCoins(txid));
+    EXPECT_FALSE(base.HaveCoins(txid));
+}
+
+TEST(TestCoinsFlush, test_write_failure)
+{
+    GatedCoinsView base;
+    base.fFail = true;
+    base.Open();
+    CCoinsViewFlushBuffer buffer(&base);
+    uint256 txid = uint256S("01");
+
+    CCoinsViewCache cache(&buffer);
+    AddCoin(cache, txid, 5);
+    ASSERT_TRUE(cache.Flush());
+    EXPECT_FALSE(buffer.WaitForFlush());
+    // The failed batch still answers reads, and later flushes report the failure
+    EXPECT_TRUE(buffer.HaveCoins(txid));
+    AddCoin(cache, uint256S("03"), 6);
+    EXPECT_FALSE(cache.Flush());
+}
+
+
+} /* namespace TestCoinsFlush */
@@ -0,0 +1,188 @@
+#include <cryptoconditions.h>
+#include <gtest/gtest.h>
+
+#include "cc/CCGateways.h"
+#include "chain.h"
+#include "script/cc.h"
+
+#include "testutils.h"
+
+
+namespace TestGatewaysIndex {
+
+
+class GatewaysIndexTest : public CCIndexTest {
+protected:
+    CPubKey pk, gatewayspk;
+    uint256 bindtxid, tokenid;
+    struct CCcontract_info *cp, C;
+
+    virtual void SetUp() {
+        CCIndexTest::SetUp();
+        pk = notaryKey.GetPubKey();
+        cp = CCinit(&C, EVAL_GATEWAYS);
+        gatewayspk = GetUnspendable(cp, 0);
+        bindtxid = GetRandHash();
+        tokenid = GetRandHash();
+    }
+
+    /** A tx spending the marker of prevtxid, or a coin if it is null */
+    CMutableTransaction MakeTx(const uint256 &prevtxid)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        if (!prevtxid.IsNull()) {
+            CC *cond = MakeCCcond1(EVAL_GATEWAYS, gatewayspk);
+            cc_signTreeSecp256k1Msg32(cond, notaryKey.begin(), GetRandHash().begin());
+            mtx.vin.push_back(CTxIn(prevtxid, 0, CCSig(cond)));
+            cc_free(cond);
+        }
+        return mtx;
+    }
+
+    CTransaction MakeDepositTx(const uint256 &cointxid, int64_t amount)
+    {
+        char txidaddr[64];
+        CMutableTransaction mtx = MakeTx(uint256());
+        mtx.vout.push_back(MakeCC1vout(EVAL_GATEWAYS, 10000, pk));
+        mtx.vout.push_back(CTxOut(10000, CScript() << ParseHex(HexStr(CCtxidaddr(txidaddr, cointxid))) << OP_CHECKSIG));
+        mtx.vout.push_back(CTxOut(0, EncodeGatewaysDepositOpRet('D', bindtxid, "KMD", std::vector<CPubKey>(), std::vector<uint256>(),
+                                                                 100, cointxid, 0, "", std::vector<uint8_t>(), pk, amount)));
+        return CTransaction(mtx);
+    }
+
+    CTransaction MakeWithdrawTx(int64_t amount)
+    {
+        CMutableTransaction mtx = MakeTx(uint256());
+        mtx.vout.push_back(MakeCC1vout(EVAL_GATEWAYS, 10000, gatewayspk));
+        mtx.vout.push_back(MakeTokensCC1vout(EVAL_GATEWAYS, amount, gatewayspk));
+        mtx.vout.push_back(CTxOut(0, EncodeGatewaysWithdrawOpRet('W', tokenid, bindtxid, "KMD", pk, amount)));
+        return CTransaction(mtx);
+    }
+
+    CTransaction MakeSignTx(const uint256 &prevtxid, const uint256 &withdrawtxid, uint8_t K, bool fComplete)
+    {
+        CMutableTransaction mtx = MakeTx(prevtxid);
+        mtx.vout.push_back(MakeCC1vout(EVAL_GATEWAYS, 10000, gatewayspk));
+        if (fComplete)
+            mtx.vout.push_back(CTxOut(0, EncodeGatewaysCompleteSigningOpRet('S', withdrawtxid, "KMD", K, "abcd")));
+        else
+            mtx.vout.push_back(CTxOut(0, EncodeGatewaysPartialOpRet('P', withdrawtxid, "KMD", K, pk, "ab")));
+        return CTransaction(mtx);
+    }
+
+    std::vector<CGatewaysWithdraw> Withdraws()
+    {
+        std::vector<CGatewaysWithdraw> withdraws;
+        EXPECT_TRUE(GetGatewaysWithdraws(bindtxid, withdraws));
+        return withdraws;
+    }
+};
+
+
+TEST_F(GatewaysIndexTest, test_deposit_until_claimed)
+{
+    uint256 cointxid = GetRandHash();
+    CTransaction depositTx = MakeDepositTx(cointxid, 5000);
+    ConnectBlock(depositTx);
+    ASSERT_TRUE(IsCCIndexReady());
+
+    std::vector<CGatewaysDeposit> deposits;
+    ASSERT_TRUE(GetGatewaysDeposits(bindtxid, deposits));
+    ASSERT_EQ(1, deposits.size());
+    EXPECT_EQ(depositTx.GetHash(), deposits[0].deposittxid);
+    EXPECT_EQ(cointxid, deposits[0].cointxid);
+    EXPECT_EQ(pk, deposits[0].destpub);
+    EXPECT_EQ(5000, deposits[0].amount);
+    char coinaddr[64];
+    _GetCCaddress(coinaddr, EVAL_GATEWAYS, pk);
+    EXPECT_EQ(coinaddr, deposits[0].markeraddr);
+
+    uint256 deposittxid;
+    bool fFound = false;
+    ASSERT_TRUE(GetGatewaysCointxidDeposit(cointxid, deposittxid, fFound));
+    ASSERT_TRUE(fFound);
+    EXPECT_EQ(depositTx.GetHash(), deposittxid);
+
+    // The claim spends the marker; the coin tx stays deposited
+    CMutableTransaction claim = MakeTx(depositTx.GetHash());
+    claim.vout.push_back(MakeCC1vout(EVAL_TOKENS, 5000, pk));
+    claim.vout.push_back(CTxOut(0, CScript() << OP_RETURN));
+    ConnectBlock(CTransaction(claim));
+    ASSERT_TRUE(GetGatewaysDeposits(bindtxid, deposits));
+    EXPECT_TRUE(deposits.empty());
+    ASSERT_TRUE(GetGatewaysCointxidDeposit(cointxid, deposittxid, fFound));
+    EXPECT_TRUE(fFound);
+
+    DisconnectBlock();
+    ASSERT_TRUE(GetGatewaysDeposits(bindtxid, deposits));
+    EXPECT_EQ(1, deposits.size());
+    DisconnectBlock();
+    ASSERT_TRUE(GetGatewaysDeposits(bindtxid, deposits));
+    EXPECT_TRUE(deposits.empty());
+    ASSERT_TRUE(GetGatewaysCointxidDeposit(cointxid, deposittxid, fFound));
+    EXPECT_FALSE(fFound);
+}
+
+TEST_F(GatewaysIndexTest, test_withdraw_follows_its_marker)
+{
+    CTransaction withdrawTx = MakeWithdrawTx(3000);
+    uint256 withdrawtxid = withdrawTx.GetHash();
+    ConnectBlock(withdrawTx);
+    std::vector<CGatewaysWithdraw> withdraws = Withdraws();
+    ASSERT_EQ(1, withdraws.size());
+    EXPECT_EQ(withdrawtxid, withdraws[0].withdrawtxid);
+    EXPECT_EQ(withdrawtxid, withdraws[0].lasttxid);
+    EXPECT_EQ(tokenid, withdraws[0].tokenid);
+    EXPECT_EQ("KMD", withdraws[0].coin);
+    EXPECT_EQ(3000, withdraws[0].amount);
+    EXPECT_EQ(0, withdraws[0].K);
+    EXPECT_FALSE(withdraws[0].fComplete);
+
+    CTransaction partialTx = MakeSignTx(withdrawtxid, withdrawtxid, 1, false);
+    ConnectBlock(partialTx);
+    withdraws = Withdraws();
+    ASSERT_EQ(1, withdraws.size());
+    EXPECT_EQ(partialTx.GetHash(), withdraws[0].lasttxid);
+    EXPECT_EQ(1, withdraws[0].K);
+    EXPECT_EQ("ab", withdraws[0].hex);
+    EXPECT_FALSE(withdraws[0].fComplete);
+
+    CTransaction completeTx = MakeSignTx(partialTx.GetHash(), withdrawtxid, 2, true);
+    ConnectBlock(completeTx);
+    withdraws = Withdraws();
+    ASSERT_EQ(1, withdraws.size());
+    EXPECT_EQ(completeTx.GetHash(), withdraws[0].lasttxid);
+    EXPECT_EQ("abcd", withdraws[0].hex);
+    EXPECT_TRUE(withdraws[0].fComplete);
+
+    // Marking it done spends the last marker
+    CMutableTransaction markdone = MakeTx(completeTx.GetHash());
+    markdone.vin.erase(markdone.vin.begin());
+    markdone.vout.push_back(CTxOut(0, EncodeGatewaysMarkDoneOpRet('M', withdrawtxid, "KMD", completeTx.GetHash())));
+    ConnectBlock(CTransaction(markdone));
+    EXPECT_TRUE(Withdraws().empty());
+
+    DisconnectBlock();
+    withdraws = Withdraws();
+    ASSERT_EQ(1, withdraws.size());
+    EXPECT_TRUE(withdraws[0].fComplete);
+    DisconnectBlock();
+    withdraws = Withdraws();
+    ASSERT_EQ(1, withdraws.size());
+    EXPECT_EQ(partialTx.GetHash(), withdraws[0].lasttxid);
+}
+
+TEST_F(GatewaysIndexTest, test_stray_signing_not_taken)
+{
+    // A partialsign of a withdraw whose marker it doesn't spend
+    CTransaction withdrawTx = MakeWithdrawTx(3000);
+    ConnectBlock(withdrawTx);
+    ConnectBlock(MakeSignTx(GetRandHash(), withdrawTx.GetHash(), 1, false));
+    std::vector<CGatewaysWithdraw> withdraws = Withdraws();
+    ASSERT_EQ(1, withdraws.size());
+    EXPECT_EQ(withdrawTx.GetHash(), withdraws[0].lasttxid);
+}
+
+
+} /* namespace TestGatewaysIndex */
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "rpc/jsonwriter.h"
+
+#include <boost/bind.hpp>
+
+
+namespace TestJSONWriter {
+
+
+/** Writes the same value through any writer: nested containers, escapes and every kind of token */
+static void WriteSample(CJSONWriter &out, size_t nElements)
+{
+    out.BeginObject();
+    out.PushKV("str", "quote\" backslash\\ tab\t newline\n ctrl\x01 del\x7f utf8\xc3\xa9");
+    out.PushKVInt("int", -42);
+    out.PushKVInt("big", 9223372036854775807LL);
+    out.PushKVBool("yes", true);
+    out.PushKVBool("no", false);
+    out.PushKVAmount("amount", 1234567890123LL);
+    out.PushKVAmount("negative", -5);
+    out.Key("double");
+    out.Double(1.0 / 3);
+    out.Key("null");
+    out.Null();
+    out.Key("empty");
+    out.BeginArray();
+    out.EndArray();
+    out.Key("list");
+    out.BeginArray();
+    for (size_t i = 0; i < nElements; i++) {
+        out.BeginObject();
+        out.PushKVInt("n", i);
+        out.Key("inner");
+        out.BeginArray();
+        out.String("a");
+        out.Int(i);
+        out.EndArray();
+        out.EndObject();
+    }
+    out.EndArray();
+
+    UniValue small(UniValue::VARR);
+    small.push_back("x");
+    small.push_back(1);
+    UniValue large(UniValue::VOBJ);
+    for (size_t i = 0; i < 100; i++)
+        large.push_back(Pair("k" + std::to_string(i), small));
+    out.PushKV("small", small);
+    out.PushKV("large", large);
+    out.EndObject();
+}
+
+
+TEST(TestJSONWriter, test_text_matches_univalue)
+{
+    UniValue value;
+    CJSONValueWriter valueWriter(value);
+    WriteSample(valueWriter, 200);
+
+    CJSONTextWriter textWriter;
+    WriteSample(textWriter, 200);
+
+    EXPECT_EQ(value.write(), textWriter.str());
+    UniValue parsed;
+    ASSERT_TRUE(parsed.read(textWriter.str()));
+    EXPECT_EQ("12345.67890123", parsed["amount"].getValStr());
+    EXPECT_EQ("-0.00000005", parsed["negative"].getValStr());
+}
+
+static void Append(std::string *pstr, size_t *pnFlushes, const std::string &str)
+{
+    *pstr += str;
+    (*pnFlushes)++;
+}
+
+TEST(TestJSONWriter, test_flush_in_pieces)
+{
+    CJSONTextWriter whole;
+    WriteSample(whole, 1000);
+
+    std::string str;
+    size_t nFlushes = 0;
+    CJSONTextWriter pieces(boost::bind(&Append, &str, &nFlushes, _1), 1024);
+    WriteSample(pieces, 1000);
+    pieces.Flush();
+
+    EXPECT_EQ(whole.str(), str);
+    EXPECT_TRUE(pieces.str().empty());
+    EXPECT_GT(nFlushes, 10);
+}
+
+TEST(TestJSONWriter, test_value_writer_appends_to_object)
+{
+    // The UniValue wrappers of the RPC helpers add fields to an object the caller started
+    UniValue entry(UniValue::VOBJ);
+    entry.push_back(Pair("hex", "00"));
+    CJSONValueWriter writer(entry);
+    writer.PushKV("txid", "ab");
+    writer.Key("vin");
+    writer.BeginArray();
+    writer.BeginObject();
+    writer.PushKVInt("vout", 1);
+    writer.EndObject();
+    writer.EndArray();
+
+    EXPECT_EQ("{\"hex\":\"00\",\"txid\":\"ab\",\"vin\":[{\"vout\":1}]}", entry.write());
+}
+
+
+} /* namespace TestJSONWriter */
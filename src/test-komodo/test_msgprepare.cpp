@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "hash.h"
+#include "main.h"
+#include "msgprepare.h"
+
+
+namespace TestMsgPrepare {
+
+
+static unsigned int Checksum(const CDataStream &payload)
+{
+    uint256 hash = Hash(payload.begin(), payload.end());
+    return ReadLE32((unsigned char*)&hash);
+}
+
+static CTransaction SampleTx()
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(uint256S("01"), 2);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 5;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    return CTransaction(mtx);
+}
+
+
+TEST(TestMsgPrepare, test_tx)
+{
+    CTransaction tx = SampleTx();
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    payload << tx;
+
+    CPreparedMessage prepared("tx", Checksum(payload), SER_NETWORK, PROTOCOL_VERSION);
+    prepared.vRecv = payload;
+    EXPECT_FALSE(prepared.IsReady());
+    prepared.Prepare();
+    ASSERT_TRUE(prepared.IsReady());
+    EXPECT_EQ(Checksum(payload), prepared.nChecksum);
+    EXPECT_NO_THROW(prepared.ThrowIfFailed());
+    EXPECT_EQ(tx.GetHash(), prepared.tx.GetHash());
+}
+
+TEST(TestMsgPrepare, test_bad_checksum)
+{
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    payload << SampleTx();
+
+    // The handler rejects the message on the checksum, so the payload is left alone
+    CPreparedMessage prepared("tx", Checksum(payload) + 1, SER_NETWORK, PROTOCOL_VERSION);
+    prepared.vRecv = payload;
+    prepared.Prepare();
+    ASSERT_TRUE(prepared.IsReady());
+    EXPECT_NE(Checksum(payload) + 1, prepared.nChecksum);
+    EXPECT_TRUE(prepared.tx.IsNull());
+    EXPECT_EQ(payload.size(), prepared.vRecv.size());
+}
+
+TEST(TestMsgPrepare, test_truncated)
+{
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    payload << SampleTx();
+    payload.resize(payload.size() - 4);
+
+    // ProcessMessages turns the failure into a reject, as when it deserializes the tx itself
+    CPreparedMessage prepared("tx", Checksum(payload), SER_NETWORK, PROTOCOL_VERSION);
+    prepared.vRecv = payload;
+    prepared.Prepare();
+    ASSERT_TRUE(prepared.IsReady());
+    EXPECT_THROW(prepared.ThrowIfFailed(), std::ios_base::failure);
+}
+
+TEST(TestMsgPrepare, test_too_many_headers)
+{
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(payload, MAX_HEADERS_RESULTS + 1);
+
+    // Only the count is read, for the handler to punish the peer
+    CPreparedMessage prepared("headers", Checksum(payload), SER_NETWORK, PROTOCOL_VERSION);
+    prepared.vRecv = payload;
+    prepared.Prepare();
+    EXPECT_NO_THROW(prepared.ThrowIfFailed());
+    EXPECT_EQ(MAX_HEADERS_RESULTS + 1, prepared.nHeaders);
+    EXPECT_TRUE(prepared.vHeaders.empty());
+}
+
+TEST(TestMsgPrepare, test_stream_swap)
+{
+    CDataStream a(SER_NETWORK, PROTOCOL_VERSION), b(SER_DISK, 1);
+    a << 1 << 2;
+    int n;
+    a >> n;
+    a.swap(b);
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(SER_DISK, a.GetType());
+    EXPECT_EQ(4, b.size());
+    EXPECT_EQ(PROTOCOL_VERSION, b.GetVersion());
+    b >> n;
+    EXPECT_EQ(2, n);
+}
+
+
+} /* namespace TestMsgPrepare */
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "net.h"
+
+#ifdef USE_EPOLL
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+namespace TestNetPoll {
+
+
+class TestNetPoll : public ::testing::Test {
+protected:
+    int hPoll;
+    int sockets[2];
+
+    virtual void SetUp() {
+        hPoll = epoll_create1(EPOLL_CLOEXEC);
+        ASSERT_NE(-1, hPoll);
+        SetSocketPoll(hPoll);
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    }
+
+    virtual void TearDown() {
+        SetSocketPoll(INVALID_SOCKET);
+        close(hPoll);
+        close(sockets[1]);
+    }
+
+    int Wait(struct epoll_event* events) {
+        return epoll_wait(hPoll, events, 4, 0);
+    }
+};
+
+
+TEST_F(TestNetPoll, test_events_carry_node_id)
+{
+    CNode node(sockets[0], CAddress(), "", true);
+    ASSERT_TRUE(RegisterNodeSocket(&node));
+    EXPECT_TRUE(node.fPollRegistered);
+
+    // A new socket has room to send
+    struct epoll_event events[4];
+    ASSERT_EQ(1, Wait(events));
+    EXPECT_EQ((uint64_t)node.GetId(), events[0].data.u64);
+    EXPECT_TRUE(events[0].events & EPOLLOUT);
+}
+
+TEST_F(TestNetPoll, test_disconnect_while_registered)
+{
+    CNode node(sockets[0], CAddress(), "", true);
+    ASSERT_TRUE(RegisterNodeSocket(&node));
+    struct epoll_event events[4];
+    ASSERT_EQ(1, Wait(events));
+
+    // A duplicate keeps the socket open past the close, as a forked child's would
+    int hDup = dup(sockets[0]);
+    ASSERT_NE(-1, hDup);
+
+    node.CloseSocketDisconnect();
+    EXPECT_TRUE(node.fDisconnect);
+    EXPECT_FALSE(node.fPollRegistered);
+    EXPECT_EQ(INVALID_SOCKET, node.hSocket);
+
+    // Still in the set, the socket would report this data under the old node's id
+    ASSERT_EQ(1, write(sockets[1], "x", 1));
+    EXPECT_EQ(0, Wait(events));
+    close(hDup);
+}
+
+
+} /* namespace TestNetPoll */
+
+#endif // USE_EPOLL
@@ -0,0 +1,132 @@
+#include <cryptoconditions.h>
+#include <gtest/gtest.h>
+
+#include "cc/CCOracles.h"
+#include "chain.h"
+#include "script/cc.h"
+
+#include "testutils.h"
+
+
+namespace TestOracleIndex {
+
+
+class OracleIndexTest : public CCIndexTest {
+protected:
+    CPubKey pk;
+    uint256 oracletxid;
+
+    virtual void SetUp() {
+        CCIndexTest::SetUp();
+        pk = notaryKey.GetPubKey();
+        oracletxid = GetRandHash();
+    }
+
+    /** A data tx paying its datafee from the oracles funds of the publisher */
+    CTransaction MakeDataTx(const uint256 &batontxid, int64_t price, bool fPaid=true)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        if (fPaid) {
+            CC *cond = MakeCCcond1(EVAL_ORACLES, pk);
+            cc_signTreeSecp256k1Msg32(cond, notaryKey.begin(), GetRandHash().begin());
+            mtx.vin.push_back(CTxIn(GetRandHash(), 0, CCSig(cond)));
+            cc_free(cond);
+        } else {
+            mtx.vin.push_back(CTxIn(GetRandHash(), 1));
+        }
+        std::vector<uint8_t> data;
+        for (int i = 0; i < 8; i++)
+            data.push_back((price >> (8 * i)) & 0xff);
+        mtx.vout.push_back(MakeCC1vout(EVAL_ORACLES, 10000, pk));
+        mtx.vout.push_back(MakeCC1vout(EVAL_ORACLES, 10000, pk));
+        mtx.vout.push_back(CTxOut(0, EncodeOraclesData('D', oracletxid, batontxid, pk, data)));
+        return CTransaction(mtx);
+    }
+
+    int64_t Price(const std::vector<uint8_t> &data)
+    {
+        uint256 hash;
+        int64_t val = 0;
+        oracle_format(&hash, &val, 0, 'L', (uint8_t *)data.data(), 0, (int32_t)data.size());
+        return val;
+    }
+};
+
+
+TEST_F(OracleIndexTest, test_samples_follow_blocks)
+{
+    CTransaction tx1 = MakeDataTx(uint256(), 100);
+    CTransaction tx2 = MakeDataTx(tx1.GetHash(), 200);
+    CTransaction tx3 = MakeDataTx(tx2.GetHash(), 300);
+    // Height 0 asks for the newest price, so the samples start above it
+    ConnectBlock(std::vector<CTransaction>());
+    ConnectBlock(std::vector<CTransaction>(1, tx1));
+    std::vector<CTransaction> vtx;
+    vtx.push_back(tx2);
+    vtx.push_back(tx3);
+    ConnectBlock(vtx);
+    ASSERT_TRUE(IsCCIndexReady());
+    int32_t height = indexes.back()->GetHeight();
+
+    // Newest first
+    std::vector<COracleSample> samples;
+    ASSERT_TRUE(GetOracleSamples(oracletxid, pk, 0, height, -1, samples));
+    ASSERT_EQ(3, samples.size());
+    EXPECT_EQ(tx3.GetHash(), samples[0].txid);
+    EXPECT_EQ(tx2.GetHash(), samples[0].batontxid);
+    EXPECT_EQ(300, Price(samples[0].data));
+    EXPECT_EQ(tx2.GetHash(), samples[1].txid);
+    EXPECT_EQ(tx1.GetHash(), samples[2].txid);
+    EXPECT_EQ(height - 1, samples[2].nHeight);
+
+    ASSERT_TRUE(GetOracleSamples(oracletxid, pk, 0, height - 1, -1, samples));
+    ASSERT_EQ(1, samples.size());
+    EXPECT_EQ(tx1.GetHash(), samples[0].txid);
+    ASSERT_TRUE(GetOracleSamples(oracletxid, pk, height, height, 1, samples));
+    ASSERT_EQ(1, samples.size());
+    EXPECT_EQ(tx3.GetHash(), samples[0].txid);
+
+    uint256 reforacletxid;
+    bool fFound = false;
+    ASSERT_TRUE(GetOracleSamplesFrom(tx2.GetHash(), 10, reforacletxid, samples, fFound));
+    ASSERT_TRUE(fFound);
+    EXPECT_EQ(oracletxid, reforacletxid);
+    ASSERT_EQ(2, samples.size());
+    EXPECT_EQ(tx2.GetHash(), samples[0].txid);
+    EXPECT_EQ(tx1.GetHash(), samples[1].txid);
+
+    std::vector<CPubKey> publishers;
+    ASSERT_TRUE(GetOraclePublishers(oracletxid, publishers));
+    ASSERT_EQ(1, publishers.size());
+    EXPECT_EQ(pk, publishers[0]);
+
+    int64_t price = 0;
+    ASSERT_TRUE(GetOracleCorrelatedPrice(oracletxid, height - 1, price));
+    EXPECT_EQ(100, price);
+    ASSERT_TRUE(GetOracleCorrelatedPrice(oracletxid, 0, price));
+    EXPECT_EQ(300, price);
+
+    // Disconnecting the tip takes its samples out again
+    DisconnectBlock();
+    ASSERT_TRUE(GetOracleSamples(oracletxid, pk, 0, height, -1, samples));
+    ASSERT_EQ(1, samples.size());
+    EXPECT_EQ(tx1.GetHash(), samples[0].txid);
+    ASSERT_TRUE(GetOracleSamplesFrom(tx2.GetHash(), 10, reforacletxid, samples, fFound));
+    EXPECT_FALSE(fFound);
+}
+
+TEST_F(OracleIndexTest, test_unpaid_samples_not_taken)
+{
+    CTransaction tx = MakeDataTx(uint256(), 100, false);
+    ConnectBlock(tx);
+    std::vector<COracleSample> samples;
+    ASSERT_TRUE(GetOracleSamples(oracletxid, pk, 0, indexes.back()->GetHeight(), -1, samples));
+    EXPECT_TRUE(samples.empty());
+    std::vector<CPubKey> publishers;
+    ASSERT_TRUE(GetOraclePublishers(oracletxid, publishers));
+    EXPECT_TRUE(publishers.empty());
+}
+
+
+} /* namespace TestOracleIndex */
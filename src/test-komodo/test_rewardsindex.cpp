@@ -0,0 +1,203 @@
+#include <cryptoconditions.h>
+#include <gtest/gtest.h>
+
+#include "cc/CCrewards.h"
+#include "chain.h"
+#include "script/cc.h"
+
+#include "testutils.h"
+
+
+namespace TestRewardsIndex {
+
+
+class RewardsIndexTest : public CCIndexTest {
+protected:
+    CPubKey pk, rewardspk;
+    uint64_t sbits;
+    struct CCcontract_info *cp, C;
+
+    virtual void SetUp() {
+        CCIndexTest::SetUp();
+        pk = notaryKey.GetPubKey();
+        cp = CCinit(&C, EVAL_REWARDS);
+        rewardspk = GetUnspendable(cp, 0);
+        sbits = stringbits((char *)"TEST");
+    }
+
+    CTransaction MakeFundingTx(int64_t funds, uint64_t APR)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        mtx.vout.push_back(MakeCC1vout(EVAL_REWARDS, funds, rewardspk));
+        mtx.vout.push_back(CTxOut(10000, CScript() << ParseHex(HexStr(rewardspk)) << OP_CHECKSIG));
+        mtx.vout.push_back(CTxOut(0, EncodeRewardsFundingOpRet('F', sbits, APR, 0, 365 * 24 * 3600, COIN)));
+        return CTransaction(mtx);
+    }
+
+    CTransaction MakeLockTx(const uint256 &fundingtxid, int64_t deposit)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        mtx.vout.push_back(MakeCC1vout(EVAL_REWARDS, deposit, rewardspk));
+        mtx.vout.push_back(CTxOut(10000, CScript() << ParseHex(HexStr(pk)) << OP_CHECKSIG));
+        mtx.vout.push_back(CTxOut(0, EncodeRewardsOpRet('L', sbits, fundingtxid)));
+        return CTransaction(mtx);
+    }
+
+    /** An unlock spending the lock and a funding vout, with the funding change */
+    CTransaction MakeUnlockTx(const uint256 &fundingtxid, const uint256 &locktxid, const uint256 &fundtxid, int64_t change, int64_t payout)
+    {
+        CMutableTransaction mtx;
+        CC *cond = MakeCCcond1(EVAL_REWARDS, rewardspk);
+        cc_signTreeSecp256k1Msg32(cond, notaryKey.begin(), GetRandHash().begin());
+        mtx.vin.push_back(CTxIn(locktxid, 0, CCSig(cond)));
+        mtx.vin.push_back(CTxIn(fundtxid, 0, CCSig(cond)));
+        cc_free(cond);
+        mtx.vout.push_back(MakeCC1vout(EVAL_REWARDS, change, rewardspk));
+        mtx.vout.push_back(CTxOut(payout, CScript() << ParseHex(HexStr(pk)) << OP_CHECKSIG));
+        mtx.vout.push_back(CTxOut(0, EncodeRewardsOpRet('U', sbits, fundingtxid)));
+        return CTransaction(mtx);
+    }
+
+    CRewardsPlan Plan(const uint256 &fundingtxid)
+    {
+        CRewardsPlan plan;
+        bool fFound = false;
+        EXPECT_TRUE(GetRewardsPlan(fundingtxid, plan, fFound));
+        EXPECT_TRUE(fFound);
+        return plan;
+    }
+};
+
+
+TEST_F(RewardsIndexTest, test_plan_totals_follow_blocks)
+{
+    CTransaction fundingTx = MakeFundingTx(100 * COIN, 5 * COIN);
+    uint256 fundingtxid = fundingTx.GetHash();
+    ConnectBlock(fundingTx, 1000);
+    ASSERT_TRUE(IsCCIndexReady());
+
+    CRewardsPlan plan = Plan(fundingtxid);
+    EXPECT_EQ(sbits, plan.sbits);
+    EXPECT_EQ(5 * COIN, plan.APR);
+    EXPECT_EQ(COIN, plan.mindeposit);
+    EXPECT_EQ(100 * COIN, plan.nFunding);
+    EXPECT_EQ(0, plan.nLocked);
+    bool fFound = false;
+    CRewardsPlan named;
+    ASSERT_TRUE(GetRewardsPlanBySbits(sbits, named, fFound));
+    ASSERT_TRUE(fFound);
+    EXPECT_EQ(fundingtxid, named.fundingtxid);
+
+    CTransaction lockTx = MakeLockTx(fundingtxid, 10 * COIN);
+    ConnectBlock(lockTx, 2000);
+    plan = Plan(fundingtxid);
+    EXPECT_EQ(100 * COIN, plan.nFunding);
+    EXPECT_EQ(10 * COIN, plan.nLocked);
+    EXPECT_EQ(1, plan.nLocks);
+
+    uint256 lockfundingtxid;
+    CRewardsUtxo utxo;
+    ASSERT_TRUE(GetRewardsUtxo(COutPoint(lockTx.GetHash(), 0), lockfundingtxid, utxo, fFound));
+    ASSERT_TRUE(fFound);
+    EXPECT_EQ(fundingtxid, lockfundingtxid);
+    EXPECT_EQ('L', utxo.funcid);
+    EXPECT_EQ(lockTx.vout[1].scriptPubKey, utxo.scriptPubKey);
+
+    ConnectBlock(MakeUnlockTx(fundingtxid, lockTx.GetHash(), fundingtxid, 99 * COIN, 11 * COIN - 10000), 3000);
+    plan = Plan(fundingtxid);
+    EXPECT_EQ(99 * COIN, plan.nFunding);
+    EXPECT_EQ(0, plan.nLocked);
+    EXPECT_EQ(0, plan.nLocks);
+    ASSERT_TRUE(GetRewardsUtxo(COutPoint(lockTx.GetHash(), 0), lockfundingtxid, utxo, fFound));
+    EXPECT_FALSE(fFound);
+
+    DisconnectBlock();
+    plan = Plan(fundingtxid);
+    EXPECT_EQ(100 * COIN, plan.nFunding);
+    EXPECT_EQ(10 * COIN, plan.nLocked);
+    rewards_utxos_type utxos;
+    ASSERT_TRUE(GetRewardsUtxos(fundingtxid, utxos));
+    EXPECT_EQ(2, utxos.size());
+
+    DisconnectBlock();
+    DisconnectBlock();
+    ASSERT_TRUE(GetRewardsPlan(fundingtxid, plan, fFound));
+    EXPECT_FALSE(fFound);
+    std::vector<CRewardsPlan> plans;
+    ASSERT_TRUE(GetRewardsPlans(plans));
+    EXPECT_TRUE(plans.empty());
+}
+
+TEST_F(RewardsIndexTest, test_first_plan_keeps_the_name)
+{
+    CTransaction fundingTx1 = MakeFundingTx(100 * COIN, 5 * COIN);
+    CTransaction fundingTx2 = MakeFundingTx(50 * COIN, 7 * COIN);
+    ConnectBlock(fundingTx1, 1000);
+    ConnectBlock(fundingTx2, 2000);
+
+    CRewardsPlan plan;
+    bool fFound = false;
+    ASSERT_TRUE(GetRewardsPlanBySbits(sbits, plan, fFound));
+    ASSERT_TRUE(fFound);
+    EXPECT_EQ(fundingTx1.GetHash(), plan.fundingtxid);
+
+    std::vector<CRewardsPlan> plans;
+    ASSERT_TRUE(GetRewardsPlans(plans));
+    ASSERT_EQ(2, plans.size());
+    EXPECT_EQ(fundingTx1.GetHash(), plans[0].fundingtxid);
+    EXPECT_EQ(fundingTx2.GetHash(), plans[1].fundingtxid);
+}
+
+TEST_F(RewardsIndexTest, test_other_name_not_counted)
+{
+    CTransaction fundingTx = MakeFundingTx(100 * COIN, 5 * COIN);
+    uint256 fundingtxid = fundingTx.GetHash();
+    ConnectBlock(fundingTx, 1000);
+
+    // A lock naming the plan by its fundingtxid but with another name
+    sbits = stringbits((char *)"OTHER");
+    CTransaction lockTx = MakeLockTx(fundingtxid, 10 * COIN);
+    ConnectBlock(lockTx, 2000);
+    CRewardsPlan plan = Plan(fundingtxid);
+    EXPECT_EQ(100 * COIN, plan.nFunding);
+    EXPECT_EQ(0, plan.nLocked);
+    EXPECT_EQ(0, plan.nLocks);
+    uint256 lockfundingtxid;
+    CRewardsUtxo utxo;
+    bool fFound = true;
+    ASSERT_TRUE(GetRewardsUtxo(COutPoint(lockTx.GetHash(), 0), lockfundingtxid, utxo, fFound));
+    EXPECT_FALSE(fFound);
+}
+
+TEST_F(RewardsIndexTest, test_accrual_matches_rewardscalc)
+{
+    uint64_t APR = 5 * COIN, maxseconds = 365 * 24 * 3600;
+    EXPECT_EQ(0, RewardsCalcDuration(COIN, 10, APR, 60, maxseconds));
+    EXPECT_EQ(RewardsCalcDuration(COIN, maxseconds, APR, 0, maxseconds), RewardsCalcDuration(COIN, 2 * maxseconds, APR, 0, maxseconds));
+
+    CRewardsPlan plan;
+    plan.APR = APR;
+    plan.maxseconds = maxseconds;
+    rewards_utxos_type utxos;
+    CRewardsUtxo funding, lock;
+    funding.funcid = 'F';
+    funding.nValue = 100 * COIN;
+    lock.funcid = 'L';
+    lock.nValue = 10 * COIN;
+    utxos.push_back(std::make_pair(COutPoint(GetRandHash(), 0), funding));
+    utxos.push_back(std::make_pair(COutPoint(GetRandHash(), 0), lock));
+
+    // A lock that is not in the active chain has earned nothing yet
+    std::vector<int64_t> rewards;
+    lock.nHeight = chainActive.Height() + 1;
+    utxos[1].second = lock;
+    EXPECT_EQ(0, RewardsPlanAccrual(plan, utxos, rewards));
+    ASSERT_EQ(2, rewards.size());
+    EXPECT_EQ(0, rewards[0]);
+    EXPECT_EQ(0, rewards[1]);
+}
+
+
+} /* namespace TestRewardsIndex */
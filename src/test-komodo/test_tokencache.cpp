@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include "cc/CCtokens.h"
+#include "random.h"
+
+
+namespace TestTokenCache {
+
+
+static CTokenVoutValue MakeValue(int64_t nValue, int64_t nVerified)
+{
+    CTokenVoutValue value;
+    value.nValue = nValue;
+    value.nVerified = nVerified;
+    return value;
+}
+
+
+TEST(TestTokenCache, test_keyed_by_outpoint_and_tokenid)
+{
+    CTokenVoutCache cache(100);
+    COutPoint outpoint(GetRandHash(), 1);
+    uint256 tokenid = GetRandHash(), othertokenid = GetRandHash();
+    CTokenVoutValue value;
+
+    ASSERT_FALSE(cache.Get(outpoint, tokenid, value));
+    cache.Set(outpoint, tokenid, MakeValue(500, -1));
+    ASSERT_TRUE(cache.Get(outpoint, tokenid, value));
+    EXPECT_EQ(500, value.nValue);
+    EXPECT_EQ(-1, value.nVerified);
+    EXPECT_FALSE(cache.Get(outpoint, othertokenid, value));
+    EXPECT_FALSE(cache.Get(COutPoint(outpoint.hash, 2), tokenid, value));
+
+    // Checking the inputs later completes the entry
+    cache.Set(outpoint, tokenid, MakeValue(500, 500));
+    ASSERT_TRUE(cache.Get(outpoint, tokenid, value));
+    EXPECT_EQ(500, value.nVerified);
+    EXPECT_EQ(1, cache.Size());
+}
+
+TEST(TestTokenCache, test_size_bounded)
+{
+    CTokenVoutCache cache(50);
+    uint256 tokenid = GetRandHash();
+    COutPoint last;
+    for (int i = 0; i < 200; i++) {
+        last = COutPoint(GetRandHash(), i);
+        cache.Set(last, tokenid, MakeValue(i, i));
+    }
+    EXPECT_EQ(50, cache.Size());
+
+    // The value just added is never the one evicted
+    CTokenVoutValue value;
+    ASSERT_TRUE(cache.Get(last, tokenid, value));
+    EXPECT_EQ(199, value.nValue);
+
+    CTokenVoutCache disabled(0);
+    disabled.Set(last, tokenid, MakeValue(1, 1));
+    EXPECT_EQ(0, disabled.Size());
+}
+
+
+} /* namespace TestTokenCache */
@@ -0,0 +1,119 @@
+#include <cryptoconditions.h>
+#include <gtest/gtest.h>
+
+#include "cc/CCtokens.h"
+#include "chain.h"
+#include "script/cc.h"
+
+#include "testutils.h"
+
+
+namespace TestTokenIndex {
+
+
+class TokenIndexTest : public CCIndexTest {
+protected:
+    CKey key2;
+    CPubKey pk, pk2;
+    struct CCcontract_info *cp, C;
+
+    virtual void SetUp() {
+        CCIndexTest::SetUp();
+        pk = notaryKey.GetPubKey();
+        key2.MakeNewKey(true);
+        pk2 = key2.GetPubKey();
+        cp = CCinit(&C, EVAL_TOKENS);
+    }
+
+    CTransaction MakeCreateTx(int64_t supply)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        mtx.vout.push_back(MakeCC1vout(EVAL_TOKENS, supply, pk));
+        mtx.vout.push_back(CTxOut(10000, CScript() << ParseHex(cp->CChexstr) << OP_CHECKSIG));
+        mtx.vout.push_back(CTxOut(0, EncodeTokenCreateOpRet('c', std::vector<uint8_t>(pk.begin(), pk.end()), "coupon", "a test token")));
+        return CTransaction(mtx);
+    }
+
+    CTransaction MakeTransferTx(const CTransaction &createTx, int64_t amount)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        CC *cond = MakeCCcond1(EVAL_TOKENS, pk);
+        cc_signTreeSecp256k1Msg32(cond, notaryKey.begin(), GetRandHash().begin());
+        mtx.vin.push_back(CTxIn(createTx.GetHash(), 0, CCSig(cond)));
+        cc_free(cond);
+        mtx.vout.push_back(MakeCC1vout(EVAL_TOKENS, amount, pk2));
+        mtx.vout.push_back(MakeCC1vout(EVAL_TOKENS, createTx.vout[0].nValue - amount, pk));
+        mtx.vout.push_back(CTxOut(0, EncodeTokenOpRet(createTx.GetHash(), std::vector<CPubKey>(1, pk2), CScript())));
+        return CTransaction(mtx);
+    }
+
+    int64_t Balance(const uint256 &tokenid, const CPubKey &holder)
+    {
+        char tokenaddr[64];
+        int64_t balance = -1;
+        GetTokensCCaddress(cp, tokenaddr, holder);
+        EXPECT_TRUE(GetTokenAddressBalance(tokenid, tokenaddr, false, balance));
+        return balance;
+    }
+};
+
+
+TEST_F(TokenIndexTest, test_registry_and_balances_follow_blocks)
+{
+    CTransaction createTx = MakeCreateTx(1000);
+    CTransaction transferTx = MakeTransferTx(createTx, 400);
+    uint256 tokenid = createTx.GetHash();
+    std::vector<CTransaction> vtx;
+    vtx.push_back(createTx);
+    vtx.push_back(transferTx);
+    ConnectBlock(vtx);
+    ASSERT_TRUE(IsCCIndexReady());
+
+    CTokenInfo info;
+    bool fFound = false;
+    ASSERT_TRUE(GetTokenInfo(tokenid, info, fFound));
+    ASSERT_TRUE(fFound);
+    EXPECT_EQ("coupon", info.name);
+    EXPECT_EQ("a test token", info.description);
+    EXPECT_EQ(1000, info.nSupply);
+    EXPECT_EQ(std::vector<uint8_t>(pk.begin(), pk.end()), info.origpubkey);
+
+    std::vector<uint256> tokenids;
+    ASSERT_TRUE(GetTokenIds(0, -1, tokenids));
+    ASSERT_EQ(1, tokenids.size());
+    EXPECT_EQ(tokenid, tokenids[0]);
+    ASSERT_TRUE(GetTokenIds(1, -1, tokenids));
+    EXPECT_TRUE(tokenids.empty());
+
+    // The supply moved on with the transfer: the change and what was sent
+    EXPECT_EQ(600, Balance(tokenid, pk));
+    EXPECT_EQ(400, Balance(tokenid, pk2));
+
+    DisconnectBlock();
+    ASSERT_TRUE(IsCCIndexReady());
+    ASSERT_TRUE(GetTokenInfo(tokenid, info, fFound));
+    EXPECT_FALSE(fFound);
+    ASSERT_TRUE(GetTokenIds(0, -1, tokenids));
+    EXPECT_TRUE(tokenids.empty());
+    EXPECT_EQ(0, Balance(tokenid, pk));
+    EXPECT_EQ(0, Balance(tokenid, pk2));
+}
+
+TEST_F(TokenIndexTest, test_unpaid_tokens_not_counted)
+{
+    // Tokens sent from coins rather than from the token vouts of the creator
+    CTransaction createTx = MakeCreateTx(1000);
+    CMutableTransaction mtx(MakeTransferTx(createTx, 400));
+    mtx.vin.resize(1);
+    std::vector<CTransaction> vtx;
+    vtx.push_back(createTx);
+    vtx.push_back(CTransaction(mtx));
+    ConnectBlock(vtx);
+    EXPECT_EQ(1000, Balance(createTx.GetHash(), pk));
+    EXPECT_EQ(0, Balance(createTx.GetHash(), pk2));
+}
+
+
+} /* namespace TestTokenIndex */
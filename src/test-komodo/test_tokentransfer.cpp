@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include "cc/CCtokens.h"
+#include "random.h"
+
+#include "testutils.h"
+
+
+namespace TestTokenTransfer {
+
+
+/** What FinalizeCCTx() appends: the normal change to mypk, then the opret */
+static CTransaction Finalize(CMutableTransaction mtx, const CPubKey &mypk, int64_t change)
+{
+    mtx.vout.push_back(CTxOut(change, CScript() << ParseHex(HexStr(mypk)) << OP_CHECKSIG));
+    mtx.vout.push_back(CTxOut(0, CScript() << OP_RETURN << std::vector<uint8_t>(1, 't')));
+    return CTransaction(mtx);
+}
+
+
+TEST(TestTokenTransfer, test_many_chains_on_change)
+{
+    CPubKey mypk = notaryKey.GetPubKey();
+    std::vector<int64_t> amounts;
+    amounts.push_back(100);
+    amounts.push_back(200);
+    amounts.push_back(300);
+    int64_t inputs = 600, normal = 4 * 10000;
+
+    std::vector<CTransaction> txs;
+    for (int i = 0; i < (int)amounts.size(); i++) {
+        CMutableTransaction mtx;
+        if (i == 0)
+            mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+        else
+            TokenTransferManyChain(mtx, txs.back());
+        CKey key;
+        key.MakeNewKey(true);
+        std::vector<uint8_t> destpubkey = ParseHex(HexStr(key.GetPubKey()));
+        inputs -= amounts[i];
+        TokenTransferManyVouts(mtx, mypk, destpubkey, amounts[i], inputs);
+        normal -= 10000;
+        txs.push_back(Finalize(mtx, mypk, normal));
+        EXPECT_EQ(MakeCC1vout(EVAL_TOKENS, amounts[i], key.GetPubKey()), txs.back().vout[0]);
+    }
+
+    // Each tx spends the normal change, then the token change of the one before
+    for (int i = 1; i < (int)txs.size(); i++) {
+        const CTransaction &prevtx = txs[i - 1];
+        ASSERT_EQ(2, txs[i].vin.size());
+        ASSERT_EQ(prevtx.GetHash(), txs[i].vin[0].prevout.hash);
+        ASSERT_EQ(prevtx.GetHash(), txs[i].vin[1].prevout.hash);
+        const CTxOut &normalchange = prevtx.vout[txs[i].vin[0].prevout.n];
+        EXPECT_EQ(CScript() << ParseHex(HexStr(mypk)) << OP_CHECKSIG, normalchange.scriptPubKey);
+        EXPECT_EQ(40000 - i * 10000, normalchange.nValue);
+        const CTxOut &tokenchange = prevtx.vout[txs[i].vin[1].prevout.n];
+        EXPECT_EQ(MakeCC1vout(EVAL_TOKENS, tokenchange.nValue, mypk), tokenchange);
+    }
+    EXPECT_EQ(500, txs[0].vout[1].nValue);
+    EXPECT_EQ(300, txs[1].vout[1].nValue);
+    // Nothing is left for a token change in the last one
+    EXPECT_EQ(3, txs.back().vout.size());
+}
+
+
+} /* namespace TestTokenTransfer */
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "primitives/transaction.h"
+#include "txcache.h"
+
+
+namespace TestTxCache {
+
+
+static CTransaction MakeTx(int n)
+{
+    CMutableTransaction mtx;
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = n;
+    mtx.vout[0].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(100, (unsigned char)n);
+    return CTransaction(mtx);
+}
+
+
+TEST(TestTxCache, test_lookup)
+{
+    CTxCache cache(1 << 20);
+    CTransaction tx = MakeTx(1), txOut;
+    uint256 hashBlock = tx.GetHash(), hashBlockOut;
+    int nHeight = 0;
+
+    ASSERT_FALSE(cache.Lookup(tx.GetHash(), txOut, hashBlockOut));
+    cache.Add(tx, hashBlock, 10);
+    ASSERT_TRUE(cache.Lookup(tx.GetHash(), txOut, hashBlockOut, &nHeight));
+    EXPECT_EQ(tx.GetHash(), txOut.GetHash());
+    EXPECT_EQ(hashBlock, hashBlockOut);
+    EXPECT_EQ(10, nHeight);
+    EXPECT_EQ(1, cache.Hits());
+    EXPECT_EQ(1, cache.Misses());
+    EXPECT_EQ(1, cache.Size());
+}
+
+TEST(TestTxCache, test_erase_block)
+{
+    CTxCache cache(1 << 20);
+    std::vector<CTransaction> vtx;
+    for (int i = 0; i < 4; i++) {
+        vtx.push_back(MakeTx(i));
+        cache.Add(vtx.back(), uint256(), 1);
+    }
+    EXPECT_EQ(4, cache.Size());
+    cache.EraseBlock(vtx);
+    EXPECT_EQ(0, cache.Size());
+    EXPECT_EQ(0, cache.DynamicMemoryUsage());
+}
+
+TEST(TestTxCache, test_bounded)
+{
+    CTxCache cache(64 * 1024);
+    for (int i = 0; i < 2000; i++)
+        cache.Add(MakeTx(i), uint256(), i);
+    EXPECT_LE(cache.DynamicMemoryUsage(), 64 * 1024);
+    EXPECT_LT(cache.Size(), 2000);
+
+    // the most recently added transaction is still there
+    CTransaction txOut; uint256 hashBlock;
+    EXPECT_TRUE(cache.Lookup(MakeTx(1999).GetHash(), txOut, hashBlock));
+}
+
+} /* namespace TestTxCache */
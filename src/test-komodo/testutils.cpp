@@ -1,6 +1,7 @@
 #include <cryptoconditions.h>
 #include <gtest/gtest.h>
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
 
 #include "core_io.h"
 #include "key.h"
@@ -145,3 +146,61 @@ void getInputTx(CScript scriptPubKey, CTransaction &txIn)
     acceptTxFail(mtx);
     txIn = CTransaction(mtx);
 }
+
+
+void CCIndexTest::SetUp()
+{
+    ASSETCHAINS_CC = 1;
+    fAddressIndex = true;
+    // An empty index is in step with the tip when it says so
+    pccindex = new CCIndexDB(1 << 20, true, true);
+    LOCK(cs_main);
+    ASSERT_TRUE(pccindex->Write('B', chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256()));
+    ASSERT_TRUE(InitCCIndexes());
+    ASSERT_TRUE(IsCCIndexReady());
+}
+
+
+void CCIndexTest::TearDown()
+{
+    BOOST_FOREACH(CBlockIndex *pindex, indexes)
+        delete pindex;
+    delete pccindex;
+    pccindex = NULL;
+}
+
+
+void CCIndexTest::ConnectBlock(const std::vector<CTransaction> &vtx, uint32_t nTime)
+{
+    CBlock block;
+    block.vtx = vtx;
+    block.nNonce = uint256(GetRandHash());
+    CBlockIndex *pindex = new CBlockIndex();
+    hashes.push_back(block.GetHash());
+    pindex->phashBlock = &hashes.back();
+    pindex->pprev = indexes.empty() ? chainActive.Tip() : indexes.back();
+    pindex->SetHeight(pindex->pprev ? pindex->pprev->GetHeight() + 1 : 0);
+    pindex->nTime = nTime;
+    blocks.push_back(block);
+    indexes.push_back(pindex);
+    LOCK(cs_main);
+    ConnectCCIndexes(block, pindex);
+}
+
+
+void CCIndexTest::ConnectBlock(const CTransaction &tx, uint32_t nTime)
+{
+    ConnectBlock(std::vector<CTransaction>(1, tx), nTime);
+}
+
+
+void CCIndexTest::DisconnectBlock()
+{
+    {
+        LOCK(cs_main);
+        DisconnectCCIndexes(blocks.back(), indexes.back());
+    }
+    delete indexes.back();
+    indexes.pop_back();
+    blocks.pop_back();
+}
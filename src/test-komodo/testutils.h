@@ -2,6 +2,11 @@
 #define TESTUTILS_H
 
 #include "main.h"
+#include "cc/CCindex.h"
+
+#include <gtest/gtest.h>
+
+#include <list>
 
 
 #define VCH(a,b) std::vector<unsigned char>(a, a + b)
@@ -26,4 +31,20 @@ CMutableTransaction spendTx(const CTransaction &txIn, int nOut=0);
 std::vector<uint8_t> getSig(const CMutableTransaction mtx, CScript inputPubKey, int nIn=0);
 
 
+/** Contract indexes in a fresh database, with blocks connected and disconnected on top of the tip */
+class CCIndexTest : public ::testing::Test {
+protected:
+    std::vector<CBlock> blocks;
+    std::vector<CBlockIndex*> indexes;
+    std::list<uint256> hashes;
+
+    virtual void SetUp();
+    virtual void TearDown();
+
+    void ConnectBlock(const std::vector<CTransaction> &vtx, uint32_t nTime=0);
+    void ConnectBlock(const CTransaction &tx, uint32_t nTime=0);
+    void DisconnectBlock();
+};
+
+
 #endif /* TESTUTILS_H */
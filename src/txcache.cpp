@@ -0,0 +1,130 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "txcache.h"
+
+#include "core_memusage.h"
+#include "memusage.h"
+
+CTxCache txcache(DEFAULT_TX_CACHE_SIZE << 20);
+
+CTxCache::CTxCache(size_t nMaxUsageIn) : nMaxShardUsage(nMaxUsageIn / NUM_SHARDS), nHits(0), nMisses(0)
+{
+}
+
+void CTxCache::SetMaxUsage(size_t nMaxUsageIn)
+{
+    nMaxShardUsage = nMaxUsageIn / NUM_SHARDS;
+    if (nMaxUsageIn == 0)
+        Clear();
+}
+
+bool CTxCache::Lookup(const uint256& txid, CTransaction& txOut, uint256& hashBlock, int* pnHeight)
+{
+    Shard& shard = GetShard(txid);
+    LOCK(shard.cs);
+    auto it = shard.index.find(txid);
+    if (it == shard.index.end()) {
+        nMisses++;
+        return false;
+    }
+    // move to the front, it is now the most recently used
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    const Entry& entry = it->second->second;
+    txOut = *entry.tx;
+    hashBlock = entry.hashBlock;
+    if (pnHeight != NULL)
+        *pnHeight = entry.nHeight;
+    nHits++;
+    return true;
+}
+
+void CTxCache::Add(const CTransaction& tx, const uint256& hashBlock, int nHeight)
+{
+    size_t nMaxUsage = nMaxShardUsage;
+    Entry entry;
+    entry.nUsage = RecursiveDynamicUsage(tx) + sizeof(CTransaction) + sizeof(Entry) + 3 * sizeof(void*);
+    if (entry.nUsage > nMaxUsage)
+        return;
+    entry.tx = std::make_shared<const CTransaction>(tx);
+    entry.hashBlock = hashBlock;
+    entry.nHeight = nHeight;
+
+    const uint256& txid = tx.GetHash();
+    Shard& shard = GetShard(txid);
+    LOCK(shard.cs);
+    auto it = shard.index.find(txid);
+    if (it != shard.index.end()) {
+        shard.nUsage -= it->second->second.nUsage;
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+    }
+    shard.entries.push_front(std::make_pair(txid, entry));
+    shard.index[txid] = shard.entries.begin();
+    shard.nUsage += entry.nUsage;
+    while (shard.nUsage > nMaxUsage && !shard.entries.empty()) {
+        shard.nUsage -= shard.entries.back().second.nUsage;
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+}
+
+void CTxCache::Erase(const uint256& txid)
+{
+    Shard& shard = GetShard(txid);
+    LOCK(shard.cs);
+    auto it = shard.index.find(txid);
+    if (it != shard.index.end()) {
+        shard.nUsage -= it->second->second.nUsage;
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+void CTxCache::EraseBlock(const std::vector<CTransaction>& vtx)
+{
+    for (const CTransaction& tx : vtx)
+        Erase(tx.GetHash());
+}
+
+void CTxCache::Clear()
+{
+    for (unsigned int i = 0; i < NUM_SHARDS; i++) {
+        LOCK(shards[i].cs);
+        shards[i].entries.clear();
+        shards[i].index.clear();
+        shards[i].nUsage = 0;
+    }
+}
+
+size_t CTxCache::Size()
+{
+    size_t nSize = 0;
+    for (unsigned int i = 0; i < NUM_SHARDS; i++) {
+        LOCK(shards[i].cs);
+        nSize += shards[i].index.size();
+    }
+    return nSize;
+}
+
+size_t CTxCache::DynamicMemoryUsage()
+{
+    size_t nUsage = 0;
+    for (unsigned int i = 0; i < NUM_SHARDS; i++) {
+        LOCK(shards[i].cs);
+        nUsage += shards[i].nUsage;
+    }
+    return nUsage;
+}
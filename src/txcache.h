@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef BITCOIN_TXCACHE_H
+#define BITCOIN_TXCACHE_H
+
+#include "coins.h"
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+/** Default for -txcache, the memory in MiB used to keep recently loaded confirmed transactions */
+static const unsigned int DEFAULT_TX_CACHE_SIZE = 32;
+
+/**
+ * Size bounded LRU of confirmed transactions that were loaded from the block
+ * files, keyed by txid. GetTransaction() and myGetTransaction() consult it
+ * before going to disk, which the CC contracts do over and over for the same
+ * funding and baton transactions.
+ *
+ * The cache is split into shards with their own lock, so that concurrent
+ * RPC and validation threads do not serialize on it. Entries of a block must
+ * be removed with EraseBlock() when the block is disconnected.
+ */
+class CTxCache
+{
+public:
+    struct Entry
+    {
+        std::shared_ptr<const CTransaction> tx;
+        uint256 hashBlock;
+        int nHeight;
+        size_t nUsage;
+    };
+
+    CTxCache(size_t nMaxUsageIn);
+
+    void SetMaxUsage(size_t nMaxUsageIn);
+    bool Lookup(const uint256& txid, CTransaction& txOut, uint256& hashBlock, int* pnHeight = NULL);
+    void Add(const CTransaction& tx, const uint256& hashBlock, int nHeight = -1);
+    void Erase(const uint256& txid);
+    void EraseBlock(const std::vector<CTransaction>& vtx);
+    void Clear();
+
+    uint64_t Hits() const { return nHits.load(); }
+    uint64_t Misses() const { return nMisses.load(); }
+    size_t Size();
+    size_t DynamicMemoryUsage();
+
+private:
+    static const unsigned int NUM_SHARDS = 16;
+
+    typedef std::list<std::pair<uint256, Entry> > EntryList;
+
+    struct Shard
+    {
+        CCriticalSection cs;
+        EntryList entries;
+        std::unordered_map<uint256, EntryList::iterator, CCoinsKeyHasher> index;
+        size_t nUsage;
+
+        Shard() : nUsage(0) {}
+    };
+
+    Shard shards[NUM_SHARDS];
+    std::atomic<size_t> nMaxShardUsage;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+    Shard& GetShard(const uint256& txid) { return shards[txid.GetCheapHash() % NUM_SHARDS]; }
+};
+
+extern CTxCache txcache;
+
+#endif // BITCOIN_TXCACHE_H
@@ -28,6 +28,7 @@
 #include "core_io.h"
 
 #include <stdint.h>
+#include <tuple>
 
 #include <boost/thread.hpp>
 
@@ -44,6 +45,8 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'd';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSUNSPENTHEIGHTINDEX = 'h';
+static const char DB_ADDRESSSUMMARYINDEX = 'y';
 static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
@@ -141,7 +144,7 @@ uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
 
 void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char& dbChar)
 {
-    for (CNullifiersMap::iterator it = mapToUse.begin(); it != mapToUse.end();) {
+    for (CNullifiersMap::iterator it = mapToUse.begin(); it != mapToUse.end(); ++it) {
         if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
             if (!it->second.entered)
                 batch.Erase(make_pair(dbChar, it->first));
@@ -149,15 +152,13 @@ void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char&
                 batch.Write(make_pair(dbChar, it->first), true);
             // TODO: changed++? ... See comment in CCoinsViewDB::BatchWrite. If this is needed we could return an int
         }
-        CNullifiersMap::iterator itOld = it++;
-        mapToUse.erase(itOld);
     }
 }
 
 template<typename Map, typename MapIterator, typename MapEntry, typename Tree>
 void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
 {
-    for (MapIterator it = mapToUse.begin(); it != mapToUse.end();) {
+    for (MapIterator it = mapToUse.begin(); it != mapToUse.end(); ++it) {
         if (it->second.flags & MapEntry::DIRTY) {
             if (!it->second.entered)
                 batch.Erase(make_pair(dbChar, it->first));
@@ -168,8 +169,6 @@ void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
             }
             // TODO: changed++?
         }
-        MapIterator itOld = it++;
-        mapToUse.erase(itOld);
     }
 }
 
@@ -184,7 +183,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             if (it->second.coins.IsPruned())
                 batch.Erase(make_pair(DB_COINS, it->first));
@@ -193,9 +192,9 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
     }
+    // The maps are left untouched: the caller releases them in one go, and
+    // CCoinsViewFlushBuffer keeps answering reads from them during the write.
 
     ::BatchWriteAnchors<CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, mapSproutAnchors, DB_SPROUT_ANCHOR);
     ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
@@ -214,6 +213,238 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     return db.WriteBatch(batch);
 }
 
+CCoinsViewFlushBuffer::CCoinsViewFlushBuffer(CCoinsView *viewIn) : CCoinsViewBacked(viewIn), fPending(false), fWriteFailed(false), fShutdown(false)
+{
+    writerThread = boost::thread(boost::bind(&CCoinsViewFlushBuffer::ThreadWriter, this));
+}
+
+CCoinsViewFlushBuffer::~CCoinsViewFlushBuffer()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fShutdown = true;
+    }
+    condWriter.notify_one();
+    // The writer commits the batch in flight before it exits.
+    writerThread.join();
+}
+
+void CCoinsViewFlushBuffer::ThreadWriter()
+{
+    RenameThread("komodo-coinsflush");
+    boost::unique_lock<boost::mutex> lock(cs);
+    while (true) {
+        while (!fShutdown && (!fPending || fWriteFailed))
+            condWriter.wait(lock);
+        if (!fPending || fWriteFailed)
+            return;
+
+        // The pending maps are not touched by anyone else while fPending is set,
+        // so they can be written without holding cs; readers only look them up.
+        lock.unlock();
+        int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = base->BatchWrite(pendingCoins, pendingBestBlock, pendingSproutAnchor, pendingSaplingAnchor,
+                                   pendingSproutAnchors, pendingSaplingAnchors, pendingSproutNullifiers, pendingSaplingNullifiers);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        int64_t nDuration = GetTimeMicros() - nStart;
+        lock.lock();
+
+        flushStats.nLastFlushMicros = nDuration;
+        if (fOk) {
+            LogPrint("coindb", "Committed %u coins to coin database in %.2fms\n", (unsigned int)pendingCoins.size(), nDuration * 0.001);
+            pendingCoins.clear();
+            pendingSproutAnchors.clear();
+            pendingSaplingAnchors.clear();
+            pendingSproutNullifiers.clear();
+            pendingSaplingNullifiers.clear();
+            pendingBestBlock.SetNull();
+            pendingSproutAnchor.SetNull();
+            pendingSaplingAnchor.SetNull();
+            fPending = false;
+            flushStats.nFlushes++;
+        } else {
+            // Keep the batch so reads stay consistent; the next flush reports the failure.
+            LogPrintf("%s: failed to write to coin database\n", __func__);
+            fWriteFailed = true;
+        }
+        condFlushed.notify_all();
+    }
+}
+
+bool CCoinsViewFlushBuffer::WaitIdle(boost::unique_lock<boost::mutex> &lock) const
+{
+    while (fPending && !fWriteFailed)
+        condFlushed.wait(lock);
+    return !fWriteFailed;
+}
+
+bool CCoinsViewFlushBuffer::WaitForFlush() const
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return WaitIdle(lock);
+}
+
+CCoinsFlushStats CCoinsViewFlushBuffer::GetFlushStats() const
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    CCoinsFlushStats ret = flushStats;
+    ret.nQueued = fPending ? 1 : 0;
+    ret.nPendingCoins = pendingCoins.size();
+    return ret;
+}
+
+bool CCoinsViewFlushBuffer::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        CAnchorsSproutMap::const_iterator it = pendingSproutAnchors.find(rt);
+        if (it != pendingSproutAnchors.end()) {
+            if (!it->second.entered)
+                return false;
+            tree = it->second.tree;
+            return true;
+        }
+    }
+    return base->GetSproutAnchorAt(rt, tree);
+}
+
+bool CCoinsViewFlushBuffer::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        CAnchorsSaplingMap::const_iterator it = pendingSaplingAnchors.find(rt);
+        if (it != pendingSaplingAnchors.end()) {
+            if (!it->second.entered)
+                return false;
+            tree = it->second.tree;
+            return true;
+        }
+    }
+    return base->GetSaplingAnchorAt(rt, tree);
+}
+
+bool CCoinsViewFlushBuffer::GetNullifier(const uint256 &nullifier, ShieldedType type) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        const CNullifiersMap *pmap = NULL;
+        switch (type) {
+            case SPROUT:
+                pmap = &pendingSproutNullifiers;
+                break;
+            case SAPLING:
+                pmap = &pendingSaplingNullifiers;
+                break;
+            default:
+                throw runtime_error("Unknown shielded type");
+        }
+        CNullifiersMap::const_iterator it = pmap->find(nullifier);
+        if (it != pmap->end())
+            return it->second.entered;
+    }
+    return base->GetNullifier(nullifier, type);
+}
+
+bool CCoinsViewFlushBuffer::GetCoins(const uint256 &txid, CCoins &coins) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        CCoinsMap::const_iterator it = pendingCoins.find(txid);
+        if (it != pendingCoins.end()) {
+            // A pruned entry is erased from the database by this batch.
+            if (it->second.coins.IsPruned())
+                return false;
+            coins = it->second.coins;
+            return true;
+        }
+    }
+    return base->GetCoins(txid, coins);
+}
+
+bool CCoinsViewFlushBuffer::HaveCoins(const uint256 &txid) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        CCoinsMap::const_iterator it = pendingCoins.find(txid);
+        if (it != pendingCoins.end())
+            return !it->second.coins.IsPruned();
+    }
+    return base->HaveCoins(txid);
+}
+
+uint256 CCoinsViewFlushBuffer::GetBestBlock() const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (!pendingBestBlock.IsNull())
+            return pendingBestBlock;
+    }
+    return base->GetBestBlock();
+}
+
+uint256 CCoinsViewFlushBuffer::GetBestAnchor(ShieldedType type) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        switch (type) {
+            case SPROUT:
+                if (!pendingSproutAnchor.IsNull())
+                    return pendingSproutAnchor;
+                break;
+            case SAPLING:
+                if (!pendingSaplingAnchor.IsNull())
+                    return pendingSaplingAnchor;
+                break;
+            default:
+                throw runtime_error("Unknown shielded type");
+        }
+    }
+    return base->GetBestAnchor(type);
+}
+
+bool CCoinsViewFlushBuffer::BatchWrite(CCoinsMap &mapCoins,
+                                       const uint256 &hashBlock,
+                                       const uint256 &hashSproutAnchor,
+                                       const uint256 &hashSaplingAnchor,
+                                       CAnchorsSproutMap &mapSproutAnchors,
+                                       CAnchorsSaplingMap &mapSaplingAnchors,
+                                       CNullifiersMap &mapSproutNullifiers,
+                                       CNullifiersMap &mapSaplingNullifiers)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        int64_t nStart = GetTimeMicros();
+        if (!WaitIdle(lock))
+            return false;
+        flushStats.nWaitMicros += GetTimeMicros() - nStart;
+
+        // The caller's maps are swapped rather than copied; it clears what it gets back.
+        pendingCoins.swap(mapCoins);
+        pendingSproutAnchors.swap(mapSproutAnchors);
+        pendingSaplingAnchors.swap(mapSaplingAnchors);
+        pendingSproutNullifiers.swap(mapSproutNullifiers);
+        pendingSaplingNullifiers.swap(mapSaplingNullifiers);
+        pendingBestBlock = hashBlock;
+        pendingSproutAnchor = hashSproutAnchor;
+        pendingSaplingAnchor = hashSaplingAnchor;
+        fPending = true;
+    }
+    condWriter.notify_one();
+    return true;
+}
+
+bool CCoinsViewFlushBuffer::GetStats(CCoinsStats &stats) const
+{
+    // Statistics are computed by walking the database, so it has to be complete.
+    if (!WaitForFlush())
+        return false;
+    return base->GetStats(stats);
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
 }
 
@@ -331,14 +562,55 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
 }
 
 bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+    typedef std::pair<unsigned int, uint160> AddressKey;
     CDBBatch batch(*this);
+    // Outputs written or erased earlier in this batch, which cannot be read back from the database yet,
+    // with their height or -1 once erased
+    std::map<std::pair<AddressKey, std::pair<uint256, size_t> >, int> mapBatchHeights;
+    std::map<AddressKey, int64_t> mapUtxoDeltas;
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        const CAddressUnspentKey &key = it->first;
+        AddressKey address(key.type, key.hashBytes);
+        std::pair<AddressKey, std::pair<uint256, size_t> > outpoint(address, std::make_pair(key.txhash, key.index));
+        // The height of the output if it is in the index, the height ordered record needs it to be removed.
+        // Only outputs that come in or go out are counted, so that a block connected again after a crash
+        // is not counted twice
+        int nHeight = -1;
+        std::map<std::pair<AddressKey, std::pair<uint256, size_t> >, int>::iterator itBatch = mapBatchHeights.find(outpoint);
+        if (itBatch != mapBatchHeights.end()) {
+            nHeight = itBatch->second;
+        } else {
+            CAddressUnspentValue value;
+            if (Read(make_pair(DB_ADDRESSUNSPENTINDEX, key), value))
+                nHeight = value.blockHeight;
+        }
         if (it->second.IsNull()) {
-            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, key));
+            if (nHeight >= 0) {
+                batch.Erase(make_pair(DB_ADDRESSUNSPENTHEIGHTINDEX, CAddressUnspentHeightKey(key, nHeight)));
+                mapUtxoDeltas[address]--;
+            }
+            mapBatchHeights[outpoint] = -1;
         } else {
-            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, key), it->second);
+            batch.Write(make_pair(DB_ADDRESSUNSPENTHEIGHTINDEX, CAddressUnspentHeightKey(key, it->second.blockHeight)), it->second);
+            if (nHeight < 0)
+                mapUtxoDeltas[address]++;
+            mapBatchHeights[outpoint] = it->second.blockHeight;
         }
     }
+    for (std::map<AddressKey, int64_t>::const_iterator it = mapUtxoDeltas.begin(); it != mapUtxoDeltas.end(); it++) {
+        if (it->second == 0)
+            continue;
+        CAddressIndexIteratorKey summaryKey(it->first.first, it->first.second);
+        CAddressSummaryValue summary;
+        Read(make_pair(DB_ADDRESSSUMMARYINDEX, summaryKey), summary);
+        summary.utxoCount += it->second;
+        if (summary.IsNull())
+            batch.Erase(make_pair(DB_ADDRESSSUMMARYINDEX, summaryKey));
+        else
+            batch.Write(make_pair(DB_ADDRESSSUMMARYINDEX, summaryKey), summary);
+    }
     return WriteBatch(batch);
 }
 
@@ -377,10 +649,52 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
+/** Orders address index keys, for the sets of them */
+struct CAddressIndexKeyCompare
+{
+    bool operator()(const CAddressIndexKey &a, const CAddressIndexKey &b) const {
+        return std::tie(a.type, a.hashBytes, a.blockHeight, a.txindex, a.txhash, a.index, a.spending) <
+               std::tie(b.type, b.hashBytes, b.blockHeight, b.txindex, b.txhash, b.index, b.spending);
+    }
+};
+
+void CBlockTreeDB::UpdateAddressSummaries(CDBBatch &batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, int nSign) {
+    typedef std::pair<unsigned int, uint160> AddressKey;
+    std::map<AddressKey, CAddressSummaryValue> mapDeltas;
+    std::set<std::pair<AddressKey, uint256> > setTxs;
+    std::set<CAddressIndexKey, CAddressIndexKeyCompare> setKeys;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        // Only the entries that the batch adds or removes are counted, so that a block connected
+        // again after a crash, its entries already in the index, is not counted twice
+        if (!setKeys.insert(it->first).second || Exists(make_pair(DB_ADDRESSINDEX, it->first)) != (nSign < 0))
+            continue;
+        AddressKey address(it->first.type, it->first.hashBytes);
+        CAddressSummaryValue &delta = mapDeltas[address];
+        delta.balance += it->second;
+        if (it->second > 0)
+            delta.received += it->second;
+        if (setTxs.insert(make_pair(address, it->first.txhash)).second)
+            delta.txCount++;
+    }
+    for (std::map<AddressKey, CAddressSummaryValue>::const_iterator it = mapDeltas.begin(); it != mapDeltas.end(); it++) {
+        CAddressIndexIteratorKey summaryKey(it->first.first, it->first.second);
+        CAddressSummaryValue summary;
+        Read(make_pair(DB_ADDRESSSUMMARYINDEX, summaryKey), summary);
+        summary.balance += nSign * it->second.balance;
+        summary.received += nSign * it->second.received;
+        summary.txCount += nSign * it->second.txCount;
+        if (summary.IsNull())
+            batch.Erase(make_pair(DB_ADDRESSSUMMARYINDEX, summaryKey));
+        else
+            batch.Write(make_pair(DB_ADDRESSSUMMARYINDEX, summaryKey), summary);
+    }
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    UpdateAddressSummaries(batch, vect, 1);
     return WriteBatch(batch);
 }
 
@@ -388,6 +702,7 @@ bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKe
     CDBBatch batch(*this);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+    UpdateAddressSummaries(batch, vect, -1);
     return WriteBatch(batch);
 }
 
@@ -435,6 +750,184 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+static bool IsSameAddressIndexKey(const CAddressIndexKey &a, const CAddressIndexKey &b) {
+    return a.blockHeight == b.blockHeight && a.txindex == b.txindex && a.txhash == b.txhash &&
+           a.index == b.index && a.spending == b.spending;
+}
+
+bool CBlockTreeDB::ReadAddressIndexPage(uint160 addressHash, int type, const CAddressIndexKey *pafter, size_t nLimit,
+                                        std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int end) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pafter) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, *pafter));
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    size_t nRead = 0;
+    while (pcursor->Valid() && (nLimit == 0 || nRead < nLimit)) {
+        boost::this_thread::interruption_point();
+        pair<char, CAddressIndexKey> keyObj;
+        if (!pcursor->GetKey(keyObj) || keyObj.first != DB_ADDRESSINDEX)
+            break;
+        const CAddressIndexKey &indexKey = keyObj.second;
+        if (indexKey.type != (unsigned int)type || indexKey.hashBytes != addressHash)
+            break;
+        if (end > 0 && indexKey.blockHeight > end)
+            break;
+        if (pafter == NULL || !IsSameAddressIndexKey(indexKey, *pafter)) {
+            CAmount nValue;
+            if (!pcursor->GetValue(nValue))
+                return error("failed to get address index value");
+            addressIndex.push_back(make_pair(indexKey, nValue));
+            nRead++;
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentHeightKey *pafter, size_t nLimit,
+                                          std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pafter) {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTHEIGHTINDEX, *pafter));
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTHEIGHTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    size_t nRead = 0;
+    while (pcursor->Valid() && (nLimit == 0 || nRead < nLimit)) {
+        boost::this_thread::interruption_point();
+        pair<char, CAddressUnspentHeightKey> keyObj;
+        if (!pcursor->GetKey(keyObj) || keyObj.first != DB_ADDRESSUNSPENTHEIGHTINDEX)
+            break;
+        const CAddressUnspentHeightKey &heightKey = keyObj.second;
+        if (heightKey.type != (unsigned int)type || heightKey.hashBytes != addressHash)
+            break;
+        if (pafter == NULL || heightKey.blockHeight != pafter->blockHeight ||
+            heightKey.txhash != pafter->txhash || heightKey.index != pafter->index) {
+            CAddressUnspentValue value;
+            if (!pcursor->GetValue(value))
+                return error("failed to get address unspent value");
+            unspentOutputs.push_back(make_pair(CAddressUnspentKey(heightKey.type, heightKey.hashBytes, heightKey.txhash, heightKey.index), value));
+            nRead++;
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressSummary(uint160 addressHash, int type, CAddressSummaryValue &summary) {
+    // Addresses without history have no record
+    if (!Read(make_pair(DB_ADDRESSSUMMARYINDEX, CAddressIndexIteratorKey(type, addressHash)), summary))
+        summary.SetNull();
+    return true;
+}
+
+bool CBlockTreeDB::BuildAddressSummaryIndex() {
+    static const size_t BATCH_ENTRIES = 10000;
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBBatch> pbatch(new CDBBatch(*this));
+    size_t nBatchEntries = 0;
+    uint64_t nAddresses = 0, nUnspent = 0;
+
+    // Totals per address. The entries of an address are contiguous, and so are those of one of its transactions.
+    bool fHaveAddress = false;
+    CAddressIndexIteratorKey current;
+    CAddressSummaryValue summary;
+    uint256 lastTx;
+    pcursor->Seek(DB_ADDRESSINDEX);
+    while (true) {
+        boost::this_thread::interruption_point();
+        pair<char, CAddressIndexKey> keyObj;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(keyObj) && keyObj.first == DB_ADDRESSINDEX;
+        const CAddressIndexKey &indexKey = keyObj.second;
+        if (fHaveAddress && (!fValid || indexKey.type != current.type || indexKey.hashBytes != current.hashBytes)) {
+            pbatch->Write(make_pair(DB_ADDRESSSUMMARYINDEX, current), summary);
+            nAddresses++;
+            if (++nBatchEntries >= BATCH_ENTRIES) {
+                if (!WriteBatch(*pbatch))
+                    return error("%s: failed to write address summaries", __func__);
+                pbatch.reset(new CDBBatch(*this));
+                nBatchEntries = 0;
+            }
+            fHaveAddress = false;
+        }
+        if (!fValid)
+            break;
+        if (!fHaveAddress) {
+            current = CAddressIndexIteratorKey(indexKey.type, indexKey.hashBytes);
+            summary.SetNull();
+            lastTx.SetNull();
+            fHaveAddress = true;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: failed to get address index value", __func__);
+        summary.balance += nValue;
+        if (nValue > 0)
+            summary.received += nValue;
+        if (indexKey.txhash != lastTx) {
+            summary.txCount++;
+            lastTx = indexKey.txhash;
+        }
+        pcursor->Next();
+    }
+    if (!WriteBatch(*pbatch))
+        return error("%s: failed to write address summaries", __func__);
+    pbatch.reset(new CDBBatch(*this));
+    nBatchEntries = 0;
+
+    // Height ordered copies of the unspent outputs, and their count per address
+    int64_t nUtxos = 0;
+    pcursor->Seek(DB_ADDRESSUNSPENTINDEX);
+    while (true) {
+        boost::this_thread::interruption_point();
+        pair<char, CAddressUnspentKey> keyObj;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(keyObj) && keyObj.first == DB_ADDRESSUNSPENTINDEX;
+        const CAddressUnspentKey &unspentKey = keyObj.second;
+        if (fHaveAddress && (!fValid || unspentKey.type != current.type || unspentKey.hashBytes != current.hashBytes)) {
+            Read(make_pair(DB_ADDRESSSUMMARYINDEX, current), summary);
+            summary.utxoCount = nUtxos;
+            pbatch->Write(make_pair(DB_ADDRESSSUMMARYINDEX, current), summary);
+            nBatchEntries++;
+            fHaveAddress = false;
+        }
+        if (nBatchEntries >= BATCH_ENTRIES) {
+            if (!WriteBatch(*pbatch))
+                return error("%s: failed to write address unspent records", __func__);
+            pbatch.reset(new CDBBatch(*this));
+            nBatchEntries = 0;
+        }
+        if (!fValid)
+            break;
+        if (!fHaveAddress) {
+            current = CAddressIndexIteratorKey(unspentKey.type, unspentKey.hashBytes);
+            summary.SetNull();
+            nUtxos = 0;
+            fHaveAddress = true;
+        }
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to get address unspent value", __func__);
+        pbatch->Write(make_pair(DB_ADDRESSUNSPENTHEIGHTINDEX, CAddressUnspentHeightKey(unspentKey, value.blockHeight)), value);
+        nBatchEntries++;
+        nUtxos++;
+        nUnspent++;
+        pcursor->Next();
+    }
+    if (!WriteBatch(*pbatch))
+        return error("%s: failed to write address unspent records", __func__);
+
+    LogPrintf("%s: %u addresses, %u unspent outputs\n", __func__, nAddresses, nUnspent);
+    return true;
+}
+
 bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &address);
 
 UniValue CBlockTreeDB::Snapshot(int top)
@@ -30,6 +30,10 @@
 #include <vector>
 #include <univalue.h>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
 class CBlockFileInfo;
 class CBlockIndex;
 struct CDiskTxPos;
@@ -38,6 +42,8 @@ struct CAddressUnspentValue;
 struct CAddressIndexKey;
 struct CAddressIndexIteratorKey;
 struct CAddressIndexIteratorHeightKey;
+struct CAddressUnspentHeightKey;
+struct CAddressSummaryValue;
 struct CTimestampIndexKey;
 struct CTimestampIndexIteratorKey;
 struct CTimestampBlockIndexKey;
@@ -80,6 +86,84 @@ public:
     bool GetStats(CCoinsStats &stats) const;
 };
 
+/** Statistics about the background chainstate writer */
+struct CCoinsFlushStats
+{
+    uint64_t nFlushes;          //!< batches committed to the coin database
+    int64_t nLastFlushMicros;   //!< duration of the last database write
+    int64_t nWaitMicros;        //!< total time flushes spent waiting for the previous write
+    unsigned int nQueued;       //!< batches handed over but not yet committed (0 or 1)
+    size_t nPendingCoins;       //!< coin entries in the batch being written
+
+    CCoinsFlushStats() : nFlushes(0), nLastFlushMicros(0), nWaitMicros(0), nQueued(0), nPendingCoins(0) {}
+};
+
+/**
+ * Double buffer between the tip cache and the coin database.
+ *
+ * BatchWrite() takes over the flushed cache and returns; a background thread
+ * commits it to the base view as a single batch, so FlushStateToDisk() does
+ * not hold cs_main for the LevelDB write. Until the batch is committed, reads
+ * are answered from it. The batch carries the best block hash, so the
+ * database always describes a complete block: after a crash the node replays
+ * from whatever best block was last committed.
+ *
+ * At most one batch is in flight; a second BatchWrite() waits for the first.
+ * The base view must not modify the maps passed to its BatchWrite().
+ */
+class CCoinsViewFlushBuffer : public CCoinsViewBacked
+{
+private:
+    mutable boost::mutex cs;
+    boost::condition_variable condWriter;
+    mutable boost::condition_variable condFlushed;
+    boost::thread writerThread;
+
+    //! The batch in flight. Only replaced or cleared under cs while fPending is false.
+    CCoinsMap pendingCoins;
+    CAnchorsSproutMap pendingSproutAnchors;
+    CAnchorsSaplingMap pendingSaplingAnchors;
+    CNullifiersMap pendingSproutNullifiers;
+    CNullifiersMap pendingSaplingNullifiers;
+    uint256 pendingBestBlock;
+    uint256 pendingSproutAnchor;
+    uint256 pendingSaplingAnchor;
+
+    bool fPending;
+    bool fWriteFailed;
+    bool fShutdown;
+    CCoinsFlushStats flushStats;
+
+    void ThreadWriter();
+    //! Wait until no batch is in flight. Requires cs to be held by lock.
+    bool WaitIdle(boost::unique_lock<boost::mutex> &lock) const;
+
+public:
+    CCoinsViewFlushBuffer(CCoinsView *viewIn);
+    ~CCoinsViewFlushBuffer();
+
+    bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
+    bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
+    bool GetNullifier(const uint256 &nullifier, ShieldedType type) const;
+    bool GetCoins(const uint256 &txid, CCoins &coins) const;
+    bool HaveCoins(const uint256 &txid) const;
+    uint256 GetBestBlock() const;
+    uint256 GetBestAnchor(ShieldedType type) const;
+    bool BatchWrite(CCoinsMap &mapCoins,
+                    const uint256 &hashBlock,
+                    const uint256 &hashSproutAnchor,
+                    const uint256 &hashSaplingAnchor,
+                    CAnchorsSproutMap &mapSproutAnchors,
+                    CAnchorsSaplingMap &mapSaplingAnchors,
+                    CNullifiersMap &mapSproutNullifiers,
+                    CNullifiersMap &mapSaplingNullifiers);
+    bool GetStats(CCoinsStats &stats) const;
+
+    //! Block until the batch in flight (if any) is committed. Returns false if the write failed.
+    bool WaitForFlush() const;
+    CCoinsFlushStats GetFlushStats() const;
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -107,6 +191,14 @@ public:
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
+    //! Read up to nLimit (0: no limit) entries in height order, starting after *pafter or from the first one
+    bool ReadAddressIndexPage(uint160 addressHash, int type, const CAddressIndexKey *pafter, size_t nLimit,
+                              std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int end = 0);
+    bool ReadAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentHeightKey *pafter, size_t nLimit,
+                                std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+    bool ReadAddressSummary(uint160 addressHash, int type, CAddressSummaryValue &summary);
+    //! Build the summary and height-ordered unspent records from an address index that predates them
+    bool BuildAddressSummaryIndex();
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
@@ -116,6 +208,8 @@ public:
     bool LoadBlockIndexGuts();
     bool blockOnchainActive(const uint256 &hash);
     UniValue Snapshot(int top);
+private:
+    void UpdateAddressSummaries(CDBBatch &batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, int nSign);
 };
 
 #endif // BITCOIN_TXDB_H
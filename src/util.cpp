@@ -856,6 +856,22 @@ void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length) {
 #endif
 }
 
+/**
+ * this function asks the OS to start reading a range of a file into its page cache
+ * in the background, so that later reads from it do not block on the disk.
+ * it is advisory, and does nothing where no such hint is available
+ */
+void PrefetchFileRange(FILE *file, unsigned int offset, unsigned int length) {
+#if defined(MAC_OSX)
+    struct radvisory advice;
+    advice.ra_offset = (off_t)offset;
+    advice.ra_count = (int)length;
+    fcntl(fileno(file), F_RDADVISE, &advice);
+#elif defined(__linux__)
+    posix_fadvise(fileno(file), (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED);
+#endif
+}
+
 void ShrinkDebugFile()
 {
     // Scroll debug.log if it's getting too big
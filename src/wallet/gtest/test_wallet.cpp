@@ -1492,6 +1492,64 @@ TEST(WalletTests, CachedWitnessesCleanIndex) {
     }
 }
 
+TEST(WalletTests, CachedWitnessesPrunedForDeeplySpentNotes) {
+    TestWallet wallet;
+    std::vector<boost::optional<SproutWitness>> sproutWitnesses;
+    std::vector<boost::optional<SaplingWitness>> saplingWitnesses;
+
+    auto sk = libzcash::SproutSpendingKey::random();
+    wallet.AddSproutSpendingKey(sk);
+
+    auto wtx = GetValidReceive(sk, 10, true, 4);
+    auto note = GetNote(sk, wtx, 0, 1);
+    auto nullifier = note.nullifier(sk);
+
+    mapSproutNoteData_t noteData;
+    JSOutPoint jsoutpt {wtx.GetHash(), 0, 1};
+    SproutNoteData nd {sk.address(), nullifier};
+    noteData[jsoutpt] = nd;
+    wtx.SetSproutNoteData(noteData);
+    wallet.AddToWallet(wtx, true, NULL);
+
+    std::vector<JSOutPoint> sproutNotes {jsoutpt};
+    std::vector<SaplingOutPoint> saplingNotes;
+
+    // Receive the note in the first block and spend it in the second. The
+    // spend is deeper than the cache from block WITNESS_CACHE_SIZE + 1 on,
+    // and the next pruning pass is at block 2 * WITNESS_CACHE_SIZE.
+    size_t numBlocks = 2 * WITNESS_CACHE_SIZE + 2;
+    std::vector<CBlock> blocks(numBlocks);
+    std::vector<CBlockIndex> indices(numBlocks);
+    blocks[0].vtx.push_back(wtx);
+    auto wtx2 = GetValidSpend(sk, note, 5);
+    blocks[1].vtx.push_back(wtx2);
+    blocks[1].hashMerkleRoot = blocks[1].BuildMerkleTree();
+    auto blockHash = blocks[1].GetHash();
+    mapBlockIndex.insert(std::make_pair(blockHash, &indices[1]));
+    wtx2.SetMerkleBranch(blocks[1]);
+    wallet.AddToWallet(wtx2, true, NULL);
+
+    SproutMerkleTree sproutTree;
+    SaplingMerkleTree saplingTree;
+    for (size_t i = 0; i < numBlocks; i++) {
+        indices[i].SetHeight(i);
+        if (i > 0)
+            indices[i].pprev = &indices[i - 1];
+        wallet.IncrementNoteWitnesses(&indices[i], &blocks[i], sproutTree, saplingTree);
+
+        ::GetWitnessesAndAnchors(wallet, sproutNotes, saplingNotes, sproutWitnesses, saplingWitnesses);
+        // The witnesses are kept until the spend is deeper than the cache
+        if (i < 2 * WITNESS_CACHE_SIZE) {
+            EXPECT_TRUE((bool) sproutWitnesses[0]);
+        } else {
+            EXPECT_FALSE((bool) sproutWitnesses[0]);
+        }
+    }
+
+    // Tear down
+    mapBlockIndex.erase(blockHash);
+}
+
 TEST(WalletTests, ClearNoteWitnessCache) {
     TestWallet wallet;
 
@@ -3201,12 +3201,60 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
                 nInputs = params[2].get_int();
             }
             sample_times.push_back(benchmark_large_tx(nInputs));
+        } else if (benchmarktype == "verifysignatures") {
+            int nThreads = 4;
+            if (params.size() >= 3) {
+                nThreads = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_verify_signatures(nThreads, 1000));
         } else if (benchmarktype == "trydecryptnotes") {
             int nAddrs = params[2].get_int();
             sample_times.push_back(benchmark_try_decrypt_notes(nAddrs));
         } else if (benchmarktype == "incnotewitnesses") {
             int nTxs = params[2].get_int();
             sample_times.push_back(benchmark_increment_note_witnesses(nTxs));
+        } else if (benchmarktype == "coinscache") {
+            int nCoins = 100000;
+            if (params.size() >= 3) {
+                nCoins = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_coins_cache(nCoins));
+        } else if (benchmarktype == "blockjson") {
+            int nTxs = 1000;
+            if (params.size() >= 3) {
+                nTxs = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_block_json(nTxs));
+        } else if (benchmarktype == "rpcload") {
+            int nThreads = 8;
+            if (params.size() >= 3) {
+                nThreads = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_rpc_load(nThreads, 100000));
+        } else if (benchmarktype == "rpcbatch") {
+            int nCalls = 500;
+            if (params.size() >= 3) {
+                nCalls = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_rpc_batch(nCalls));
+        } else if (benchmarktype == "p2preplay") {
+            int nPeers = 8;
+            if (params.size() >= 3) {
+                nPeers = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_p2p_replay(nPeers, 100));
+        } else if (benchmarktype == "p2pconnections") {
+            int nPeers = 200;
+            if (params.size() >= 3) {
+                nPeers = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_p2p_connections(nPeers, 20));
+        } else if (benchmarktype == "blockserve") {
+            int nBlocks = 1000;
+            if (params.size() >= 3) {
+                nBlocks = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_block_serve(nBlocks));
         } else if (benchmarktype == "connectblockslow") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -6958,12 +7006,18 @@ UniValue diceinfo(const UniValue& params, bool fHelp)
 
 UniValue tokenlist(const UniValue& params, bool fHelp)
 {
-    uint256 tokenid;
-    if ( fHelp || params.size() > 0 )
-        throw runtime_error("tokenlist\n");
+    uint256 tokenid; int64_t count = -1, from = 0;
+    if ( fHelp || params.size() > 2 )
+        throw runtime_error("tokenlist [count] [from]\n");
     if ( ensure_CCrequirements() < 0 )
         throw runtime_error("to use CC contracts, you need to launch daemon with valid -pubkey= for an address in your wallet\n");
-    return(TokenList());
+    if ( params.size() > 0 )
+        count = params[0].get_int64();
+    if ( params.size() > 1 )
+        from = params[1].get_int64();
+    if ( count < 0 || from < 0 )
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count or from");
+    return(TokenList(count, from));
 }
 
 UniValue tokeninfo(const UniValue& params, bool fHelp)
@@ -6998,6 +7052,22 @@ UniValue tokenorders(const UniValue& params, bool fHelp)
     return(AssetOrders(tokenid));
 }
 
+UniValue mytokenorders(const UniValue& params, bool fHelp)
+{
+    uint256 tokenid;
+    if ( fHelp || params.size() > 1 )
+        throw runtime_error("mytokenorders [tokenid]\n");
+    if ( ensure_CCrequirements() < 0 )
+        throw runtime_error("to use CC contracts, you need to launch daemon with valid -pubkey= for an address in your wallet\n");
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    if (params.size() == 1) {
+        tokenid = Parseuint256((char *)params[0].get_str().c_str());
+        if (tokenid == zeroid)
+            throw runtime_error("incorrect tokenid\n");
+    }
+    return(AssetOrdersByPubkey(Mypubkey(), tokenid));
+}
+
 UniValue tokenbalance(const UniValue& params, bool fHelp)
 {
     UniValue result(UniValue::VOBJ); uint256 tokenid; uint64_t balance; std::vector<unsigned char> pubkey; struct CCcontract_info *cp,C;
@@ -7111,6 +7181,52 @@ UniValue tokentransfer(const UniValue& params, bool fHelp)
     return(result);
 }
 
+UniValue tokentransfermany(const UniValue& params, bool fHelp)
+{
+    UniValue result(UniValue::VOBJ),txids(UniValue::VARR); int64_t amount; uint256 tokenid; std::vector<CTransaction> txs;
+    std::vector< std::pair<std::vector<uint8_t>,int64_t> > outputs;
+    if ( fHelp || params.size() != 2 )
+        throw runtime_error("tokentransfermany tokenid [{\"pubkey\":destpubkey,\"amount\":amount},...]\n"
+                            "makes a transfer tx for each of the outputs, chained on the change of the one before, and sends them\n");
+    if ( ensure_CCrequirements() < 0 )
+        throw runtime_error("to use CC contracts, you need to launch daemon with valid -pubkey= for an address in your wallet\n");
+    const CKeyStore& keystore = *pwalletMain;
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    tokenid = Parseuint256((char *)params[0].get_str().c_str());
+    if ( tokenid == zeroid )
+    {
+        ERR_RESULT("invalid tokenid");
+        return(result);
+    }
+    UniValue array = params[1].get_array();
+    if ( array.size() == 0 )
+    {
+        ERR_RESULT("no outputs");
+        return(result);
+    }
+    for (size_t i=0; i<array.size(); i++)
+    {
+        const UniValue &o = array[i];
+        std::vector<unsigned char> pubkey(ParseHex(find_value(o,"pubkey").get_str().c_str()));
+        const UniValue &av = find_value(o,"amount");
+        amount = av.isNum() ? av.get_int64() : atoll(av.get_str().c_str());
+        if ( pubkey.size() != 33 || amount <= 0 )
+        {
+            ERR_RESULT(strprintf("invalid output.%d",(int32_t)i));
+            return(result);
+        }
+        outputs.push_back(std::make_pair(pubkey,amount));
+    }
+    txs = TokenTransferMany(0,tokenid,outputs);
+    BOOST_FOREACH(const CTransaction &tx,txs)
+        txids.push_back(tx.GetHash().GetHex());
+    if ( txs.size() == outputs.size() )
+        result.push_back(Pair("result", "success"));
+    else ERR_RESULT(strprintf("sent %d of %d transfers",(int32_t)txs.size(),(int32_t)outputs.size()));
+    result.push_back(Pair("txids", txids));
+    return(result);
+}
+
 UniValue tokenconvert(const UniValue& params, bool fHelp)
 {
     UniValue result(UniValue::VOBJ); std::string hex; int32_t evalcode; int64_t amount; uint256 tokenid;
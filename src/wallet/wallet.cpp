@@ -998,16 +998,72 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
     }
 }
 
-template<typename NoteDataMap>
-void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
+/**
+ * Extend the tree by one note commitment, recording the roots of the subtrees
+ * it completes so that cached witnesses can be brought up to date from the
+ * tree alone.
+ */
+template<typename Tree, typename SubtreeRoots>
+void AppendNoteCommitment(Tree& tree, const uint256& note_commitment, SubtreeRoots* roots)
+{
+    if (roots) {
+        auto completed = tree.completed_roots(note_commitment);
+        uint64_t position = tree.size();
+        for (size_t depth = 0; depth < completed.size(); depth++) {
+            (*roots)[std::make_pair(depth, position >> depth)] = completed[depth];
+        }
+    }
+    tree.append(note_commitment);
+}
+
+template<typename NoteDataMap, typename Tree, typename SubtreeRoots>
+void FastForwardNoteWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize,
+                              const Tree& frontier, const SubtreeRoots& roots)
 {
+    if (roots.empty())
+        return;
     for (auto& item : noteDataMap) {
         auto* nd = &(item.second);
         if (nd->witnessHeight < indexHeight && nd->witnesses.size() > 0) {
             // Check the validity of the cache
             // See comment in CopyPreviousWitnesses about validity.
             assert(nWitnessCacheSize >= nd->witnesses.size());
-            nd->witnesses.front().append(note_commitment);
+            nd->witnesses.front().fast_forward(frontier, roots);
+        }
+    }
+}
+
+/**
+ * Drop the cached witnesses of notes whose nullifier was revealed by a wallet
+ * transaction that is now deeper than the witness cache. Such notes can never
+ * be spent again, and no rewind we support can bring them back, so there is no
+ * reason to keep paying for their witnesses on every block. The nullifier
+ * lookups cost as much as the witnesses, so this runs every WITNESS_CACHE_SIZE
+ * blocks rather than on each one.
+ */
+template<typename NoteDataMap>
+void PruneSpentNoteWitnesses(NoteDataMap& noteDataMap, const CBlockIndex* pindex,
+                             const std::map<uint256, CWalletTx>& mapWallet,
+                             const std::multimap<uint256, uint256>& mapTxNullifiers)
+{
+    for (auto& item : noteDataMap) {
+        auto* nd = &(item.second);
+        if (nd->witnesses.empty() || !nd->nullifier || nd->witnessHeight >= pindex->GetHeight())
+            continue;
+        auto range = mapTxNullifiers.equal_range(*nd->nullifier);
+        for (auto it = range.first; it != range.second; ++it) {
+            auto mit = mapWallet.find(it->second);
+            if (mit == mapWallet.end() || mit->second.hashBlock.IsNull())
+                continue;
+            BlockMap::const_iterator mi = mapBlockIndex.find(mit->second.hashBlock);
+            if (mi == mapBlockIndex.end() || mi->second == NULL)
+                continue;
+            const CBlockIndex* pindexSpend = mi->second;
+            if (pindex->GetHeight() - pindexSpend->GetHeight() >= (int)WITNESS_CACHE_SIZE &&
+                pindex->GetAncestor(pindexSpend->GetHeight()) == pindexSpend) {
+                nd->witnesses.clear();
+                break;
+            }
         }
     }
 }
@@ -1042,6 +1098,34 @@ void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeigh
     }
 }
 
+/**
+ * A note of ours that was created in the block being connected, together with
+ * its witness at the point of creation.
+ */
+template<typename OutPoint, typename Witness>
+struct NewNoteWitness
+{
+    OutPoint outpoint;
+    Witness witness;
+
+    NewNoteWitness(const OutPoint& o, const Witness& w) : outpoint(o), witness(w) { }
+};
+
+template<typename OutPoint, typename NoteData, typename Witness, typename Tree>
+void WitnessNewNotes(std::map<uint256, CWalletTx>& mapWallet, std::map<OutPoint, NoteData> CWalletTx::* noteDataMap,
+                     int indexHeight, int64_t nWitnessCacheSize,
+                     const std::vector<NewNoteWitness<OutPoint, Witness>>& newNotes,
+                     const Tree& frontier, const typename Witness::SubtreeRoots& roots)
+{
+    for (const NewNoteWitness<OutPoint, Witness>& newNote : newNotes) {
+        std::map<OutPoint, NoteData>& noteData = mapWallet[newNote.outpoint.hash].*noteDataMap;
+        if (!noteData.count(newNote.outpoint) || noteData[newNote.outpoint].witnessHeight >= indexHeight)
+            continue;
+        ::WitnessNoteIfMine(noteData, indexHeight, nWitnessCacheSize, newNote.outpoint, newNote.witness);
+        noteData[newNote.outpoint].witnesses.front().fast_forward(frontier, roots);
+    }
+}
+
 
 template<typename NoteDataMap>
 void UpdateWitnessHeights(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize)
@@ -1063,15 +1147,6 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                      SaplingMerkleTree& saplingTree)
 {
     LOCK(cs_wallet);
-    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-       ::CopyPreviousWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
-       ::CopyPreviousWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize);
-    }
-
-    if (nWitnessCacheSize < WITNESS_CACHE_SIZE) {
-        nWitnessCacheSize += 1;
-    }
-
     const CBlock* pblock {pblockIn};
     CBlock block;
     if (!pblock) {
@@ -1079,6 +1154,33 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         pblock = &block;
     }
 
+    // Copy the cached witnesses forward a block, dropping those of notes
+    // spent deeper than the cache every WITNESS_CACHE_SIZE blocks.
+    bool fPruneSpent = pindex->GetHeight() % WITNESS_CACHE_SIZE == 0;
+    bool fHaveNotes = false;
+    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
+        if (fPruneSpent) {
+            ::PruneSpentNoteWitnesses(wtxItem.second.mapSproutNoteData, pindex, mapWallet, mapTxSproutNullifiers);
+            ::PruneSpentNoteWitnesses(wtxItem.second.mapSaplingNoteData, pindex, mapWallet, mapTxSaplingNullifiers);
+        }
+        ::CopyPreviousWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
+        ::CopyPreviousWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize);
+        fHaveNotes = fHaveNotes || !wtxItem.second.mapSproutNoteData.empty() || !wtxItem.second.mapSaplingNoteData.empty();
+    }
+
+    if (nWitnessCacheSize < WITNESS_CACHE_SIZE) {
+        nWitnessCacheSize += 1;
+    }
+
+    // Walk the block once, extending the commitment trees, recording the
+    // witnesses of any notes of ours that it creates and the roots of the
+    // subtrees it completes. Every cached witness is then fast-forwarded
+    // from those roots and the final trees, so the hashing is done once per
+    // commitment rather than once per commitment for every note we hold.
+    SproutWitness::SubtreeRoots sproutRoots;
+    SaplingWitness::SubtreeRoots saplingRoots;
+    std::vector<NewNoteWitness<JSOutPoint, SproutWitness>> newSproutNotes;
+    std::vector<NewNoteWitness<SaplingOutPoint, SaplingWitness>> newSaplingNotes;
     for (const CTransaction& tx : pblock->vtx) {
         auto hash = tx.GetHash();
         bool txIsOurs = mapWallet.count(hash);
@@ -1086,39 +1188,35 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         for (size_t i = 0; i < tx.vjoinsplit.size(); i++) {
             const JSDescription& jsdesc = tx.vjoinsplit[i];
             for (uint8_t j = 0; j < jsdesc.commitments.size(); j++) {
-                const uint256& note_commitment = jsdesc.commitments[j];
-                sproutTree.append(note_commitment);
-
-                // Increment existing witnesses
-                for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                    ::AppendNoteCommitment(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-                }
+                ::AppendNoteCommitment(sproutTree, jsdesc.commitments[j], fHaveNotes ? &sproutRoots : NULL);
 
                 // If this is our note, witness it
-                if (txIsOurs) {
-                    JSOutPoint jsoutpt {hash, i, j};
-                    ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                if (txIsOurs && mapWallet[hash].mapSproutNoteData.count(JSOutPoint {hash, i, j})) {
+                    newSproutNotes.emplace_back(JSOutPoint {hash, i, j}, sproutTree.witness());
                 }
             }
         }
         // Sapling
         for (uint32_t i = 0; i < tx.vShieldedOutput.size(); i++) {
-            const uint256& note_commitment = tx.vShieldedOutput[i].cm;
-            saplingTree.append(note_commitment);
-
-            // Increment existing witnesses
-            for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                ::AppendNoteCommitment(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-            }
+            ::AppendNoteCommitment(saplingTree, tx.vShieldedOutput[i].cm, fHaveNotes ? &saplingRoots : NULL);
 
             // If this is our note, witness it
-            if (txIsOurs) {
-                SaplingOutPoint outPoint {hash, i};
-                ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, outPoint, saplingTree.witness());
+            if (txIsOurs && mapWallet[hash].mapSaplingNoteData.count(SaplingOutPoint {hash, i})) {
+                newSaplingNotes.emplace_back(SaplingOutPoint {hash, i}, saplingTree.witness());
             }
         }
     }
 
+    // Increment existing witnesses
+    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
+        ::FastForwardNoteWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, sproutTree, sproutRoots);
+        ::FastForwardNoteWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, saplingTree, saplingRoots);
+    }
+
+    // Witness the notes created in this block
+    ::WitnessNewNotes(mapWallet, &CWalletTx::mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, newSproutNotes, sproutTree, sproutRoots);
+    ::WitnessNewNotes(mapWallet, &CWalletTx::mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, newSaplingNotes, saplingTree, saplingRoots);
+
     // Update witness heights
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
         ::UpdateWitnessHeights(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
@@ -2716,6 +2814,9 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
             if (pindex->GetHeight() % 100 == 0 && dProgressTip - dProgressStart > 0.0)
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
+            if ((pindex->GetHeight() - pindexStart->GetHeight()) % BLOCK_PREFETCH_WINDOW == 0)
+                PrefetchBlockRange(pindex->GetHeight(), pindex->GetHeight() + 2 * BLOCK_PREFETCH_WINDOW - 1);
+
             CBlock block;
             ReadBlockFromDisk(block, pindex,1);
             BOOST_FOREACH(CTransaction& tx, block.vtx)
@@ -165,6 +165,26 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
     }
 }
 
+template<size_t Depth, typename Hash>
+std::vector<Hash> IncrementalMerkleTree<Depth, Hash>::completed_roots(Hash obj) const {
+    std::vector<Hash> roots;
+    roots.push_back(obj);
+
+    // Only a right leaf closes a pair, and the pair closes every subtree
+    // above it whose left half is waiting in the parents.
+    if (left && !right) {
+        Hash combined = Hash::combine(*left, obj, 0);
+        roots.push_back(combined);
+
+        for (size_t i = 0; i < parents.size() && parents[i]; i++) {
+            combined = Hash::combine(*parents[i], combined, i+1);
+            roots.push_back(combined);
+        }
+    }
+
+    return roots;
+}
+
 // This is for allowing the witness to determine if a subtree has filled
 // to a particular depth, or for append() to ensure we're not appending
 // to a full tree.
@@ -348,6 +368,83 @@ void IncrementalWitness<Depth, Hash>::append(Hash obj) {
     }
 }
 
+// This finds the position of the first leaf after the filled subtrees, which
+// is where the cursor starts.
+template<size_t Depth, typename Hash>
+uint64_t IncrementalWitness<Depth, Hash>::next_position() const {
+    uint64_t position = tree.size();
+    size_t skip = filled.size();
+
+    // The filled subtrees take the empty slots in the order next_depth()
+    // hands them out.
+    if (!tree.left && skip) {
+        position += 1;
+        skip--;
+    }
+
+    if (!tree.right && skip) {
+        position += 1;
+        skip--;
+    }
+
+    size_t d = 1;
+
+    BOOST_FOREACH(const boost::optional<Hash>& parent, tree.parents) {
+        if (!parent && skip) {
+            position += uint64_t(1) << d;
+            skip--;
+        }
+
+        d++;
+    }
+
+    for (; skip; skip--, d++) {
+        position += uint64_t(1) << d;
+    }
+
+    return position;
+}
+
+template<size_t Depth, typename Hash>
+void IncrementalWitness<Depth, Hash>::fast_forward(const IncrementalMerkleTree<Depth, Hash>& frontier,
+                                                   const SubtreeRoots& roots) {
+    uint64_t size = frontier.size();
+    uint64_t next = next_position();
+
+    while (next < size) {
+        cursor_depth = tree.next_depth(filled.size());
+
+        if (cursor_depth >= Depth) {
+            throw std::runtime_error("tree is full");
+        }
+
+        uint64_t end = next + (uint64_t(1) << cursor_depth);
+
+        if (end > size) {
+            // The subtree is still filling, and what it holds so far is the
+            // low end of the frontier.
+            cursor = IncrementalMerkleTree<Depth, Hash>();
+            cursor->left = frontier.left;
+            cursor->right = frontier.right;
+            cursor->parents.assign(frontier.parents.begin(),
+                                   frontier.parents.begin() + std::min(frontier.parents.size(), cursor_depth - 1));
+            while (!cursor->parents.empty() && !cursor->parents.back()) {
+                cursor->parents.pop_back();
+            }
+            break;
+        }
+
+        typename SubtreeRoots::const_iterator it = roots.find(std::make_pair(cursor_depth, next >> cursor_depth));
+        if (it == roots.end()) {
+            throw std::runtime_error("subtree root is missing");
+        }
+
+        filled.push_back(it->second);
+        cursor = boost::none;
+        next = end;
+    }
+}
+
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
 
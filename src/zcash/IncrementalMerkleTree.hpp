@@ -3,6 +3,7 @@
 
 #include <array>
 #include <deque>
+#include <map>
 #include <boost/optional.hpp>
 #include <boost/static_assert.hpp>
 
@@ -101,6 +102,11 @@ public:
     size_t size() const;
 
     void append(Hash obj);
+
+    // The roots of the subtrees that appending obj would complete, indexed
+    // by depth; the first is the leaf itself.
+    std::vector<Hash> completed_roots(Hash obj) const;
+
     Hash root() const {
         return root(Depth, std::deque<Hash>());
     }
@@ -180,6 +186,16 @@ public:
 
     void append(Hash obj);
 
+    // Subtree roots keyed by depth and by index among the subtrees of
+    // that depth.
+    typedef std::map<std::pair<size_t, uint64_t>, Hash> SubtreeRoots;
+
+    // Bring the witness up to frontier, a later state of the tree it was
+    // taken from, without hashing: the subtrees completed since are looked
+    // up in roots, the one still filling is cut from the frontier.
+    void fast_forward(const IncrementalMerkleTree<Depth, Hash>& frontier,
+                      const SubtreeRoots& roots);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -201,6 +217,7 @@ private:
     boost::optional<IncrementalMerkleTree<Depth, Hash>> cursor;
     size_t cursor_depth = 0;
     std::deque<Hash> partial_path() const;
+    uint64_t next_position() const;
     IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) : tree(tree) {}
 };
 
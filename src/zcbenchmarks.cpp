@@ -1,6 +1,7 @@
 #include <cstdio>
 #include <future>
 #include <map>
+#include <atomic>
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
@@ -13,15 +14,22 @@
 #include "crypto/equihash.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
+#include "msgprepare.h"
+#include "net.h"
+#include "netbase.h"
+#include "random.h"
 #include "pow.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
+#include "txcache.h"
 #include "txdb.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
@@ -280,6 +288,71 @@ double benchmark_large_tx(size_t nInputs)
     return timer_stop(tv_start);
 }
 
+double benchmark_verify_signatures(int nThreads, size_t nInputs)
+{
+    // A notarization-like tx, each input spending a pay-to-pubkey output
+    CKey priv;
+    priv.MakeNewKey(true);
+    CBasicKeyStore tempKeystore;
+    tempKeystore.AddKey(priv);
+    CScript prevPubKey = CScript() << ToByteVector(priv.GetPubKey()) << OP_CHECKSIG;
+
+    CMutableTransaction funding_tx;
+    for (size_t i = 0; i < nInputs; i++) {
+        funding_tx.vout.push_back(CTxOut(10000, prevPubKey));
+    }
+    CTransaction final_funding_tx(funding_tx);
+    CCoins coins(final_funding_tx, 0);
+
+    CMutableTransaction spending_tx;
+    spending_tx.fOverwintered = true;
+    spending_tx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+    spending_tx.nVersion = SAPLING_TX_VERSION;
+    for (size_t i = 0; i < nInputs; i++) {
+        spending_tx.vin.emplace_back(final_funding_tx.GetHash(), i);
+    }
+    auto consensusBranchId = NetworkUpgradeInfo[Consensus::UPGRADE_SAPLING].nBranchId;
+    for (size_t i = 0; i < nInputs; i++) {
+        SignSignature(tempKeystore, prevPubKey, spending_tx, i, 10000, SIGHASH_ALL, consensusBranchId);
+    }
+    CTransaction final_spending_tx(spending_tx);
+    PrecomputedTransactionData txdata(final_spending_tx);
+
+    // Nothing is stored in the signature cache, so that each run verifies all of them
+    std::vector<CScriptCheck> vChecks;
+    for (size_t i = 0; i < nInputs; i++) {
+        vChecks.push_back(CScriptCheck(coins, final_spending_tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, false, consensusBranchId, &txdata));
+    }
+
+    // One by one, as the script checks of a tx do without the script check threads
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (size_t i = 0; i < nInputs; i++) {
+        assert(vChecks[i]());
+    }
+    double serialDuration = timer_stop(tv_start);
+
+    // On a check queue of its own with nThreads - 1 workers and the calling thread
+    CCheckQueue<CScriptCheck> queue(128);
+    boost::thread_group threadGroup;
+    for (int i = 1; i < nThreads; i++) {
+        threadGroup.create_thread(boost::bind(&CCheckQueue<CScriptCheck>::Thread, &queue));
+    }
+    timer_start(tv_start);
+    {
+        CCheckQueueControl<CScriptCheck> control(&queue);
+        control.Add(vChecks);
+        assert(control.Wait());
+    }
+    double duration = timer_stop(tv_start);
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    LogPrint("bench", "verifysignatures: %u signatures, %.0f sigs/s one by one, %.0f sigs/s on %d threads\n",
+        nInputs, nInputs / serialDuration, nInputs / duration, nThreads);
+    return duration;
+}
+
 double benchmark_try_decrypt_notes(size_t nAddrs)
 {
     CWallet wallet;
@@ -354,6 +427,537 @@ double benchmark_increment_note_witnesses(size_t nTxs)
     return timer_stop(tv_start);
 }
 
+// Backing view that can produce coins for any txid, standing in for the chainstate database
+class BenchmarkCoinsView : public CCoinsView {
+public:
+    bool GetCoins(const uint256 &txid, CCoins &coins) const {
+        CMutableTransaction mtx;
+        mtx.vout.resize(2 + txid.GetCheapHash() % 3);
+        for (size_t i = 0; i < mtx.vout.size(); i++) {
+            mtx.vout[i].nValue = 1000 + i;
+            mtx.vout[i].scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(txid.begin(), txid.begin() + 20))));
+        }
+        coins = CCoins(mtx, 1);
+        return true;
+    }
+
+    bool HaveCoins(const uint256 &txid) const {
+        return true;
+    }
+};
+
+// Runs an access pattern against a CCoinsViewCache, flushing whenever the cache
+// goes over nMaxUsage like FlushStateToDisk does; fKeepCapacity gives spent
+// outputs their memory back after each spend, which is how entries were
+// accounted before CCoins::Cleanup() shrank them
+static double RunCoinsCacheLoad(const std::vector<uint256>& txids, const std::vector<size_t>& accesses,
+                                size_t nMaxUsage, bool fKeepCapacity, std::string& strStats)
+{
+    BenchmarkCoinsView base;
+    CCoinsViewCache view(&base);
+    size_t nHits = 0, nFlushes = 0, nPeakUsage = 0, nPeakEntries = 0;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (size_t i = 0; i < accesses.size(); i++) {
+        const uint256& txid = txids[accesses[i]];
+        unsigned int nSize = view.GetCacheSize();
+        const CCoins* coins = view.AccessCoins(txid);
+        if (view.GetCacheSize() == nSize)
+            nHits++;
+        if (coins != NULL && (i % 4) == 0) {
+            // spend the last output, as most spends pop the tail
+            CCoinsModifier modifier = view.ModifyCoins(txid);
+            size_t nCapacity = modifier->vout.capacity();
+            if (!modifier->vout.empty())
+                modifier->Spend(modifier->vout.size() - 1);
+            if (fKeepCapacity)
+                modifier->vout.reserve(nCapacity);
+        }
+        size_t nUsage = view.DynamicMemoryUsage();
+        if (nUsage > nPeakUsage) {
+            nPeakUsage = nUsage;
+            nPeakEntries = view.GetCacheSize();
+        }
+        if (nUsage > nMaxUsage) {
+            view.Flush();
+            nFlushes++;
+        }
+    }
+    double duration = timer_stop(tv_start);
+
+    strStats = strprintf("hit rate %.3f, %u flushes, %.1f bytes per entry, %.3fs",
+        (double)nHits / accesses.size(), nFlushes, nPeakEntries ? (double)nPeakUsage / nPeakEntries : 0.0, duration);
+    return duration;
+}
+
+double benchmark_coins_cache(size_t nCoins)
+{
+    // Access a working set four times the size of what fits in the cache, with
+    // a skew towards a hot subset like block validation has, once as entries are
+    // accounted now and once keeping the capacity of spent outputs as before
+    std::vector<uint256> txids(4 * nCoins);
+    for (size_t i = 0; i < txids.size(); i++)
+        txids[i] = GetRandHash();
+    std::vector<size_t> accesses(8 * nCoins);
+    for (size_t i = 0; i < accesses.size(); i++) {
+        size_t r = GetRand(txids.size());
+        accesses[i] = (r * r) / txids.size();
+    }
+
+    std::string strShrink, strKeep;
+    double duration = RunCoinsCacheLoad(txids, accesses, nCoins * 256, false, strShrink);
+    RunCoinsCacheLoad(txids, accesses, nCoins * 256, true, strKeep);
+
+    LogPrint("bench", "coinscache: %u accesses; shrinking spent outputs: %s; keeping their capacity: %s\n",
+        accesses.size(), strShrink, strKeep);
+    return duration;
+}
+
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails);
+extern void blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, CJSONWriter& result);
+
+// Approximate heap usage of a UniValue tree
+static size_t UniValueUsage(const UniValue& val)
+{
+    size_t nUsage = sizeof(UniValue) + val.getValStr().capacity();
+    const std::vector<std::string>& keys = val.getKeys();
+    for (size_t i = 0; i < keys.size(); i++)
+        nUsage += sizeof(std::string) + keys[i].capacity();
+    for (size_t i = 0; i < val.size(); i++)
+        nUsage += UniValueUsage(val[i]);
+    return nUsage;
+}
+
+double benchmark_block_json(size_t nTxs)
+{
+    // A block of ordinary two-in two-out transactions, shown the way getblock <hash> 2 does
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 3 * COIN;
+    coinbase.vout[0].scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, 1))));
+    block.vtx.push_back(coinbase);
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(2);
+        mtx.vout.resize(2);
+        for (size_t j = 0; j < 2; j++) {
+            mtx.vin[j].prevout = COutPoint(GetRandHash(), j);
+            mtx.vin[j].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+            mtx.vout[j].nValue = 1000 + i;
+            mtx.vout[j].scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, j))));
+        }
+        block.vtx.push_back(mtx);
+    }
+
+    LOCK(cs_main);
+    const CBlockIndex* pindex = chainActive.LastTip();
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    UniValue value = blockToJSON(block, pindex, true);
+    size_t nValueUsage = UniValueUsage(value);
+    std::string strValue = value.write();
+    double valueDuration = timer_stop(tv_start);
+
+    timer_start(tv_start);
+    CJSONTextWriter writer;
+    writer.BeginObject();
+    blockToJSON(block, pindex, true, writer);
+    writer.EndObject();
+    double writerDuration = timer_stop(tv_start);
+
+    LogPrint("bench", "blockjson: %u bytes of json, %s; UniValue %.1f MB/s, %u bytes peak; writer %.1f MB/s, %u bytes peak\n",
+        strValue.size(), strValue == writer.str() ? "identical" : "DIFFERENT",
+        strValue.size() / valueDuration / 1e6, nValueUsage + strValue.capacity(),
+        writer.str().size() / writerDuration / 1e6, writer.str().capacity());
+    return writerDuration;
+}
+
+// Runs nCalls read-only RPCs spread over nThreads while another thread keeps
+// taking cs_main the way block validation does; fLockMain makes every call
+// hold cs_main as well, which is how these RPCs behaved before the chain snapshot
+static double RunRPCLoad(int nThreads, size_t nCalls, bool fLockMain)
+{
+    static const char* methods[] = {"getblockcount", "getbestblockhash", "getdifficulty", "getblockhash"};
+    UniValue paramsNone(UniValue::VARR), paramsHeight(UniValue::VARR);
+    paramsHeight.push_back(0);
+    std::atomic<bool> fDone(false);
+    std::atomic<size_t> nNext(0);
+
+    std::thread validator([&fDone]() {
+        while (!fDone) {
+            {
+                LOCK(cs_main);
+                MilliSleep(20);
+            }
+            MilliSleep(2);
+        }
+    });
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < nThreads; i++) {
+        workers.emplace_back([&]() {
+            size_t n;
+            while ((n = nNext++) < nCalls) {
+                const UniValue& params = (n % 4 == 3) ? paramsHeight : paramsNone;
+                if (fLockMain) {
+                    LOCK(cs_main);
+                    tableRPC.execute(methods[n % 4], params);
+                } else {
+                    tableRPC.execute(methods[n % 4], params);
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    double duration = timer_stop(tv_start);
+
+    fDone = true;
+    validator.join();
+    return duration;
+}
+
+double benchmark_rpc_load(int nThreads, size_t nCalls)
+{
+    double lockedDuration = RunRPCLoad(nThreads, nCalls, true);
+    double duration = RunRPCLoad(nThreads, nCalls, false);
+    LogPrint("bench", "rpcload: %u calls on %d threads, %.0f calls/s holding cs_main, %.0f calls/s from the chain snapshot\n",
+        nCalls, nThreads, nCalls / lockedDuration, nCalls / duration);
+    return duration;
+}
+
+double benchmark_rpc_batch(size_t nCalls)
+{
+    // A batch of verbose getrawtransaction calls for transactions of recent blocks, as indexers send
+    UniValue batch(UniValue::VARR);
+    {
+        LOCK(cs_main);
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex != NULL && batch.size() < nCalls; pindex = pindex->pprev) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, 1))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+            for (size_t i = 0; i < block.vtx.size() && batch.size() < nCalls; i++) {
+                UniValue params(UniValue::VARR);
+                params.push_back(block.vtx[i].GetHash().GetHex());
+                params.push_back(1);
+                UniValue req(UniValue::VOBJ);
+                req.push_back(Pair("method", "getrawtransaction"));
+                req.push_back(Pair("params", params));
+                req.push_back(Pair("id", (uint64_t)batch.size()));
+                batch.push_back(req);
+            }
+        }
+    }
+
+    // Both runs read every transaction from disk
+    txcache.Clear();
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::string strSerial = JSONRPCExecBatch(batch, 1);
+    double serialDuration = timer_stop(tv_start);
+
+    txcache.Clear();
+    timer_start(tv_start);
+    std::string strParallel = JSONRPCExecBatch(batch);
+    double duration = timer_stop(tv_start);
+
+    LogPrint("bench", "rpcbatch: %u calls, %.0f calls/s one at a time, %.0f calls/s in parallel, replies %s\n",
+        batch.size(), batch.size() / serialDuration, batch.size() / duration,
+        strSerial == strParallel ? "identical" : "DIFFERENT");
+    return duration;
+}
+
+/** Appends a message with its header, the way CNode::EndMessage() puts it on the wire */
+static void AppendWireMessage(std::vector<char>& vBytes, const char* pszCommand, const CDataStream& payload)
+{
+    CMessageHeader hdr(Params().MessageStart(), pszCommand, payload.size());
+    uint256 hash = Hash(payload.begin(), payload.end());
+    hdr.nChecksum = ReadLE32((unsigned char*)&hash);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hdr;
+    vBytes.insert(vBytes.end(), ss.begin(), ss.end());
+    vBytes.insert(vBytes.end(), payload.begin(), payload.end());
+}
+
+/** Feeds the same traffic to nPeers unconnected peers and processes it round robin, like ThreadMessageHandler */
+static double RunP2PReplay(const std::vector<char>& vBytes, int nPeers)
+{
+    std::vector<CNode*> vPeers;
+    for (int i = 0; i < nPeers; i++) {
+        CNode* pnode = new CNode(INVALID_SOCKET, CAddress(), "replay", true);
+        pnode->nVersion = PROTOCOL_VERSION;
+        pnode->fSuccessfullyConnected = true;
+        LOCK(pnode->cs_vRecvMsg);
+        pnode->SetRecvVersion(PROTOCOL_VERSION);
+        pnode->ReceiveMsgBytes(&vBytes[0], vBytes.size());
+        vPeers.push_back(pnode);
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    bool fBusy = true;
+    while (fBusy) {
+        fBusy = false;
+        BOOST_FOREACH(CNode* pnode, vPeers) {
+            LOCK(pnode->cs_vRecvMsg);
+            if (pnode->fDisconnect || pnode->vRecvMsg.empty())
+                continue;
+            if (!ProcessMessages(pnode))
+                pnode->fDisconnect = true;
+            fBusy = true;
+        }
+    }
+    double duration = timer_stop(tv_start);
+
+    BOOST_FOREACH(CNode* pnode, vPeers)
+        delete pnode;
+    return duration;
+}
+
+double benchmark_p2p_replay(int nPeers, int nBlocks)
+{
+    // Each peer announces the headers of recent blocks, then sends the blocks
+    // with the mempool transactions relayed in between
+    std::vector<char> vBytes;
+    std::vector<uint256> vTxid;
+    mempool.queryHashes(vTxid);
+    size_t nTx = 0, nMessages = 0;
+    {
+        LOCK(cs_main);
+        std::vector<CBlockIndex*> vIndex;
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex != NULL && (int)vIndex.size() < std::min(nBlocks, (int)MAX_HEADERS_RESULTS); pindex = pindex->pprev)
+            vIndex.push_back(pindex);
+        std::reverse(vIndex.begin(), vIndex.end());
+        if (vIndex.empty())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "No blocks to replay");
+
+        CDataStream headers(SER_NETWORK, PROTOCOL_VERSION);
+        WriteCompactSize(headers, vIndex.size());
+        BOOST_FOREACH(CBlockIndex* pindex, vIndex) {
+            headers << pindex->GetBlockHeader();
+            WriteCompactSize(headers, 0);
+        }
+        AppendWireMessage(vBytes, "headers", headers);
+        nMessages++;
+
+        BOOST_FOREACH(CBlockIndex* pindex, vIndex) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, 1))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << block;
+            AppendWireMessage(vBytes, "block", ss);
+            nMessages++;
+            for (size_t i = 0; i < vTxid.size() / vIndex.size() + 1 && nTx < vTxid.size(); nTx++) {
+                CTransaction tx;
+                if (!mempool.lookup(vTxid[nTx], tx))
+                    continue;
+                CDataStream sstx(SER_NETWORK, PROTOCOL_VERSION);
+                sstx << tx;
+                AppendWireMessage(vBytes, "tx", sstx);
+                nMessages++;
+                i++;
+            }
+        }
+    }
+
+    int nPrevThreads = GetMessagePreparationThreads();
+    int nThreads = nPrevThreads > 0 ? nPrevThreads : DEFAULT_MSG_PREPARE_THREADS;
+
+    // Both runs verify every solution
+    StopMessagePreparation();
+    ClearEquihashCache();
+    double inlineDuration = RunP2PReplay(vBytes, nPeers);
+
+    StartMessagePreparation(nThreads);
+    ClearEquihashCache();
+    double duration = RunP2PReplay(vBytes, nPeers);
+
+    if (nPrevThreads > 0)
+        StartMessagePreparation(nPrevThreads);
+    else
+        StopMessagePreparation();
+
+    LogPrint("bench", "p2preplay: %d peers, %u messages (%u bytes) each, %.0f messages/s inline, %.0f messages/s with %d preparation threads\n",
+        nPeers, nMessages, vBytes.size(), nPeers * nMessages / inlineDuration, nPeers * nMessages / duration, nThreads);
+    return duration;
+}
+
+/** A loopback peer of the connection benchmark, speaking just enough of the protocol */
+class CBenchPeer
+{
+public:
+    SOCKET hSocket;
+    std::vector<char> vRecv;
+
+    CBenchPeer() : hSocket(INVALID_SOCKET) {}
+    ~CBenchPeer() { if (hSocket != INVALID_SOCKET) CloseSocket(hSocket); }
+
+    /** Connects from its own loopback address, as a node takes only a few connections per address */
+    bool Connect(int n, unsigned short nPort)
+    {
+        hSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (hSocket == INVALID_SOCKET)
+            return false;
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(0x7f000000 | ((n / 250 + 1) << 8) | (n % 250 + 1));
+        bind(hSocket, (struct sockaddr*)&addr, sizeof(addr));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(nPort);
+        if (connect(hSocket, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR)
+            return false;
+#ifdef _WIN32
+        DWORD nTimeout = 30000;
+#else
+        struct timeval nTimeout = MillisToTimeval(30000);
+#endif
+        setsockopt(hSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&nTimeout, sizeof(nTimeout));
+        return true;
+    }
+
+    bool Send(const char* pszCommand, const CDataStream& payload)
+    {
+        std::vector<char> vBytes;
+        AppendWireMessage(vBytes, pszCommand, payload);
+        for (size_t nSent = 0; nSent < vBytes.size(); ) {
+            int nBytes = send(hSocket, &vBytes[nSent], vBytes.size() - nSent, MSG_NOSIGNAL);
+            if (nBytes <= 0)
+                return false;
+            nSent += nBytes;
+        }
+        return true;
+    }
+
+    /** Reads until a message with the command arrives, skipping the others */
+    bool WaitFor(const std::string& strCommand)
+    {
+        while (true) {
+            if (vRecv.size() >= CMessageHeader::HEADER_SIZE) {
+                CDataStream ss(&vRecv[0], &vRecv[0] + CMessageHeader::HEADER_SIZE, SER_NETWORK, PROTOCOL_VERSION);
+                CMessageHeader hdr(Params().MessageStart());
+                ss >> hdr;
+                size_t nSize = CMessageHeader::HEADER_SIZE + hdr.nMessageSize;
+                if (vRecv.size() >= nSize) {
+                    vRecv.erase(vRecv.begin(), vRecv.begin() + nSize);
+                    if (hdr.GetCommand() == strCommand)
+                        return true;
+                    continue;
+                }
+            }
+            char pchBuf[0x10000];
+            int nBytes = recv(hSocket, pchBuf, sizeof(pchBuf), 0);
+            if (nBytes <= 0)
+                return false;
+            vRecv.insert(vRecv.end(), pchBuf, pchBuf + nBytes);
+        }
+    }
+};
+
+double benchmark_p2p_connections(int nPeers, int nRounds)
+{
+    if (!fListen)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Benchmark needs the node to listen");
+    {
+        LOCK(cs_vNodes);
+        // Stay clear of the inbound limit, which would evict real peers
+        if ((int)vNodes.size() + nPeers + 16 > nMaxConnections)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Raise -maxconnections to benchmark this many peers");
+    }
+
+    // Connect everyone and wait for all of the handshakes
+    std::vector<std::shared_ptr<CBenchPeer> > vPeers;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int i = 0; i < nPeers; i++) {
+        std::shared_ptr<CBenchPeer> peer = std::make_shared<CBenchPeer>();
+        CDataStream version(SER_NETWORK, INIT_PROTO_VERSION);
+        version << PROTOCOL_VERSION << (uint64_t)0 << GetTime() << CAddress() << CAddress()
+                << GetRand(std::numeric_limits<uint64_t>::max()) << std::string("/bench/") << 0 << false;
+        if (!peer->Connect(i, GetListenPort()) || !peer->Send("version", version))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("Can't connect loopback peer %d", i));
+        vPeers.push_back(peer);
+    }
+    BOOST_FOREACH(std::shared_ptr<CBenchPeer>& peer, vPeers) {
+        if (!peer->WaitFor("verack") || !peer->Send("verack", CDataStream(SER_NETWORK, PROTOCOL_VERSION)))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Handshake with loopback peer failed");
+    }
+    double connectDuration = timer_stop(tv_start);
+
+    // Then every peer pings at once, a round at a time
+    timer_start(tv_start);
+    for (int nRound = 0; nRound < nRounds; nRound++) {
+        CDataStream ping(SER_NETWORK, PROTOCOL_VERSION);
+        ping << (uint64_t)(nRound + 1);
+        BOOST_FOREACH(std::shared_ptr<CBenchPeer>& peer, vPeers) {
+            if (!peer->Send("ping", ping))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Sending to loopback peer failed");
+        }
+        BOOST_FOREACH(std::shared_ptr<CBenchPeer>& peer, vPeers) {
+            if (!peer->WaitFor("pong"))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Loopback peer got no pong");
+        }
+    }
+    double duration = timer_stop(tv_start);
+
+    LogPrint("bench", "p2pconnections: %d loopback peers, handshakes in %.3fs, %.0f pings/s over %d rounds\n",
+        nPeers, connectDuration, nPeers * nRounds / duration, nRounds);
+    return duration;
+}
+
+double benchmark_block_serve(int nBlocks)
+{
+    // Serve the last nBlocks blocks of the chain the way getdata did before and does now
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* pindex = chainActive.Tip(); pindex && (int)vIndex.size() < nBlocks; pindex = pindex->pprev)
+            if (pindex->nStatus & BLOCK_HAVE_DATA)
+                vIndex.push_back(pindex);
+    }
+    if (vIndex.empty())
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No blocks on disk");
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    size_t nBytes = 0;
+    BOOST_FOREACH(const CBlockIndex* pindex, vIndex) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, 1))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block;
+        nBytes += ss.size();
+    }
+    double reserializeDuration = timer_stop(tv_start);
+
+    double rawDuration[2];
+    for (int i = 0; i < 2; i++) {
+        timer_start(tv_start);
+        BOOST_FOREACH(const CBlockIndex* pindex, vIndex) {
+            CRawBlockRef pblock;
+            if (!ReadRawBlock(pindex, pblock))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read raw block from disk");
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << CFlatData((void*)pblock->data(), (void*)(pblock->data() + pblock->size()));
+        }
+        rawDuration[i] = timer_stop(tv_start);
+    }
+
+    LogPrint("bench", "blockserve: %u blocks, %u bytes; reserialized %.1f MB/s, raw %.1f MB/s, raw cached %.1f MB/s\n",
+        vIndex.size(), nBytes, nBytes / reserializeDuration / 1e6, nBytes / rawDuration[0] / 1e6, nBytes / rawDuration[1] / 1e6);
+    return rawDuration[0];
+}
+
 // Fake the input of a given block
 class FakeCoinsViewDB : public CCoinsViewDB {
     uint256 hash;
@@ -13,8 +13,16 @@ extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
 extern double benchmark_large_tx(size_t nInputs);
+extern double benchmark_verify_signatures(int nThreads, size_t nInputs);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
+extern double benchmark_coins_cache(size_t nCoins);
+extern double benchmark_block_json(size_t nTxs);
+extern double benchmark_rpc_load(int nThreads, size_t nCalls);
+extern double benchmark_rpc_batch(size_t nCalls);
+extern double benchmark_p2p_replay(int nPeers, int nBlocks);
+extern double benchmark_p2p_connections(int nPeers, int nRounds);
+extern double benchmark_block_serve(int nBlocks);
 extern double benchmark_connectblock_slow();
 extern double benchmark_sendtoaddress(CAmount amount);
 extern double benchmark_loadwallet();